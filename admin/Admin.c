@@ -16,6 +16,7 @@
 #include "benc/String.h"
 #include "benc/Int.h"
 #include "benc/Dict.h"
+#include "benc/List.h"
 #include "benc/serialization/standard/BencMessageWriter.h"
 #include "benc/serialization/standard/BencMessageReader.h"
 #include "memory/Allocator.h"
@@ -46,6 +47,12 @@ static String* TXID =     String_CONST_SO("txid");
 /** Number of milliseconds before a session times out and outgoing messages are failed. */
 #define TIMEOUT_MILLISECONDS 30000
 
+/** Stop asking a function for more pages after this many, in case it never stops saying "more". */
+#define BATCH_MAX_PAGES 16384
+
+/** Room in each batch response for everything except the results. */
+#define BATCH_OVERHEAD 64
+
 /** map values for tracking time of last message by source address */
 struct MapValue
 {
@@ -84,6 +91,26 @@ struct Function
     Dict* args;
 };
 
+/** State of an Admin_batch() call while the calls which are in it are running. */
+struct Batch
+{
+    /** Replies to this txid are results of the batch, it is the txid of the Admin_batch() call. */
+    String* txid;
+
+    /** The index of the call which is running. */
+    int call;
+
+    /** Set if the last reply of the running call contained "more". */
+    bool more;
+
+    /** Encoded results which have not yet been sent. */
+    uint8_t* results;
+    int32_t resultsLen;
+
+    /** The most bytes of results which fit in one response. */
+    int32_t maxResultsLen;
+};
+
 struct Admin_pvt
 {
     struct Admin pub;
@@ -108,6 +135,12 @@ struct Admin_pvt
     /** non-zero if this session able to receive asynchronous messages. */
     int asyncEnabled;
 
+    /** True if the request which is being handled was authenticated. */
+    bool currentAuthed;
+
+    /** non-null while the calls of an Admin_batch() are running. */
+    struct Batch* batch;
+
     struct Message* tempSendMsg;
 
     Identity
@@ -166,12 +199,73 @@ static void clearExpiredAddresses(void* vAdmin)
     Log_debug(admin->logger, "Cleared [%d] expired sessions", count);
 }
 
+/**
+ * Send the results of an Admin_batch() which have been collected so far.
+ *
+ * @param more true if there will be another response after this one.
+ */
+static void sendBatchResults(struct Admin_pvt* admin, struct Batch* batch, bool more)
+{
+    struct Allocator* alloc = admin->currentRequest->alloc;
+    struct Sockaddr* addr = Sockaddr_clone((struct Sockaddr*) batch->txid->bytes, alloc);
+    uint32_t userTxidLen = batch->txid->len - addr->addrLen;
+
+    // Keys in benc dictionaries are sorted: more, results, txid
+    char txidPrefix[32];
+    snprintf(txidPrefix, 32, "4:txid%u:", userTxidLen);
+    char* resultsPrefix = (more) ? "d4:morei1e7:resultsl" : "d7:resultsl";
+
+    uint32_t len = CString_strlen(resultsPrefix) + batch->resultsLen + 1 +
+        ((userTxidLen) ? CString_strlen(txidPrefix) + userTxidLen : 0) + 1;
+    struct Message* msg = Message_new(0, len + addr->addrLen + 32, alloc);
+    Er_assert(Message_epush(msg, "e", 1));
+    if (userTxidLen) {
+        Er_assert(Message_epush(msg, &batch->txid->bytes[addr->addrLen], userTxidLen));
+        Er_assert(Message_epush(msg, txidPrefix, CString_strlen(txidPrefix)));
+    }
+    Er_assert(Message_epush(msg, "e", 1));
+    Er_assert(Message_epush(msg, batch->results, batch->resultsLen));
+    Er_assert(Message_epush(msg, resultsPrefix, CString_strlen(resultsPrefix)));
+    sendMessage(msg, addr, admin);
+    batch->resultsLen = 0;
+}
+
+/** Add a reply of one of the calls in an Admin_batch() to the results. */
+static void addBatchResult(struct Admin_pvt* admin, struct Batch* batch, Dict* message)
+{
+    struct Allocator* alloc = admin->currentRequest->alloc;
+    batch->more = Dict_getIntC(message, "more") != NULL;
+    Dict_putIntC(message, "call", batch->call, alloc);
+    Message_reset(admin->tempSendMsg);
+    Er_assert(BencMessageWriter_write(message, admin->tempSendMsg));
+    Dict_remove(message, String_CONST("call"));
+    struct Message* result = admin->tempSendMsg;
+    if (result->length > batch->maxResultsLen) {
+        // Too big to ever fit, the caller will have to call the function without batching it.
+        Dict* err = Dict_new(alloc);
+        Dict_putIntC(err, "call", batch->call, alloc);
+        Dict_putStringCC(err, "error", "response_too_big", alloc);
+        Message_reset(result);
+        Er_assert(BencMessageWriter_write(err, result));
+        batch->more = false;
+    }
+    if (batch->resultsLen + result->length > batch->maxResultsLen) {
+        sendBatchResults(admin, batch, true);
+    }
+    Bits_memcpy(&batch->results[batch->resultsLen], result->bytes, result->length);
+    batch->resultsLen += result->length;
+}
+
 static int sendMessage0(Dict* message, String* txid, struct Admin* adminPub, int fd)
 {
     struct Admin_pvt* admin = Identity_check((struct Admin_pvt*) adminPub);
     if (!admin) {
         return 0;
     }
+    if (admin->batch && txid == admin->batch->txid && fd < 0) {
+        addBatchResult(admin, admin->batch, message);
+        return 0;
+    }
     Assert_true(txid && txid->len >= sizeof(struct Sockaddr));
     uint16_t addrLen = 0;
     Bits_memcpy(&addrLen, txid->bytes, 2);
@@ -288,6 +382,90 @@ static bool checkArgs(Dict* args,
     return !error;
 }
 
+static void callFunction(String* query,
+                         Dict* args,
+                         String* txid,
+                         struct Allocator* requestAlloc,
+                         struct Admin_pvt* admin)
+{
+    bool noFunctionsCalled = true;
+    for (int i = 0; i < admin->functionCount; i++) {
+        if (String_equals(query, admin->functions[i].name)
+            && (admin->currentAuthed || !admin->functions[i].needsAuth))
+        {
+            if (checkArgs(args, &admin->functions[i], txid, requestAlloc, admin)) {
+                uint64_t begin = EventBase_traceBegin(admin->eventBase);
+                admin->functions[i].call(args, admin->functions[i].context, txid, requestAlloc);
+                EventBase_traceEnd(admin->eventBase, "admin", admin->functions[i].name->bytes,
+                                   0, begin);
+            }
+            noFunctionsCalled = false;
+        }
+    }
+
+    if (noFunctionsCalled) {
+        Dict d = Dict_CONST(
+            String_CONST("error"),
+            String_OBJ(String_CONST("No functions matched your request, "
+                                    "try Admin_availableFunctions()")),
+            NULL
+        );
+        Admin_sendMessage(&d, txid, &admin->pub);
+    }
+}
+
+/**
+ * Call a list of functions and send all of their replies in one response, or as few as possible
+ * if they do not fit. A call with allPages is repeated with page 0, 1, 2... for as long as the
+ * reply contains "more" so a whole table can be read with one request.
+ */
+static void batch(Dict* args, void* vAdmin, String* txid, struct Allocator* requestAlloc)
+{
+    struct Admin_pvt* admin = Identity_check((struct Admin_pvt*) vAdmin);
+    if (admin->batch) {
+        Dict d = Dict_CONST(String_CONST("error"), String_OBJ(String_CONST("nested_batch")), NULL);
+        Admin_sendMessage(&d, txid, &admin->pub);
+        return;
+    }
+    struct Batch b = {
+        .txid = txid,
+        .results = Allocator_malloc(requestAlloc, Admin_MAX_RESPONSE_SIZE),
+        .maxResultsLen = Admin_MAX_RESPONSE_SIZE - BATCH_OVERHEAD - txid->len
+    };
+    admin->batch = &b;
+
+    List* calls = Dict_getListC(args, "calls");
+    int count = List_size(calls);
+    for (b.call = 0; b.call < count; b.call++) {
+        // BencMessageReader puts the items of a list in reverse order.
+        Dict* call = List_getDict(calls, count - 1 - b.call);
+        String* query = (call) ? Dict_getStringC(call, "q") : NULL;
+        if (!query) {
+            Dict d = Dict_CONST(String_CONST("error"), String_OBJ(String_CONST("no_q")), NULL);
+            Admin_sendMessage(&d, txid, &admin->pub);
+            continue;
+        }
+        int64_t* allPages = Dict_getIntC(call, "allPages");
+        Dict* callArgs = Dict_getDictC(call, "args");
+        if (allPages && *allPages && !callArgs) {
+            callArgs = Dict_new(requestAlloc);
+        }
+        for (int page = 0; page < BATCH_MAX_PAGES; page++) {
+            struct Allocator* callAlloc = Allocator_child(requestAlloc);
+            if (allPages && *allPages) {
+                Dict_putIntC(callArgs, "page", page, requestAlloc);
+            }
+            b.more = false;
+            callFunction(query, callArgs, txid, callAlloc, admin);
+            Allocator_free(callAlloc);
+            if (!allPages || !*allPages || !b.more) { break; }
+        }
+    }
+
+    admin->batch = NULL;
+    sendBatchResults(admin, &b, false);
+}
+
 static void asyncEnabled(Dict* args, void* vAdmin, String* txid, struct Allocator* requestAlloc)
 {
     struct Admin_pvt* admin = Identity_check((struct Admin_pvt*) vAdmin);
@@ -389,29 +567,9 @@ static void handleRequest(Dict* messageDict,
     }
 
     Dict* args = Dict_getDictC(messageDict, "args");
-    bool noFunctionsCalled = true;
-    for (int i = 0; i < admin->functionCount; i++) {
-        if (String_equals(query, admin->functions[i].name)
-            && (authed || !admin->functions[i].needsAuth))
-        {
-            if (checkArgs(args, &admin->functions[i], txid, message->alloc, admin)) {
-                admin->functions[i].call(args, admin->functions[i].context, txid, message->alloc);
-            }
-            noFunctionsCalled = false;
-        }
-    }
-
-    if (noFunctionsCalled) {
-        Dict d = Dict_CONST(
-            String_CONST("error"),
-            String_OBJ(String_CONST("No functions matched your request, "
-                                    "try Admin_availableFunctions()")),
-            NULL
-        );
-        Admin_sendMessage(&d, txid, &admin->pub);
-    }
-
-    return;
+    admin->currentAuthed = authed;
+    callFunction(query, args, txid, message->alloc, admin);
+    admin->currentAuthed = false;
 }
 
 static void handleMessage(struct Message* message,
@@ -589,6 +747,10 @@ struct Admin* Admin_new(struct AddrIface* ai,
         ((struct Admin_FunctionArg[]) {
             { .name = "page", .required = 0, .type = "Int" }
         }), &admin->pub);
+    Admin_registerFunction("Admin_batch", batch, admin, false,
+        ((struct Admin_FunctionArg[]) {
+            { .name = "calls", .required = 1, .type = "List" }
+        }), &admin->pub);
     Admin_registerFunction("Admin_importFd", importFd, admin, true, NULL, &admin->pub);
     Admin_registerFunction("Admin_exportFd", exportFd, admin, true,
         ((struct Admin_FunctionArg[]) {
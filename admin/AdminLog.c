@@ -24,6 +24,9 @@
 #include "memory/BufferAllocator.h"
 #include "util/log/Log.h"
 #include "util/log/Log_impl.h"
+#include "util/Bits.h"
+#include "util/CString.h"
+#include "util/Endian.h"
 #include "util/Hex.h"
 #include "util/Identity.h"
 #include "util/events/Time.h"
@@ -32,6 +35,31 @@
 #define MAX_SUBSCRIPTIONS 64
 #define FILE_NAME_COUNT 32
 
+/** Binary subscriptions get their records in batches of at most this many bytes. */
+#define BATCH_SIZE 16384
+
+/** Batches which are not full are sent this often. */
+#define FLUSH_MILLISECONDS 100
+
+/** Call sites are numbered from 1, 0 is the record which defines a call site. */
+#define MAX_CALL_SITES 8192
+
+#define RECORD_HEADER_SIZE 8
+#define MAX_ARGS_SIZE 2048
+#define MAX_STRING_ARG 1024
+
+/** Number, level and line then file and format. */
+#define DEFINITION_SIZE (9 * 3 + (3 + MAX_STRING_ARG) * 2)
+
+/** A place in the code which logs, identified by the pointers which it passes to doLog(). */
+struct CallSite
+{
+    const char* format;
+    const char* file;
+    int line;
+    enum Log_Level level;
+};
+
 struct Subscription
 {
     /** The log level to match against, all higher levels will also be matched. */
@@ -60,6 +88,20 @@ struct Subscription
 
     /** An allocator which will live during the lifecycle of the Subscription */
     struct Allocator* alloc;
+
+    /** True if the subscriber gets batches of binary records, see AdminLog.h. */
+    bool binary;
+
+    /** Records which have not yet been sent. */
+    uint8_t* batch;
+    uint32_t batchLen;
+    uint32_t batchRecords;
+
+    /** Time in milliseconds of the first record in the batch, records have an offset from it. */
+    uint64_t batchTime;
+
+    /** One bit per call site which has already been defined to this subscriber. */
+    uint8_t* defined;
 };
 
 struct AdminLog
@@ -73,6 +115,13 @@ struct AdminLog
 
     struct Timeout* unpause;
 
+    /** Interned call sites, by number and in a hash table of numbers, allocated on first use. */
+    struct CallSite* callSites;
+    uint16_t* callSiteTable;
+    int callSiteCount;
+
+    struct Timeout* flush;
+
     struct Admin* admin;
     struct Allocator* alloc;
     struct Random* rand;
@@ -157,7 +206,8 @@ static void unpause(void* vAdminLog)
     bool noneDropped = true;
     for (int i = log->subscriptionCount - 1; i >= 0; i--) {
         int dropped = log->subscriptions[i].dropped;
-        if (!dropped) { continue; }
+        // Binary subscriptions report what they dropped in the next batch.
+        if (!dropped || log->subscriptions[i].binary) { continue; }
         noneDropped = false;
         log->subscriptions[i].dropped = 0;
         Log_warn((struct Log*) log,
@@ -173,6 +223,265 @@ static void unpause(void* vAdminLog)
     }
 }
 
+/** Same as String_vprintf() but without the newline at the end, if any. */
+static String* formatMessage(const char* format, va_list args, struct Allocator* alloc)
+{
+    va_list argsCopy;
+    va_copy(argsCopy, args);
+    String* message = String_vprintf(alloc, format, argsCopy);
+    va_end(argsCopy);
+    // Strip all of the annoying \n marks in the log entries.
+    if (message->len > 0 && message->bytes[message->len - 1] == '\n') {
+        message->len--;
+    }
+    return message;
+}
+
+static int putInt(uint8_t* out, int max, uint8_t type, uint64_t value)
+{
+    if (max < 9) { return -1; }
+    out[0] = type;
+    uint64_t value_be = Endian_hostToBigEndian64(value);
+    Bits_memcpy(&out[1], &value_be, 8);
+    return 9;
+}
+
+/** Strings longer than maxLen or the space which is left are truncated. */
+static int putString(uint8_t* out, int max, const char* str, int maxLen)
+{
+    if (max < 3) { return -1; }
+    if (!str) {
+        str = "(null)";
+    }
+    if (maxLen < 0 || maxLen > MAX_STRING_ARG) { maxLen = MAX_STRING_ARG; }
+    if (maxLen > max - 3) { maxLen = max - 3; }
+    int len = 0;
+    while (len < maxLen && str[len]) { len++; }
+    out[0] = 's';
+    uint16_t len_be = Endian_hostToBigEndian16(len);
+    Bits_memcpy(&out[1], &len_be, 2);
+    Bits_memcpy(&out[3], str, len);
+    return 3 + len;
+}
+
+static bool isOneOf(char c, const char* chars)
+{
+    return c && CString_strchr(chars, c);
+}
+
+/**
+ * Encode the arguments for a printf style format in the order they appear, including the
+ * arguments taken by * widths and precisions, see AdminLog.h.
+ *
+ * @return the length of the encoded arguments or -1 if there is a conversion which is not
+ *         supported or the arguments do not fit.
+ */
+static int encodeArgs(uint8_t* out, int max, const char* format, va_list args)
+{
+    int len = 0;
+    for (const char* f = format; *f; f++) {
+        if (*f != '%') { continue; }
+        f++;
+        if (*f == '%') { continue; }
+        while (isOneOf(*f, "-+ #0")) { f++; }
+        int precision = -1;
+        for (int part = 0; part < 2; part++) {
+            if (*f == '*') {
+                int x = va_arg(args, int);
+                if (part) { precision = x; }
+                int ret = putInt(&out[len], max - len, 'i', (uint64_t)(int64_t)x);
+                if (ret < 0) { return -1; }
+                len += ret;
+                f++;
+            } else {
+                int x = 0;
+                while (*f >= '0' && *f <= '9') { x = x * 10 + (*f++ - '0'); }
+                if (part) { precision = x; }
+            }
+            if (part || *f != '.') { break; }
+            f++;
+        }
+        int size = 0;
+        for (;; f++) {
+            switch (*f) {
+                case 'h': size--; continue;
+                case 'l': size++; continue;
+                case 'q':
+                case 'j': size = 2; continue;
+                case 'z':
+                case 't': size = (sizeof(size_t) == 8) ? 2 : 0; continue;
+                case 'L': size = 3; continue;
+                default:;
+            }
+            break;
+        }
+        int ret;
+        if (isOneOf(*f, "di")) {
+            int64_t x = (size >= 2) ? va_arg(args, long long)
+                : (size == 1) ? va_arg(args, long) : va_arg(args, int);
+            ret = putInt(&out[len], max - len, 'i', (uint64_t)x);
+        } else if (isOneOf(*f, "uoxXc")) {
+            uint64_t x = (size >= 2) ? va_arg(args, unsigned long long)
+                : (size == 1) ? va_arg(args, unsigned long) : va_arg(args, unsigned int);
+            ret = putInt(&out[len], max - len, 'u', x);
+        } else if (*f == 'p') {
+            ret = putInt(&out[len], max - len, 'u', (uintptr_t) va_arg(args, void*));
+        } else if (*f == 's' && size <= 0) {
+            ret = putString(&out[len], max - len, va_arg(args, char*), precision);
+        } else if (isOneOf(*f, "fFeEgGaA") && size <= 1) {
+            double x = va_arg(args, double);
+            uint64_t bits;
+            Bits_memcpy(&bits, &x, 8);
+            ret = putInt(&out[len], max - len, 'f', bits);
+        } else {
+            return -1;
+        }
+        if (ret < 0) { return -1; }
+        len += ret;
+    }
+    return len;
+}
+
+static uint32_t callSiteHash(const char* format, const char* file, int line, enum Log_Level lvl)
+{
+    uint64_t x = ((uintptr_t)format) ^ (((uintptr_t)file) << 7) ^ (((uint64_t)line) << 32) ^ lvl;
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdull;
+    x ^= x >> 33;
+    return (uint32_t) x;
+}
+
+/** @return the number of the call site or 0 if there are too many. */
+static int internCallSite(struct AdminLog* log,
+                          const char* format,
+                          const char* file,
+                          int line,
+                          enum Log_Level level)
+{
+    if (!log->callSites) {
+        log->callSites = Allocator_calloc(log->alloc, sizeof(struct CallSite), MAX_CALL_SITES);
+        log->callSiteTable = Allocator_calloc(log->alloc, sizeof(uint16_t), MAX_CALL_SITES * 2);
+        log->callSiteCount = 1;
+    }
+    uint32_t mask = MAX_CALL_SITES * 2 - 1;
+    for (uint32_t i = callSiteHash(format, file, line, level) & mask;; i = (i + 1) & mask) {
+        int num = log->callSiteTable[i];
+        if (!num) {
+            if (log->callSiteCount >= MAX_CALL_SITES) { return 0; }
+            num = log->callSiteTable[i] = log->callSiteCount++;
+            log->callSites[num] = (struct CallSite) {
+                .format = format, .file = file, .line = line, .level = level
+            };
+            return num;
+        }
+        struct CallSite* cs = &log->callSites[num];
+        if (cs->format == format && cs->file == file && cs->line == line && cs->level == level) {
+            return num;
+        }
+    }
+}
+
+/** @return the return value of Admin_sendMessage() */
+static int flushBatch(struct AdminLog* log, struct Subscription* sub)
+{
+    if (!sub->batchLen) { return 0; }
+    struct Allocator* alloc = Allocator_child(log->alloc);
+    String* records = String_newBinary(NULL, sub->batchLen * 2, alloc);
+    Hex_encode(records->bytes, records->len, sub->batch, sub->batchLen);
+    Dict* out = Dict_new(alloc);
+    Dict_putString(out, STREAM_ID, sub->streamId, alloc);
+    Dict_putInt(out, TIME, sub->batchTime, alloc);
+    Dict_putStringC(out, "records", records, alloc);
+    if (sub->dropped) {
+        Dict_putIntC(out, "dropped", sub->dropped, alloc);
+    }
+    int ret = Admin_sendMessage(out, sub->txid, log->admin);
+    if (!ret) {
+        sub->dropped = 0;
+    } else {
+        // The definitions in the batch are lost too so they will need to be sent again.
+        sub->dropped += sub->batchRecords;
+        Bits_memset(sub->defined, 0, MAX_CALL_SITES / 8);
+    }
+    sub->batchLen = 0;
+    sub->batchRecords = 0;
+    Allocator_free(alloc);
+    return ret;
+}
+
+static void putRecord(struct AdminLog* log,
+                      struct Subscription* sub,
+                      int callSite,
+                      uint8_t* args,
+                      int argsLen)
+{
+    if (!sub->batchLen) {
+        sub->batchTime = Time_currentTimeMilliseconds(log->base);
+    }
+    uint8_t* rec = &sub->batch[sub->batchLen];
+    uint16_t len_be = Endian_hostToBigEndian16(RECORD_HEADER_SIZE - 2 + argsLen);
+    uint16_t callSite_be = Endian_hostToBigEndian16(callSite);
+    uint32_t offset_be =
+        Endian_hostToBigEndian32(Time_currentTimeMilliseconds(log->base) - sub->batchTime);
+    Bits_memcpy(rec, &len_be, 2);
+    Bits_memcpy(&rec[2], &callSite_be, 2);
+    Bits_memcpy(&rec[4], &offset_be, 4);
+    Bits_memcpy(&rec[RECORD_HEADER_SIZE], args, argsLen);
+    sub->batchLen += RECORD_HEADER_SIZE + argsLen;
+    sub->batchRecords += (callSite != 0);
+}
+
+/**
+ * Add a record to the batch of a binary subscription, preceeded by the definition of the call
+ * site if the subscriber does not have it yet.
+ *
+ * @return the return value of Admin_sendMessage() if the batch had to be sent, otherwise 0.
+ */
+static int addRecord(struct AdminLog* log,
+                     struct Subscription* sub,
+                     int callSite,
+                     uint8_t* args,
+                     int argsLen)
+{
+    struct CallSite* cs = &log->callSites[callSite];
+    uint8_t def[DEFINITION_SIZE];
+    int defLen = 0;
+    defLen += putInt(&def[defLen], DEFINITION_SIZE - defLen, 'u', callSite);
+    defLen += putInt(&def[defLen], DEFINITION_SIZE - defLen, 'u', cs->level);
+    defLen += putInt(&def[defLen], DEFINITION_SIZE - defLen, 'u', cs->line);
+    defLen += putString(&def[defLen], DEFINITION_SIZE - defLen, cs->file, -1);
+    defLen += putString(&def[defLen], DEFINITION_SIZE - defLen, cs->format, -1);
+
+    int ret = 0;
+    bool isDefined = sub->defined[callSite / 8] & (1 << (callSite % 8));
+    uint32_t need = RECORD_HEADER_SIZE + argsLen + ((isDefined) ? 0 : RECORD_HEADER_SIZE + defLen);
+    if (sub->batchLen + need > BATCH_SIZE) {
+        ret = flushBatch(log, sub);
+    }
+    if (!(sub->defined[callSite / 8] & (1 << (callSite % 8)))) {
+        putRecord(log, sub, 0, def, defLen);
+        sub->defined[callSite / 8] |= (1 << (callSite % 8));
+    }
+    putRecord(log, sub, callSite, args, argsLen);
+    return ret;
+}
+
+static void flushAll(void* vAdminLog)
+{
+    struct AdminLog* log = Identity_check((struct AdminLog*) vAdminLog);
+    if (log->logging) { return; }
+    log->logging++;
+    for (int i = log->subscriptionCount - 1; i >= 0; i--) {
+        if (!log->subscriptions[i].binary) { continue; }
+        if (flushBatch(log, &log->subscriptions[i]) == Admin_sendMessage_CHANNEL_CLOSED) {
+            removeSubscription(log, &log->subscriptions[i]);
+        }
+    }
+    Assert_true(!--log->logging);
+}
+
+static const char* TEXT_FORMAT = "%s";
+
 static void doLog(struct Log* genericLog,
                   enum Log_Level logLevel,
                   const char* fullFilePath,
@@ -187,19 +496,46 @@ static void doLog(struct Log* genericLog,
     if (log->logging) { return; }
     log->logging++;
 
+    uint8_t recordArgs[MAX_ARGS_SIZE];
+    int recordLen = -1;
+    int callSite = 0;
+
     for (int i = log->subscriptionCount - 1; i >= 0; i--) {
         if (!isMatch(&log->subscriptions[i], log, logLevel, fullFilePath, line)) { continue; }
+        if (log->subscriptions[i].binary) {
+            if (!callSite) {
+                va_list argsCopy;
+                va_copy(argsCopy, args);
+                recordLen = encodeArgs(recordArgs, MAX_ARGS_SIZE, format, argsCopy);
+                va_end(argsCopy);
+                callSite = internCallSite(log, format, fullFilePath, line, logLevel);
+                if (recordLen < 0 || !callSite) {
+                    // Format it here and send it as the only argument of "%s".
+                    if (!message) {
+                        logLineAlloc = Allocator_child(log->alloc);
+                        message = formatMessage(format, args, logLineAlloc);
+                    }
+                    recordLen = putString(recordArgs, MAX_ARGS_SIZE, message->bytes, message->len);
+                    callSite = internCallSite(log, TEXT_FORMAT, fullFilePath, line, logLevel);
+                }
+            }
+            if (!callSite) {
+                log->subscriptions[i].dropped++;
+                continue;
+            }
+            int ret = addRecord(log, &log->subscriptions[i], callSite, recordArgs, recordLen);
+            if (ret == Admin_sendMessage_CHANNEL_CLOSED) {
+                removeSubscription(log, &log->subscriptions[i]);
+            }
+            continue;
+        }
         if (log->subscriptions[i].dropped) {
             log->subscriptions[i].dropped++;
             continue;
         }
         if (!message) {
             logLineAlloc = Allocator_child(log->alloc);
-            message = String_vprintf(logLineAlloc, format, args);
-            // Strip all of the annoying \n marks in the log entries.
-            if (message->len > 0 && message->bytes[message->len - 1] == '\n') {
-                message->len--;
-            }
+            message = formatMessage(format, args, logLineAlloc);
         }
         Dict* d = makeLogMessage(&log->subscriptions[i],
                                  log,
@@ -233,6 +569,7 @@ static void subscribe(Dict* args, void* vcontext, String* txid, struct Allocator
     int64_t* lineNumPtr = Dict_getIntC(args, "line");
     String* fileStr = Dict_getStringC(args, "file");
     if (fileStr && !fileStr->len) { fileStr = NULL; }
+    int64_t* binaryPtr = Dict_getIntC(args, "binary");
     char* error = "2+2=5";
     if (level == Log_Level_INVALID) {
         level = Log_Level_KEYS;
@@ -250,6 +587,15 @@ static void subscribe(Dict* args, void* vcontext, String* txid, struct Allocator
         sub->file = (fileStrCpy) ? fileStrCpy->bytes : NULL;
         sub->lineNum = (lineNumPtr) ? *lineNumPtr : 0;
         sub->txid = String_clone(txid, sub->alloc);
+        if (binaryPtr && *binaryPtr) {
+            sub->binary = true;
+            sub->batch = Allocator_malloc(sub->alloc, BATCH_SIZE);
+            sub->defined = Allocator_calloc(sub->alloc, MAX_CALL_SITES / 8, 1);
+            if (!log->flush) {
+                log->flush = Timeout_setInterval(flushAll, log, FLUSH_MILLISECONDS, log->base,
+                                                 log->alloc);
+            }
+        }
         uint8_t streamId[8];
         Random_bytes(log->rand, streamId, 8);
         uint8_t streamIdHex[20];
@@ -326,6 +672,7 @@ static void subscriptions(Dict* args, void* vcontext, String* txid, struct Alloc
         Dict_putInt(entry, LINE, sub->lineNum, alloc);
         Dict_putIntC(entry, "dropped", sub->dropped, alloc);
         Dict_putIntC(entry, "internalFile", sub->internalFile, alloc);
+        Dict_putIntC(entry, "binary", sub->binary, alloc);
         Dict_putStringC(entry, "streamId", sub->streamId, alloc);
         List_addDict(entries, entry, alloc);
     }
@@ -352,7 +699,8 @@ struct Log* AdminLog_registerNew(struct Admin* admin,
         ((struct Admin_FunctionArg[]) {
             { .name = "level", .required = 0, .type = "String" },
             { .name = "line", .required = 0, .type = "Int" },
-            { .name = "file", .required = 0, .type = "String" }
+            { .name = "file", .required = 0, .type = "String" },
+            { .name = "binary", .required = 0, .type = "Int" }
         }), admin);
 
     Admin_registerFunction("AdminLog_unsubscribe", unsubscribe, log, true,
@@ -23,6 +23,25 @@
 #include "util/Linker.h"
 Linker_require("admin/AdminLog.c");
 
+/**
+ * Subscribers which pass binary=1 to AdminLog_subscribe() get batches of records instead of one
+ * message per log line, each batch is a message with the streamId, the time in milliseconds
+ * of the first record, the number of log lines which were "dropped" since the last batch, if any,
+ * and the "records" hex encoded. All numbers are big endian.
+ *
+ *     [ u16 length of the rest of the record ][ u16 call site ][ u32 milliseconds since time ]
+ *     [ arguments... ]
+ *
+ * An argument is one byte for the type followed by the value:
+ * 'i' signed 64 bit int, 'u' unsigned 64 bit int, 'p' pointer as 64 bit int,
+ * 'f' 64 bit IEEE754 double, 's' u16 length followed by the bytes of the string.
+ *
+ * The arguments are in the order of the conversions in the printf format of the call site,
+ * including those taken by * widths and precisions. Call site 0 is the definition of a call site
+ * and it always comes in the stream before the first use of the call site it defines, its
+ * arguments are 'u' call site, 'u' level, 'u' line, 's' file, 's' format. If a batch is lost,
+ * call sites are defined again. Lines which cannot be encoded are sent with the format "%s".
+ */
 struct Log* AdminLog_registerNew(struct Admin* admin,
                                  struct Allocator* alloc,
                                  struct Random* rand,
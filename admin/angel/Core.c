@@ -58,12 +58,17 @@
 #include "tunnel/IpTunnel_admin.h"
 #include "tunnel/RouteGen_admin.h"
 #include "util/events/EventBase.h"
+#include "util/events/EventBase_admin.h"
 #include "util/events/Pipe.h"
 #include "util/events/PipeServer.h"
 #include "util/events/Timeout.h"
 #include "util/Hex.h"
+#include "util/Metrics_admin.h"
+#include "util/log/AsyncFileLog.h"
 #include "util/log/FileWriterLog.h"
 #include "util/log/IndirectLog.h"
+#include "util/log/LevelLog.h"
+#include "util/log/LevelLog_admin.h"
 #include "util/platform/netdev/NetDev.h"
 #include "util/Security_admin.h"
 #include "util/Security.h"
@@ -382,7 +387,7 @@ void Core_init(struct Allocator* alloc,
 #endif
 
     SupernodeHunter_admin_register(spf->snh, admin, alloc);
-    ReachabilityCollector_admin_register(spf->rc, admin, alloc);
+    ReachabilityCollector_admin_register(spf->rc, spf->ra, admin, alloc);
 
     AuthorizedPasswords_init(admin, nc->ca, alloc);
     Admin_registerFunction("ping", adminPing, admin, false, NULL, admin);
@@ -393,6 +398,9 @@ void Core_init(struct Allocator* alloc,
     SessionManager_admin_register(nc->sm, admin, alloc);
     Allocator_admin_register(alloc, admin);
     Sign_admin_register(privateKey, admin, rand, alloc);
+    Metrics_watchEventLoop(nc->metrics, eventBase, 100, alloc);
+    Metrics_admin_register(nc->metrics, eventBase, logger, admin, alloc);
+    EventBase_admin_register(eventBase, admin, alloc);
 
     struct Context* ctx = Allocator_calloc(alloc, sizeof(struct Context), 1);
     Identity_set(ctx);
@@ -455,7 +463,8 @@ int Core_main(int argc, char** argv)
 
     struct Allocator* tempAlloc = Allocator_child(alloc);
     // Not using tempalloc because we're going to keep this pipe around for admin
-    struct PipeServer* clientPipe = PipeServer_named(argv[2], eventBase, eh, logger, alloc);
+    struct PipeServer* clientPipe =
+        Except_er(eh, PipeServer_named(argv[2], eventBase, logger, alloc));
     Log_debug(logger, "Getting pre-configuration from client");
     struct Message* preConf =
         InterfaceWaiter_waitForData(&clientPipe->iface.iface, eventBase, tempAlloc, eh);
@@ -507,13 +516,17 @@ int Core_main(int argc, char** argv)
     // --------------------- Setup the Logger --------------------- //
     Dict* logging = Dict_getDictC(config, "logging");
     String* logTo = Dict_getStringC(logging, "logTo");
+    struct Log* backendLogger;
     if (logTo && String_equals(logTo, String_CONST("stdout"))) {
-        // do nothing, continue logging to stdout.
+        // Continue logging to the same place but without blocking the event loop.
+        backendLogger = AsyncFileLog_new(stderr, eventBase, alloc);
     } else {
-        struct Log* adminLogger = AdminLog_registerNew(admin, alloc, rand, eventBase);
-        IndirectLog_set(logger, adminLogger);
-        logger = adminLogger;
+        backendLogger = AdminLog_registerNew(admin, alloc, rand, eventBase);
     }
+    struct Log* levelLogger = LevelLog_new(backendLogger, alloc);
+    LevelLog_admin_register(levelLogger, admin, alloc);
+    IndirectLog_set(logger, levelLogger);
+    logger = levelLogger;
 
     // --------------------- Inform client of UDP Addr --------------------- //
     char* boundAddr = Sockaddr_print(udpAdmin->generic.addr, tempAlloc);
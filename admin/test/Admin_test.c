@@ -0,0 +1,165 @@
+/* vim: set expandtab ts=4 sw=4: */
+/*
+ * You may redistribute this program and/or modify it under the terms of
+ * the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "admin/Admin.h"
+#include "benc/Dict.h"
+#include "benc/List.h"
+#include "benc/String.h"
+#include "benc/serialization/standard/BencMessageReader.h"
+#include "interface/addressable/AddrIface.h"
+#include "memory/MallocAllocator.h"
+#include "util/Assert.h"
+#include "util/CString.h"
+#include "util/events/EventBase.h"
+#include "util/log/FileWriterLog.h"
+
+#include <stdio.h>
+
+#define MAX_RESPONSES 4
+#define MAX_CALLS 8
+
+struct Context
+{
+    struct AddrIface ai;
+    struct Admin* admin;
+    struct Allocator* alloc;
+
+    /** The results of the last batch by the index of their call. */
+    Dict* results[MAX_CALLS];
+    int resultCount;
+
+    int responseCount;
+    bool lastHadMore;
+    Identity
+};
+
+static Iface_DEFUN receiveResponse(struct Message* msg, struct Iface* iface)
+{
+    struct Context* ctx = Identity_containerOf(iface, struct Context, ai.iface);
+    Er_assert(AddrIface_popAddr(msg));
+    Assert_true(msg->length <= Admin_MAX_RESPONSE_SIZE);
+    Dict* d = Er_assert(BencMessageReader_read(msg, ctx->alloc));
+
+    String* txid = Dict_getStringC(d, "txid");
+    Assert_true(txid && String_equals(txid, String_CONST("abcd")));
+
+    // Only the last response of a batch comes without "more".
+    Assert_true(ctx->responseCount == 0 || ctx->lastHadMore);
+    ctx->lastHadMore = Dict_getIntC(d, "more") != NULL;
+    ctx->responseCount++;
+
+    List* results = Dict_getListC(d, "results");
+    Assert_true(results);
+    for (int i = 0; i < List_size(results); i++) {
+        Dict* result = List_getDict(results, i);
+        int64_t* call = Dict_getIntC(result, "call");
+        Assert_true(call && *call >= 0 && *call < MAX_CALLS && !ctx->results[*call]);
+        ctx->results[*call] = result;
+        ctx->resultCount++;
+    }
+    return NULL;
+}
+
+/** Reply with a String of the requested size. */
+static void testReply(Dict* args, void* vctx, String* txid, struct Allocator* requestAlloc)
+{
+    struct Context* ctx = Identity_check((struct Context*) vctx);
+    int64_t size = *Dict_getIntC(args, "size");
+    String* data = String_newBinary(NULL, size, requestAlloc);
+    Bits_memset(data->bytes, 'x', size);
+    Dict* d = Dict_new(requestAlloc);
+    Dict_putStringC(d, "data", data, requestAlloc);
+    Admin_sendMessage(d, txid, ctx->admin);
+}
+
+/** Call Admin_batch() with a call of Test_reply for each size, a negative size has no q. */
+static void batch(struct Context* ctx, int* sizes, int count)
+{
+    char request[Admin_MAX_REQUEST_SIZE];
+    int len = snprintf(request, sizeof request, "d4:argsd5:callsl");
+    for (int i = 0; i < count; i++) {
+        if (sizes[i] < 0) {
+            len += snprintf(&request[len], sizeof request - len, "d4:argsdee");
+        } else {
+            len += snprintf(&request[len], sizeof request - len,
+                "d4:argsd4:sizei%dee1:q10:Test_replye", sizes[i]);
+        }
+    }
+    len += snprintf(&request[len], sizeof request - len, "ee1:q11:Admin_batch4:txid4:abcde");
+    Assert_true(len < (int) sizeof request);
+
+    Bits_memset(ctx->results, 0, sizeof ctx->results);
+    ctx->resultCount = 0;
+    ctx->responseCount = 0;
+    ctx->lastHadMore = false;
+
+    struct Allocator* alloc = Allocator_child(ctx->alloc);
+    struct Message* msg = Message_new(0, len + 64, alloc);
+    Er_assert(Message_epush(msg, request, len));
+    Er_assert(AddrIface_pushAddr(msg, (struct Sockaddr*) Sockaddr_LOOPBACK));
+    Iface_send(&ctx->ai.iface, msg);
+    Allocator_free(alloc);
+
+    Assert_true(ctx->resultCount == count);
+    Assert_true(!ctx->lastHadMore);
+}
+
+static int dataLength(struct Context* ctx, int call)
+{
+    String* data = Dict_getStringC(ctx->results[call], "data");
+    return (data) ? (int) data->len : -1;
+}
+
+static bool isError(struct Context* ctx, int call, char* error)
+{
+    String* err = Dict_getStringC(ctx->results[call], "error");
+    return err && String_equals(err, String_CONST(error));
+}
+
+int main(int argc, char** argv)
+{
+    struct Allocator* alloc = MallocAllocator_new(1<<24);
+    struct EventBase* base = EventBase_new(alloc);
+    struct Log* log = FileWriterLog_new(stdout, alloc);
+
+    struct Context* ctx = Allocator_calloc(alloc, sizeof(struct Context), 1);
+    Identity_set(ctx);
+    ctx->alloc = alloc;
+    ctx->ai.alloc = alloc;
+    ctx->ai.iface.send = receiveResponse;
+    ctx->admin = Admin_new(&ctx->ai, log, base, String_CONST("NONE"));
+    Admin_registerFunction("Test_reply", testReply, ctx, false,
+        ((struct Admin_FunctionArg[]) {
+            { .name = "size", .required = 1, .type = "Int" }
+        }), ctx->admin);
+
+    // An error partway through the batch, the calls after it still run.
+    // A reply which can never fit in a response is replaced by an error.
+    batch(ctx, (int[]) { 100, -1, 65500, 200 }, 4);
+    Assert_true(ctx->responseCount == 1);
+    Assert_true(dataLength(ctx, 0) == 100);
+    Assert_true(isError(ctx, 1, "no_q"));
+    Assert_true(isError(ctx, 2, "response_too_big"));
+    Assert_true(dataLength(ctx, 3) == 200);
+
+    // Results which do not all fit in one response are split over several.
+    batch(ctx, (int[]) { 20000, 20000, 20000, 20000, 20000 }, 5);
+    Assert_true(ctx->responseCount == 2);
+    for (int i = 0; i < 5; i++) {
+        Assert_true(dataLength(ctx, i) == 20000);
+    }
+
+    Allocator_free(alloc);
+    return 0;
+}
@@ -0,0 +1,219 @@
+/* vim: set expandtab ts=4 sw=4: */
+/*
+ * You may redistribute this program and/or modify it under the terms of
+ * the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "benc/serialization/standard/BencStreamReader.h"
+#include "util/Bits.h"
+#include "util/CString.h"
+
+void BencStreamReader_init(struct BencStreamReader* r, const uint8_t* bytes, uint32_t length)
+{
+    Bits_memset(r, 0, sizeof(struct BencStreamReader));
+    r->bytes = bytes;
+    r->length = length;
+}
+
+static enum BencStreamReader_Type fail(struct BencStreamReader* r,
+                                       struct BencStreamReader_Token* tok,
+                                       const char* error)
+{
+    r->error = error;
+    tok->type = BencStreamReader_Type_ERROR;
+    return tok->type;
+}
+
+/** Same rules as Base10_read(), including the wrapping of numbers which are too large. */
+static const char* readNumber(struct BencStreamReader* r, int64_t* numOut)
+{
+    if (r->pos >= r->length) { return "Unexpected end of input"; }
+    uint8_t chr = r->bytes[r->pos++];
+    bool negative = false;
+    if (chr == '-') {
+        negative = true;
+        if (r->pos >= r->length) { return "Unexpected end of input"; }
+        chr = r->bytes[r->pos++];
+    }
+    if (chr < '0' || chr > '9') { return "No base10 characters found"; }
+    uint64_t out = 0;
+    for (;;) {
+        out = out * 10 + (chr - '0');
+        if (r->pos >= r->length) { break; }
+        chr = r->bytes[r->pos++];
+        if (chr < '0' || chr > '9') {
+            r->pos--;
+            break;
+        }
+    }
+    *numOut = (int64_t) (negative ? (0 - out) : out);
+    return NULL;
+}
+
+static const char* readString(struct BencStreamReader* r, struct BencStreamReader_Token* tok)
+{
+    int64_t len = 0;
+    const char* err = readNumber(r, &len);
+    if (err) { return err; }
+    if (len < 0) { return "Negative string length"; }
+    if (r->pos >= r->length || r->bytes[r->pos++] != ':') {
+        return "String not deliniated with a ':'";
+    }
+    if (len > r->length - r->pos) { return "String too long"; }
+    tok->type = BencStreamReader_Type_STRING;
+    tok->bytes = &r->bytes[r->pos];
+    tok->len = len;
+    r->pos += len;
+    return NULL;
+}
+
+static bool inDict(struct BencStreamReader* r)
+{
+    return r->depth && ((r->dicts >> (r->depth - 1)) & 1);
+}
+
+static bool wantKey(struct BencStreamReader* r)
+{
+    return inDict(r) && ((r->wantKey >> (r->depth - 1)) & 1);
+}
+
+/** A whole value has been read at the current depth, if this is a dict, a key comes next. */
+static void valueDone(struct BencStreamReader* r)
+{
+    if (inDict(r)) { r->wantKey |= ((uint64_t)1) << (r->depth - 1); }
+}
+
+enum BencStreamReader_Type BencStreamReader_next(struct BencStreamReader* r,
+                                                 struct BencStreamReader_Token* tok)
+{
+    Bits_memset(tok, 0, sizeof(struct BencStreamReader_Token));
+    if (r->error) { return fail(r, tok, r->error); }
+    if (r->pos >= r->length) {
+        if (r->depth) { return fail(r, tok, "Unexpected end of input"); }
+        return BencStreamReader_Type_NONE;
+    }
+
+    uint8_t chr = r->bytes[r->pos];
+    if (chr == 'e' && r->depth) {
+        if (inDict(r) && !wantKey(r)) {
+            return fail(r, tok, "Unexpected character in message [e]");
+        }
+        r->pos++;
+        r->depth--;
+        valueDone(r);
+        tok->type = BencStreamReader_Type_END;
+        return tok->type;
+    }
+
+    if (wantKey(r)) {
+        const char* err = readString(r, tok);
+        if (err) { return fail(r, tok, err); }
+        r->wantKey &= ~(((uint64_t)1) << (r->depth - 1));
+        return tok->type;
+    }
+
+    switch (chr) {
+        case 'd':
+        case 'l': {
+            if (r->depth >= BencStreamReader_MAX_DEPTH) {
+                return fail(r, tok, "Nested too deeply");
+            }
+            r->pos++;
+            uint64_t bit = ((uint64_t)1) << r->depth;
+            if (chr == 'd') {
+                r->dicts |= bit;
+                r->wantKey |= bit;
+                tok->type = BencStreamReader_Type_DICT;
+            } else {
+                r->dicts &= ~bit;
+                tok->type = BencStreamReader_Type_LIST;
+            }
+            r->depth++;
+            return tok->type;
+        }
+        case 'i': {
+            r->pos++;
+            const char* err = readNumber(r, &tok->number);
+            if (err) { return fail(r, tok, err); }
+            if (r->pos >= r->length || r->bytes[r->pos++] != 'e') {
+                return fail(r, tok, "Int not terminated with 'e'");
+            }
+            tok->type = BencStreamReader_Type_INT;
+            break;
+        }
+        case '0':
+        case '1':
+        case '2':
+        case '3':
+        case '4':
+        case '5':
+        case '6':
+        case '7':
+        case '8':
+        case '9': {
+            const char* err = readString(r, tok);
+            if (err) { return fail(r, tok, err); }
+            break;
+        }
+        default: return fail(r, tok, "Unexpected character in message");
+    }
+    valueDone(r);
+    return tok->type;
+}
+
+int BencStreamReader_skip(struct BencStreamReader* r, struct BencStreamReader_Token* tok)
+{
+    if (tok->type == BencStreamReader_Type_ERROR) { return -1; }
+    if (tok->type != BencStreamReader_Type_DICT && tok->type != BencStreamReader_Type_LIST) {
+        return 0;
+    }
+    struct BencStreamReader_Token t;
+    for (int depth = r->depth - 1; r->depth > depth;) {
+        if (BencStreamReader_next(r, &t) == BencStreamReader_Type_ERROR) { return -1; }
+    }
+    return 0;
+}
+
+int BencStreamReader_getFields(struct BencStreamReader* r,
+                               struct BencStreamReader_Field* fields,
+                               int count)
+{
+    for (int i = 0; i < count; i++) {
+        Bits_memset(&fields[i].value, 0, sizeof(struct BencStreamReader_Token));
+    }
+    struct BencStreamReader_Token key;
+    struct BencStreamReader_Token val;
+    enum BencStreamReader_Type t = BencStreamReader_next(r, &key);
+    if (t == BencStreamReader_Type_ERROR) { return -1; }
+    if (t != BencStreamReader_Type_DICT) {
+        r->error = "Message does not begin with a 'd' to open the dictionary";
+        return -1;
+    }
+    for (;;) {
+        t = BencStreamReader_next(r, &key);
+        if (t == BencStreamReader_Type_END) { return 0; }
+        if (t == BencStreamReader_Type_ERROR) { return -1; }
+
+        uint32_t start = r->pos;
+        if (BencStreamReader_next(r, &val) == BencStreamReader_Type_ERROR) { return -1; }
+        if (BencStreamReader_skip(r, &val)) { return -1; }
+        if (val.type == BencStreamReader_Type_DICT || val.type == BencStreamReader_Type_LIST) {
+            val.bytes = &r->bytes[start];
+            val.len = r->pos - start;
+        }
+
+        for (int i = 0; i < count; i++) {
+            if (key.len != CString_strlen(fields[i].key)) { continue; }
+            if (Bits_memcmp(key.bytes, fields[i].key, key.len)) { continue; }
+            Bits_memcpy(&fields[i].value, &val, sizeof(struct BencStreamReader_Token));
+        }
+    }
+}
@@ -0,0 +1,124 @@
+/* vim: set expandtab ts=4 sw=4: */
+/*
+ * You may redistribute this program and/or modify it under the terms of
+ * the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef BencStreamReader_H
+#define BencStreamReader_H
+
+#include "util/Linker.h"
+Linker_require("benc/serialization/standard/BencStreamReader.c");
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * A pull reader for benc which never allocates, strings are returned as pointers into the
+ * input buffer. It accepts exactly the same input as BencMessageReader so it can be used to
+ * look at a few keys of a message before deciding whether it is worth building a Dict.
+ * The only exception is that dicts and lists may not be nested more than
+ * BencStreamReader_MAX_DEPTH deep.
+ */
+#define BencStreamReader_MAX_DEPTH 64
+
+enum BencStreamReader_Type
+{
+    BencStreamReader_Type_ERROR = -1,
+    BencStreamReader_Type_NONE = 0,
+    BencStreamReader_Type_DICT,
+    BencStreamReader_Type_LIST,
+    BencStreamReader_Type_END,
+    BencStreamReader_Type_INT,
+    BencStreamReader_Type_STRING
+};
+
+struct BencStreamReader_Token
+{
+    enum BencStreamReader_Type type;
+
+    /**
+     * For a string, the content of the string.
+     * For a dict or list which was returned by BencStreamReader_getFields(), the whole encoded
+     * value including the opening and closing characters.
+     */
+    const uint8_t* bytes;
+    uint32_t len;
+
+    /** For an int, the value. */
+    int64_t number;
+};
+
+struct BencStreamReader
+{
+    const uint8_t* bytes;
+    uint32_t length;
+
+    /** Offset of the next character to read. */
+    uint32_t pos;
+
+    /** Number of dicts and lists which are open. */
+    int depth;
+
+    /** One bit per open container, set if it is a dict. */
+    uint64_t dicts;
+
+    /** One bit per open container, set if it is a dict and the next token is a key. */
+    uint64_t wantKey;
+
+    /** Set when a token of type ERROR is returned. */
+    const char* error;
+};
+
+void BencStreamReader_init(struct BencStreamReader* r, const uint8_t* bytes, uint32_t length);
+
+/**
+ * Read the next token.
+ * Inside of a dict, keys and values are returned alternately, every key is a STRING.
+ *
+ * @return the type of the token which is also stored in tok->type, NONE if there is no more
+ *         input at depth zero and ERROR if the input is invalid or ends inside of a dict or list.
+ */
+enum BencStreamReader_Type BencStreamReader_next(struct BencStreamReader* r,
+                                                 struct BencStreamReader_Token* tok);
+
+/**
+ * Skip the remainder of a value, if tok is the beginning of a dict or list then everything up
+ * to and including the matching end is skipped, otherwise nothing is done.
+ *
+ * @return 0 or -1 if the input is invalid, in which case r->error is set.
+ */
+int BencStreamReader_skip(struct BencStreamReader* r, struct BencStreamReader_Token* tok);
+
+struct BencStreamReader_Field
+{
+    /** The key to look for. */
+    const char* key;
+
+    /** Type NONE if the key was not found. If the key is present more than once, the last. */
+    struct BencStreamReader_Token value;
+};
+
+/**
+ * Read a whole dict and extract the values of some keys without looking inside of any of the
+ * other values.
+ *
+ * @param r a reader which is positioned at the beginning of a dict, after this call it is
+ *          positioned just after the end of the dict.
+ * @param fields the keys to look for, the values are written into this array.
+ * @param count the number of fields.
+ * @return 0 or -1 if the input is invalid, in which case r->error is set.
+ */
+int BencStreamReader_getFields(struct BencStreamReader* r,
+                               struct BencStreamReader_Field* fields,
+                               int count);
+
+#endif
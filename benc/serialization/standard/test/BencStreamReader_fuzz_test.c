@@ -0,0 +1,101 @@
+/* vim: set expandtab ts=4 sw=4: */
+/*
+ * You may redistribute this program and/or modify it under the terms of
+ * the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "benc/Dict.h"
+#include "benc/String.h"
+#include "benc/serialization/standard/BencMessageReader.h"
+#include "benc/serialization/standard/BencStreamReader.h"
+#include "crypto/random/Random.h"
+#include "memory/Allocator.h"
+#include "test/FuzzTest.h"
+#include "util/Assert.h"
+#include "util/Bits.h"
+
+/** Check that a value found by the stream reader is the same as what is in the Dict. */
+static void checkField(struct BencStreamReader_Field* field, Dict* dict, struct Allocator* alloc)
+{
+    String* key = String_new(field->key, alloc);
+    struct BencStreamReader_Token* val = &field->value;
+    switch (val->type) {
+        case BencStreamReader_Type_NONE: {
+            Assert_true(!Dict_getInt(dict, key) && !Dict_getString(dict, key));
+            Assert_true(!Dict_getDict(dict, key) && !Dict_getList(dict, key));
+            break;
+        }
+        case BencStreamReader_Type_INT: {
+            int64_t* num = Dict_getInt(dict, key);
+            Assert_true(num && *num == val->number);
+            break;
+        }
+        case BencStreamReader_Type_STRING: {
+            String* str = Dict_getString(dict, key);
+            Assert_true(str && str->len == val->len);
+            Assert_true(!Bits_memcmp(str->bytes, val->bytes, val->len));
+            break;
+        }
+        case BencStreamReader_Type_LIST: {
+            Assert_true(Dict_getList(dict, key));
+            break;
+        }
+        case BencStreamReader_Type_DICT: {
+            Assert_true(Dict_getDict(dict, key));
+
+            // The raw value must be a complete dict on it's own.
+            struct BencStreamReader r;
+            BencStreamReader_init(&r, val->bytes, val->len);
+            Assert_true(!BencStreamReader_getFields(&r, NULL, 0));
+            Assert_true(r.pos == val->len);
+            break;
+        }
+        default: Assert_true(0);
+    }
+}
+
+void CJDNS_FUZZ_MAIN(void* vctx, struct Message* fuzz)
+{
+    struct Allocator* alloc = Allocator_child((struct Allocator*) vctx);
+    struct Message* msg = Message_clone(fuzz, alloc);
+    Dict* dict = NULL;
+    const char* err = BencMessageReader_readNoExcept(msg, alloc, &dict);
+
+    struct BencStreamReader_Field fields[] = {
+        { .key = "q" }, { .key = "txid" }, { .key = "p" }, { .key = "n" }, { .key = "args" }
+    };
+    int count = sizeof(fields) / sizeof(*fields);
+    struct BencStreamReader r;
+    BencStreamReader_init(&r, fuzz->bytes, fuzz->length);
+    int ret = BencStreamReader_getFields(&r, fields, count);
+
+    if (err) {
+        Assert_true(ret);
+    } else if (ret) {
+        // Only allowed to reject what BencMessageReader accepts if it is too deep.
+        Assert_true(r.depth == BencStreamReader_MAX_DEPTH);
+    } else {
+        Assert_true(r.pos == (uint32_t) (fuzz->length - msg->length));
+        for (int i = 0; i < count; i++) { checkField(&fields[i], dict, alloc); }
+
+        // Walking every token must reach the end of the dict without error.
+        struct BencStreamReader_Token tok;
+        BencStreamReader_init(&r, fuzz->bytes, fuzz->length - msg->length);
+        while (BencStreamReader_next(&r, &tok) > BencStreamReader_Type_NONE) { }
+        Assert_true(tok.type == BencStreamReader_Type_NONE && !r.depth);
+    }
+    Allocator_free(alloc);
+}
+
+void* CJDNS_FUZZ_INIT(struct Allocator* alloc, struct Random* rand)
+{
+    return alloc;
+}
@@ -422,12 +422,37 @@ static void supernodes(List* supernodes, struct Allocator* tempAlloc, struct Con
     }
 }
 
+static void janitor(Dict* janitorConf, struct Allocator* tempAlloc, struct Context* ctx)
+{
+    if (!janitorConf) { return; }
+    int64_t* size = Dict_getIntC(janitorConf, "blacklistSize");
+    int64_t* milliseconds = Dict_getIntC(janitorConf, "blacklistMilliseconds");
+    Dict* reqDict = Dict_new(tempAlloc);
+    if (size) { Dict_putIntC(reqDict, "size", *size, tempAlloc); }
+    if (milliseconds) { Dict_putIntC(reqDict, "milliseconds", *milliseconds, tempAlloc); }
+    if (!Dict_size(reqDict)) { return; }
+    Log_debug(ctx->logger, "Setting up the path blacklist");
+    // Not fatal, Janitor does not exist in subnode builds.
+    rpcCall0(String_CONST("Janitor_setBlacklist"), reqDict, ctx, tempAlloc, NULL, false);
+}
+
+static void metricsSocket(Dict* adminConf, struct Allocator* tempAlloc, struct Context* ctx)
+{
+    String* path = Dict_getStringC(adminConf, "metricsSocket");
+    if (!path) { return; }
+    Dict* d = Dict_new(tempAlloc);
+    Dict_putStringC(d, "path", path, tempAlloc);
+    // Must happen before the seccomp sandbox because it creates a socket.
+    rpcCall0(String_CONST("Metrics_listen"), d, ctx, tempAlloc, NULL, false);
+}
+
 static void routerConfig(Dict* routerConf, struct Allocator* tempAlloc, struct Context* ctx)
 {
     tunInterface(Dict_getDictC(routerConf, "interface"), tempAlloc, ctx);
     socketInterface(Dict_getDictC(routerConf, "interface"), tempAlloc, ctx);
     ipTunnel(Dict_getDictC(routerConf, "ipTunnel"), tempAlloc, ctx);
     supernodes(Dict_getListC(routerConf, "supernodes"), tempAlloc, ctx);
+    janitor(Dict_getDictC(routerConf, "janitor"), tempAlloc, ctx);
 }
 
 static void ethInterfaceSetBeacon(int ifNum, Dict* eth, struct Context* ctx)
@@ -741,6 +766,8 @@ void Configurator_config(Dict* config,
     Dict* routerConf = Dict_getDictC(config, "router");
     routerConfig(routerConf, tempAlloc, &ctx);
 
+    metricsSocket(Dict_getDictC(config, "admin"), tempAlloc, &ctx);
+
     List* secList = Dict_getListC(config, "security");
     security(tempAlloc, secList, logger, &ctx);
 
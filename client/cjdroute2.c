@@ -161,6 +161,10 @@ static int genconf(struct Allocator* alloc, struct Random* rand, bool eth, bool
            "        // Port to bind the admin RPC server to.\n"
            "        \"bind\": \"127.0.0.1:11234\",\n"
            "\n"
+           "        // Serve counters and latency histograms in the prometheus text format\n"
+           "        // on a unix socket, eg: curl --unix-socket /tmp/cjdns_metrics http://x/\n"
+           "        // \"metricsSocket\": \"/tmp/cjdns_metrics\",\n"
+           "\n"
            "        // Password for admin RPC server.\n"
            "        // This is a static password by default, so that tools like\n"
            "        // ./tools/cexec can use the API without you creating a\n"
@@ -269,6 +273,16 @@ static int genconf(struct Allocator* alloc, struct Random* rand, bool eth, bool
            "            //\"6743gf5tw80ExampleExampleExampleExamplevlyb23zfnuzv0.k\",\n"
            "        ],\n"
            "\n"
+           "        // Tuning for the DHT maintenance, most users don't need this.\n"
+           "        \"janitor\": {\n"
+           "            // Number of recently pinged paths which will not be pinged again for\n"
+           "            // blacklistMilliseconds, raise this if Janitor_blacklistStats()\n"
+           "            // shows many evictions. It is rounded up to a power of 2 between\n"
+           "            // 16 and 65536.\n"
+           "            //\"blacklistSize\": 512,\n"
+           "            //\"blacklistMilliseconds\": 30000\n"
+           "        },\n"
+           "\n"
            "        // The interface which is used for connecting to the cjdns network.\n"
            "        \"interface\": {\n"
            "            // The type of interface (only TUNInterface is supported for now)\n"
@@ -12,41 +12,166 @@
  * You should have received a copy of the GNU General Public License
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
-#include "crypto/Key.h"
+#include "util/events/libuv/UvWrapper.h"
+#include "crypto/KeyGen.h"
 #include "crypto/random/Random.h"
 #include "memory/MallocAllocator.h"
-#include "crypto/AddressCalc.h"
+#include "util/Assert.h"
 #include "util/AddrTools.h"
 #include "util/Base32.h"
+#include "util/Bits.h"
+#include "util/CString.h"
 #include "util/Hex.h"
+#include "util/events/Time.h"
 
 #include <signal.h>
 #include <stdio.h>
+#include <stdlib.h>
 
-int main(int argc, char** argv)
+#define MAX_THREADS 256
+
+/** How often to print the rate when asked to. */
+#define REPORT_SECONDS 5
+
+struct Context
 {
-    struct Allocator* alloc = MallocAllocator_new(1<<22);
-    struct Random* rand = Random_new(alloc, NULL, NULL);
+    uint8_t prefix[16];
+    int prefixBits;
+
+    /** Keys left to print, negative to print forever. */
+    int64_t remaining;
+
+    uint64_t tries;
+    uint64_t found;
+
+    uv_mutex_t lock;
+    uv_cond_t done;
+};
+
+struct Worker
+{
+    struct Context* ctx;
+    struct KeyGen* kg;
+    uv_thread_t thread;
+};
 
+static void worker(void* vworker)
+{
+    struct Worker* w = vworker;
+    struct Context* ctx = w->ctx;
     uint8_t privateKey[32];
     uint8_t publicKey[32];
-    uint8_t publicKeyBase32[53];
     uint8_t ip[16];
     uint8_t hexPrivateKey[65];
+    uint8_t publicKeyBase32[53];
     uint8_t printedIp[40];
+    for (;;) {
+        uint64_t tries = 0;
+        int ret =
+            KeyGen_search(w->kg, ip, publicKey, privateKey, ctx->prefix, ctx->prefixBits, &tries);
+        if (!ret) {
+            Hex_encode(hexPrivateKey, 65, privateKey, 32);
+            Base32_encode(publicKeyBase32, 53, publicKey, 32);
+            AddrTools_printIp(printedIp, ip);
+        }
+        uv_mutex_lock(&ctx->lock);
+        ctx->tries += tries;
+        if (!ret && ctx->remaining) {
+            printf("%s %s %s.k\n", hexPrivateKey, printedIp, publicKeyBase32);
+            fflush(stdout);
+            ctx->found++;
+            if (ctx->remaining > 0 && !--ctx->remaining) {
+                uv_cond_signal(&ctx->done);
+            }
+        }
+        uv_mutex_unlock(&ctx->lock);
+    }
+}
+
+static int parsePrefix(struct Context* ctx, const char* str)
+{
+    Bits_memset(ctx->prefix, 0, 16);
+    ctx->prefixBits = 0;
+    for (; *str; str++) {
+        if (*str == ':') { continue; }
+        if (!Hex_isHexEntity(*str) || ctx->prefixBits >= 128) { return -1; }
+        uint8_t nibble = Hex_decodeByte('0', *str);
+        ctx->prefix[ctx->prefixBits / 8] |= nibble << ((ctx->prefixBits % 8) ? 0 : 4);
+        ctx->prefixBits += 4;
+    }
+    return (ctx->prefixBits >= 8 && ctx->prefix[0] == 0xfc) ? 0 : -1;
+}
+
+static int usage(char* appName)
+{
+    printf("Usage: %s [-t <threads>] [-n <count>] [-r] [prefix]\n"
+           "\n"
+           "Generate cjdns keys and print them as: <private key> <ip6> <public key>\n"
+           "  -t <threads>  number of threads to search with, default is one per cpu\n"
+           "  -n <count>    stop after this many keys, default is to go forever\n"
+           "  -r            print how many candidates per second are tried to stderr\n"
+           "  prefix        only print keys whose ip6 begins with this, eg: fc00:1234\n"
+           "                every 4 characters beyond fc make the search 16 times slower\n",
+           appName);
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    struct Allocator* alloc = MallocAllocator_new(1<<24);
+    struct Random* rand = Random_new(alloc, NULL, NULL);
+
+    struct Context ctx = { .prefix = { 0xfc }, .prefixBits = 8, .remaining = -1 };
+    int threads = 0;
+    int report = 0;
+    for (int i = 1; i < argc; i++) {
+        if (!CString_strcmp(argv[i], "-t") && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (!CString_strcmp(argv[i], "-n") && i + 1 < argc) {
+            ctx.remaining = atoll(argv[++i]);
+        } else if (!CString_strcmp(argv[i], "-r")) {
+            report = 1;
+        } else if (argv[i][0] == '-' || parsePrefix(&ctx, argv[i])) {
+            return usage(argv[0]);
+        }
+    }
+    if (!ctx.remaining) { return 0; }
+    if (threads <= 0) {
+        uv_cpu_info_t* cpus;
+        Assert_true(!uv_cpu_info(&cpus, &threads));
+        uv_free_cpu_info(cpus, threads);
+    }
+    if (threads > MAX_THREADS) { threads = MAX_THREADS; }
 
 #ifndef win32
     signal(SIGPIPE,SIG_DFL);
 #endif
 
-    for (;;) {
-        Key_gen(ip, publicKey, privateKey, rand);
-        Hex_encode(hexPrivateKey, 65, privateKey, 32);
-        Base32_encode(publicKeyBase32, 53, publicKey, 32);
-        AddrTools_printIp(printedIp, ip);
-        printf("%s %s %s.k\n", hexPrivateKey, printedIp, publicKeyBase32);
-        fflush(stdout);
+    Assert_true(!uv_mutex_init(&ctx.lock));
+    Assert_true(!uv_cond_init(&ctx.done));
+    struct Worker* workers = Allocator_calloc(alloc, sizeof(struct Worker), threads);
+    for (int i = 0; i < threads; i++) {
+        workers[i].ctx = &ctx;
+        workers[i].kg = KeyGen_new(rand, alloc);
+        Assert_true(!uv_thread_create(&workers[i].thread, worker, &workers[i]));
+    }
+
+    // The workers are never joined, returning from main() stops them.
+    uint64_t lastTime = Time_hrtime();
+    uint64_t lastTries = 0;
+    uint64_t lastFound = 0;
+    uv_mutex_lock(&ctx.lock);
+    while (ctx.remaining) {
+        uv_cond_timedwait(&ctx.done, &ctx.lock, REPORT_SECONDS * 1000000000ull);
+        uint64_t now = Time_hrtime();
+        if (!report || now - lastTime < REPORT_SECONDS * 1000000000ull) { continue; }
+        double seconds = (now - lastTime) / 1e9;
+        fprintf(stderr, "%d threads, %.0f candidates per second, %.2f keys per second\n",
+                threads, (ctx.tries - lastTries) / seconds, (ctx.found - lastFound) / seconds);
+        lastTime = now;
+        lastTries = ctx.tries;
+        lastFound = ctx.found;
     }
+    uv_mutex_unlock(&ctx.lock);
     return 0;
 }
-
@@ -14,6 +14,7 @@
  */
 #include "crypto/CryptoAuth_pvt.h"
 #include "crypto/AddressCalc.h"
+#include "crypto/Curve25519.h"
 #include "crypto/ReplayProtector.h"
 #include "crypto/random/Random.h"
 #include "benc/Dict.h"
@@ -60,7 +61,7 @@ static inline void printHexPubKey(uint8_t output[65], uint8_t privateKey[32])
 {
     if (privateKey) {
         uint8_t publicKey[32];
-        crypto_scalarmult_curve25519_base(publicKey, privateKey);
+        Curve25519_scalarmultBase(publicKey, privateKey);
         printHexKey(output, publicKey);
     } else {
         printHexKey(output, NULL);
@@ -301,6 +302,65 @@ static void getIp6(struct CryptoAuth_Session_pvt* session, uint8_t* addr)
 #define cryptoAuthDebug0(wrapper, format) \
     cryptoAuthDebug(session, format "%s", "")
 
+/** The secret for a hello, our permanent key with hers, which only changes with the password. */
+static void getHelloSecret(uint8_t outputSecret[32],
+                           struct CryptoAuth_Session_pvt* session,
+                           uint8_t passwordHash[32])
+{
+    if (!session->helloSecretValid ||
+        Bits_memcmp(session->helloSecretHerKey, session->pub.herPublicKey, 32) ||
+        session->helloSecretHasPassword != (passwordHash != NULL) ||
+        (passwordHash && Bits_memcmp(session->helloSecretPassword, passwordHash, 32)))
+    {
+        getSharedSecret(session->helloSecret,
+                        session->context->privateKey,
+                        session->pub.herPublicKey,
+                        passwordHash,
+                        session->context->logger);
+        Bits_memcpy(session->helloSecretHerKey, session->pub.herPublicKey, 32);
+        if (passwordHash) {
+            Bits_memcpy(session->helloSecretPassword, passwordHash, 32);
+        }
+        session->helloSecretHasPassword = (passwordHash != NULL);
+        session->helloSecretValid = true;
+    }
+    Bits_memcpy(outputSecret, session->helloSecret, 32);
+}
+
+#define TEMP_KEY_REFILL_MS 10
+#define TEMP_KEYS_PER_REFILL 4
+
+/** Make a few temporary keys at a time so as not to hold up the event loop for long. */
+static void refillTempKeys(void* vcontext)
+{
+    struct CryptoAuth_pvt* ca = Identity_check((struct CryptoAuth_pvt*) vcontext);
+    for (int i = 0; i < TEMP_KEYS_PER_REFILL && ca->tempKeyCount < CryptoAuth_TEMP_KEYS; i++) {
+        struct CryptoAuth_TempKey* key = &ca->tempKeys[ca->tempKeyCount++];
+        Random_bytes(ca->rand, key->privateKey, 32);
+        Curve25519_scalarmultBase(key->publicKey, key->privateKey);
+    }
+    if (ca->tempKeyCount < CryptoAuth_TEMP_KEYS) {
+        Timeout_resetTimeout(ca->tempKeyRefill, TEMP_KEY_REFILL_MS);
+    }
+}
+
+/** Take a temporary keypair from the pool, or make one if it is empty. */
+static void newTempKey(struct CryptoAuth_pvt* ca, uint8_t privateKey[32], uint8_t publicKey[32])
+{
+    if (ca->tempKeyCount) {
+        struct CryptoAuth_TempKey* key = &ca->tempKeys[--ca->tempKeyCount];
+        Bits_memcpy(privateKey, key->privateKey, 32);
+        Bits_memcpy(publicKey, key->publicKey, 32);
+        Bits_memset(key, 0, sizeof(struct CryptoAuth_TempKey));
+    } else {
+        Random_bytes(ca->rand, privateKey, 32);
+        Curve25519_scalarmultBase(publicKey, privateKey);
+    }
+    if (!Timeout_isActive(ca->tempKeyRefill)) {
+        Timeout_resetTimeout(ca->tempKeyRefill, TEMP_KEY_REFILL_MS);
+    }
+}
+
 static void reset(struct CryptoAuth_Session_pvt* session)
 {
     session->nextNonce = CryptoAuth_State_INIT;
@@ -312,7 +372,7 @@ static void reset(struct CryptoAuth_Session_pvt* session)
     Bits_memset(session->sharedSecret, 0, 32);
     session->established = false;
 
-    Bits_memset(&session->pub.replayProtector, 0, sizeof(struct ReplayProtector));
+    ReplayProtector_reset(&session->pub.replayProtector);
 }
 
 static void resetIfTimeout(struct CryptoAuth_Session_pvt* session)
@@ -378,8 +438,7 @@ static void encryptHandshake(struct Message* message,
     {
         // If we're sending a hello or a key
         // Here we make up a temp keypair
-        Random_bytes(session->context->rand, session->ourTempPrivKey, 32);
-        crypto_scalarmult_curve25519_base(session->ourTempPubKey, session->ourTempPrivKey);
+        newTempKey(session->context, session->ourTempPrivKey, session->ourTempPubKey);
 
         if (Defined(Log_KEYS)) {
             uint8_t tempPrivateKeyHex[65];
@@ -410,11 +469,7 @@ static void encryptHandshake(struct Message* message,
 
     uint8_t sharedSecret[32];
     if (session->nextNonce < CryptoAuth_State_RECEIVED_HELLO) {
-        getSharedSecret(sharedSecret,
-                        session->context->privateKey,
-                        session->pub.herPublicKey,
-                        passwordHash,
-                        session->context->logger);
+        getHelloSecret(sharedSecret, session, passwordHash);
 
         session->isInitiator = true;
 
@@ -614,11 +669,7 @@ static enum CryptoAuth_DecryptErr decryptHandshake(struct CryptoAuth_Session_pvt
             cryptoAuthDebug0(session, "Received a repeat hello packet");
         }
 
-        getSharedSecret(sharedSecret,
-                        session->context->privateKey,
-                        session->pub.herPublicKey,
-                        passwordHash,
-                        session->context->logger);
+        getHelloSecret(sharedSecret, session, passwordHash);
         nextNonce = CryptoAuth_State_RECEIVED_HELLO;
     } else {
         if (nonce == Nonce_KEY) {
@@ -826,7 +877,7 @@ static enum CryptoAuth_DecryptErr decryptHandshake(struct CryptoAuth_Session_pvt
     );
     session->nextNonce = nextNonce;
 
-    Bits_memset(&session->pub.replayProtector, 0, sizeof(struct ReplayProtector));
+    ReplayProtector_reset(&session->pub.replayProtector);
 
     return 0;
 }
@@ -871,8 +922,7 @@ enum CryptoAuth_DecryptErr CryptoAuth_decrypt(struct CryptoAuth_Session* session
             enum CryptoAuth_DecryptErr ret = decryptMessage(session, nonce, msg, secret);
 
             // This prevents a few "ghost" dropped packets at the beginning of a session.
-            session->pub.replayProtector.baseOffset = nonce + 1;
-            session->pub.replayProtector.bitfield = 0;
+            ReplayProtector_begin(nonce, &session->pub.replayProtector);
 
             if (!ret) {
                 cryptoAuthDebug0(session, "Final handshake step succeeded");
@@ -933,7 +983,11 @@ struct CryptoAuth* CryptoAuth_new(struct Allocator* allocator,
     } else {
         Random_bytes(rand, ca->privateKey, 32);
     }
-    crypto_scalarmult_curve25519_base(ca->pub.publicKey, ca->privateKey);
+    Curve25519_scalarmultBase(ca->pub.publicKey, ca->privateKey);
+
+    ca->tempKeyRefill =
+        Timeout_setTimeout(refillTempKeys, ca, TEMP_KEY_REFILL_MS, eventBase, allocator);
+    Timeout_clearTimeout(ca->tempKeyRefill);
 
     if (Defined(Log_KEYS)) {
         uint8_t publicKeyHex[65];
@@ -1112,6 +1166,16 @@ enum CryptoAuth_State CryptoAuth_getState(struct CryptoAuth_Session* caSession)
     return (session->established) ? CryptoAuth_State_ESTABLISHED : CryptoAuth_State_RECEIVED_KEY;
 }
 
+void CryptoAuth_setReplayWindow(struct CryptoAuth_Session* caSession, uint32_t bits)
+{
+    struct CryptoAuth_Session_pvt* session =
+        Identity_check((struct CryptoAuth_Session_pvt*) caSession);
+    uint32_t wordCount = ReplayProtector_DEFAULT_WORDS;
+    while (wordCount * 64 < bits) { wordCount <<= 1; }
+    uint64_t* words = Allocator_calloc(session->alloc, 8, wordCount);
+    ReplayProtector_setWindow(words, wordCount, &session->pub.replayProtector);
+}
+
 void CryptoAuth_resetIfTimeout(struct CryptoAuth_Session* caSession)
 {
     struct CryptoAuth_Session_pvt* session =
@@ -219,6 +219,13 @@ void CryptoAuth_setAuth(const String* password,
 
 void CryptoAuth_resetIfTimeout(struct CryptoAuth_Session* session);
 
+/**
+ * Use a replay window of this many bits, rounded up to a power of 2, so that packets which arrive
+ * up to (bits - 64) places out of order are accepted. The default is 128 bits.
+ * This resets the replay counters.
+ */
+void CryptoAuth_setReplayWindow(struct CryptoAuth_Session* session, uint32_t bits);
+
 void CryptoAuth_reset(struct CryptoAuth_Session* caSession);
 
 enum CryptoAuth_State {
@@ -20,6 +20,7 @@
 #include "util/log/Log.h"
 #include "memory/Allocator.h"
 #include "util/events/EventBase.h"
+#include "util/events/Timeout.h"
 #include "wire/CryptoHeader.h"
 #include "wire/Message.h"
 #include "util/Identity.h"
@@ -47,12 +48,29 @@ struct CryptoAuth_User {
     Identity
 };
 
+/** How many temporary keypairs to keep ready for handshakes. */
+#define CryptoAuth_TEMP_KEYS 32
+
+struct CryptoAuth_TempKey
+{
+    uint8_t privateKey[32];
+    uint8_t publicKey[32];
+};
+
 struct CryptoAuth_pvt
 {
     struct CryptoAuth pub;
 
     uint8_t privateKey[32];
 
+    /**
+     * Temporary keypairs which are made between handshakes so that a burst of them (eg: after a
+     * restart) does not have to wait for key generation, refilled by tempKeyRefill.
+     */
+    struct CryptoAuth_TempKey tempKeys[CryptoAuth_TEMP_KEYS];
+    int tempKeyCount;
+    struct Timeout* tempKeyRefill;
+
     struct CryptoAuth_User* users;
 
     struct Log* logger;
@@ -80,6 +98,14 @@ struct CryptoAuth_Session_pvt
 
     uint8_t ourTempPubKey[32];
 
+    /**
+     * The secret from our permanent key and hers, it is the same for every hello so it is kept
+     * along with the key and password it was made for.
+     */
+    uint8_t helloSecret[32];
+    uint8_t helloSecretHerKey[32];
+    uint8_t helloSecretPassword[32];
+
     /** A password to use for authing with the other party. */
     struct Allocator* passwdAlloc;
     String* password;
@@ -105,6 +131,9 @@ struct CryptoAuth_Session_pvt
 
     bool established : 1;
 
+    bool helloSecretValid : 1;
+    bool helloSecretHasPassword : 1;
+
     /** A pointer back to the main cryptoauth context. */
     struct CryptoAuth_pvt* context;
 
@@ -0,0 +1,40 @@
+/* vim: set expandtab ts=4 sw=4: */
+/*
+ * You may redistribute this program and/or modify it under the terms of
+ * the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "crypto/Curve25519.h"
+#include "util/Bits.h"
+
+#include "node_build/dependencies/cnacl/crypto_sign/ed25519/ref10/ge.h"
+
+void Curve25519_scalarmultBase(uint8_t publicKeyOut[32], const uint8_t privateKey[32])
+{
+    uint8_t scalar[32];
+    Bits_memcpy(scalar, privateKey, 32);
+    scalar[0] &= 248;
+    scalar[31] &= 127;
+    scalar[31] |= 64;
+
+    ge_p3 A;
+    ge_scalarmult_base(&A, scalar);
+    Bits_memset(scalar, 0, 32);
+
+    // u = (1 + y) / (1 - y) = (Z + Y) / (Z - Y)
+    fe numerator;
+    fe denominator;
+    fe_add(numerator, A.Z, A.Y);
+    fe_sub(denominator, A.Z, A.Y);
+    fe_invert(denominator, denominator);
+    fe_mul(numerator, numerator, denominator);
+    fe_tobytes(publicKeyOut, numerator);
+}
@@ -0,0 +1,31 @@
+/* vim: set expandtab ts=4 sw=4: */
+/*
+ * You may redistribute this program and/or modify it under the terms of
+ * the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef Curve25519_H
+#define Curve25519_H
+
+#include "util/Linker.h"
+Linker_require("crypto/Curve25519.c");
+
+#include <stdint.h>
+
+/**
+ * Same result as crypto_scalarmult_curve25519_base() but about 12% faster, see the
+ * "curve25519 base" benchmarks. Instead of running the montgomery ladder it uses the table of
+ * multiples of the base point from the ed25519 code and converts the edwards point to the
+ * montgomery u coordinate with one inversion. Runs in constant time so it is fine for secret keys.
+ */
+void Curve25519_scalarmultBase(uint8_t publicKeyOut[32], const uint8_t privateKey[32]);
+
+#endif
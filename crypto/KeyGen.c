@@ -0,0 +1,153 @@
+/* vim: set expandtab ts=4 sw=4: */
+/*
+ * You may redistribute this program and/or modify it under the terms of
+ * the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "crypto/KeyGen.h"
+#include "crypto/AddressCalc.h"
+#include "util/Assert.h"
+#include "util/Bits.h"
+#include "util/Identity.h"
+
+#include "node_build/dependencies/cnacl/crypto_sign/ed25519/ref10/ge.h"
+#include "crypto_hash_sha512.h"
+
+#include <stdbool.h>
+
+struct KeyGen
+{
+    /** Secret from which the first private key of each batch is derived. */
+    uint8_t seed[32];
+    uint64_t batchNumber;
+
+    /** 8 times the base point. */
+    ge_cached eightB;
+
+    /** The private key of the first candidate in the batch, the others follow 8 apart. */
+    uint8_t batchKey[32];
+    uint8_t publicKeys[KeyGen_BATCH][32];
+
+    /** The next candidate to try, KeyGen_BATCH when a new batch is needed. */
+    int next;
+
+    /** Scratch space for the batch inversion. */
+    fe numerators[KeyGen_BATCH];
+    fe denominators[KeyGen_BATCH];
+    fe products[KeyGen_BATCH];
+
+    Identity
+};
+
+struct KeyGen* KeyGen_new(struct Random* rand, struct Allocator* alloc)
+{
+    struct KeyGen* kg = Allocator_calloc(alloc, sizeof(struct KeyGen), 1);
+    Random_bytes(rand, kg->seed, 32);
+    kg->next = KeyGen_BATCH;
+
+    const uint8_t eight[32] = { 8 };
+    ge_p3 eightB;
+    ge_scalarmult_base(&eightB, eight);
+    ge_p3_to_cached(&kg->eightB, &eightB);
+
+    Identity_set(kg);
+    return kg;
+}
+
+static void newBatch(struct KeyGen* kg)
+{
+    uint8_t hashIn[40];
+    uint8_t hash[64];
+    Bits_memcpy(hashIn, kg->seed, 32);
+    Bits_memcpy(&hashIn[32], &kg->batchNumber, 8);
+    kg->batchNumber++;
+    crypto_hash_sha512(hash, hashIn, 40);
+    Bits_memcpy(kg->batchKey, hash, 32);
+    kg->batchKey[0] &= 248;
+    kg->batchKey[31] &= 63;
+    kg->batchKey[31] |= 64;
+
+    // The curve25519 key is u = (Z + Y) / (Z - Y) of the edwards point.
+    ge_p3 point;
+    ge_p1p1 sum;
+    ge_scalarmult_base(&point, kg->batchKey);
+    for (int i = 0; i < KeyGen_BATCH; i++) {
+        fe_add(kg->numerators[i], point.Z, point.Y);
+        fe_sub(kg->denominators[i], point.Z, point.Y);
+        ge_add(&sum, &point, &kg->eightB);
+        ge_p1p1_to_p3(&point, &sum);
+    }
+
+    // Montgomery's trick, invert the product of the denominators then peel them off one by one.
+    fe_copy(kg->products[0], kg->denominators[0]);
+    for (int i = 1; i < KeyGen_BATCH; i++) {
+        fe_mul(kg->products[i], kg->products[i - 1], kg->denominators[i]);
+    }
+    fe inverse;
+    fe_invert(inverse, kg->products[KeyGen_BATCH - 1]);
+    for (int i = KeyGen_BATCH - 1; i >= 0; i--) {
+        fe u;
+        if (i) {
+            fe_mul(u, inverse, kg->products[i - 1]);
+            fe_mul(inverse, inverse, kg->denominators[i]);
+        } else {
+            fe_copy(u, inverse);
+        }
+        fe_mul(u, u, kg->numerators[i]);
+        fe_tobytes(kg->publicKeys[i], u);
+    }
+    kg->next = 0;
+}
+
+static bool hasPrefix(const uint8_t address[16], const uint8_t prefix[16], int prefixBits)
+{
+    int bytes = prefixBits / 8;
+    if (Bits_memcmp(address, prefix, bytes)) { return false; }
+    if (!(prefixBits % 8)) { return true; }
+    uint8_t mask = 0xff << (8 - (prefixBits % 8));
+    return !((address[bytes] ^ prefix[bytes]) & mask);
+}
+
+int KeyGen_search(struct KeyGen* kg,
+                  uint8_t addressOut[16],
+                  uint8_t publicKeyOut[32],
+                  uint8_t privateKeyOut[32],
+                  const uint8_t prefix[16],
+                  int prefixBits,
+                  uint64_t* triesOut)
+{
+    Identity_check(kg);
+    Assert_true(prefixBits >= 8 && prefixBits <= 128);
+    if (kg->next >= KeyGen_BATCH) {
+        newBatch(kg);
+    }
+    for (; kg->next < KeyGen_BATCH; kg->next++) {
+        (*triesOut)++;
+        int i = kg->next;
+        if (!AddressCalc_addressForPublicKey(addressOut, kg->publicKeys[i])) { continue; }
+        if (!hasPrefix(addressOut, prefix, prefixBits)) { continue; }
+
+        // batchKey + 8 * i, carrying into the bits which clamping sets would take ~200 ones.
+        uint32_t carry = 8 * i;
+        for (int j = 0; j < 32; j++) {
+            carry += kg->batchKey[j];
+            privateKeyOut[j] = carry & 0xff;
+            carry >>= 8;
+        }
+        Assert_true((privateKeyOut[31] & 0xc0) == 0x40);
+        Bits_memcpy(publicKeyOut, kg->publicKeys[i], 32);
+
+        // Start over with a new key so that no two keys which are found are related.
+        kg->next = KeyGen_BATCH;
+        return 0;
+    }
+    return -1;
+}
@@ -0,0 +1,61 @@
+/* vim: set expandtab ts=4 sw=4: */
+/*
+ * You may redistribute this program and/or modify it under the terms of
+ * the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef KeyGen_H
+#define KeyGen_H
+
+#include "crypto/random/Random.h"
+#include "memory/Allocator.h"
+#include "util/Linker.h"
+Linker_require("crypto/KeyGen.c");
+
+#include <stdint.h>
+
+/**
+ * Searches for keys whose address is in fc00::/8, or under a longer prefix, much faster than
+ * Key_gen(). Rather than doing a full scalar multiplication for each candidate, the private key
+ * is stepped by 8 (which keeps it clamped) and the public point by 8 times the base point, and
+ * the conversion to curve25519 for a batch of candidates shares one field inversion.
+ * Each batch starts from a new private key derived from a secret seed so keys which are found
+ * are not related to one another.
+ *
+ * A KeyGen is not thread safe but once created it uses no shared state, so keys can be searched
+ * for on many threads by giving each thread its own.
+ */
+struct KeyGen;
+
+/** How many candidates are tried in each batch. */
+#define KeyGen_BATCH 256
+
+/** The rand is only used to create the seed. */
+struct KeyGen* KeyGen_new(struct Random* rand, struct Allocator* alloc);
+
+/**
+ * Try candidates until one is found or the current batch runs out.
+ *
+ * @param prefix the address must begin with the first prefixBits bits of prefix.
+ * @param prefixBits how many bits of prefix to match, at least 8 since every address begins
+ *                   with fc and at most 128.
+ * @param triesOut incremented by the number of candidates which were tried.
+ * @return 0 if a key was found, -1 if the batch ran out first.
+ */
+int KeyGen_search(struct KeyGen* kg,
+                  uint8_t addressOut[16],
+                  uint8_t publicKeyOut[32],
+                  uint8_t privateKeyOut[32],
+                  const uint8_t prefix[16],
+                  int prefixBits,
+                  uint64_t* triesOut);
+
+#endif
@@ -19,12 +19,23 @@
 
 #include <stdbool.h>
 
+/** Number of 64 bit words in the window of a ReplayProtector which has no words given to it. */
+#define ReplayProtector_DEFAULT_WORDS 2
+
 struct ReplayProtector
 {
-    /** internal bitfield. */
-    uint64_t bitfield;
+    /**
+     * The window, a ring of 64 bit words each of which holds the nonces of a block of 64.
+     * If this is NULL then defaultWords is used so a zeroed ReplayProtector is ready to use.
+     */
+    uint64_t* words;
 
-    /** Internal offset. */
+    /** One less than the number of words in the ring, which is a power of 2. */
+    uint32_t wordMask;
+
+    uint64_t defaultWords[ReplayProtector_DEFAULT_WORDS];
+
+    /** Nonces below this have left the window, it is always a multiple of 64. */
     uint32_t baseOffset;
 
     /** Number of definite duplicate packets. */
@@ -42,15 +53,54 @@ struct ReplayProtector
     uint32_t receivedOutOfRange;
 };
 
-static inline int RelayProtector_lostInShift(uint64_t bitfield, int shiftAmount)
+/**
+ * Give the ReplayProtector a bigger window so that packets which are reordered by more than
+ * 64 places are not dropped. The window covers at least (wordCount - 1) * 64 nonces behind the
+ * highest one seen.
+ *
+ * @param words wordCount zeroed words which must live as long as the ReplayProtector.
+ * @param wordCount the number of words, a power of 2, at least 2.
+ * @param context the ReplayProtector, this also resets it.
+ */
+static inline void ReplayProtector_setWindow(uint64_t* words,
+                                             uint32_t wordCount,
+                                             struct ReplayProtector* context)
+{
+    Bits_memset(context, 0, sizeof(struct ReplayProtector));
+    if (wordCount < 2 || (wordCount & (wordCount - 1))) { return; }
+    context->words = words;
+    context->wordMask = wordCount - 1;
+    Bits_memset(words, 0, wordCount * 8);
+}
+
+/** Forget every nonce and clear the counters but keep the window given by setWindow(). */
+static inline void ReplayProtector_reset(struct ReplayProtector* context)
 {
-    if (shiftAmount == 0) {
-        return 0;
+    uint64_t* words = context->words;
+    uint32_t wordMask = context->wordMask;
+    Bits_memset(context, 0, sizeof(struct ReplayProtector));
+    if (words) {
+        context->words = words;
+        context->wordMask = wordMask;
+        Bits_memset(words, 0, (wordMask + 1) * 8);
     }
-    if (shiftAmount > 63) {
-        return shiftAmount - Bits_popCountx64(bitfield);
+}
+
+/**
+ * Start the window at a nonce as if it and every nonce before it had been seen, so that the
+ * nonces which were used up by the handshake do not show up as lost.
+ */
+static inline void ReplayProtector_begin(uint32_t nonce, struct ReplayProtector* context)
+{
+    uint64_t* words = context->words;
+    uint32_t wordMask = context->wordMask;
+    if (!words) {
+        words = context->defaultWords;
+        wordMask = ReplayProtector_DEFAULT_WORDS - 1;
     }
-    return shiftAmount - Bits_popCountx64(bitfield << (64 - shiftAmount));
+    Bits_memset(words, 0, (wordMask + 1) * 8);
+    context->baseOffset = nonce & ~((uint32_t)63);
+    words[(nonce >> 6) & wordMask] = (((uint64_t)2) << (nonce & 63)) - 1;
 }
 
 /**
@@ -58,8 +108,12 @@ static inline int RelayProtector_lostInShift(uint64_t bitfield, int shiftAmount)
  * Don't call this until the packet has been authenticated or else forged packets will
  * make legit ones appear to be duplicates.
  *
- * @param nonce the number to check, this should be a counter nonce as numbers less than 32 minus
- *              the highest seen nonce will be dropped erroniously.
+ * When a nonce is ahead of the window, the window is slid forward by whole words and the
+ * unset bits in the words which leave it are counted as lost. Each word leaves once per 64
+ * nonces so the cost is constant per packet whatever the size of the window.
+ *
+ * @param nonce the number to check, this should be a counter nonce as numbers which are more than
+ *              the window size behind the highest seen nonce will be dropped erroniously.
  * @param context the context
  * @return true if the packet is provably not a replay, otherwise false.
  */
@@ -70,36 +124,37 @@ static inline bool ReplayProtector_checkNonce(const uint32_t nonce, struct Repla
         return false;
     }
 
-    uint32_t offset = nonce - context->baseOffset;
-
-    while (offset > 63) {
-
-        #define ReplayProtector_DO_SHIFT(bits) \
-            context->baseOffset += (bits);     \
-            if ((bits) > 63) {                 \
-                context->bitfield = 0;         \
-            } else {                           \
-                context->bitfield >>= (bits);  \
-            }                                  \
-            offset -= (bits);
-
-        if ((context->bitfield & 0xffffffffu) == 0xffffffffu) {
-            // happy path, low 32 bits are checked in, rotate and continue.
-            ReplayProtector_DO_SHIFT(32);
+    uint64_t* words = context->words;
+    uint32_t wordMask = context->wordMask;
+    if (!words) {
+        words = context->defaultWords;
+        wordMask = ReplayProtector_DEFAULT_WORDS - 1;
+    }
 
-        } else {
-            // we are going to have to accept some losses, take offset - 47 to mitigate that
-            // as much as possible.
-            context->lostPackets += RelayProtector_lostInShift(context->bitfield, offset - 47);
-            ReplayProtector_DO_SHIFT(offset - 47);
+    uint32_t block = nonce >> 6;
+    uint32_t baseBlock = context->baseOffset >> 6;
+    if (block - baseBlock > wordMask) {
+        uint32_t leaving = block - wordMask - baseBlock;
+        if (leaving > wordMask + 1) {
+            // These blocks were skipped over without ever being in the window.
+            context->lostPackets += (leaving - wordMask - 1) * 64;
+            leaving = wordMask + 1;
+        }
+        for (uint32_t i = 0; i < leaving; i++) {
+            uint64_t* word = &words[(baseBlock + i) & wordMask];
+            context->lostPackets += 64 - Bits_popCountx64(*word);
+            *word = 0;
         }
+        context->baseOffset = (block - wordMask) << 6;
     }
 
-    if (context->bitfield & (((uint64_t)1) << offset)) {
+    uint64_t* word = &words[block & wordMask];
+    uint64_t bit = ((uint64_t)1) << (nonce & 63);
+    if (*word & bit) {
         context->duplicates++;
         return false;
     }
-    context->bitfield |= (((uint64_t)1) << offset);
+    *word |= bit;
     return true;
 }
 
@@ -19,6 +19,10 @@
 #include "node_build/dependencies/cnacl/crypto_sign/ed25519/ref10/sc.h"
 #include "crypto_hash_sha512.h"
 #include "crypto_sign_ed25519.h"
+#include "crypto_verify_32.h"
+#include "util/Assert.h"
+
+#include <stdbool.h>
 
 #if crypto_sign_ed25519_open != crypto_sign_ed25519_ref10_open
     Assert_compileTime(crypto_sign_ed25519_open == crypto_sign_ed25519_ref10_open);
@@ -76,21 +80,218 @@ void Sign_signMsg(uint8_t keyPair[64], struct Message* msg, struct Random* rand)
     sc_muladd(&msg->bytes[32], hram, az, r);
 }
 
+/**
+ * Hash R, the public key and the content to get h, without copying the message the public key
+ * is placed over S for the duration.
+ */
+static void hram(uint8_t out[64], uint8_t publicSigningKey[32], struct Message* msg)
+{
+    uint8_t s[32];
+    Bits_memcpy(s, &msg->bytes[32], 32);
+    Bits_memcpy(&msg->bytes[32], publicSigningKey, 32);
+    crypto_hash_sha512(out, msg->bytes, msg->length);
+    Bits_memcpy(&msg->bytes[32], s, 32);
+    sc_reduce(out);
+}
+
 int Sign_verifyMsg(uint8_t publicSigningKey[32], struct Message* msg)
 {
-    if (msg->length < 64) { return -1; }
-    struct Allocator* alloc = Allocator_child(msg->alloc);
-    uint8_t* buff = Allocator_malloc(alloc, msg->length);
-    unsigned long long ml = msg->length;
-    int ret = crypto_sign_ed25519_open(buff, &ml, msg->bytes, msg->length, publicSigningKey);
-    Allocator_free(alloc);
-    if (ret) {
-        return -1;
-    }
+    if (msg->length < 64 || (msg->bytes[63] & 224)) { return -1; }
+    ge_p3 A;
+    if (ge_frombytes_negate_vartime(&A, publicSigningKey)) { return -1; }
+    uint8_t h[64];
+    hram(h, publicSigningKey, msg);
+
+    // R = S*B - h*A
+    ge_p2 R;
+    uint8_t checkR[32];
+    ge_double_scalarmult_vartime(&R, h, &A, &msg->bytes[32]);
+    ge_tobytes(checkR, &R);
+    if (crypto_verify_32(checkR, msg->bytes)) { return -1; }
+
     Er_assert(Message_epop(msg, NULL, 64));
     return 0;
 }
 
+/** Signed odd digits of at most 15 in absolute value, see ge_double_scalarmult.c */
+static void slide(int8_t r[256], const uint8_t a[32])
+{
+    for (int i = 0; i < 256; i++) {
+        r[i] = 1 & (a[i >> 3] >> (i & 7));
+    }
+    for (int i = 0; i < 256; i++) {
+        if (!r[i]) { continue; }
+        for (int b = 1; b <= 6 && i + b < 256; b++) {
+            if (!r[i + b]) { continue; }
+            if (r[i] + (r[i + b] << b) <= 15) {
+                r[i] += r[i + b] << b;
+                r[i + b] = 0;
+            } else if (r[i] - (r[i + b] << b) >= -15) {
+                r[i] -= r[i + b] << b;
+                for (int k = i + b; k < 256; k++) {
+                    if (!r[k]) {
+                        r[k] = 1;
+                        break;
+                    }
+                    r[k] = 0;
+                }
+            } else {
+                break;
+            }
+        }
+    }
+}
+
+/** P, 3P, 5P ... 15P */
+static void oddMultiples(ge_cached out[8], ge_p3* p)
+{
+    ge_p1p1 t;
+    ge_p3 p2;
+    ge_p3 u;
+    ge_p3_to_cached(&out[0], p);
+    ge_p3_dbl(&t, p);
+    ge_p1p1_to_p3(&p2, &t);
+    for (int i = 1; i < 8; i++) {
+        ge_add(&t, &p2, &out[i - 1]);
+        ge_p1p1_to_p3(&u, &t);
+        ge_p3_to_cached(&out[i], &u);
+    }
+}
+
+/**
+ * Straus' method, sum of scalars[i] * points[i] with the doublings shared between all points
+ * so each one only costs the additions for its non-zero digits.
+ */
+static void multiScalarmult(ge_p2* out, ge_cached points[][8], int8_t scalars[][256], int count)
+{
+    int top = -1;
+    for (int j = 0; j < count; j++) {
+        for (int i = 255; i > top; i--) {
+            if (scalars[j][i]) {
+                top = i;
+                break;
+            }
+        }
+    }
+    ge_p2_0(out);
+    for (int i = top; i >= 0; i--) {
+        ge_p1p1 t;
+        ge_p3 u;
+        ge_p2_dbl(&t, out);
+        for (int j = 0; j < count; j++) {
+            int8_t d = scalars[j][i];
+            if (d > 0) {
+                ge_p1p1_to_p3(&u, &t);
+                ge_add(&t, &u, &points[j][d / 2]);
+            } else if (d < 0) {
+                ge_p1p1_to_p3(&u, &t);
+                ge_sub(&t, &u, &points[j][(-d) / 2]);
+            }
+        }
+        ge_p1p1_to_p2(out, &t);
+    }
+}
+
+/**
+ * The single verify compares the encoding of R so a point which decodes from a non-canonical
+ * encoding (y >= 2^255 - 19 or x = 0 with the sign bit set) would never pass it.
+ */
+static bool isCanonical(const uint8_t p[32])
+{
+    int high = p[31] & 0x7f;
+    bool allOnes = (high == 0x7f);
+    bool allZero = !high;
+    for (int i = 1; i < 31; i++) {
+        allOnes = allOnes && p[i] == 0xff;
+        allZero = allZero && !p[i];
+    }
+    if (allOnes && p[0] >= 0xed) { return false; }
+    if (!(p[31] & 0x80)) { return true; }
+    // With the sign bit set, y = 1 and y = -1 are the points where x = 0.
+    return !(allZero && p[0] == 1) && !(allOnes && p[0] == 0xec);
+}
+
+/**
+ * Check that the sum over the signatures of z * (S*B - R - h*A) is the identity where each z is
+ * a random 128 bit number, so an invalid signature can only slip through by guessing its z.
+ * Like other batch verifiers, a signature which differs from a valid one by a point of small
+ * order might pass here and not in Sign_verifyMsg(), only the holder of the key can make one.
+ */
+static int verifyBatch(uint8_t* publicSigningKeys[],
+                       struct Message* msgs[],
+                       int count,
+                       struct Random* rand)
+{
+    Assert_true(count <= Sign_BATCH_MAX);
+    // -R and -A for each signature, then the base point.
+    ge_cached points[Sign_BATCH_MAX * 2 + 1][8];
+    int8_t scalars[Sign_BATCH_MAX * 2 + 1][256];
+    uint8_t sSum[32] = {0};
+    const uint8_t zero[32] = {0};
+
+    for (int i = 0; i < count; i++) {
+        struct Message* msg = msgs[i];
+        if (msg->length < 64 || (msg->bytes[63] & 224) || !isCanonical(msg->bytes)) {
+            return -1;
+        }
+        ge_p3 negR;
+        ge_p3 negA;
+        if (ge_frombytes_negate_vartime(&negA, publicSigningKeys[i])) { return -1; }
+        if (ge_frombytes_negate_vartime(&negR, msg->bytes)) { return -1; }
+        uint8_t h[64];
+        hram(h, publicSigningKeys[i], msg);
+
+        uint8_t z[32] = {0};
+        Random_bytes(rand, z, 16);
+        uint8_t zh[32];
+        sc_muladd(zh, z, h, zero);
+        sc_muladd(sSum, z, &msg->bytes[32], sSum);
+
+        oddMultiples(points[i * 2], &negR);
+        slide(scalars[i * 2], z);
+        oddMultiples(points[i * 2 + 1], &negA);
+        slide(scalars[i * 2 + 1], zh);
+    }
+
+    const uint8_t one[32] = {1};
+    ge_p3 B;
+    ge_scalarmult_base(&B, one);
+    oddMultiples(points[count * 2], &B);
+    slide(scalars[count * 2], sSum);
+
+    ge_p2 sum;
+    multiScalarmult(&sum, points, scalars, count * 2 + 1);
+    uint8_t sumBytes[32];
+    ge_tobytes(sumBytes, &sum);
+    const uint8_t identity[32] = {1};
+    return crypto_verify_32(sumBytes, identity);
+}
+
+int Sign_verifyBatch(uint8_t* publicSigningKeys[],
+                     struct Message* msgs[],
+                     int results[],
+                     int count,
+                     struct Random* rand)
+{
+    int ret = 0;
+    for (int i = 0; i < count; i += Sign_BATCH_MAX) {
+        int n = (count - i < Sign_BATCH_MAX) ? count - i : Sign_BATCH_MAX;
+        if (!verifyBatch(&publicSigningKeys[i], &msgs[i], n, rand)) {
+            for (int j = i; j < i + n; j++) {
+                Er_assert(Message_epop(msgs[j], NULL, 64));
+                results[j] = 0;
+            }
+            continue;
+        }
+        // Something in this batch is bad, find out which ones.
+        for (int j = i; j < i + n; j++) {
+            results[j] = Sign_verifyMsg(publicSigningKeys[j], msgs[j]);
+            ret |= results[j];
+        }
+    }
+    return ret;
+}
+
 int Sign_publicSigningKeyToCurve25519(uint8_t curve25519keyOut[32], uint8_t publicSigningKey[32])
 {
     ge_p3 A;
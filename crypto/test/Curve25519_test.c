@@ -0,0 +1,50 @@
+/* vim: set expandtab ts=4 sw=4: */
+/*
+ * You may redistribute this program and/or modify it under the terms of
+ * the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "crypto/Curve25519.h"
+#include "crypto/random/Random.h"
+#include "memory/MallocAllocator.h"
+#include "util/Assert.h"
+#include "util/Bits.h"
+
+#include "crypto_scalarmult_curve25519.h"
+
+static void check(uint8_t privateKey[32])
+{
+    uint8_t expected[32];
+    uint8_t actual[32];
+    crypto_scalarmult_curve25519_base(expected, privateKey);
+    Curve25519_scalarmultBase(actual, privateKey);
+    Assert_true(!Bits_memcmp(expected, actual, 32));
+}
+
+int main()
+{
+    struct Allocator* alloc = MallocAllocator_new(1<<20);
+    struct Random* rand = Random_new(alloc, NULL, NULL);
+
+    uint8_t privateKey[32];
+    for (int i = 0; i < 1000; i++) {
+        Random_bytes(rand, privateKey, 32);
+        check(privateKey);
+    }
+    // Clamping makes the extremes valid keys too.
+    Bits_memset(privateKey, 0, 32);
+    check(privateKey);
+    Bits_memset(privateKey, 0xff, 32);
+    check(privateKey);
+
+    Allocator_free(alloc);
+    return 0;
+}
@@ -0,0 +1,59 @@
+/* vim: set expandtab ts=4 sw=4: */
+/*
+ * You may redistribute this program and/or modify it under the terms of
+ * the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "crypto/AddressCalc.h"
+#include "crypto/KeyGen.h"
+#include "crypto/random/Random.h"
+#include "memory/MallocAllocator.h"
+#include "util/Assert.h"
+#include "util/Bits.h"
+
+#include "crypto_scalarmult_curve25519.h"
+
+static void check(uint8_t address[16], uint8_t publicKey[32], uint8_t privateKey[32])
+{
+    uint8_t derivedPublic[32];
+    uint8_t derivedAddress[16];
+    crypto_scalarmult_curve25519_base(derivedPublic, privateKey);
+    Assert_true(!Bits_memcmp(derivedPublic, publicKey, 32));
+    Assert_true(AddressCalc_addressForPublicKey(derivedAddress, publicKey));
+    Assert_true(!Bits_memcmp(derivedAddress, address, 16));
+}
+
+int main()
+{
+    struct Allocator* alloc = MallocAllocator_new(1<<20);
+    struct Random* rand = Random_new(alloc, NULL, NULL);
+    struct KeyGen* kg = KeyGen_new(rand, alloc);
+
+    uint8_t address[16];
+    uint8_t publicKey[32];
+    uint8_t privateKey[32];
+    uint8_t lastPrivateKey[32] = {0};
+    uint8_t prefix[16] = { 0xfc, 0x50 };
+    uint64_t tries = 0;
+    for (int prefixBits = 8; prefixBits <= 12; prefixBits += 4) {
+        for (int i = 0; i < 4; i++) {
+            while (KeyGen_search(kg, address, publicKey, privateKey, prefix, prefixBits, &tries)) ;
+            check(address, publicKey, privateKey);
+            Assert_true(address[0] == 0xfc);
+            Assert_true(prefixBits == 8 || (address[1] & 0xf0) == 0x50);
+            Assert_true(Bits_memcmp(privateKey, lastPrivateKey, 32));
+            Bits_memcpy(lastPrivateKey, privateKey, 32);
+        }
+    }
+
+    Allocator_free(alloc);
+    return 0;
+}
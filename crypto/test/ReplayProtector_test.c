@@ -26,7 +26,7 @@ static void testDuplicates(struct Random* rand)
 {
     uint16_t randomShorts[8192];
     uint16_t out[8192];
-    struct ReplayProtector rp = {.bitfield = 0};
+    struct ReplayProtector rp = { .words = NULL };
 
     Random_bytes(rand, (uint8_t*)randomShorts, sizeof(randomShorts));
 
@@ -45,12 +45,83 @@ static void testDuplicates(struct Random* rand)
     }
 }
 
+/** Packets reordered by less than the window are all accepted once, and loss is not counted. */
+static void testReorder(struct Random* rand, uint32_t wordCount)
+{
+    uint64_t words[64];
+    struct ReplayProtector rp;
+    ReplayProtector_setWindow(words, wordCount, &rp);
+    uint32_t window = (wordCount - 1) * 64;
+
+    uint32_t nonces[8192];
+    for (uint32_t i = 0; i < 8192; i++) { nonces[i] = i; }
+    // Shuffle within chunks of the window size.
+    for (uint32_t chunk = 0; chunk < 8192; chunk += window) {
+        uint32_t len = (8192 - chunk < window) ? 8192 - chunk : window;
+        for (uint32_t i = len - 1; i > 0; i--) {
+            uint32_t j = Random_uint32(rand) % (i + 1);
+            uint32_t tmp = nonces[chunk + i];
+            nonces[chunk + i] = nonces[chunk + j];
+            nonces[chunk + j] = tmp;
+        }
+    }
+    for (uint32_t i = 0; i < 8192; i++) {
+        Assert_true(ReplayProtector_checkNonce(nonces[i], &rp));
+    }
+    for (uint32_t i = 0; i < 8192; i++) {
+        Assert_true(!ReplayProtector_checkNonce(nonces[i], &rp));
+    }
+    Assert_true(rp.duplicates + rp.receivedOutOfRange == 8192);
+    Assert_true(rp.lostPackets == 0);
+
+    ReplayProtector_reset(&rp);
+    Assert_true(rp.words == words && !rp.duplicates && !rp.baseOffset);
+    Assert_true(ReplayProtector_checkNonce(0, &rp));
+}
+
+static uint32_t missedBelow(bool* got, uint32_t count, uint32_t baseOffset)
+{
+    uint32_t missed = (baseOffset > count) ? baseOffset - count : 0;
+    for (uint32_t i = 0; i < count && i < baseOffset; i++) {
+        missed += !got[i];
+    }
+    return missed;
+}
+
+/** Every nonce which leaves the window without being seen is counted as lost, exactly once. */
+static void testLoss(struct Random* rand, uint32_t wordCount)
+{
+    uint64_t words[64];
+    struct ReplayProtector rp;
+    ReplayProtector_setWindow(words, wordCount, &rp);
+
+    bool got[20000];
+    for (uint32_t i = 0; i < 20000; i++) {
+        got[i] = (Random_uint8(rand) >= 32);
+        if (got[i]) {
+            Assert_true(ReplayProtector_checkNonce(i, &rp));
+        }
+    }
+    Assert_true(rp.lostPackets == missedBelow(got, 20000, rp.baseOffset));
+
+    // Jump far enough that every word leaves the window.
+    Assert_true(ReplayProtector_checkNonce(1000000, &rp));
+    Assert_true(rp.lostPackets == missedBelow(got, 20000, rp.baseOffset));
+    Assert_true(!ReplayProtector_checkNonce(19999, &rp));
+    Assert_true(rp.receivedOutOfRange == 1);
+}
+
 int main()
 {
     struct Allocator* alloc = MallocAllocator_new(4096);
     struct Random* rand = Random_new(alloc, NULL, NULL);
     for (int i = 0; i < CYCLES; i++) {
         testDuplicates(rand);
+        testReorder(rand, 2);
+        testReorder(rand, 16);
+        testReorder(rand, 64);
+        testLoss(rand, 2);
+        testLoss(rand, 64);
     }
     Allocator_free(alloc);
     return 0;
@@ -19,8 +19,48 @@
 #include "util/Bits.h"
 #include "util/log/FileWriterLog.h"
 
+#include <stdbool.h>
+
 #include "crypto_scalarmult_curve25519.h"
 
+#define BATCH (Sign_BATCH_MAX * 2 + 3)
+
+static void batch(struct Random* rand, struct Allocator* alloc)
+{
+    uint8_t keyPairs[BATCH][64];
+    uint8_t* keys[BATCH];
+    struct Message* msgs[BATCH];
+    int results[BATCH];
+    for (int i = 0; i < BATCH; i++) {
+        uint8_t secret[32];
+        Random_bytes(rand, secret, 32);
+        Sign_signingKeyPairFromCurve25519(keyPairs[i], secret);
+        keys[i] = &keyPairs[i][32];
+        msgs[i] = Message_new(0, 512, alloc);
+        Er_assert(Message_epush(msgs[i], NULL, i * 7));
+        Random_bytes(rand, msgs[i]->bytes, msgs[i]->length);
+        Sign_signMsg(keyPairs[i], msgs[i], rand);
+    }
+
+    Assert_true(!Sign_verifyBatch(keys, msgs, results, BATCH, rand));
+    for (int i = 0; i < BATCH; i++) {
+        Assert_true(!results[i] && msgs[i]->length == i * 7);
+        Er_assert(Message_eshift(msgs[i], 64));
+    }
+
+    // A bad signature, a message signed by someone else and a truncated message.
+    msgs[3]->bytes[40] ^= 1;
+    keys[Sign_BATCH_MAX + 1] = keys[0];
+    msgs[BATCH - 1]->length = 63;
+    Assert_true(Sign_verifyBatch(keys, msgs, results, BATCH, rand));
+    for (int i = 0; i < BATCH; i++) {
+        bool bad = (i == 3 || i == Sign_BATCH_MAX + 1 || i == BATCH - 1);
+        Assert_true(results[i] == (bad ? -1 : 0));
+        Assert_true(msgs[i]->length == (bad ? ((i == BATCH - 1) ? 63 : i * 7 + 64) : i * 7));
+    }
+    Assert_true(Sign_verifyMsg(keys[3], msgs[3]) && msgs[3]->length == 3 * 7 + 64);
+}
+
 int main()
 {
     struct Allocator* alloc = MallocAllocator_new(1048576);
@@ -43,6 +83,8 @@ int main()
     Assert_true(!Sign_publicSigningKeyToCurve25519(curve25519publicB, &signingKeyPair[32]));
     Assert_true(!Bits_memcmp(curve25519publicB, curve25519public, 32));
 
+    batch(rand, alloc);
+
     Allocator_free(alloc);
     return 0;
 }
@@ -28,6 +28,7 @@
 #include "dht/dhtcore/SearchRunner.h"
 #include "dht/dhtcore/SearchRunner_admin.h"
 #include "dht/dhtcore/NodeStore_admin.h"
+#include "dht/dhtcore/NodeStoreSnapshot_admin.h"
 #include "dht/dhtcore/Janitor_admin.h"
 #include "dht/dhtcore/Janitor.h"
 #include "dht/dhtcore/Router_new.h"
@@ -233,6 +234,8 @@ static Iface_DEFUN connected(struct Pathfinder_pvt* pf, struct Message* msg)
         RouterModule_admin_register(routerModule, pf->router, pf->admin, pf->alloc);
         SearchRunner_admin_register(pf->searchRunner, pf->admin, pf->alloc);
         Janitor_admin_register(pf->janitor, pf->admin, pf->alloc);
+        NodeStoreSnapshot_admin_register(
+            pf->nodeStore, pf->janitor, pf->base, pf->log, pf->admin, pf->alloc);
     }
 
     pf->state = Pathfinder_pvt_state_RUNNING;
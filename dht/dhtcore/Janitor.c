@@ -39,6 +39,12 @@
 
 #define MAX_SEARCHES 10
 
+/**
+ * Nodes restored from a snapshot which are pinged each cycle, a few hundred nodes are verified
+ * within about a minute of a restart without flooding the network.
+ */
+#define SNAPSHOT_PINGS_PER_CYCLE 8
+
 /** A path which has recently been probed will be quiet for blacklistPathForMilliseconds */
 struct Janitor_Blacklist
 {
@@ -46,6 +52,15 @@ struct Janitor_Blacklist
     uint64_t path;
 };
 
+/**
+ * Number of slots, starting with the one chosen by the hash of the path, which a path may be
+ * stored in. If they are all holding paths which have not yet expired, the oldest is evicted.
+ */
+#define Janitor_pvt_blacklist_PROBE 8
+
+#define Janitor_pvt_blacklist_MIN_SIZE 16
+#define Janitor_pvt_blacklist_MAX_SIZE (1<<16)
+
 /**
  * The goal of this is to run searches in the local area of this node.
  * it searches for hashes every localMaintainenceSearchPeriod milliseconds.
@@ -67,8 +82,12 @@ struct Janitor_pvt
 
     struct Log* logger;
 
-    #define Janitor_pvt_blacklist_NUM 64
-    struct Janitor_Blacklist blacklist[Janitor_pvt_blacklist_NUM];
+    /**
+     * Open addressed hash table of recently pinged paths, the number of slots is
+     * pub.blacklistStats.size which is always a power of 2.
+     */
+    struct Janitor_Blacklist* blacklist;
+    struct Allocator* blacklistAlloc;
 
     uint64_t timeOfNextGlobalMaintainence;
 
@@ -99,38 +118,65 @@ struct Janitor_Search
     Identity
 };
 
+static uint32_t blacklistSlot(struct Janitor_pvt* j, uint64_t path)
+{
+    // Fibonacci hashing, labels differ mostly in the low bits.
+    return ((path * 0x9e3779b97f4a7c15ull) >> 32) & (j->pub.blacklistStats.size - 1);
+}
+
+static bool isExpired(struct Janitor_pvt* j, struct Janitor_Blacklist* qp, int64_t now)
+{
+    return !qp->path || now - qp->timeAdded >= j->pub.blacklistPathForMilliseconds;
+}
+
 static bool isBlacklisted(struct Janitor_pvt* j, uint64_t path)
 {
     int64_t now = Time_currentTimeMilliseconds(j->eventBase);
-    for (int i = 0; i < Janitor_pvt_blacklist_NUM; i++) {
-        struct Janitor_Blacklist* qp = &j->blacklist[i];
-        if (qp->path == path && now - qp->timeAdded < j->pub.blacklistPathForMilliseconds) {
+    uint32_t mask = j->pub.blacklistStats.size - 1;
+    uint32_t slot = blacklistSlot(j, path);
+    j->pub.blacklistStats.lookups++;
+    for (int i = 0; i < Janitor_pvt_blacklist_PROBE; i++) {
+        struct Janitor_Blacklist* qp = &j->blacklist[(slot + i) & mask];
+        if (qp->path == path && !isExpired(j, qp, now)) {
+            j->pub.blacklistStats.hits++;
             return true;
         }
     }
     return false;
 }
 
-static void blacklist(struct Janitor_pvt* j, uint64_t path)
+static void blacklistAt(struct Janitor_pvt* j, uint64_t path, int64_t now)
 {
-    int64_t now = Time_currentTimeMilliseconds(j->eventBase);
-    int oldestIndex = 0;
-    int64_t oldestTime = INT64_MAX;
-    for (int i = 0; i < Janitor_pvt_blacklist_NUM; i++) {
-        struct Janitor_Blacklist* qp = &j->blacklist[i];
-        if (qp->path == path || now - qp->timeAdded > j->pub.blacklistPathForMilliseconds) {
+    uint32_t mask = j->pub.blacklistStats.size - 1;
+    uint32_t slot = blacklistSlot(j, path);
+    struct Janitor_Blacklist* empty = NULL;
+    struct Janitor_Blacklist* oldest = NULL;
+    for (int i = 0; i < Janitor_pvt_blacklist_PROBE; i++) {
+        struct Janitor_Blacklist* qp = &j->blacklist[(slot + i) & mask];
+        if (qp->path == path) {
             qp->timeAdded = now;
-            qp->path = path;
             return;
-        } else if (qp->timeAdded < oldestTime) {
-            oldestIndex = i;
-            oldestTime = qp->timeAdded;
+        } else if (isExpired(j, qp, now)) {
+            if (!empty) { empty = qp; }
+        } else if (!oldest || qp->timeAdded < oldest->timeAdded) {
+            oldest = qp;
         }
     }
-    Log_debug(j->logger, "Replacing [%lld]ms old blacklist node because blacklist is full",
-        (long long)(now - oldestTime));
-    j->blacklist[oldestIndex].timeAdded = now;
-    j->blacklist[oldestIndex].path = path;
+    j->pub.blacklistStats.insertions++;
+    if (!empty) {
+        Log_debug(j->logger, "Evicting [%lld]ms old blacklist entry because its slots are full",
+            (long long)(now - oldest->timeAdded));
+        j->pub.blacklistStats.evictions++;
+        j->pub.blacklistStats.evictedAgeMilliseconds += now - oldest->timeAdded;
+        empty = oldest;
+    }
+    empty->timeAdded = now;
+    empty->path = path;
+}
+
+static void blacklist(struct Janitor_pvt* j, uint64_t path)
+{
+    blacklistAt(j, path, Time_currentTimeMilliseconds(j->eventBase));
 }
 
 static void responseCallback(struct RouterModule_Promise* promise,
@@ -637,6 +683,11 @@ static void maintanenceCycle(void* vcontext)
         //Log_debug(janitor->logger, "Could not find anything to do");
     }
 
+    // Re-verify nodes which were restored from a snapshot.
+    for (int i = 0; i < SNAPSHOT_PINGS_PER_CYCLE; i++) {
+        if (!tryMill(janitor, janitor->pub.snapshotMill, tryMill_rules_CAN_PING)) { break; }
+    }
+
     // Try to ping the existing node we have heard from least recently.
     tryExistingNode(janitor);
 
@@ -670,6 +721,43 @@ static void maintanenceCycle(void* vcontext)
     }
 }
 
+uint32_t Janitor_setBlacklistSize(struct Janitor* pub, uint32_t size)
+{
+    struct Janitor_pvt* janitor = Identity_check((struct Janitor_pvt*) pub);
+    if (size > Janitor_pvt_blacklist_MAX_SIZE) { size = Janitor_pvt_blacklist_MAX_SIZE; }
+    uint32_t newSize = Janitor_pvt_blacklist_MIN_SIZE;
+    while (newSize < size) { newSize <<= 1; }
+
+    struct Allocator* oldAlloc = janitor->blacklistAlloc;
+    struct Janitor_Blacklist* old = janitor->blacklist;
+    uint32_t oldSize = janitor->pub.blacklistStats.size;
+
+    janitor->blacklistAlloc = Allocator_child(janitor->allocator);
+    janitor->blacklist =
+        Allocator_calloc(janitor->blacklistAlloc, sizeof(struct Janitor_Blacklist), newSize);
+    janitor->pub.blacklistStats.size = newSize;
+
+    // Carry over the paths which are still blacklisted, this counts as insertion again.
+    int64_t now = Time_currentTimeMilliseconds(janitor->eventBase);
+    for (int i = 0; i < (int)oldSize; i++) {
+        if (isExpired(janitor, &old[i], now)) { continue; }
+        blacklistAt(janitor, old[i].path, old[i].timeAdded);
+    }
+    if (oldAlloc) { Allocator_free(oldAlloc); }
+    return newSize;
+}
+
+void Janitor_getBlacklistStats(struct Janitor* pub, struct Janitor_BlacklistStats* out)
+{
+    struct Janitor_pvt* janitor = Identity_check((struct Janitor_pvt*) pub);
+    Bits_memcpy(out, &janitor->pub.blacklistStats, sizeof(struct Janitor_BlacklistStats));
+    int64_t now = Time_currentTimeMilliseconds(janitor->eventBase);
+    out->entries = 0;
+    for (int i = 0; i < (int)out->size; i++) {
+        if (!isExpired(janitor, &janitor->blacklist[i], now)) { out->entries++; }
+    }
+}
+
 struct Janitor* Janitor_new(struct RouterModule* routerModule,
                             struct NodeStore* nodeStore,
                             struct SearchRunner* searchRunner,
@@ -700,10 +788,16 @@ struct Janitor* Janitor_new(struct RouterModule* routerModule,
                                          logger,
                                          "dhtMill");
     janitor->pub.splitMill = RumorMill_new(alloc, nodeStore->selfAddress, 16, logger, "splitMill");
+    janitor->pub.snapshotMill = RumorMill_new(alloc,
+                                              nodeStore->selfAddress,
+                                              NodeStore_DEFAULT_NODE_CAPACITY,
+                                              logger,
+                                              "snapshotMill");
 
     janitor->pub.globalMaintainenceMilliseconds = Janitor_GLOBAL_MAINTENANCE_MILLISECONDS_DEFAULT;
     janitor->pub.localMaintainenceMilliseconds = Janitor_LOCAL_MAINTENANCE_MILLISECONDS_DEFAULT;
     janitor->pub.blacklistPathForMilliseconds = Janitor_BLACKLIST_PATH_FOR_MILLISECONDS_DEFAULT;
+    Janitor_setBlacklistSize(&janitor->pub, Janitor_BLACKLIST_SIZE_DEFAULT);
 
     janitor->timeOfNextGlobalMaintainence = Time_currentTimeMilliseconds(eventBase);
 
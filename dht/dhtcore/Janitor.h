@@ -33,6 +33,30 @@ Linker_require("dht/dhtcore/Janitor.c");
 
 #include <stdint.h>
 
+struct Janitor_BlacklistStats
+{
+    /** Number of paths which can be blacklisted at once. */
+    uint32_t size;
+
+    /** Number of paths currently blacklisted, only filled in by Janitor_getBlacklistStats(). */
+    uint32_t entries;
+
+    /** Number of times a path was checked and number of times it was found blacklisted. */
+    uint64_t lookups;
+    uint64_t hits;
+
+    uint64_t insertions;
+
+    /**
+     * Number of paths which were dropped from the blacklist before they expired because there
+     * was no room, if this is large, the blacklist should be bigger.
+     */
+    uint64_t evictions;
+
+    /** Sum of the ages of the paths when they were evicted. */
+    uint64_t evictedAgeMilliseconds;
+};
+
 struct Janitor
 {
     /**
@@ -59,6 +83,13 @@ struct Janitor
     /** Used for splitting links which are longer than 1 hop. */
     struct RumorMill* splitMill;
 
+    /**
+     * Nodes restored from a NodeStore snapshot after a restart.
+     * A few of these are pinged every cycle, in addition to the normal work, so that the table
+     * warms up quickly but nodes only enter the NodeStore once they have answered.
+     */
+    struct RumorMill* snapshotMill;
+
     /**
      * The number of milliseconds after a path has been (successfully) pinged which it will
      * not be pinged again.
@@ -66,6 +97,10 @@ struct Janitor
     #define Janitor_BLACKLIST_PATH_FOR_MILLISECONDS_DEFAULT 30000
     int64_t blacklistPathForMilliseconds;
 
+    /** The size can be changed with Janitor_setBlacklistSize(). */
+    #define Janitor_BLACKLIST_SIZE_DEFAULT 512
+    struct Janitor_BlacklistStats blacklistStats;
+
     /** The number of milliseconds between attempting local maintenance searches. */
     #define Janitor_LOCAL_MAINTENANCE_MILLISECONDS_DEFAULT 1000
     uint64_t localMaintainenceMilliseconds;
@@ -87,4 +122,17 @@ struct Janitor* Janitor_new(struct RouterModule* routerModule,
                             struct EventBase* eventBase,
                             struct Random* rand);
 
+/**
+ * Change the number of paths which can be blacklisted at once, paths which are blacklisted
+ * remain so.
+ *
+ * @param janitor
+ * @param size the new size, it is rounded up to a power of 2 between 16 and 65536.
+ * @return the size which is used.
+ */
+uint32_t Janitor_setBlacklistSize(struct Janitor* janitor, uint32_t size);
+
+/** Copy the blacklist statistics into out and count the number of active entries. */
+void Janitor_getBlacklistStats(struct Janitor* janitor, struct Janitor_BlacklistStats* out);
+
 #endif
@@ -36,6 +36,8 @@ static struct RumorMill* getRumorMill(struct Context* ctx, String* name)
         return ctx->janitor->dhtMill;
     } else if (String_equals(String_CONST("splitMill"), name)) {
         return ctx->janitor->splitMill;
+    } else if (String_equals(String_CONST("snapshotMill"), name)) {
+        return ctx->janitor->snapshotMill;
     } else {
         return NULL;
     }
@@ -52,7 +54,8 @@ static void dumpRumorMill(Dict* args, void* vcontext, String* txid, struct Alloc
         Dict_putStringC(out,
                        "error",
                        String_CONST("mill must be one of "
-                                    "[externalMill,linkMill,nodeMill,dhtMill,splitMill]"),
+                                    "[externalMill,linkMill,nodeMill,dhtMill,splitMill,"
+                                    "snapshotMill]"),
                        requestAlloc);
         Admin_sendMessage(out, txid, ctx->admin);
         return;
@@ -71,6 +74,50 @@ static void dumpRumorMill(Dict* args, void* vcontext, String* txid, struct Alloc
     Admin_sendMessage(out, txid, ctx->admin);
 }
 
+static void blacklistStats(Dict* args, void* vcontext, String* txid, struct Allocator* requestAlloc)
+{
+    struct Context* ctx = Identity_check((struct Context*) vcontext);
+    struct Janitor_BlacklistStats stats;
+    Janitor_getBlacklistStats(ctx->janitor, &stats);
+
+    Dict* out = Dict_new(requestAlloc);
+    Dict_putIntC(out, "size", stats.size, requestAlloc);
+    Dict_putIntC(out, "entries", stats.entries, requestAlloc);
+    Dict_putIntC(out, "milliseconds", ctx->janitor->blacklistPathForMilliseconds, requestAlloc);
+    Dict_putIntC(out, "lookups", stats.lookups, requestAlloc);
+    Dict_putIntC(out, "hits", stats.hits, requestAlloc);
+    Dict_putIntC(out, "insertions", stats.insertions, requestAlloc);
+    Dict_putIntC(out, "evictions", stats.evictions, requestAlloc);
+    if (stats.evictions) {
+        Dict_putIntC(out, "averageEvictedAge",
+            stats.evictedAgeMilliseconds / stats.evictions, requestAlloc);
+    }
+    Dict_putStringCC(out, "error", "none", requestAlloc);
+    Admin_sendMessage(out, txid, ctx->admin);
+}
+
+static void setBlacklist(Dict* args, void* vcontext, String* txid, struct Allocator* requestAlloc)
+{
+    struct Context* ctx = Identity_check((struct Context*) vcontext);
+    int64_t* size = Dict_getIntC(args, "size");
+    int64_t* milliseconds = Dict_getIntC(args, "milliseconds");
+    Dict* out = Dict_new(requestAlloc);
+    char* err = "none";
+    if (milliseconds && *milliseconds < 0) {
+        err = "milliseconds must not be negative";
+    } else {
+        if (size) {
+            uint32_t s = (*size < 0) ? 0 : (*size > UINT32_MAX) ? UINT32_MAX : *size;
+            Dict_putIntC(out, "size", Janitor_setBlacklistSize(ctx->janitor, s), requestAlloc);
+        }
+        if (milliseconds) {
+            ctx->janitor->blacklistPathForMilliseconds = *milliseconds;
+        }
+    }
+    Dict_putStringCC(out, "error", err, requestAlloc);
+    Admin_sendMessage(out, txid, ctx->admin);
+}
+
 void Janitor_admin_register(struct Janitor* janitor, struct Admin* admin, struct Allocator* alloc)
 {
     struct Context* ctx = Allocator_clone(alloc, (&(struct Context) {
@@ -85,4 +132,12 @@ void Janitor_admin_register(struct Janitor* janitor, struct Admin* admin, struct
             { .name = "page", .required = 1, .type = "Int" },
             { .name = "mill", .required = 1, .type = "String" },
         }), admin);
+
+    Admin_registerFunction("Janitor_blacklistStats", blacklistStats, ctx, false, NULL, admin);
+
+    Admin_registerFunction("Janitor_setBlacklist", setBlacklist, ctx, true,
+        ((struct Admin_FunctionArg[]) {
+            { .name = "size", .required = 0, .type = "Int" },
+            { .name = "milliseconds", .required = 0, .type = "Int" },
+        }), admin);
 }
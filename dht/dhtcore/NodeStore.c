@@ -1700,6 +1700,19 @@ struct Node_Two* NodeStore_getNextNode(struct NodeStore* nodeStore, struct Node_
     return Identity_ncheck(NodeRBTree_RB_NEXT(lastNode));
 }
 
+struct Node_Two* NodeStore_getNodeAfter(struct NodeStore* nodeStore, uint8_t addr[16])
+{
+    struct NodeStore_pvt* store = Identity_check((struct NodeStore_pvt*)nodeStore);
+    struct Node_Two fakeNode;
+    Identity_set(&fakeNode);
+    Bits_memcpy(fakeNode.address.ip6.bytes, addr, 16);
+    struct Node_Two* n = Identity_ncheck(RB_NFIND(NodeRBTree, &store->nodeTree, &fakeNode));
+    if (n && !Bits_memcmp(n->address.ip6.bytes, addr, 16)) {
+        n = Identity_ncheck(NodeRBTree_RB_NEXT(n));
+    }
+    return n;
+}
+
 static struct Node_Two* getBestCycleB(struct Node_Two* node,
                                       uint8_t target[16],
                                       struct NodeStore_pvt* store)
@@ -1761,10 +1774,10 @@ struct Node_Two* NodeStore_getBest(struct NodeStore* nodeStore, uint8_t targetAd
     return NULL;
 }
 
-struct NodeList* NodeStore_getPeers(uint64_t label,
-                                    const uint32_t max,
-                                    struct Allocator* allocator,
-                                    struct NodeStore* nodeStore)
+int NodeStore_getPeerRefs(struct NodeStore* nodeStore,
+                          uint64_t label,
+                          struct Node_Two** out,
+                          const int max)
 {
     struct NodeStore_pvt* store = Identity_check((struct NodeStore_pvt*)nodeStore);
     Log_debug(store->logger, "getPeers request for [%llx]", (unsigned long long) label);
@@ -1774,8 +1787,7 @@ struct NodeList* NodeStore_getPeers(uint64_t label,
         int bitsUsed = NumberCompress_bitsUsedForLabel(label);
         label = (label & Bits_maxBits64(bitsUsed)) | 1 << bitsUsed;
     }
-    struct NodeList* out = Allocator_calloc(allocator, sizeof(struct NodeList), 1);
-    out->nodes = Allocator_calloc(allocator, sizeof(char*), max);
+    Bits_memset(out, 0, max * sizeof(char*));
 
     struct Node_Link* next = NULL;
     RB_FOREACH(next, PeerRBTree, &store->pub.selfNode->peerTree) {
@@ -1785,34 +1797,47 @@ struct NodeList* NodeStore_getPeers(uint64_t label,
         if (p < label) { continue; }
         if (next->child->address.path != p) { continue; }
         int j;
-        for (j = 0; j < (int)max; j++) {
-            if (!out->nodes[j]) { continue; }
-            if ((out->nodes[j]->address.path - label) > (p - label)) { continue; }
+        for (j = 0; j < max; j++) {
+            if (!out[j]) { continue; }
+            if ((out[j]->address.path - label) > (p - label)) { continue; }
             break;
         }
         switch (j) {
-            default: Bits_memmove(out->nodes, &out->nodes[1], (j - 1) * sizeof(char*));
+            default: Bits_memmove(out, &out[1], (j - 1) * sizeof(char*));
                 Gcc_FALLTHRU;
-            case 1: out->nodes[j - 1] = next->child;
+            case 1: out[j - 1] = next->child;
                 Gcc_FALLTHRU;
             case 0:;
         }
     }
 
-    out->size = 0;
-    for (int i = 0; i < (int)max; i++) {
-        if (out->nodes[i]) {
-            out->nodes = &out->nodes[i];
-            out->size = max - i;
+    int size = 0;
+    for (int i = 0; i < max; i++) {
+        if (out[i]) {
+            size = max - i;
+            Bits_memmove(out, &out[i], size * sizeof(char*));
             break;
         }
     }
 
+    for (int i = 0; i < size; i++) {
+        Identity_check(out[i]);
+        checkNode(out[i], store);
+        Assert_true(out[i]->address.path);
+        Assert_true(out[i]->address.path < (((uint64_t)1)<<63));
+    }
+    return size;
+}
+
+struct NodeList* NodeStore_getPeers(uint64_t label,
+                                    const uint32_t max,
+                                    struct Allocator* allocator,
+                                    struct NodeStore* nodeStore)
+{
+    struct NodeList* out = Allocator_calloc(allocator, sizeof(struct NodeList), 1);
+    out->nodes = Allocator_calloc(allocator, sizeof(char*), max);
+    out->size = NodeStore_getPeerRefs(nodeStore, label, out->nodes, max);
     for (int i = 0; i < (int)out->size; i++) {
-        Identity_check(out->nodes[i]);
-        checkNode(out->nodes[i], store);
-        Assert_true(out->nodes[i]->address.path);
-        Assert_true(out->nodes[i]->address.path < (((uint64_t)1)<<63));
         out->nodes[i] = Allocator_clone(allocator, out->nodes[i]);
     }
     return out;
@@ -1836,18 +1861,14 @@ static bool isOkAnswer(struct Node_Two* node,
 }
 
 /** See: NodeStore.h */
-struct NodeList* NodeStore_getClosestNodes(struct NodeStore* nodeStore,
-                                           struct Address* targetAddress,
-                                           const uint32_t count,
-                                           uint32_t compatVer,
-                                           struct Allocator* allocator)
+int NodeStore_getClosestNodeRefs(struct NodeStore* nodeStore,
+                                 struct Address* targetAddress,
+                                 uint32_t compatVer,
+                                 struct Node_Two** out,
+                                 const int count)
 {
     struct NodeStore_pvt* store = Identity_check((struct NodeStore_pvt*)nodeStore);
 
-    struct NodeList* out = Allocator_malloc(allocator, sizeof(struct NodeList));
-    out->nodes = Allocator_calloc(allocator, count, sizeof(char*));
-    out->size = count;
-
     struct Node_Two fakeNode = { .marked = 0 };
     Bits_memcpy(&fakeNode.address, targetAddress, sizeof(struct Address));
 
@@ -1856,34 +1877,48 @@ struct NodeList* NodeStore_getClosestNodes(struct NodeStore* nodeStore,
         next = Identity_ncheck(RB_MAX(NodeRBTree, &store->nodeTree));
     }
     if (!next) {
-        out->size = 0;
-        return out;
+        return 0;
     }
 
     struct Node_Two* prev = Identity_ncheck(NodeRBTree_RB_PREV(next));
-    int idx = out->size-1;
+    int idx = count-1;
 
     while (idx > -1) {
         if (prev && (!next || Address_closest(targetAddress, &next->address, &prev->address) > 0)) {
-            if (isOkAnswer(prev, compatVer, store)) { out->nodes[idx--] = prev; }
+            if (isOkAnswer(prev, compatVer, store)) { out[idx--] = prev; }
             prev = Identity_ncheck(NodeRBTree_RB_PREV(prev));
             continue;
         }
         if (next && (!prev || Address_closest(targetAddress, &next->address, &prev->address) < 0)) {
-            if (isOkAnswer(next, compatVer, store)) { out->nodes[idx--] = next; }
+            if (isOkAnswer(next, compatVer, store)) { out[idx--] = next; }
             next = Identity_ncheck(NodeRBTree_RB_NEXT(next));
             continue;
         }
         break;
     }
 
-    out->nodes = &out->nodes[idx+1];
-    out->size -= idx+1;
+    int size = count - (idx+1);
+    Bits_memmove(out, &out[idx+1], size * sizeof(char*));
 
+    for (int i = 0; i < size; i++) {
+        Identity_check(out[i]);
+        Assert_true(out[i]->address.path);
+        Assert_true(out[i]->address.path < (((uint64_t)1)<<63));
+    }
+    return size;
+}
+
+struct NodeList* NodeStore_getClosestNodes(struct NodeStore* nodeStore,
+                                           struct Address* targetAddress,
+                                           const uint32_t count,
+                                           uint32_t compatVer,
+                                           struct Allocator* allocator)
+{
+    struct NodeList* out = Allocator_malloc(allocator, sizeof(struct NodeList));
+    out->nodes = Allocator_calloc(allocator, count, sizeof(char*));
+    out->size =
+        NodeStore_getClosestNodeRefs(nodeStore, targetAddress, compatVer, out->nodes, count);
     for (int i = 0; i < (int)out->size; i++) {
-        Identity_check(out->nodes[i]);
-        Assert_true(out->nodes[i]->address.path);
-        Assert_true(out->nodes[i]->address.path < (((uint64_t)1)<<63));
         out->nodes[i] = Allocator_clone(allocator, out->nodes[i]);
     }
     return out;
@@ -171,6 +171,22 @@ char* NodeStore_getRouteLabel_strerror(uint64_t returnVal);
  */
 struct Node_Two* NodeStore_getBest(struct NodeStore* nodeStore, uint8_t targetAddress[16]);
 
+/**
+ * Get direct peers of this node without copying them.
+ * The pointers which are written to out are only valid until the NodeStore is next modified,
+ * they are meant for encoding a reply immediately.
+ *
+ * @param store the nodestore.
+ * @param label will get peers whose labels are XOR close to this label.
+ * @param out an array of at least max entries which will be filled with the peers.
+ * @param max will not return more than this number of peers.
+ * @return the number of entries written to out.
+ */
+int NodeStore_getPeerRefs(struct NodeStore* store,
+                          uint64_t label,
+                          struct Node_Two** out,
+                          const int max);
+
 /**
  * Get direct peers of this node.
  * Will get peers with switch labels XOR close to the provided label up to max number.
@@ -185,6 +201,25 @@ struct NodeList* NodeStore_getPeers(uint64_t label,
                                     struct Allocator* allocator,
                                     struct NodeStore* store);
 
+/**
+ * Get the best nodes for servicing a lookup without copying them.
+ * Like NodeStore_getClosestNodes() the nodes are written in order from farthest to closest,
+ * the pointers are only valid until the NodeStore is next modified.
+ *
+ * @param store the store to get the nodes from.
+ * @param targetAddress the address to get closest nodes for.
+ * @param versionOfRequestingNode no nodes will be returned which are known to be incompatible
+ *                                with this version.
+ * @param out an array of at least count entries which will be filled with the nodes.
+ * @param count the maximum number of nodes to return.
+ * @return the number of entries written to out.
+ */
+int NodeStore_getClosestNodeRefs(struct NodeStore* store,
+                                 struct Address* targetAddress,
+                                 uint32_t versionOfRequestingNode,
+                                 struct Node_Two** out,
+                                 const int count);
+
 /**
  * Get the best nodes for servicing a lookup.
  * These are returned in reverse order, from farthest to closest.
@@ -219,6 +254,12 @@ void NodeStore_brokenLink(struct NodeStore* nodeStore, uint64_t path, uint64_t p
 void NodeStore_disconnectedPeer(struct NodeStore* nodeStore, uint64_t path);
 
 struct Node_Two* NodeStore_getNextNode(struct NodeStore* nodeStore, struct Node_Two* lastNode);
+
+/**
+ * The first node whose address comes after addr in the order of NodeStore_getNextNode(),
+ * addr need not be the address of a node which is (still) in the store.
+ */
+struct Node_Two* NodeStore_getNodeAfter(struct NodeStore* nodeStore, uint8_t addr[16]);
 struct Node_Link* NodeStore_getNextLink(struct NodeStore* nodeStore, struct Node_Link* last);
 
 uint64_t NodeStore_timeSinceLastPing(struct NodeStore* nodeStore, struct Node_Two* node);
@@ -0,0 +1,122 @@
+/* vim: set expandtab ts=4 sw=4: */
+/*
+ * You may redistribute this program and/or modify it under the terms of
+ * the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "crypto/AddressCalc.h"
+#include "dht/Address.h"
+#include "dht/dhtcore/Node.h"
+#include "dht/dhtcore/NodeStoreSnapshot.h"
+#include "util/Bits.h"
+#include "util/Endian.h"
+#include "util/Hash.h"
+
+int NodeStoreSnapshot_getBlock(struct NodeStore* nodeStore,
+                               uint8_t cursor[16],
+                               uint8_t out[NodeStoreSnapshot_BLOCK_MAX_SIZE],
+                               bool* more)
+{
+    struct NodeStoreSnapshot_Record* records =
+        (struct NodeStoreSnapshot_Record*) &out[NodeStoreSnapshot_Header_SIZE];
+    int count = 0;
+    *more = false;
+    for (struct Node_Two* nn = NodeStore_getNodeAfter(nodeStore, cursor);
+         nn;
+         nn = NodeStore_getNextNode(nodeStore, nn))
+    {
+        // The self node is not worth saving and nodes which we have no path to can't be pinged.
+        if (nn == nodeStore->selfNode || nn->address.path == UINT64_MAX) { continue; }
+        if (count == NodeStoreSnapshot_RECORDS_PER_BLOCK) {
+            *more = true;
+            break;
+        }
+        struct NodeStoreSnapshot_Record* rec = &records[count++];
+        uint64_t cost = Node_getCost(nn);
+        rec->path_be = Endian_hostToBigEndian64(nn->address.path);
+        Bits_memcpy(rec->key, nn->address.key, 32);
+        rec->protocolVersion_be = Endian_hostToBigEndian32(nn->address.protocolVersion);
+        rec->cost_be = Endian_hostToBigEndian32((cost > UINT32_MAX) ? UINT32_MAX : cost);
+        Bits_memcpy(cursor, nn->address.ip6.bytes, 16);
+    }
+
+    struct NodeStoreSnapshot_Header* hdr = (struct NodeStoreSnapshot_Header*) out;
+    hdr->magic_be = Endian_hostToBigEndian32(NodeStoreSnapshot_MAGIC);
+    hdr->version_be = Endian_hostToBigEndian16(NodeStoreSnapshot_VERSION);
+    hdr->recordSize_be = Endian_hostToBigEndian16(NodeStoreSnapshot_Record_SIZE);
+    hdr->recordCount_be = Endian_hostToBigEndian32(count);
+    int recordsLen = count * NodeStoreSnapshot_Record_SIZE;
+    hdr->checksum_be = Endian_hostToBigEndian32(Hash_compute((uint8_t*) records, recordsLen));
+
+    return NodeStoreSnapshot_Header_SIZE + recordsLen;
+}
+
+int NodeStoreSnapshot_loadBlock(uint8_t* block,
+                                int length,
+                                struct RumorMill* mill,
+                                struct Address* addrsOut)
+{
+    if (length < NodeStoreSnapshot_Header_SIZE) { return NodeStoreSnapshot_loadBlock_TRUNCATED; }
+
+    struct NodeStoreSnapshot_Header hdr;
+    Bits_memcpy(&hdr, block, NodeStoreSnapshot_Header_SIZE);
+    if (Endian_bigEndianToHost32(hdr.magic_be) != NodeStoreSnapshot_MAGIC) {
+        return NodeStoreSnapshot_loadBlock_BAD_MAGIC;
+    }
+    if (Endian_bigEndianToHost16(hdr.version_be) != NodeStoreSnapshot_VERSION) {
+        return NodeStoreSnapshot_loadBlock_BAD_VERSION;
+    }
+    int recordSize = Endian_bigEndianToHost16(hdr.recordSize_be);
+    uint32_t count = Endian_bigEndianToHost32(hdr.recordCount_be);
+    if (recordSize < NodeStoreSnapshot_Record_SIZE || count > NodeStoreSnapshot_RECORDS_PER_BLOCK) {
+        return NodeStoreSnapshot_loadBlock_BAD_LENGTH;
+    }
+    int recordsLen = recordSize * count;
+    if (length < NodeStoreSnapshot_Header_SIZE + recordsLen) {
+        return NodeStoreSnapshot_loadBlock_TRUNCATED;
+    }
+    uint8_t* records = &block[NodeStoreSnapshot_Header_SIZE];
+    if (Endian_bigEndianToHost32(hdr.checksum_be) != Hash_compute(records, recordsLen)) {
+        return NodeStoreSnapshot_loadBlock_BAD_CHECKSUM;
+    }
+
+    int added = 0;
+    for (int i = 0; i < (int)count; i++) {
+        struct NodeStoreSnapshot_Record rec;
+        Bits_memcpy(&rec, &records[i * recordSize], NodeStoreSnapshot_Record_SIZE);
+
+        struct Address addr = { .protocolVersion = 0 };
+        Bits_memcpy(addr.key, rec.key, 32);
+        addr.path = Endian_bigEndianToHost64(rec.path_be);
+        addr.protocolVersion = Endian_bigEndianToHost32(rec.protocolVersion_be);
+        if (!addr.path || addr.path == UINT64_MAX || !addr.protocolVersion) { continue; }
+        if (!AddressCalc_addressForPublicKey(addr.ip6.bytes, addr.key)) { continue; }
+
+        RumorMill_addNode(mill, &addr);
+        if (addrsOut) {
+            Bits_memcpy(&addrsOut[added], &addr, Address_SIZE);
+        }
+        added++;
+    }
+    return added;
+}
+
+char* NodeStoreSnapshot_strerror(int loadBlockError)
+{
+    switch (loadBlockError) {
+        case NodeStoreSnapshot_loadBlock_TRUNCATED: return "NodeStoreSnapshot_TRUNCATED";
+        case NodeStoreSnapshot_loadBlock_BAD_MAGIC: return "NodeStoreSnapshot_BAD_MAGIC";
+        case NodeStoreSnapshot_loadBlock_BAD_VERSION: return "NodeStoreSnapshot_BAD_VERSION";
+        case NodeStoreSnapshot_loadBlock_BAD_LENGTH: return "NodeStoreSnapshot_BAD_LENGTH";
+        case NodeStoreSnapshot_loadBlock_BAD_CHECKSUM: return "NodeStoreSnapshot_BAD_CHECKSUM";
+        default: return "none";
+    }
+}
@@ -0,0 +1,136 @@
+/* vim: set expandtab ts=4 sw=4: */
+/*
+ * You may redistribute this program and/or modify it under the terms of
+ * the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef NodeStoreSnapshot_H
+#define NodeStoreSnapshot_H
+
+#ifdef SUBNODE
+    #error "this file should not be included in subnode"
+#endif
+
+#include "dht/dhtcore/NodeStore.h"
+#include "dht/dhtcore/RumorMill.h"
+#include "util/Assert.h"
+#include "util/Linker.h"
+Linker_require("dht/dhtcore/NodeStoreSnapshot.c");
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * A snapshot of the NodeStore is a sequence of self-contained blocks, each one is a header
+ * followed by recordCount fixed size records. All fields are big endian and naturally aligned
+ * so a file made of concatenated blocks can be mapped and walked in place.
+ *
+ *                     1               2               3
+ *     0 1 2 3 4 5 6 7 0 1 2 3 4 5 6 7 0 1 2 3 4 5 6 7 0 1 2 3 4 5 6 7
+ *    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ *  0 |                         Magic "cjNS"                          |
+ *    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ *  4 |            Version            |          Record Size          |
+ *    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ *  8 |                         Record Count                          |
+ *    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ * 12 |                   Checksum (of the records)                   |
+ *    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ *
+ * Record Size may be larger than NodeStoreSnapshot_Record_SIZE in future versions, readers
+ * only consider the first NodeStoreSnapshot_Record_SIZE bytes of each record.
+ * Record Count is never more than NodeStoreSnapshot_RECORDS_PER_BLOCK.
+ */
+struct NodeStoreSnapshot_Header
+{
+    uint32_t magic_be;
+    uint16_t version_be;
+    uint16_t recordSize_be;
+    uint32_t recordCount_be;
+
+    /** Hash_compute() of all of the records in this block. */
+    uint32_t checksum_be;
+};
+#define NodeStoreSnapshot_Header_SIZE 16
+Assert_compileTime(sizeof(struct NodeStoreSnapshot_Header) == NodeStoreSnapshot_Header_SIZE);
+
+#define NodeStoreSnapshot_MAGIC 0x636a4e53
+#define NodeStoreSnapshot_VERSION 1
+
+struct NodeStoreSnapshot_Record
+{
+    /** The best known path to the node at the time the snapshot was taken. */
+    uint64_t path_be;
+
+    uint8_t key[32];
+
+    uint32_t protocolVersion_be;
+
+    /** Cost of the node when the snapshot was taken, clamped to 32 bits, informational only. */
+    uint32_t cost_be;
+};
+#define NodeStoreSnapshot_Record_SIZE 48
+Assert_compileTime(sizeof(struct NodeStoreSnapshot_Record) == NodeStoreSnapshot_Record_SIZE);
+
+/**
+ * As many records as will fit in an admin request (Admin_MAX_REQUEST_SIZE) once the block is
+ * hex encoded for NodeStore_restore(), 16 records is 1568 hex digits which leaves room for the
+ * rest of the request.
+ */
+#define NodeStoreSnapshot_RECORDS_PER_BLOCK 16
+#define NodeStoreSnapshot_BLOCK_MAX_SIZE \
+    (NodeStoreSnapshot_Header_SIZE +     \
+        (NodeStoreSnapshot_RECORDS_PER_BLOCK * NodeStoreSnapshot_Record_SIZE))
+
+/**
+ * Write one block of the snapshot.
+ * Nodes are written in the order of their addresses and the cursor is the address of the last
+ * one written so each block continues where the last one stopped, even if nodes were added or
+ * removed in between.
+ *
+ * @param nodeStore the store to snapshot.
+ * @param cursor all zeros for the first block, it is set to where the next block begins.
+ * @param out a buffer of at least NodeStoreSnapshot_BLOCK_MAX_SIZE bytes.
+ * @param more will be set to true if there are more nodes after this block.
+ * @return the number of bytes written.
+ */
+int NodeStoreSnapshot_getBlock(struct NodeStore* nodeStore,
+                               uint8_t cursor[16],
+                               uint8_t out[NodeStoreSnapshot_BLOCK_MAX_SIZE],
+                               bool* more);
+
+/**
+ * Load one block of a snapshot.
+ * Nodes are not trusted because the network might have changed since the snapshot was taken,
+ * instead they are added to the rumor mill so that they will be pinged and only enter the
+ * NodeStore if they respond.
+ *
+ * @param block the block to load.
+ * @param length the length of the block.
+ * @param mill the mill to add the restored nodes to.
+ * @param addrsOut if non-null, the addresses of the restored nodes will be copied here,
+ *                 it must have space for NodeStoreSnapshot_RECORDS_PER_BLOCK entries.
+ * @return the number of nodes added or one of the negative error codes below.
+ */
+#define NodeStoreSnapshot_loadBlock_TRUNCATED    -1
+#define NodeStoreSnapshot_loadBlock_BAD_MAGIC    -2
+#define NodeStoreSnapshot_loadBlock_BAD_VERSION  -3
+#define NodeStoreSnapshot_loadBlock_BAD_LENGTH   -4
+#define NodeStoreSnapshot_loadBlock_BAD_CHECKSUM -5
+int NodeStoreSnapshot_loadBlock(uint8_t* block,
+                                int length,
+                                struct RumorMill* mill,
+                                struct Address* addrsOut);
+
+/** @return a string constant describing an error from NodeStoreSnapshot_loadBlock(). */
+char* NodeStoreSnapshot_strerror(int loadBlockError);
+
+#endif
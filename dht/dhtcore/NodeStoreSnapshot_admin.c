@@ -0,0 +1,182 @@
+/* vim: set expandtab ts=4 sw=4: */
+/*
+ * You may redistribute this program and/or modify it under the terms of
+ * the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "admin/Admin.h"
+#include "benc/Dict.h"
+#include "benc/String.h"
+#include "dht/dhtcore/NodeStoreSnapshot.h"
+#include "dht/dhtcore/NodeStoreSnapshot_admin.h"
+#include "util/Bits.h"
+#include "util/Hex.h"
+#include "util/events/Time.h"
+#include "util/events/Timeout.h"
+
+/** How often to check whether one of the restored nodes has become reachable. */
+#define WATCH_INTERVAL_MILLISECONDS 100
+
+/** Stop looking for the first route after this long, the snapshot was probably stale. */
+#define WATCH_GIVE_UP_MILLISECONDS (10 * 60 * 1000)
+
+#define MAX_RESTORED NodeStore_DEFAULT_NODE_CAPACITY
+
+struct Context {
+    struct Admin* admin;
+    struct Allocator* alloc;
+    struct NodeStore* store;
+    struct Janitor* janitor;
+    struct EventBase* base;
+    struct Log* log;
+
+    /** Time when the first block of the snapshot was restored, zero if nothing restored. */
+    uint64_t restoredAt;
+
+    /** Milliseconds from restore until a restored node was reachable, -1 if not (yet). */
+    int64_t timeToFirstRoute;
+
+    struct Timeout* watch;
+
+    int restoredCount;
+    struct Address restored[MAX_RESTORED];
+
+    Identity
+};
+
+static void watchCycle(void* vcontext)
+{
+    struct Context* ctx = Identity_check((struct Context*) vcontext);
+    uint64_t now = Time_currentTimeMilliseconds(ctx->base);
+    for (int i = 0; i < ctx->restoredCount; i++) {
+        if (!NodeStore_nodeForAddr(ctx->store, ctx->restored[i].ip6.bytes)) { continue; }
+        ctx->timeToFirstRoute = now - ctx->restoredAt;
+        Log_info(ctx->log, "First route to a restored node after [%d]ms",
+                 (int) ctx->timeToFirstRoute);
+        Timeout_clearTimeout(ctx->watch);
+        return;
+    }
+    if (now - ctx->restoredAt > WATCH_GIVE_UP_MILLISECONDS) {
+        Log_info(ctx->log, "None of the [%d] restored nodes became reachable, giving up",
+                 ctx->restoredCount);
+        Timeout_clearTimeout(ctx->watch);
+    }
+}
+
+static void snapshot(Dict* args, void* vcontext, String* txid, struct Allocator* requestAlloc)
+{
+    struct Context* ctx = Identity_check((struct Context*) vcontext);
+    String* cursorHex = Dict_getStringC(args, "cursor");
+    uint8_t cursor[16] = { 0 };
+    if (cursorHex && Hex_decode(cursor, 16, cursorHex->bytes, cursorHex->len) != 16) {
+        Dict* out = Dict_new(requestAlloc);
+        Dict_putStringCC(out, "error", "parse_cursor", requestAlloc);
+        Admin_sendMessage(out, txid, ctx->admin);
+        return;
+    }
+
+    uint8_t block[NodeStoreSnapshot_BLOCK_MAX_SIZE];
+    bool more = false;
+    int len = NodeStoreSnapshot_getBlock(ctx->store, cursor, block, &more);
+
+    String* hex = String_newBinary(NULL, len * 2, requestAlloc);
+    Hex_encode(hex->bytes, hex->len, block, len);
+
+    Dict* out = Dict_new(requestAlloc);
+    Dict_putStringC(out, "snapshot", hex, requestAlloc);
+    if (more) {
+        Dict_putIntC(out, "more", 1, requestAlloc);
+        String* next = String_newBinary(NULL, 32, requestAlloc);
+        Hex_encode(next->bytes, next->len, cursor, 16);
+        Dict_putStringC(out, "cursor", next, requestAlloc);
+    }
+    Dict_putStringCC(out, "error", "none", requestAlloc);
+    Admin_sendMessage(out, txid, ctx->admin);
+}
+
+static void restore(Dict* args, void* vcontext, String* txid, struct Allocator* requestAlloc)
+{
+    struct Context* ctx = Identity_check((struct Context*) vcontext);
+    String* hex = Dict_getStringC(args, "snapshot");
+    Dict* out = Dict_new(requestAlloc);
+
+    uint8_t block[NodeStoreSnapshot_BLOCK_MAX_SIZE];
+    int len = -1;
+    if (hex->len <= NodeStoreSnapshot_BLOCK_MAX_SIZE * 2) {
+        len = Hex_decode(block, NodeStoreSnapshot_BLOCK_MAX_SIZE, hex->bytes, hex->len);
+    }
+    if (len < 0) {
+        Dict_putStringCC(out, "error", "parse_snapshot", requestAlloc);
+        Admin_sendMessage(out, txid, ctx->admin);
+        return;
+    }
+
+    struct Address addrs[NodeStoreSnapshot_RECORDS_PER_BLOCK];
+    int ret = NodeStoreSnapshot_loadBlock(block, len, ctx->janitor->snapshotMill, addrs);
+    if (ret < 0) {
+        Dict_putStringCC(out, "error", NodeStoreSnapshot_strerror(ret), requestAlloc);
+        Admin_sendMessage(out, txid, ctx->admin);
+        return;
+    }
+
+    for (int i = 0; i < ret && ctx->restoredCount < MAX_RESTORED; i++) {
+        Bits_memcpy(&ctx->restored[ctx->restoredCount++], &addrs[i], Address_SIZE);
+    }
+    if (!ctx->restoredAt && ret) {
+        ctx->restoredAt = Time_currentTimeMilliseconds(ctx->base);
+        ctx->watch = Timeout_setInterval(
+            watchCycle, ctx, WATCH_INTERVAL_MILLISECONDS, ctx->base, ctx->alloc);
+    }
+
+    Dict_putIntC(out, "restored", ret, requestAlloc);
+    Dict_putStringCC(out, "error", "none", requestAlloc);
+    Admin_sendMessage(out, txid, ctx->admin);
+}
+
+static void status(Dict* args, void* vcontext, String* txid, struct Allocator* requestAlloc)
+{
+    struct Context* ctx = Identity_check((struct Context*) vcontext);
+    Dict* out = Dict_new(requestAlloc);
+    Dict_putIntC(out, "restored", ctx->restoredCount, requestAlloc);
+    Dict_putIntC(out, "pending", ctx->janitor->snapshotMill->count, requestAlloc);
+    Dict_putIntC(out, "timeToFirstRoute", ctx->timeToFirstRoute, requestAlloc);
+    Dict_putStringCC(out, "error", "none", requestAlloc);
+    Admin_sendMessage(out, txid, ctx->admin);
+}
+
+void NodeStoreSnapshot_admin_register(struct NodeStore* nodeStore,
+                                      struct Janitor* janitor,
+                                      struct EventBase* base,
+                                      struct Log* log,
+                                      struct Admin* admin,
+                                      struct Allocator* alloc)
+{
+    struct Context* ctx = Allocator_clone(alloc, (&(struct Context) {
+        .admin = admin,
+        .alloc = alloc,
+        .store = nodeStore,
+        .janitor = janitor,
+        .base = base,
+        .log = log,
+        .timeToFirstRoute = -1
+    }));
+    Identity_set(ctx);
+
+    Admin_registerFunction("NodeStore_snapshot", snapshot, ctx, false,
+        ((struct Admin_FunctionArg[]) {
+            { .name = "cursor", .required = false, .type = "String" },
+        }), admin);
+    Admin_registerFunction("NodeStore_restore", restore, ctx, true,
+        ((struct Admin_FunctionArg[]) {
+            { .name = "snapshot", .required = true, .type = "String" },
+        }), admin);
+    Admin_registerFunction("NodeStore_snapshotStatus", status, ctx, false, NULL, admin);
+}
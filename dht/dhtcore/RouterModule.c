@@ -249,45 +249,45 @@ uint64_t RouterModule_searchTimeoutMilliseconds(struct RouterModule* module)
     return (x > MAX_TIMEOUT) ? MAX_TIMEOUT : (x < MIN_TIMEOUT) ? MIN_TIMEOUT : x;
 }
 
-static inline int sendNodes(struct NodeList* nodeList,
+/**
+ * Encode nodes into the reply, the compact addresses and the version list are written
+ * straight from the NodeStore into the 2 strings which go in the message so there is no
+ * copying of the nodes and no intermediate VersionList.
+ */
+static inline int sendNodes(struct Node_Two** nodeList,
+                            int count,
                             struct DHTMessage* message,
-                            struct RouterModule* module,
-                            uint32_t askerVersion)
+                            struct RouterModule* module)
 {
+    if (count <= 0) { return 0; }
     struct DHTMessage* query = message->replyTo;
-    String* nodes =
-        String_newBinary(NULL, nodeList->size * Address_SERIALIZED_SIZE, message->allocator);
-
-    struct VersionList* versions = VersionList_new(nodeList->size, message->allocator);
+    String* nodes = String_newBinary(NULL, count * Address_SERIALIZED_SIZE, message->allocator);
+    uint32_t versions[RouterModule_K];
 
-    int i = 0;
-    for (; i < (int)nodeList->size; i++) {
+    for (int i = 0; i < count; i++) {
+        uint8_t* out = &nodes->bytes[i * Address_SERIALIZED_SIZE];
 
         // We have to modify the reply in case this node uses a longer label discriminator
         // in our switch than its target address, the target address *must* have the same
         // length or longer.
-        struct Address addr;
-        Bits_memcpy(&addr, &nodeList->nodes[i]->address, sizeof(struct Address));
+        uint64_t path = NumberCompress_getLabelFor(nodeList[i]->address.path,
+                                                   query->address->path);
+        uint64_t path_be = Endian_hostToBigEndian64(path);
+        Bits_memcpy(out, nodeList[i]->address.key, Address_KEY_SIZE);
+        Bits_memcpy(&out[Address_KEY_SIZE], &path_be, Address_NETWORK_ADDR_SIZE);
 
-        addr.path = NumberCompress_getLabelFor(addr.path, query->address->path);
+        versions[i] = nodeList[i]->address.protocolVersion;
 
-        Address_serialize(&nodes->bytes[i * Address_SERIALIZED_SIZE], &addr);
-
-        versions->versions[i] = nodeList->nodes[i]->address.protocolVersion;
-
-        Assert_ifParanoid(!Bits_isZero(&nodes->bytes[i * Address_SERIALIZED_SIZE],
-                                       Address_SERIALIZED_SIZE));
-    }
-    nodes->len = i * Address_SERIALIZED_SIZE;
-    versions->length = i;
-    if (i > 0) {
-        Dict_putString(message->asDict, CJDHTConstants_NODES, nodes, message->allocator);
-        String* versionsStr = VersionList_stringify(versions, message->allocator);
-        Dict_putString(message->asDict,
-                       CJDHTConstants_NODE_PROTOCOLS,
-                       versionsStr,
-                       message->allocator);
+        Assert_ifParanoid(!Bits_isZero(out, Address_SERIALIZED_SIZE));
     }
+    Dict_putString(message->asDict, CJDHTConstants_NODES, nodes, message->allocator);
+
+    uint8_t versionsBytes[VersionList_MAX_ENCODED_SIZE(RouterModule_K)];
+    int versionsLen = VersionList_encode(versionsBytes, versions, count);
+    Dict_putString(message->asDict,
+                   CJDHTConstants_NODE_PROTOCOLS,
+                   String_newBinary((char*) versionsBytes, versionsLen, message->allocator),
+                   message->allocator);
     return 0;
 }
 
@@ -309,7 +309,8 @@ static inline int handleQuery(struct DHTMessage* message,
     int64_t* versionPtr = Dict_getInt(query->asDict, CJDHTConstants_PROTOCOL);
     uint32_t version = (versionPtr && *versionPtr <= UINT32_MAX) ? *versionPtr : 0;
 
-    struct NodeList* nodeList = NULL;
+    struct Node_Two* nodeList[RouterModule_K];
+    int count = 0;
 
     String* queryType = Dict_getString(query->asDict, CJDHTConstants_QUERY);
     if (String_equals(queryType, CJDHTConstants_QUERY_FN)) {
@@ -324,11 +325,11 @@ static inline int handleQuery(struct DHTMessage* message,
         Bits_memcpy(targetAddr.ip6.bytes, target->bytes, Address_SEARCH_TARGET_SIZE);
 
         // send the closest nodes
-        nodeList = NodeStore_getClosestNodes(module->nodeStore,
+        count = NodeStore_getClosestNodeRefs(module->nodeStore,
                                              &targetAddr,
-                                             RouterModule_K,
                                              version,
-                                             message->allocator);
+                                             nodeList,
+                                             RouterModule_K);
 
     } else if (String_equals(queryType, CJDHTConstants_QUERY_GP)) {
         Log_debug(module->logger, "GetPeers Query");
@@ -341,8 +342,7 @@ static inline int handleQuery(struct DHTMessage* message,
         Bits_memcpy(&targetPath, target->bytes, 8);
         targetPath = Endian_bigEndianToHost64(targetPath);
 
-        nodeList =
-            NodeStore_getPeers(targetPath, RouterModule_K, message->allocator, module->nodeStore);
+        count = NodeStore_getPeerRefs(module->nodeStore, targetPath, nodeList, RouterModule_K);
 
     } else if (String_equals(queryType, CJDHTConstants_QUERY_NH)) {
         Log_debug(module->logger, "HN Query");
@@ -352,15 +352,12 @@ static inline int handleQuery(struct DHTMessage* message,
             return 0;
         }
         struct Node_Two* nn = NodeStore_getBest(module->nodeStore, target->bytes);
-        nodeList = Allocator_calloc(message->allocator, sizeof(struct NodeList), 1);
         if (nn) {
-            nodeList->size = 1;
-            nodeList->nodes = Allocator_calloc(message->allocator, sizeof(char*), 1);
-            nodeList->nodes[0] = nn;
+            nodeList[count++] = nn;
         }
     }
 
-    return (nodeList) ? sendNodes(nodeList, message, module, version) : 0;
+    return sendNodes(nodeList, count, message, module);
 }
 
 /**
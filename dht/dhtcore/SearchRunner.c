@@ -37,6 +37,7 @@ struct SearchRunner_pvt
     struct EventBase* eventBase;
     struct RouterModule* router;
     struct RumorMill* rumorMill;
+    struct Allocator* alloc;
     uint8_t myAddress[16];
 
     /** Number of concurrent searches in operation. */
@@ -45,6 +46,12 @@ struct SearchRunner_pvt
     /** Maximum number of concurrent searches allowed. */
     int maxConcurrentSearches;
 
+    /** Number of requests each search may have in flight, shared by all searches. */
+    int alpha;
+
+    /** Replies in a row which came back faster than the global mean response time. */
+    int fastReplies;
+
     /** Beginning of a linked list of searches. */
     struct SearchRunner_Search* firstSearch;
 
@@ -88,6 +95,13 @@ struct SearchRunner_Search
     /** The last node sent a search request. */
     struct Address lastNodeAsked;
 
+    /**
+     * Nodes which we are waiting on a reply from, this includes nodes which were asked by
+     * another search for the same target, their reply is shared.
+     */
+    struct Address inFlight[SearchRunner_MAX_ALPHA];
+    int inFlightCount;
+
     /**
      * The timeout if this timeout is hit then the search will continue
      * but the node will still be allowed to respond and it will be counted as a pong.
@@ -103,6 +117,18 @@ struct SearchRunner_Search
     Identity
 };
 
+/** One request sent out by a search. */
+struct SearchRunner_Query
+{
+    /** The search which sent the request, other searches for the same target may share it. */
+    struct SearchRunner_Search* search;
+
+    /** The node which was asked. */
+    struct Address addr;
+
+    Identity
+};
+
 /**
  * Spot a duplicate entry in a node list.
  * If a router sends a response containing duplicate entries,
@@ -115,35 +141,80 @@ struct SearchRunner_Search
 static inline bool isDuplicateEntry(struct Address_List* list, uint32_t index)
 {
     for (int i = index+1; i < list->length; i++) {
-        if (Bits_memcmp(&list->elems[i].key, &list->elems[i].key, Address_KEY_SIZE) == 0) {
+        if (Bits_memcmp(&list->elems[index].key, &list->elems[i].key, Address_KEY_SIZE) == 0) {
             return true;
         }
     }
     return false;
 }
 
-static void searchStep(struct SearchRunner_Search* search);
+static int inFlightIndex(struct SearchRunner_Search* search, struct Address* addr)
+{
+    for (int i = 0; i < search->inFlightCount; i++) {
+        if (Address_isSameIp(&search->inFlight[i], addr)) { return i; }
+    }
+    return -1;
+}
 
-static void searchReplyCallback(struct RouterModule_Promise* promise,
-                                uint32_t lagMilliseconds,
-                                struct Address* from,
-                                Dict* result)
+static void removeInFlight(struct SearchRunner_Search* search, int index)
 {
-    struct SearchRunner_Search* search =
-        Identity_check((struct SearchRunner_Search*)promise->userData);
+    search->inFlightCount--;
+    if (index < search->inFlightCount) {
+        Bits_memcpy(&search->inFlight[index],
+                    &search->inFlight[search->inFlightCount],
+                    Address_SIZE);
+    }
+}
 
-    if (!Bits_memcmp(from->ip6.bytes, search->lastNodeAsked.ip6.bytes, 16)) {
-        Timeout_resetTimeout(search->continueSearchTimeout,
-                RouterModule_searchTimeoutMilliseconds(search->runner->router));
+static bool isActiveSearch(struct SearchRunner_pvt* runner, struct SearchRunner_Search* search)
+{
+    for (struct SearchRunner_Search* s = runner->firstSearch; s; s = s->nextSearch) {
+        if (s == search) { return true; }
     }
+    return false;
+}
+
+static int maxAlpha(struct SearchRunner_pvt* runner)
+{
+    int max = runner->pub.maxAlpha;
+    return (max < 1) ? 1 : (max > SearchRunner_MAX_ALPHA) ? SearchRunner_MAX_ALPHA : max;
+}
 
-    if (!Bits_memcmp(from->ip6.bytes, search->target.ip6.bytes, 16)) {
-        search->numFinds++;
+/**
+ * Find the number of requests each search may have in flight.
+ * Replies which are slower than twice the global mean response time (or never come) mean some
+ * of the nodes we are asking are dead or far away so more are asked in parallel, a streak of
+ * replies faster than the global mean means the extra requests are mostly wasted.
+ */
+static void adaptAlpha(struct SearchRunner_pvt* runner, uint32_t lagMilliseconds, bool timedOut)
+{
+    uint32_t gmrt = RouterModule_globalMeanResponseTime(runner->router);
+    if (timedOut || lagMilliseconds > gmrt * 2) {
+        runner->fastReplies = 0;
+        if (runner->alpha < maxAlpha(runner)) { runner->alpha++; }
+    } else if (lagMilliseconds <= gmrt) {
+        if (++runner->fastReplies < SearchRunner_ALPHA_DECREASE_AFTER) { return; }
+        runner->fastReplies = 0;
+        if (runner->alpha > SearchRunner_MIN_ALPHA) { runner->alpha--; }
     }
+}
+
+static int currentAlpha(struct SearchRunner_pvt* runner)
+{
+    int max = maxAlpha(runner);
+    return (runner->alpha > max) ? max : runner->alpha;
+}
 
-    struct Address_List* nodeList =
-        ReplySerializer_parse(from, result, search->runner->logger, true, promise->alloc);
+static void searchStep(struct SearchRunner_Search* search);
 
+/**
+ * Add the nodes from a reply to a search, nodes which are further from the target than the
+ * node which replied are noise and are dropped.
+ */
+static void addReplyNodes(struct SearchRunner_Search* search,
+                          struct Address* from,
+                          struct Address_List* nodeList)
+{
     struct Address* best = NULL;
 
     for (int i = 0; nodeList && i < nodeList->length; i++) {
@@ -157,18 +228,6 @@ static void searchReplyCallback(struct RouterModule_Promise* promise,
             continue;
         }
 
-        if (search->lastNodeAsked.path != from->path) {
-            // old queries coming in late...
-            continue;
-        }
-
-        struct Node_Two* nn =
-            NodeStore_getBest(search->runner->nodeStore, nodeList->elems[i].ip6.bytes);
-
-        if (!nn) {
-            RumorMill_addNode(search->runner->rumorMill, &nodeList->elems[i]);
-        }
-
         //nodeList->elems[i].path =
         //    NodeStore_optimizePath(search->runner->nodeStore, nodeList->elems[i].path);
 
@@ -190,27 +249,99 @@ static void searchReplyCallback(struct RouterModule_Promise* promise,
     }
 }
 
+/**
+ * Called when a request is answered or times out.
+ * The reply is handed to every search for the same target which is waiting on that node,
+ * a late reply (one which came in after the search gave up waiting) is only passed to the
+ * callback of the search which asked.
+ */
 static void searchCallback(struct RouterModule_Promise* promise,
                            uint32_t lagMilliseconds,
                            struct Address* from,
                            Dict* result)
 {
-    struct SearchRunner_Search* search =
-        Identity_check((struct SearchRunner_Search*)promise->userData);
+    struct SearchRunner_Query* query =
+        Identity_check((struct SearchRunner_Query*)promise->userData);
+    struct SearchRunner_Search* asker = Identity_check(query->search);
+    struct SearchRunner_pvt* runner = Identity_check(asker->runner);
 
+    adaptAlpha(runner, lagMilliseconds, !from);
+
+    // The asker might be freed by its callback so don't use the promise allocator.
+    struct Allocator* alloc = Allocator_child(runner->alloc);
+    struct Address_List* nodeList = NULL;
+    struct Address target;
+    Bits_memcpy(&target, &asker->target, Address_SIZE);
+    // The query is on the asker's allocator too, searchStep() can free it during the loop below.
+    struct Address queryAddr;
+    Bits_memcpy(&queryAddr, &query->addr, Address_SIZE);
     if (from) {
-        searchReplyCallback(promise, lagMilliseconds, from, result);
+        nodeList = ReplySerializer_parse(from, result, runner->logger, true, alloc);
+        for (int i = 0; nodeList && i < nodeList->length; i++) {
+            if (!NodeStore_getBest(runner->nodeStore, nodeList->elems[i].ip6.bytes)) {
+                RumorMill_addNode(runner->rumorMill, &nodeList->elems[i]);
+            }
+        }
     }
 
-    if (search->pub.callback) {
-        search->pub.callback(&search->pub, lagMilliseconds, from, result);
+    // Searches can end (and be removed from the list) while the reply is being handled.
+    struct SearchRunner_Search* waiting[SearchRunner_DEFAULT_MAX_CONCURRENT_SEARCHES + 1];
+    int waitingCount = 0;
+    bool askerWaiting = false;
+    for (struct SearchRunner_Search* s = runner->firstSearch; s; s = s->nextSearch) {
+        if (waitingCount > SearchRunner_DEFAULT_MAX_CONCURRENT_SEARCHES) { break; }
+        if (Bits_memcmp(s->target.ip6.bytes, target.ip6.bytes, 16)) { continue; }
+        if (inFlightIndex(s, &queryAddr) < 0) { continue; }
+        askerWaiting |= (s == asker);
+        waiting[waitingCount++] = s;
     }
-    searchStep(search);
+    if (!askerWaiting && from) {
+        // old queries coming in late...
+        if (asker->pub.callback) {
+            asker->pub.callback(&asker->pub, lagMilliseconds, from, result);
+        }
+    }
+
+    for (int i = 0; i < waitingCount; i++) {
+        struct SearchRunner_Search* search = waiting[i];
+        if (!isActiveSearch(runner, search)) { continue; }
+        int index = inFlightIndex(search, &queryAddr);
+        if (index < 0) { continue; }
+        removeInFlight(search, index);
+
+        if (from) {
+            Timeout_resetTimeout(search->continueSearchTimeout,
+                                 RouterModule_searchTimeoutMilliseconds(runner->router));
+            if (!Bits_memcmp(from->ip6.bytes, target.ip6.bytes, 16)) {
+                search->numFinds++;
+            }
+            addReplyNodes(search, from, nodeList);
+            if (search->pub.callback) {
+                search->pub.callback(&search->pub, lagMilliseconds, from, result);
+            }
+            if (!isActiveSearch(runner, search)) { continue; }
+        }
+        searchStep(search);
+    }
+
+    Allocator_free(alloc);
+}
+
+/** @return true if another search for the same target is already waiting on this node. */
+static bool isAskedByOtherSearch(struct SearchRunner_Search* search, struct Address* addr)
+{
+    for (struct SearchRunner_Search* s = search->runner->firstSearch; s; s = s->nextSearch) {
+        if (s == search || Bits_memcmp(s->target.ip6.bytes, search->target.ip6.bytes, 16)) {
+            continue;
+        }
+        if (inFlightIndex(s, addr) > -1) { return true; }
+    }
+    return false;
 }
 
 /**
- * Send a search request to the next node in this search.
- * This is called whenever a response comes in or after the global mean response time passes.
+ * Send search requests to the next nodes in this search until alpha requests are in flight.
+ * This is called whenever a response comes in or after the search timeout passes.
  */
 static void searchStep(struct SearchRunner_Search* search)
 {
@@ -218,45 +349,69 @@ static void searchStep(struct SearchRunner_Search* search)
 
     struct SearchStore_Node* nextSearchNode;
     for (;;) {
-        nextSearchNode = SearchStore_getNextNode(search->search);
+        if (search->inFlightCount >= currentAlpha(ctx)) {
+            return;
+        }
 
         // If the number of requests sent has exceeded the max search requests, let's stop there.
         if (search->totalRequests >= search->maxRequests) {
-            // fallthrough
+            break;
         } else if (search->numFinds > 0 && search->totalRequests >= search->maxRequestsIfFound) {
-            // fallthrough
-        } else if (nextSearchNode == NULL) {
-            // fallthrough
-        } else {
             break;
         }
-        if (search->pub.callback) {
-            search->pub.callback(&search->pub, 0, NULL, NULL);
+
+        nextSearchNode = SearchStore_getNextNode(search->search);
+        if (nextSearchNode == NULL) {
+            break;
         }
-        Allocator_free(search->pub.alloc);
-        return;
-    }
 
-    Bits_memcpy(&search->lastNodeAsked, &nextSearchNode->address, sizeof(struct Address));
+        if (isAskedByOtherSearch(search, &nextSearchNode->address)) {
+            // Wait for the reply to the other search rather than asking the same thing twice.
+            Bits_memcpy(&search->inFlight[search->inFlightCount++],
+                        &nextSearchNode->address,
+                        Address_SIZE);
+            continue;
+        }
 
-    struct RouterModule_Promise* rp =
-        RouterModule_newMessage(&nextSearchNode->address, 0, ctx->router, search->pub.alloc);
+        Bits_memcpy(&search->lastNodeAsked, &nextSearchNode->address, sizeof(struct Address));
+        Bits_memcpy(&search->inFlight[search->inFlightCount++],
+                    &nextSearchNode->address,
+                    Address_SIZE);
 
-    Dict* message = Dict_new(rp->alloc);
+        struct RouterModule_Promise* rp =
+            RouterModule_newMessage(&nextSearchNode->address, 0, ctx->router, search->pub.alloc);
 
-    if (!Bits_memcmp(nextSearchNode->address.ip6.bytes, search->target.ip6.bytes, 16)) {
-        Dict_putString(message, CJDHTConstants_QUERY, CJDHTConstants_QUERY_GP, rp->alloc);
-    } else {
-        Dict_putString(message, CJDHTConstants_QUERY, CJDHTConstants_QUERY_FN, rp->alloc);
-    }
-    Dict_putString(message, CJDHTConstants_TARGET, search->targetStr, rp->alloc);
+        Dict* message = Dict_new(rp->alloc);
+
+        if (!Bits_memcmp(nextSearchNode->address.ip6.bytes, search->target.ip6.bytes, 16)) {
+            Dict_putString(message, CJDHTConstants_QUERY, CJDHTConstants_QUERY_GP, rp->alloc);
+        } else {
+            Dict_putString(message, CJDHTConstants_QUERY, CJDHTConstants_QUERY_FN, rp->alloc);
+        }
+        Dict_putString(message, CJDHTConstants_TARGET, search->targetStr, rp->alloc);
 
-    rp->userData = search;
-    rp->callback = searchCallback;
+        struct SearchRunner_Query* query =
+            Allocator_calloc(rp->alloc, sizeof(struct SearchRunner_Query), 1);
+        query->search = search;
+        Bits_memcpy(&query->addr, &nextSearchNode->address, Address_SIZE);
+        Identity_set(query);
 
-    RouterModule_sendMessage(rp, message);
+        rp->userData = query;
+        rp->callback = searchCallback;
 
-    search->totalRequests++;
+        RouterModule_sendMessage(rp, message);
+
+        search->totalRequests++;
+    }
+
+    // Nothing more to send, the search is over once the last replies are in.
+    if (search->inFlightCount) {
+        return;
+    }
+    if (search->pub.callback) {
+        search->pub.callback(&search->pub, 0, NULL, NULL);
+    }
+    Allocator_free(search->pub.alloc);
 }
 
 // Triggered by a search timeout (the message may still come back and will be treated as a ping)
@@ -264,6 +419,12 @@ static void searchNextNode(void* vsearch)
 {
     struct SearchRunner_Search* search = Identity_check((struct SearchRunner_Search*) vsearch);
 
+    // Stop waiting for the nodes which have not answered, they are probably dead.
+    if (search->inFlightCount) {
+        search->inFlightCount = 0;
+        adaptAlpha(search->runner, 0, true);
+    }
+
     // Timeout for trying the next node.
     Timeout_resetTimeout(search->continueSearchTimeout,
                          RouterModule_searchTimeoutMilliseconds(search->runner->router));
@@ -303,8 +464,10 @@ struct SearchRunner_SearchData* SearchRunner_showActiveSearch(struct SearchRunne
         Bits_memcpy(out->target, &search->target.ip6.bytes, 16);
         Bits_memcpy(&out->lastNodeAsked, &search->lastNodeAsked, sizeof(struct Address));
         out->totalRequests = search->totalRequests;
+        out->inFlight = search->inFlightCount;
     }
     out->activeSearches = runner->searches;
+    out->alpha = currentAlpha(runner);
 
     return out;
 }
@@ -399,7 +562,12 @@ struct SearchRunner* SearchRunner_new(struct NodeStore* nodeStore,
         .eventBase = base,
         .router = module,
         .rumorMill = rumorMill,
-        .maxConcurrentSearches = SearchRunner_DEFAULT_MAX_CONCURRENT_SEARCHES
+        .alloc = alloc,
+        .maxConcurrentSearches = SearchRunner_DEFAULT_MAX_CONCURRENT_SEARCHES,
+        .alpha = SearchRunner_DEFAULT_ALPHA,
+        .pub = {
+            .maxAlpha = SearchRunner_DEFAULT_MAX_ALPHA
+        }
     }));
     out->searchStore = SearchStore_new(alloc, logger);
     Bits_memcpy(out->myAddress, myAddress, 16);
@@ -42,15 +42,42 @@ struct SearchRunner_SearchData
 
     /** Number of searches which are currently active. */
     int activeSearches;
+
+    /** How many requests are waiting for a reply. */
+    int inFlight;
+
+    /** How many requests the search may have waiting for a reply at once. */
+    int alpha;
 };
 
 struct SearchRunner
 {
-    int unused;
+    /**
+     * The most requests which a single search may have waiting for a reply,
+     * the actual number (alpha) adapts between SearchRunner_MIN_ALPHA and this.
+     * Set to 1 to ask one node at a time.
+     */
+    int maxAlpha;
 };
 
 #define SearchRunner_DEFAULT_MAX_CONCURRENT_SEARCHES 30
 
+/** Hard upper bound on maxAlpha. */
+#define SearchRunner_MAX_ALPHA 8
+
+/** The alpha which a new SearchRunner begins with and the default maxAlpha. */
+#define SearchRunner_DEFAULT_ALPHA 3
+#define SearchRunner_DEFAULT_MAX_ALPHA 6
+
+/**
+ * Alpha is never reduced below this, even when replies come back quickly
+ * because asking nodes in parallel is what saves round trips.
+ */
+#define SearchRunner_MIN_ALPHA 2
+
+/** Number of consecutive replies faster than the global mean before alpha is reduced. */
+#define SearchRunner_ALPHA_DECREASE_AFTER 8
+
 /** The maximum number of requests to make before calling a search failed. */
 #define SearchRunner_DEFAULT_MAX_REQUESTS 8
 
@@ -61,6 +88,8 @@ struct SearchRunner
  * Start a search.
  * The returned promise will have it's callback called for each result of the search and
  * then it will be called with 0 milliseconds lag and NULL response indicating the search is over.
+ * Up to alpha nodes are asked in parallel, if another search for the same target is already
+ * waiting on a node then that node is not asked again and the reply is shared by both searches.
  *
  * @param searchTarget the address to search for.
  * @param maxRequests the number of requests to make before terminating the search.
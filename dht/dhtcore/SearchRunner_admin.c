@@ -56,8 +56,10 @@ static void showActiveSearch(Dict* args, void* vctx, String* txid, struct Alloca
                        alloc);
 
         Dict_putInt(dict, String_new("totalRequests", alloc), search->totalRequests, alloc);
+        Dict_putIntC(dict, "inFlight", search->inFlight, alloc);
     }
     Dict_putInt(dict, String_new("activeSearches", alloc), search->activeSearches, alloc);
+    Dict_putIntC(dict, "alpha", search->alpha, alloc);
 
     Admin_sendMessage(dict, txid, ctx->admin);
 }
@@ -15,9 +15,8 @@
 #include "dht/dhtcore/VersionList.h"
 #include "memory/Allocator.h"
 #include "io/Reader.h"
-#include "io/Writer.h"
-#include "io/ArrayWriter.h"
 #include "io/ArrayReader.h"
+#include "util/Bits.h"
 #include "util/Endian.h"
 #include <stdio.h>
 
@@ -45,29 +44,35 @@ struct VersionList* VersionList_parse(String* str, struct Allocator* alloc)
     return list;
 }
 
-String* VersionList_stringify(struct VersionList* list, struct Allocator* alloc)
+static uint8_t numberSizeFor(const uint32_t* versions, int count)
 {
     uint8_t numberSize = 1;
     uint32_t max = 0xff;
-    for (int i = 0; i < (int)list->length; i++) {
-        while (list->versions[i] >= max) {
+    for (int i = 0; i < count; i++) {
+        while (versions[i] >= max) {
             numberSize++;
             max = max << 8 | 0xff;
         }
     }
+    return numberSize;
+}
 
-    String* out = String_newBinary(NULL, (numberSize * list->length + 1), alloc);
-
-    struct Writer* w = ArrayWriter_new(out->bytes, out->len, alloc);
-    Writer_write(w, &numberSize, 1);
-
-    for (int i = 0; i < (int)list->length; i++) {
-        uint32_t ver = list->versions[i] << ((4-numberSize) * 8);
-        ver = Endian_hostToBigEndian32(ver);
-        Writer_write(w, (uint8_t*) &ver, numberSize);
+int VersionList_encode(uint8_t* out, const uint32_t* versions, int count)
+{
+    const uint8_t numberSize = numberSizeFor(versions, count);
+    out[0] = numberSize;
+    for (int i = 0; i < count; i++) {
+        uint32_t ver = Endian_hostToBigEndian32(versions[i] << ((4-numberSize) * 8));
+        Bits_memcpy(&out[1 + i * numberSize], &ver, numberSize);
     }
-    Writer_write(w, &numberSize, 1);
+    return 1 + count * numberSize;
+}
 
+String* VersionList_stringify(struct VersionList* list, struct Allocator* alloc)
+{
+    uint8_t numberSize = numberSizeFor(list->versions, list->length);
+    String* out = String_newBinary(NULL, (numberSize * list->length + 1), alloc);
+    VersionList_encode(out->bytes, list->versions, list->length);
     return out;
 }
 
@@ -31,6 +31,19 @@ struct VersionList
 
 struct VersionList* VersionList_parse(String* str, struct Allocator* alloc);
 
+/** The most bytes which VersionList_encode() will write for a list of count versions. */
+#define VersionList_MAX_ENCODED_SIZE(count) (1 + (count) * 4)
+
+/**
+ * Encode a list of versions directly into a buffer without building a VersionList.
+ *
+ * @param out a buffer of at least VersionList_MAX_ENCODED_SIZE(count) bytes.
+ * @param versions the versions to encode.
+ * @param count the number of versions.
+ * @return the number of bytes written.
+ */
+int VersionList_encode(uint8_t* out, const uint32_t* versions, int count);
+
 String* VersionList_stringify(struct VersionList* list, struct Allocator* alloc);
 
 struct VersionList* VersionList_new(uint32_t count, struct Allocator* alloc);
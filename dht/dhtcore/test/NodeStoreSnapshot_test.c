@@ -0,0 +1,99 @@
+/* vim: set expandtab ts=4 sw=4: */
+/*
+ * You may redistribute this program and/or modify it under the terms of
+ * the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "memory/MallocAllocator.h"
+#include "crypto/Key.h"
+#include "crypto/random/Random.h"
+#include "dht/Address.h"
+#include "dht/dhtcore/Node.h"
+#include "dht/dhtcore/NodeStore.h"
+#include "dht/dhtcore/NodeStoreSnapshot.h"
+#include "dht/dhtcore/RumorMill.h"
+#include "switch/NumberCompress.h"
+#include "util/Assert.h"
+#include "util/Bits.h"
+#include "util/log/FileWriterLog.h"
+#include "util/version/Version.h"
+
+/** Enough for a few blocks with a part filled one at the end. */
+#define NODES (NodeStoreSnapshot_RECORDS_PER_BLOCK * 2 + 7)
+
+static void genAddress(struct Address* addr, uint64_t path, struct Random* rand)
+{
+    uint8_t privateKey[32];
+    Bits_memset(addr, 0, Address_SIZE);
+    Key_gen(addr->ip6.bytes, addr->key, privateKey, rand);
+    addr->path = path;
+    addr->protocolVersion = Version_CURRENT_PROTOCOL;
+}
+
+int main(int argc, char** argv)
+{
+    struct Allocator* alloc = MallocAllocator_new(1<<20);
+    struct Log* logger = FileWriterLog_new(stdout, alloc);
+    struct EventBase* base = EventBase_new(alloc);
+    struct Random* rand = Random_new(alloc, NULL, NULL);
+
+    struct Address myAddr;
+    genAddress(&myAddr, 1, rand);
+    struct NodeStore* ns = NodeStore_new(&myAddr, alloc, base, logger, NULL);
+    struct EncodingScheme* scheme = NumberCompress_v3x5x8_defineScheme(alloc);
+
+    struct Address addrs[NODES];
+    for (int i = 0; i < NODES; i++) {
+        uint32_t bits = NumberCompress_v3x5x8_bitsUsedForNumber(i + 2);
+        uint64_t label = NumberCompress_v3x5x8_getCompressed(i + 2, bits) | (1ull << bits);
+        genAddress(&addrs[i], label, rand);
+        Assert_true(NodeStore_discoverNode(ns, &addrs[i], scheme, 0, 100));
+    }
+
+    struct RumorMill* mill = RumorMill_new(alloc, &myAddr, 64, logger, "test");
+    uint8_t block[NodeStoreSnapshot_BLOCK_MAX_SIZE];
+    uint8_t cursor[16] = { 0 };
+    int restored = 0;
+    int blocks = 0;
+    bool more = true;
+    while (more) {
+        int len = NodeStoreSnapshot_getBlock(ns, cursor, block, &more);
+        blocks++;
+        struct Address out[NodeStoreSnapshot_RECORDS_PER_BLOCK];
+        int ret = NodeStoreSnapshot_loadBlock(block, len, mill, out);
+        Assert_true(ret >= 0 && ret <= NodeStoreSnapshot_RECORDS_PER_BLOCK);
+        for (int i = 0; i < ret; i++) {
+            struct Node_Two* nn = NodeStore_nodeForAddr(ns, out[i].ip6.bytes);
+            Assert_true(nn && nn->address.path == out[i].path);
+        }
+        restored += ret;
+
+        if (ret) {
+            Assert_true(NodeStoreSnapshot_loadBlock(block, len - 1, mill, NULL) ==
+                NodeStoreSnapshot_loadBlock_TRUNCATED);
+            block[len - 1] ^= 1;
+            Assert_true(NodeStoreSnapshot_loadBlock(block, len, mill, NULL) ==
+                NodeStoreSnapshot_loadBlock_BAD_CHECKSUM);
+            block[4] ^= 1;
+            Assert_true(NodeStoreSnapshot_loadBlock(block, len, mill, NULL) ==
+                NodeStoreSnapshot_loadBlock_BAD_VERSION);
+            block[0] ^= 1;
+            Assert_true(NodeStoreSnapshot_loadBlock(block, len, mill, NULL) ==
+                NodeStoreSnapshot_loadBlock_BAD_MAGIC);
+        }
+    }
+    Assert_true(restored == NODES);
+    Assert_true(blocks == 3);
+    Assert_true(mill->count == NODES);
+
+    Allocator_free(alloc);
+    return 0;
+}
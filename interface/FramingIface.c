@@ -19,13 +19,9 @@
 #include "wire/Error.h"
 #include "util/Assert.h"
 
-#define REQUIRED_PADDING 512
+#include <stdbool.h>
 
-struct MessageList;
-struct MessageList {
-    struct Message* msg;
-    struct MessageList* next;
-};
+#define REQUIRED_PADDING 512
 
 struct FramingIface_pvt {
     struct Iface messageIf;
@@ -33,10 +29,12 @@ struct FramingIface_pvt {
     const uint32_t maxMessageSize;
     struct Allocator* alloc;
 
-    // fields specific to this frame.
-    uint32_t bytesRemaining;
+    /** The frame which is being put together from more than one read, or NULL. */
+    struct Message* frame;
     struct Allocator* frameAlloc;
-    struct MessageList* frameParts;
+
+    /** The number of bytes which are still missing from frame. */
+    uint32_t bytesRemaining;
 
     union {
         uint32_t length_be;
@@ -47,31 +45,6 @@ struct FramingIface_pvt {
     Identity
 };
 
-static struct Message* mergeMessage(struct FramingIface_pvt* fi, struct Message* last)
-{
-    int length = last->length;
-
-    // The only accurate way to get the full length because this last might contain
-    // the beginning of the next frame.
-    struct MessageList* part = fi->frameParts;
-    for (part = fi->frameParts; part; part = part->next) {
-        length += part->msg->length;
-    }
-
-    struct Message* out = Message_new(0, length + REQUIRED_PADDING, fi->frameAlloc);
-    Er_assert(Message_epush(out, last->bytes, last->length));
-    out->associatedFd = last->associatedFd;
-    for (part = fi->frameParts; part; part = part->next) {
-        Er_assert(Message_epush(out, part->msg->bytes, part->msg->length));
-        if (!out->associatedFd) {
-            out->associatedFd = part->msg->associatedFd;
-        }
-    }
-
-    Assert_true(length <= out->length);
-    return out;
-}
-
 static Iface_DEFUN receiveMessage(struct Message* msg, struct Iface* streamIf)
 {
     struct FramingIface_pvt* fi = Identity_containerOf(streamIf, struct FramingIface_pvt, streamIf);
@@ -82,79 +55,78 @@ static Iface_DEFUN receiveMessage(struct Message* msg, struct Iface* streamIf)
         return NULL;
     }
 
-    if (fi->frameParts) {
-        if (fi->bytesRemaining <= (uint32_t)msg->length) {
-            struct Message* wholeMessage = mergeMessage(fi, msg);
-            fi->bytesRemaining = 0;
-            fi->frameParts = NULL;
-            Assert_true(fi->headerIndex == 0);
-            struct Allocator* frameAlloc = fi->frameAlloc;
-            fi->frameAlloc = NULL;
-            // Run the message through again since it's almost certainly not perfect size.
-            Iface_CALL(receiveMessage, wholeMessage, streamIf);
-            Allocator_free(frameAlloc);
+    if (fi->frame) {
+        uint32_t length = (uint32_t) msg->length;
+        if (length > fi->bytesRemaining) { length = fi->bytesRemaining; }
+        uint8_t* out = &fi->frame->bytes[fi->frame->length - fi->bytesRemaining];
+        Er_assert(Message_epop(msg, out, length));
+        fi->bytesRemaining -= length;
+        if (!fi->frame->associatedFd) {
+            fi->frame->associatedFd = msg->associatedFd;
+        }
+        if (fi->bytesRemaining) {
             return NULL;
         }
-        fi->bytesRemaining -= msg->length;
-        Allocator_adopt(fi->frameAlloc, msg->alloc);
-        struct MessageList* parts = Allocator_calloc(fi->frameAlloc, sizeof(struct MessageList), 1);
-        parts->msg = msg;
-        parts->next = fi->frameParts;
-        fi->frameParts = parts;
-        return NULL;
+        struct Message* frame = fi->frame;
+        struct Allocator* frameAlloc = fi->frameAlloc;
+        fi->frame = NULL;
+        fi->frameAlloc = NULL;
+        Iface_send(&fi->messageIf, frame);
+        Allocator_free(frameAlloc);
     }
 
-    for (;;) {
-        while (fi->headerIndex < 4) {
-            if (!msg->length) {
+    // Set once a frame has been delivered as a slice, the bytes in front of what is left of msg
+    // then belong to that frame and must not be used as padding.
+    bool sliced = false;
+    while (msg->length) {
+        if (fi->headerIndex < 4) {
+            uint32_t length = 4 - fi->headerIndex;
+            if (length > (uint32_t) msg->length) { length = msg->length; }
+            Er_assert(Message_epop(msg, &fi->header.bytes[fi->headerIndex], length));
+            fi->headerIndex += length;
+            if (fi->headerIndex < 4) {
                 return NULL;
             }
-            fi->header.bytes[fi->headerIndex] = msg->bytes[0];
-            Er_assert(Message_eshift(msg, -1));
-            fi->headerIndex++;
         }
         fi->headerIndex = 0;
 
-        fi->bytesRemaining = Endian_bigEndianToHost32(fi->header.length_be);
-        if (fi->bytesRemaining > fi->maxMessageSize) {
-            // oversize
+        uint32_t frameLength = Endian_bigEndianToHost32(fi->header.length_be);
+        if (frameLength > fi->maxMessageSize) {
+            // oversize, everything which comes after is dropped.
+            fi->bytesRemaining = frameLength;
             Assert_ifTesting(0);
             return NULL;
         }
 
-        if (fi->bytesRemaining == (uint32_t)msg->length) {
-            fi->bytesRemaining = 0;
+        if (frameLength == (uint32_t)msg->length) {
+            if (sliced) { msg->padding = 0; }
             return Iface_next(&fi->messageIf, msg);
 
-        } else if (fi->bytesRemaining < (uint32_t)msg->length) {
-            struct Allocator* alloc = Allocator_child(msg->alloc);
-            struct Message* m = Message_new(fi->bytesRemaining, REQUIRED_PADDING, alloc);
+        } else if (frameLength < (uint32_t)msg->length) {
+            // The frame is delivered where it lies in the buffer which was read. Only the first
+            // one may use the padding of the read, pushing onto the others fails rather than
+            // overwriting the frames before them.
+            struct Message* m = Allocator_calloc(msg->alloc, sizeof(struct Message), 1);
+            m->bytes = msg->bytes;
+            m->length = m->capacity = frameLength;
+            m->padding = (sliced) ? 0 : msg->padding;
             m->associatedFd = msg->associatedFd;
-            Bits_memcpy(m->bytes, msg->bytes, fi->bytesRemaining);
-            Er_assert(Message_eshift(msg, -fi->bytesRemaining));
-            fi->bytesRemaining = 0;
+            m->alloc = msg->alloc;
+            Er_assert(Message_eshift(msg, -frameLength));
+            sliced = true;
             Iface_send(&fi->messageIf, m);
-            Allocator_free(alloc);
-            continue;
 
         } else {
+            // The frame will be finished by the next reads, it is copied once into a buffer
+            // which is big enough for all of it.
             fi->frameAlloc = Allocator_child(fi->alloc);
-            struct Message* m = Allocator_calloc(fi->frameAlloc, sizeof(struct Message), 1);
-            m->associatedFd = msg->associatedFd;
-            m->capacity = m->length = msg->length + 4;
-            m->bytes = Allocator_calloc(fi->frameAlloc, m->length, 1);
-            m->alloc = fi->frameAlloc;
-            Er_assert(Message_eshift(m, -m->length));
-            Er_assert(Message_epush(m, msg->bytes, msg->length));
-            Er_assert(Message_epush(m, fi->header.bytes, 4));
-
-            fi->bytesRemaining -= msg->length;
-            fi->frameParts = Allocator_calloc(fi->frameAlloc, sizeof(struct MessageList), 1);
-            fi->frameParts->msg = m;
-            fi->frameParts->next = NULL;
+            fi->frame = Message_new(frameLength, REQUIRED_PADDING, fi->frameAlloc);
+            fi->frame->associatedFd = msg->associatedFd;
+            fi->bytesRemaining = frameLength - msg->length;
+            Er_assert(Message_epop(msg, fi->frame->bytes, msg->length));
         }
-        return NULL;
     }
+    return NULL;
 }
 
 static Iface_DEFUN sendMessage(struct Message* msg, struct Iface* messageIf)
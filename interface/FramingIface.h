@@ -26,6 +26,12 @@ Linker_require("interface/FramingIface.c");
  * The length is of only the content, not including the beginning 4 bytes
  * which represents the length itself.
  *
+ * A frame which lies entirely inside of one read is delivered without copying, as a slice of
+ * the read buffer. The first frame of a read has the padding of the read, the ones after it
+ * have no padding because the bytes in front of them are the frames before, so anything which
+ * needs to push headers or keep a frame after it is handled must copy it.
+ * Frames which span more than one read are copied once, into a buffer of their full size.
+ *
  * @param maxMessageSize how large of a framed message to allow
  * @param wrappedIface the stream interface which will be used to
  *                     communicate framed messages to a peer.
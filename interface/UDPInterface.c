@@ -234,6 +234,7 @@ Er_DEFUN(struct UDPInterface* UDPInterface_new(struct EventBase* eventBase,
     context->commSock.send = fromCommSock;
     context->bcastSock.send = fromBcastSock;
     context->commIf = uai;
+    context->pub.queueBytes = &uai->queueBytes;
     context->globalConf = globalConf;
     Iface_plumb(&uai->generic.iface, &context->commSock);
 
@@ -53,6 +53,9 @@ Assert_compileTime(
 struct UDPInterface
 {
     struct AddrIface generic;
+
+    /** Bytes waiting to be written to the socket, see InterfaceController_Iface.queueBytes. */
+    int* queueBytes;
 };
 
 /**
@@ -186,6 +186,7 @@ static void newInterface2(struct Context* ctx,
     struct InterfaceController_Iface* ici =
         InterfaceController_newIface(ctx->ic, name, alloc);
     Iface_plumb(&ici->addrIf, &udpif->generic.iface);
+    ici->queueBytes = udpif->queueBytes;
     ArrayList_UDPInterface_put(ctx->ifaces, ici->ifNum, udpif);
 
     Dict* out = Dict_new(requestAlloc);
@@ -20,13 +20,17 @@
 
 #define BUF_SZ 1024
 
+// Frames are sent back to back so that some reads hold more than one.
+#define FRAMES 3
+
 struct Context {
     struct Iface iface;
     struct Iface* fi;
     struct Iface outer;
-    int success;
+    int frames;
     struct Allocator* alloc;
     int messageLen;
+    struct Message* stream;
     struct Message* buf;
     uint8_t* bufPtr;
     Identity
@@ -35,11 +39,12 @@ struct Context {
 static Iface_DEFUN ifaceRecvMsg(struct Message* message, struct Iface* thisInterface)
 {
     struct Context* ctx = Identity_containerOf(thisInterface, struct Context, iface);
-    Assert_true(!ctx->success);
+    Assert_true(ctx->frames < FRAMES);
     Assert_true(message->length == ctx->messageLen);
-    Assert_true(ctx->buf->length == 0);
+    // Not delivered before the last byte of the frame was sent.
+    Assert_true(ctx->stream->length <= (FRAMES - 1 - ctx->frames) * (ctx->messageLen + 4));
     Assert_true(!Bits_memcmp(ctx->bufPtr, message->bytes, ctx->messageLen));
-    ctx->success = 1;
+    ctx->frames++;
     return NULL;
 }
 
@@ -48,22 +53,26 @@ void CJDNS_FUZZ_MAIN(void* vctx, struct Message* fuzz)
     struct Context* ctx = Identity_check((struct Context*) vctx);
     if (fuzz->length <= 2) { return; }
     ctx->messageLen = Er_assert(Message_epop16be(fuzz)) % BUF_SZ;
-    ctx->buf->length = ctx->messageLen;
-    Er_assert(Message_epush32be(ctx->buf, ctx->messageLen));
-    for (int i = 0; ; i++) {
-        uint8_t len = fuzz->bytes[i % fuzz->length] + 1;
-        if (len > ctx->buf->length) {
-            len = ctx->buf->length;
+    struct Allocator* streamAlloc = Allocator_child(ctx->alloc);
+    ctx->stream = Message_new(0, (BUF_SZ + 4) * FRAMES, streamAlloc);
+    for (int i = 0; i < FRAMES; i++) {
+        Er_assert(Message_epush(ctx->stream, ctx->bufPtr, ctx->messageLen));
+        Er_assert(Message_epush32be(ctx->stream, ctx->messageLen));
+    }
+    for (int i = 0; ctx->stream->length; i++) {
+        uint16_t len = fuzz->bytes[i % fuzz->length] + 1;
+        if (len > ctx->stream->length) {
+            len = ctx->stream->length;
         }
         struct Allocator* a = Allocator_child(ctx->alloc);
         struct Message* m = Message_new(len, 0, a);
-        Er_assert(Message_epop(ctx->buf, m->bytes, len));
+        Er_assert(Message_epop(ctx->stream, m->bytes, len));
         Iface_send(&ctx->outer, m);
         Allocator_free(a);
-        if (ctx->success) {
-            return;
-        }
     }
+    Assert_true(ctx->frames == FRAMES);
+    ctx->frames = 0;
+    Allocator_free(streamAlloc);
 }
 
 void* CJDNS_FUZZ_INIT(struct Allocator* alloc, struct Random* rand)
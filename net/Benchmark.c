@@ -16,13 +16,57 @@
 #include "memory/MallocAllocator.h"
 #include "memory/Allocator.h"
 #include "crypto/random/Random.h"
+#include "crypto/Curve25519.h"
 #include "crypto/Key.h"
+#include "crypto/ReplayProtector.h"
+#include "crypto/KeyGen.h"
+#include "crypto/Sign.h"
+#include "interface/FramingIface.h"
 #include "interface/Iface.h"
+#include "util/log/AsyncFileLog.h"
 #include "util/log/FileWriterLog.h"
+#include "util/log/LevelLog.h"
+#include "util/events/Pipe.h"
 #include "util/events/Time.h"
 #include "util/events/Timeout.h"
 #include "net/NetCore.h"
+#include "net/UpperDistributor.h"
+#include "net/SessionManager.h"
+#include "net/TUNAdapter.h"
+#include "crypto/AddressCalc.h"
+#include "interface/tuntap/TUNMessageType.h"
 #include "util/Checksum.h"
+#include "benc/Dict.h"
+#include "benc/serialization/standard/BencMessageReader.h"
+#include "benc/serialization/standard/BencMessageWriter.h"
+#include "benc/serialization/standard/BencStreamReader.h"
+#include "tunnel/IpTunnel.h"
+#include "util/GlobalConfig.h"
+#include "wire/DataHeader.h"
+#include "wire/Ethernet.h"
+#include "wire/Headers.h"
+
+#include "crypto_scalarmult_curve25519.h"
+
+#ifndef win32
+    #include <fcntl.h>
+    #include <sys/socket.h>
+#endif
+
+#ifndef SUBNODE
+    #include "dht/Address.h"
+    #include "dht/DHTModule.h"
+    #include "dht/DHTModuleRegistry.h"
+    #include "dht/EncodingSchemeModule.h"
+    #include "dht/ReplyModule.h"
+    #include "dht/SerializationModule.h"
+    #include "dht/dhtcore/NodeStore.h"
+    #include "dht/dhtcore/RouterModule.h"
+    #include "dht/dhtcore/RumorMill.h"
+    #include "dht/dhtcore/SearchRunner.h"
+    #include "switch/EncodingScheme.h"
+    #include "switch/NumberCompress.h"
+#endif
 
 struct Context
 {
@@ -102,6 +146,144 @@ static void cryptoAuth(struct Context* ctx)
 }
 
 
+static void replayWindow(struct Context* ctx, uint32_t wordCount, char* benchName)
+{
+    uint64_t words[64];
+    struct ReplayProtector rp;
+    ReplayProtector_setWindow(words, wordCount, &rp);
+
+    // Every block of 64 nonces arrives back to front, so each one is reordered within the block.
+    uint32_t count = 20000000;
+    begin(ctx, benchName, count, "packets");
+    for (uint32_t i = 0; i < count; i++) {
+        Assert_true(ReplayProtector_checkNonce(i ^ 63, &rp));
+    }
+    done(ctx);
+    Assert_true(!rp.lostPackets && !rp.duplicates);
+}
+
+static void handshakes(struct Context* ctx)
+{
+    struct Allocator* alloc = Allocator_child(ctx->alloc);
+    uint8_t privateKey[32];
+    uint8_t publicKey[32];
+    Random_bytes(ctx->rand, privateKey, 32);
+
+    int count = 5000;
+    begin(ctx, "curve25519 base (ladder)", count, "keys");
+    for (int i = 0; i < count; i++) {
+        crypto_scalarmult_curve25519_base(publicKey, privateKey);
+        privateKey[i & 31] ^= publicKey[0];
+    }
+    done(ctx);
+
+    begin(ctx, "curve25519 base (table)", count, "keys");
+    for (int i = 0; i < count; i++) {
+        Curve25519_scalarmultBase(publicKey, privateKey);
+        privateKey[i & 31] ^= publicKey[0];
+    }
+    done(ctx);
+
+    struct CryptoAuth* ca1 = CryptoAuth_new(alloc, NULL, ctx->base, ctx->log, ctx->rand);
+    struct CryptoAuth* ca2 = CryptoAuth_new(alloc, NULL, ctx->base, ctx->log, ctx->rand);
+    struct Message* msg = Message_new(64, 256, alloc);
+
+    count = 1000;
+    begin(ctx, "CryptoAuth handshake", count, "handshakes");
+    for (int i = 0; i < count; i++) {
+        struct Allocator* sessAlloc = Allocator_child(alloc);
+        struct CryptoAuth_Session* sess1 =
+            CryptoAuth_newSession(ca1, sessAlloc, ca2->publicKey, false, "bench");
+        struct CryptoAuth_Session* sess2 =
+            CryptoAuth_newSession(ca2, sessAlloc, ca1->publicKey, false, "bench");
+        for (int j = 0; j < 2; j++) {
+            Assert_true(!CryptoAuth_encrypt(sess1, msg));
+            Assert_true(!CryptoAuth_decrypt(sess2, msg));
+            Assert_true(!CryptoAuth_encrypt(sess2, msg));
+            Assert_true(!CryptoAuth_decrypt(sess1, msg));
+        }
+        Allocator_free(sessAlloc);
+    }
+    done(ctx);
+    Allocator_free(alloc);
+}
+
+/**
+ * Ed25519 benchmark.
+ * Signing, then checking the signatures one at a time and in batches, the messages are about
+ * the size of a subnode announcement.
+ */
+static void signatures(struct Context* ctx)
+{
+    Log_info(ctx->log, "Setting up ed25519 benchmark");
+    struct Allocator* alloc = Allocator_child(ctx->alloc);
+    enum { KEYS = 256, ROUNDS = 20 };
+    uint8_t (* keyPairs)[64] = Allocator_malloc(alloc, KEYS * 64);
+    uint8_t** keys = Allocator_malloc(alloc, KEYS * sizeof(uint8_t*));
+    struct Message** msgs = Allocator_malloc(alloc, KEYS * sizeof(struct Message*));
+    int* results = Allocator_malloc(alloc, KEYS * sizeof(int));
+    for (int i = 0; i < KEYS; i++) {
+        uint8_t secret[32];
+        Random_bytes(ctx->rand, secret, 32);
+        Sign_signingKeyPairFromCurve25519(keyPairs[i], secret);
+        keys[i] = &keyPairs[i][32];
+        msgs[i] = Message_new(200, 64, alloc);
+        Random_bytes(ctx->rand, msgs[i]->bytes, msgs[i]->length);
+    }
+
+    begin(ctx, "ed25519 sign", KEYS * ROUNDS, "signatures");
+    for (int r = 0; r < ROUNDS; r++) {
+        for (int i = 0; i < KEYS; i++) {
+            Sign_signMsg(keyPairs[i], msgs[i], ctx->rand);
+            if (r + 1 < ROUNDS) { Er_assert(Message_epop(msgs[i], NULL, 64)); }
+        }
+    }
+    done(ctx);
+
+    begin(ctx, "ed25519 verify", KEYS * ROUNDS, "signatures");
+    for (int r = 0; r < ROUNDS; r++) {
+        for (int i = 0; i < KEYS; i++) {
+            Assert_true(!Sign_verifyMsg(keys[i], msgs[i]));
+            Er_assert(Message_eshift(msgs[i], 64));
+        }
+    }
+    done(ctx);
+
+    begin(ctx, "ed25519 batch verify", KEYS * ROUNDS, "signatures");
+    for (int r = 0; r < ROUNDS; r++) {
+        Assert_true(!Sign_verifyBatch(keys, msgs, results, KEYS, ctx->rand));
+        for (int i = 0; i < KEYS; i++) { Er_assert(Message_eshift(msgs[i], 64)); }
+    }
+    done(ctx);
+    Allocator_free(alloc);
+}
+
+/** Key generation, one full scalar multiplication per candidate versus stepping the point. */
+static void keyGen(struct Context* ctx)
+{
+    struct Allocator* alloc = Allocator_child(ctx->alloc);
+    uint8_t address[16];
+    uint8_t publicKey[32];
+    uint8_t privateKey[32];
+
+    int count = 20;
+    begin(ctx, "Key_gen", count, "keys");
+    for (int i = 0; i < count; i++) {
+        Key_gen(address, publicKey, privateKey, ctx->rand);
+    }
+    done(ctx);
+
+    struct KeyGen* kg = KeyGen_new(ctx->rand, alloc);
+    const uint8_t prefix[16] = { 0xfc };
+    uint64_t tries = 0;
+    count = 1000;
+    begin(ctx, "KeyGen", count, "keys");
+    for (int i = 0; i < count; i++) {
+        while (KeyGen_search(kg, address, publicKey, privateKey, prefix, 8, &tries)) ;
+    }
+    done(ctx);
+    Allocator_free(alloc);
+}
 
 struct SwitchingContext
 {
@@ -217,6 +399,882 @@ static void switching(struct Context* ctx)
     Allocator_free(alloc);
 }
 
+/**
+ * Reading the keys which MsgCore needs to dispatch a getPeers reply, first by building a Dict
+ * with BencMessageReader then in place with BencStreamReader.
+ */
+static void bencReader(struct Context* ctx)
+{
+    Log_info(ctx->log, "Setting up benc reader benchmark");
+    struct Allocator* alloc = Allocator_child(ctx->alloc);
+    Dict* d = Dict_new(alloc);
+    String* nodes = String_newBinary(NULL, 8 * 40, alloc);
+    Random_bytes(ctx->rand, (uint8_t*) nodes->bytes, nodes->len);
+    Dict_putStringC(d, "n", nodes, alloc);
+    Dict_putStringC(d, "np", String_newBinary("\x01\x15\x15\x15\x15\x15\x15\x15\x15", 9, alloc),
+        alloc);
+    Dict_putStringCC(d, "es", "\x61\x14\x45\x81", alloc);
+    Dict_putIntC(d, "ei", 0, alloc);
+    Dict_putIntC(d, "p", 21, alloc);
+    Dict_putStringCC(d, "txid", "1abcdefg", alloc);
+    struct Message* msg = Message_new(0, 512, alloc);
+    Er_assert(BencMessageWriter_write(d, msg));
+
+    int count = 1000000;
+    begin(ctx, "benc tree reader", count, "messages");
+    for (int i = 0; i < count; i++) {
+        struct Allocator* child = Allocator_child(alloc);
+        struct Message m =
+            { .bytes = msg->bytes, .length = msg->length, .capacity = msg->length, .alloc = child };
+        Dict* out = Er_assert(BencMessageReader_read(&m, child));
+        Assert_true(Dict_getIntC(out, "p") && Dict_getStringC(out, "txid"));
+        Assert_true(!Dict_getStringC(out, "q"));
+        Allocator_free(child);
+    }
+    done(ctx);
+
+    begin(ctx, "benc stream reader", count, "messages");
+    for (int i = 0; i < count; i++) {
+        struct BencStreamReader_Field fields[] = {
+            { .key = "p" }, { .key = "q" }, { .key = "txid" }
+        };
+        struct BencStreamReader r;
+        BencStreamReader_init(&r, msg->bytes, msg->length);
+        Assert_true(!BencStreamReader_getFields(&r, fields, 3));
+        Assert_true(fields[0].value.type == BencStreamReader_Type_INT);
+        Assert_true(fields[1].value.type == BencStreamReader_Type_NONE);
+        Assert_true(fields[2].value.type == BencStreamReader_Type_STRING);
+    }
+    done(ctx);
+    Allocator_free(alloc);
+}
+
+/**
+ * IpTunnel gateway benchmark.
+ * A gateway with some number of clients, each of which is allowed one IPv6 and one IPv4 address,
+ * forwarding IPv6 and IPv4 packets from the TUN to the clients and IPv6 packets from the clients
+ * to the TUN. Packets go to the clients in a scattered order so that it is not always the same
+ * part of the tables which is used.
+ */
+struct GatewaySink
+{
+    struct Iface iface;
+    uint64_t count;
+};
+
+static Iface_DEFUN gatewaySink(struct Message* msg, struct Iface* iface)
+{
+    ((struct GatewaySink*) iface)->count++;
+    return NULL;
+}
+
+static struct Message gatewayMessage(uint8_t buff[512], int length, struct Allocator* alloc)
+{
+    return (struct Message) {
+        .bytes = &buff[256], .length = length, .padding = 256, .capacity = length, .alloc = alloc
+    };
+}
+
+static void gateway(struct Context* ctx, int clients, char* benchName)
+{
+    Log_info(ctx->log, "Setting up IpTunnel gateway benchmark with [%d] clients", clients);
+    struct Allocator* alloc = MallocAllocator_new(1<<27);
+    struct IpTunnel* ipTun =
+        IpTunnel_new(NULL, ctx->base, alloc, ctx->rand, NULL, GlobalConfig_new(alloc));
+    struct GatewaySink* tun = Allocator_calloc(alloc, sizeof(struct GatewaySink), 1);
+    struct GatewaySink* node = Allocator_calloc(alloc, sizeof(struct GatewaySink), 1);
+    tun->iface.send = gatewaySink;
+    node->iface.send = gatewaySink;
+    Iface_plumb(&tun->iface, &ipTun->tunInterface);
+    Iface_plumb(&node->iface, &ipTun->nodeInterface);
+
+    uint8_t* keys = Allocator_malloc(alloc, clients * 32);
+    Random_bytes(ctx->rand, keys, clients * 32);
+    struct Sockaddr_storage ip6;
+    struct Sockaddr_storage ip4;
+    Assert_true(!Sockaddr_parse("2001:db8::", &ip6));
+    Assert_true(!Sockaddr_parse("10.0.0.0", &ip4));
+    uint8_t* ip6Bytes = NULL;
+    uint8_t* ip4Bytes = NULL;
+    Assert_true(Sockaddr_getAddress(&ip6.addr, &ip6Bytes) == 16);
+    Assert_true(Sockaddr_getAddress(&ip4.addr, &ip4Bytes) == 4);
+    for (int i = 0; i < clients; i++) {
+        uint32_t num_be = Endian_hostToBigEndian32(i + 1);
+        Bits_memcpy(&ip6Bytes[12], &num_be, 4);
+        Bits_memcpy(ip4Bytes, &num_be, 4);
+        ip4Bytes[0] = 10;
+        IpTunnel_allowConnection(&keys[i * 32], &ip6.addr, 0, 128, &ip4.addr, 0, 32, ipTun);
+    }
+    uint8_t internet6[16] = { 0x20, 0x01, 0x0d, 0xb8, 0xff, 0xff, [15] = 1 };
+    uint8_t internet4[4] = { 192, 0, 2, 1 };
+
+    int count = 1000000;
+    uint8_t buff[512];
+    begin(ctx, benchName, count * 3, "packets");
+    for (int i = 0; i < count; i++) {
+        uint32_t client = ((uint64_t)i * 7919) % clients;
+        uint32_t num_be = Endian_hostToBigEndian32(client + 1);
+
+        struct Message m = gatewayMessage(buff, Headers_IP6Header_SIZE + 12, alloc);
+        struct Headers_IP6Header* ip6h = (struct Headers_IP6Header*) m.bytes;
+        Bits_memset(ip6h, 0, Headers_IP6Header_SIZE);
+        Headers_setIpVersion(ip6h);
+        Bits_memcpy(ip6h->sourceAddr, internet6, 16);
+        Bits_memcpy(ip6h->destinationAddr, ip6Bytes, 12);
+        Bits_memcpy(&ip6h->destinationAddr[12], &num_be, 4);
+        Iface_send(&tun->iface, &m);
+
+        m = gatewayMessage(buff, Headers_IP4Header_SIZE + 12, alloc);
+        struct Headers_IP4Header* ip4h = (struct Headers_IP4Header*) m.bytes;
+        Bits_memset(ip4h, 0, Headers_IP4Header_SIZE);
+        Headers_setIpVersion(ip4h);
+        Bits_memcpy(ip4h->sourceAddr, internet4, 4);
+        Bits_memcpy(ip4h->destAddr, &num_be, 4);
+        ip4h->destAddr[0] = 10;
+        Iface_send(&tun->iface, &m);
+
+        m = gatewayMessage(buff, RouteHeader_SIZE + DataHeader_SIZE + Headers_IP6Header_SIZE + 12,
+            alloc);
+        struct RouteHeader* rh = (struct RouteHeader*) m.bytes;
+        struct DataHeader* dh = (struct DataHeader*) &rh[1];
+        ip6h = (struct Headers_IP6Header*) &dh[1];
+        Bits_memset(rh, 0, RouteHeader_SIZE + DataHeader_SIZE + Headers_IP6Header_SIZE);
+        Bits_memcpy(rh->publicKey, &keys[client * 32], 32);
+        DataHeader_setContentType(dh, ContentType_IPTUN);
+        Headers_setIpVersion(ip6h);
+        Bits_memcpy(ip6h->sourceAddr, ip6Bytes, 12);
+        Bits_memcpy(&ip6h->sourceAddr[12], &num_be, 4);
+        Bits_memcpy(ip6h->destinationAddr, internet6, 16);
+        Iface_send(&node->iface, &m);
+    }
+    done(ctx);
+    Assert_true(node->count == (uint64_t)count * 2 && tun->count == (uint64_t)count);
+    Allocator_free(alloc);
+}
+
+/**
+ * FramingIface benchmark.
+ * A stream of frames which is read Pipe_BUFFER_CAP bytes at a time, with small frames there are
+ * many in each read and with frames about the size of a packet many span two reads.
+ */
+static void framing(struct Context* ctx, int frameSize, char* benchName)
+{
+    Log_info(ctx->log, "Setting up FramingIface benchmark with [%d] byte frames", frameSize);
+    struct Allocator* alloc = Allocator_child(ctx->alloc);
+    struct GatewaySink* sink = Allocator_calloc(alloc, sizeof(struct GatewaySink), 1);
+    sink->iface.send = gatewaySink;
+    struct Iface stream = { .send = NULL };
+    Iface_plumb(&sink->iface, FramingIface_new(frameSize, &stream, alloc));
+
+    int frames = 1000;
+    int streamLength = frames * (frameSize + 4);
+    uint8_t* buff = Allocator_malloc(alloc, Pipe_PADDING_AMOUNT + streamLength);
+    uint8_t* bytes = &buff[Pipe_PADDING_AMOUNT];
+    Random_bytes(ctx->rand, bytes, streamLength);
+    uint32_t length_be = Endian_hostToBigEndian32(frameSize);
+    for (int i = 0; i < frames; i++) {
+        Bits_memcpy(&bytes[i * (frameSize + 4)], &length_be, 4);
+    }
+
+    int rounds = 1000;
+    begin(ctx, benchName, (uint64_t)rounds * frames, "frames");
+    for (int i = 0; i < rounds; i++) {
+        for (int offset = 0; offset < streamLength; offset += Pipe_BUFFER_CAP) {
+            int length = streamLength - offset;
+            if (length > Pipe_BUFFER_CAP) { length = Pipe_BUFFER_CAP; }
+            struct Allocator* readAlloc = Allocator_child(alloc);
+            struct Message m = {
+                .bytes = &bytes[offset],
+                .length = length,
+                .capacity = length,
+                .padding = Pipe_PADDING_AMOUNT,
+                .alloc = readAlloc
+            };
+            Iface_send(&stream, &m);
+            Allocator_free(readAlloc);
+        }
+    }
+    done(ctx);
+    Assert_true(sink->count == (uint64_t)rounds * frames);
+    Allocator_free(alloc);
+}
+
+#ifndef win32
+struct PipeBench
+{
+    struct Iface toWriter;
+    struct Iface fromReader;
+    struct Allocator* alloc;
+    struct EventBase* base;
+    int size;
+    int count;
+    int sent;
+    bool paused;
+    uint64_t received;
+    Identity
+};
+
+static void pipeBenchFill(struct PipeBench* pb)
+{
+    struct Allocator* msgAlloc = Allocator_child(pb->alloc);
+    while (!pb->paused && pb->sent < pb->count) {
+        struct Message* msg = Message_new(pb->size, 0, msgAlloc);
+        Bits_memset(msg->bytes, pb->sent, pb->size);
+        Iface_send(&pb->toWriter, msg);
+        pb->sent++;
+    }
+    Allocator_free(msgAlloc);
+}
+
+static void pipeBenchBackPressure(struct Pipe* p, int status)
+{
+    struct PipeBench* pb = Identity_check((struct PipeBench*) p->userData);
+    pb->paused = status;
+    if (!status) { pipeBenchFill(pb); }
+}
+
+static Iface_DEFUN pipeBenchReceive(struct Message* msg, struct Iface* iface)
+{
+    struct PipeBench* pb = Identity_containerOf(iface, struct PipeBench, fromReader);
+    pb->received += msg->length;
+    if (pb->received == (uint64_t)pb->count * pb->size) { EventBase_endLoop(pb->base); }
+    return NULL;
+}
+
+/**
+ * Pipe benchmark.
+ * Small messages are written to one end of a socketpair as fast as the back-pressure signal
+ * allows and read out the other end.
+ */
+static void pipes(struct Context* ctx)
+{
+    Log_info(ctx->log, "Setting up Pipe benchmark");
+    struct Allocator* alloc = Allocator_child(ctx->alloc);
+    int fds[2];
+    Assert_true(!socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    for (int i = 0; i < 2; i++) {
+        Assert_true(!fcntl(fds[i], F_SETFL, fcntl(fds[i], F_GETFL) | O_NONBLOCK));
+    }
+    struct Pipe* writer = Er_assert(Pipe_forFd(fds[0], false, ctx->base, ctx->log, alloc));
+    struct Pipe* reader = Er_assert(Pipe_forFd(fds[1], false, ctx->base, ctx->log, alloc));
+
+    struct PipeBench* pb = Allocator_calloc(alloc, sizeof(struct PipeBench), 1);
+    Identity_set(pb);
+    pb->alloc = alloc;
+    pb->base = ctx->base;
+    pb->size = 64;
+    pb->count = 1000000;
+    pb->fromReader.send = pipeBenchReceive;
+    Iface_plumb(&pb->toWriter, &writer->iface);
+    Iface_plumb(&pb->fromReader, &reader->iface);
+    writer->userData = pb;
+    writer->onBackPressure = pipeBenchBackPressure;
+
+    begin(ctx, "Pipe 64 byte messages", pb->count, "messages");
+    pipeBenchFill(pb);
+    EventBase_beginLoop(ctx->base);
+    done(ctx);
+    Assert_true(pb->received == (uint64_t)pb->count * pb->size);
+    Allocator_free(alloc);
+}
+#endif
+
+/**
+ * UpperDistributor benchmark.
+ * Packets from the SessionManager to the TUN, first with no handlers and then with monitoring
+ * handlers registered for the content type, two which want the whole packet and two which only
+ * want the headers, one of which is sampled.
+ */
+static void upperHandlers(struct Context* ctx)
+{
+    Log_info(ctx->log, "Setting up UpperDistributor handler benchmark");
+    struct Allocator* alloc = Allocator_child(ctx->alloc);
+    struct Address* myAddr = Allocator_calloc(alloc, sizeof(struct Address), 1);
+    uint8_t privateKey[32];
+    Key_gen(myAddr->ip6.bytes, myAddr->key, privateKey, ctx->rand);
+    struct EventEmitter* ee = EventEmitter_new(alloc, ctx->log, myAddr->key);
+    struct UpperDistributor* ud = UpperDistributor_new(alloc, ctx->log, ee, myAddr);
+    struct GatewaySink* tun = Allocator_calloc(alloc, sizeof(struct GatewaySink), 1);
+    struct GatewaySink* sm = Allocator_calloc(alloc, sizeof(struct GatewaySink), 1);
+    tun->iface.send = gatewaySink;
+    sm->iface.send = gatewaySink;
+    Iface_plumb(&tun->iface, &ud->tunAdapterIf);
+    Iface_plumb(&sm->iface, &ud->sessionManagerIf);
+
+    uint8_t buff[2048];
+    int length = RouteHeader_SIZE + DataHeader_SIZE + 1280;
+    Random_bytes(ctx->rand, &buff[512], length);
+    struct RouteHeader* rh = (struct RouteHeader*) &buff[512];
+    rh->flags = 0;
+    DataHeader_setContentType((struct DataHeader*) &rh[1], ContentType_IP6_TCP);
+
+    int count = 1000000;
+    for (int round = 0; round < 2; round++) {
+        if (round) {
+            UpperDistributor_registerHandler(ud, ContentType_IP6_TCP, 1000, 0, 0);
+            UpperDistributor_registerHandler(ud, ContentType_IP6_TCP, 1001, 0, 0);
+            UpperDistributor_registerHandler(ud, ContentType_IP6_TCP, 1002, 0, 64);
+            UpperDistributor_registerHandler(ud, ContentType_IP6_TCP, 1003, 16, 64);
+        }
+        tun->count = 0;
+        begin(ctx, (round) ? "UpperDistributor with 4 handlers" : "UpperDistributor",
+            count, "packets");
+        for (int i = 0; i < count; i++) {
+            struct Message m = {
+                .bytes = &buff[512], .length = length, .padding = 512, .capacity = length,
+                .alloc = alloc
+            };
+            Iface_send(&sm->iface, &m);
+        }
+        done(ctx);
+        Assert_true(tun->count == (uint64_t)((round) ? (count * 4 + count / 16) : count));
+    }
+    Allocator_free(alloc);
+}
+
+struct TunToWire
+{
+    struct Iface aliceSwitchIf;
+    struct Iface bobSwitchIf;
+
+    /** If false then what alice sends is counted and dropped instead of being sent to bob. */
+    bool linked;
+    uint64_t sent;
+    Identity
+};
+
+static Iface_DEFUN tunToWireAliceSend(struct Message* msg, struct Iface* iface)
+{
+    struct TunToWire* ttw = Identity_containerOf(iface, struct TunToWire, aliceSwitchIf);
+    if (!ttw->linked) {
+        ttw->sent++;
+        return NULL;
+    }
+    return Iface_next(&ttw->bobSwitchIf, msg);
+}
+
+static Iface_DEFUN tunToWireBobSend(struct Message* msg, struct Iface* iface)
+{
+    struct TunToWire* ttw = Identity_containerOf(iface, struct TunToWire, bobSwitchIf);
+    return Iface_next(&ttw->aliceSwitchIf, msg);
+}
+
+/** Send a CJDHT message from the inside of a node, this creates the session if there is none. */
+static void tunToWireDht(struct NetCore* from, uint8_t key[32], uint8_t ip6[16])
+{
+    struct Allocator* alloc = Allocator_child(from->alloc);
+    struct Message* msg = Message_new(64, 512, alloc);
+    Bits_memset(msg->bytes, 0, 64);
+    struct DataHeader dh = { .unused = 0 };
+    DataHeader_setVersion(&dh, DataHeader_CURRENT_VERSION);
+    DataHeader_setContentType(&dh, ContentType_CJDHT);
+    Er_assert(Message_epush(msg, &dh, DataHeader_SIZE));
+    struct RouteHeader rh = {
+        .version_be = Endian_hostToBigEndian32(Version_CURRENT_PROTOCOL),
+        .sh = { .label_be = Endian_hostToBigEndian64(0x13) }
+    };
+    Bits_memcpy(rh.publicKey, key, 32);
+    Bits_memcpy(rh.ip6, ip6, 16);
+    Er_assert(Message_epush(msg, &rh, RouteHeader_SIZE));
+    Iface_send(&from->upper->sessionManagerIf, msg);
+    Allocator_free(alloc);
+}
+
+/**
+ * Packets from the TUN through TUNAdapter, UpperDistributor and SessionManager up to the switch.
+ * The other sessions are opened first so that they are ahead of the one which is used.
+ */
+static void tunToWire(struct Context* ctx, int otherSessions, char* benchName)
+{
+    Log_info(ctx->log, "Setting up TUN to switch benchmark with [%d] other sessions",
+        otherSessions);
+    struct Allocator* alloc = Allocator_child(ctx->alloc);
+    uint8_t ip6[16];
+    uint8_t publicKey[32];
+    uint8_t privateKeyA[32];
+    uint8_t privateKeyB[32];
+    Key_gen(ip6, publicKey, privateKeyA, ctx->rand);
+    Key_gen(ip6, publicKey, privateKeyB, ctx->rand);
+    struct NetCore* alice = NetCore_new(privateKeyA, alloc, ctx->base, ctx->rand, ctx->log);
+    struct NetCore* bob = NetCore_new(privateKeyB, alloc, ctx->base, ctx->rand, ctx->log);
+
+    // The session managers talk directly without switches between them.
+    struct TunToWire* ttw = Allocator_calloc(alloc, sizeof(struct TunToWire), 1);
+    Identity_set(ttw);
+    ttw->aliceSwitchIf.send = tunToWireAliceSend;
+    ttw->bobSwitchIf.send = tunToWireBobSend;
+    Iface_unplumb(alice->switchCore->routerIf, &alice->sm->switchIf);
+    Iface_unplumb(bob->switchCore->routerIf, &bob->sm->switchIf);
+    Iface_plumb(&ttw->aliceSwitchIf, &alice->sm->switchIf);
+    Iface_plumb(&ttw->bobSwitchIf, &bob->sm->switchIf);
+
+    // Sessions to nodes which will never answer, only the address and key are needed.
+    for (int i = 0; i < otherSessions; i++) {
+        do {
+            Random_bytes(ctx->rand, publicKey, 32);
+        } while (!AddressCalc_addressForPublicKey(ip6, publicKey));
+        tunToWireDht(alice, publicKey, ip6);
+    }
+
+    // Hello from alice, then key from bob.
+    ttw->linked = true;
+    tunToWireDht(alice, bob->myAddress->key, bob->myAddress->ip6.bytes);
+    tunToWireDht(bob, alice->myAddress->key, alice->myAddress->ip6.bytes);
+    struct SessionManager_Session* sess =
+        SessionManager_sessionForIp6(bob->myAddress->ip6.bytes, alice->sm);
+    Assert_true(CryptoAuth_getState(sess->caSession) >= CryptoAuth_State_RECEIVED_KEY);
+    ttw->linked = false;
+    ttw->sent = 0;
+
+    struct GatewaySink* tun = Allocator_calloc(alloc, sizeof(struct GatewaySink), 1);
+    tun->iface.send = gatewaySink;
+    Iface_plumb(&tun->iface, &alice->tunAdapt->tunIf);
+
+    uint8_t buff[2048];
+    int length = 1280;
+    Random_bytes(ctx->rand, &buff[512], length);
+    struct Headers_IP6Header ip6Header = {
+        .payloadLength_be = Endian_hostToBigEndian16(length - Headers_IP6Header_SIZE),
+        .nextHeader = 6,
+        .hopLimit = 64
+    };
+    Headers_setIpVersion(&ip6Header);
+    Bits_memcpy(ip6Header.sourceAddr, alice->myAddress->ip6.bytes, 16);
+    Bits_memcpy(ip6Header.destinationAddr, bob->myAddress->ip6.bytes, 16);
+
+    int count = 200000;
+    begin(ctx, benchName, count, "packets");
+    for (int i = 0; i < count; i++) {
+        struct Message m = {
+            .bytes = &buff[512], .length = length, .padding = 512, .capacity = length,
+            .alloc = alloc
+        };
+        Bits_memcpy(m.bytes, &ip6Header, Headers_IP6Header_SIZE);
+        Er_assert(TUNMessageType_push(&m, Ethernet_TYPE_IP6));
+        Iface_send(&tun->iface, &m);
+    }
+    done(ctx);
+    Assert_true(ttw->sent == (uint64_t)count);
+    Allocator_free(alloc);
+}
+
+#ifndef SUBNODE
+
+/**
+ * DHT search benchmark.
+ * A network of SearchSim_NODES nodes is simulated, every node is physically connected to every
+ * other node but each node only begins knowing about a few others, some of which are close to
+ * it in keyspace. One in SearchSim_DEAD_ONE_IN nodes never answers anything.
+ * Every live node searches for another live node at the same time and the time taken for the
+ * searches to complete is measured using the real event loop because the searches adapt to
+ * the measured response times.
+ */
+#define SearchSim_NODES 128
+#define SearchSim_PEERS 8
+#define SearchSim_DEAD_ONE_IN 5
+#define SearchSim_CAPTURE_MAX 2
+
+struct SearchSim;
+
+struct SearchSim_Node
+{
+    struct SearchSim* sim;
+    struct Address addr;
+    struct DHTModuleRegistry* registry;
+    struct NodeStore* store;
+    struct RouterModule* router;
+    struct SearchRunner* runner;
+
+    /** Milliseconds from this node to the middle of the network. */
+    int latency;
+    bool dead;
+
+    Identity
+};
+
+struct SearchSim
+{
+    struct Context* ctx;
+    struct Allocator* alloc;
+    struct EncodingScheme* scheme;
+    struct SearchSim_Node* nodes[SearchSim_NODES];
+
+    /** Pings or searches still running, the event loop is stopped when this reaches zero. */
+    int pending;
+
+    int searches;
+    int found;
+    uint64_t requests;
+    uint64_t totalMilliseconds;
+
+    /** If set then nothing is delivered, requests are kept for replaying and replies counted. */
+    bool capture;
+    int capturedCount;
+    struct Message* captured[SearchSim_CAPTURE_MAX];
+    uint64_t replies;
+    uint32_t lastReplyLength;
+
+    Identity
+};
+
+struct SearchSim_Packet
+{
+    struct SearchSim_Node* from;
+    struct SearchSim_Node* to;
+    struct Message* msg;
+    struct Allocator* alloc;
+    Identity
+};
+
+struct SearchSim_Search
+{
+    struct SearchSim* sim;
+    struct SearchSim_Node* target;
+    uint64_t startTime;
+    bool found;
+    Identity
+};
+
+/** Every node uses the same interface number to reach a given node, offset past self (1). */
+static uint64_t simLabel(struct SearchSim_Node* node)
+{
+    int index = 0;
+    while (node->sim->nodes[index] != node) { index++; }
+    uint32_t number = index + 2;
+    uint32_t bits = NumberCompress_bitsUsedForNumber(number);
+    return (((uint64_t)1) << bits) | NumberCompress_getCompressed(number, bits);
+}
+
+static void simDeliver(void* vpacket)
+{
+    struct SearchSim_Packet* pkt = Identity_check((struct SearchSim_Packet*) vpacket);
+    struct Address from;
+    Bits_memcpy(&from, &pkt->from->addr, Address_SIZE);
+    from.path = simLabel(pkt->from);
+    struct DHTMessage dht = {
+        .address = &from,
+        .binMessage = pkt->msg,
+        .allocator = pkt->alloc
+    };
+    DHTModuleRegistry_handleIncoming(&dht, pkt->to->registry);
+    Allocator_free(pkt->alloc);
+}
+
+/** The switch, follow the label through the (fully connected) network. */
+static int simSend(struct DHTMessage* dmessage, void* vnode)
+{
+    struct SearchSim_Node* node = Identity_check((struct SearchSim_Node*) vnode);
+    struct SearchSim* sim = Identity_check(node->sim);
+    struct SearchSim_Node* to = node;
+    uint64_t label = dmessage->address->path;
+    while (label > 1) {
+        uint32_t bits = NumberCompress_bitsUsedForLabel(label);
+        uint32_t number = NumberCompress_getDecompressed(label, bits);
+        label >>= bits;
+        if (number < 2 || number - 2 >= SearchSim_NODES) { return 0; }
+        to = sim->nodes[number - 2];
+    }
+    if (!dmessage->replyTo) { sim->requests++; }
+    if (to == node || to->dead) { return 0; }
+
+    if (sim->capture && dmessage->replyTo) {
+        sim->replies++;
+        sim->lastReplyLength = dmessage->binMessage->length;
+        return 0;
+    } else if (sim->capture) {
+        Assert_true(sim->capturedCount < SearchSim_CAPTURE_MAX);
+        sim->captured[sim->capturedCount++] = Message_clone(dmessage->binMessage, sim->alloc);
+        if (sim->capturedCount == SearchSim_CAPTURE_MAX) { EventBase_endLoop(sim->ctx->base); }
+        return 0;
+    }
+
+    struct Allocator* alloc = Allocator_child(sim->alloc);
+    struct SearchSim_Packet* pkt = Allocator_calloc(alloc, sizeof(struct SearchSim_Packet), 1);
+    Identity_set(pkt);
+    pkt->from = node;
+    pkt->to = to;
+    pkt->alloc = alloc;
+    pkt->msg = Message_clone(dmessage->binMessage, alloc);
+    Timeout_setTimeout(simDeliver, pkt, node->latency + to->latency, sim->ctx->base, alloc);
+    return 0;
+}
+
+static struct SearchSim_Node* simNode(struct SearchSim* sim, uint8_t publicKey[32])
+{
+    struct Context* ctx = sim->ctx;
+    struct Allocator* alloc = sim->alloc;
+    struct SearchSim_Node* node = Allocator_calloc(alloc, sizeof(struct SearchSim_Node), 1);
+    Identity_set(node);
+    node->sim = sim;
+    Address_forKey(&node->addr, publicKey);
+    node->addr.path = 1;
+    node->addr.protocolVersion = Version_CURRENT_PROTOCOL;
+    node->latency = 5 + Random_uint32(ctx->rand) % 20;
+
+    node->registry = DHTModuleRegistry_new(alloc);
+    ReplyModule_register(node->registry, alloc);
+    struct RumorMill* mill = RumorMill_new(alloc, &node->addr, 64, NULL, "sim");
+    node->store = NodeStore_new(&node->addr, alloc, ctx->base, NULL, mill);
+    node->router = RouterModule_register(
+        node->registry, alloc, node->addr.key, ctx->base, NULL, ctx->rand, node->store);
+    node->runner = SearchRunner_new(
+        node->store, NULL, ctx->base, node->router, node->addr.ip6.bytes, mill, alloc);
+    EncodingSchemeModule_register(node->registry, NULL, alloc);
+    SerializationModule_register(node->registry, NULL, alloc);
+
+    struct DHTModule* dm = Allocator_clone(alloc, (&(struct DHTModule) {
+        .name = "SearchSim",
+        .context = node,
+        .handleOutgoing = simSend
+    }));
+    DHTModuleRegistry_register(dm, node->registry);
+    return node;
+}
+
+static void simLink(struct SearchSim_Node* node, struct SearchSim_Node* peer)
+{
+    struct Address addr;
+    Bits_memcpy(&addr, &peer->addr, Address_SIZE);
+    addr.path = simLabel(peer);
+    int formNum = EncodingScheme_getFormNum(node->sim->scheme, simLabel(node));
+    NodeStore_discoverNode(node->store, &addr, node->sim->scheme, formNum, 100);
+}
+
+static void simDone(struct SearchSim* sim)
+{
+    if (!--sim->pending) { EventBase_endLoop(sim->ctx->base); }
+}
+
+static void simPingDone(struct RouterModule_Promise* promise,
+                        uint32_t lag,
+                        struct Address* from,
+                        Dict* result)
+{
+    simDone(Identity_check((struct SearchSim*) promise->userData));
+}
+
+static void simSearchDone(struct RouterModule_Promise* promise,
+                          uint32_t lag,
+                          struct Address* from,
+                          Dict* result)
+{
+    struct SearchSim_Search* ss = Identity_check((struct SearchSim_Search*) promise->userData);
+    struct SearchSim* sim = ss->sim;
+    if (from) {
+        ss->found |= Address_isSameIp(from, &ss->target->addr);
+        return;
+    }
+    sim->searches++;
+    sim->found += ss->found;
+    sim->totalMilliseconds += Time_currentTimeMilliseconds(sim->ctx->base) - ss->startTime;
+    simDone(sim);
+}
+
+static void searchRound(struct Context* ctx, uint8_t keys[SearchSim_NODES][32], int maxAlpha)
+{
+    // Every node has it's own NodeStore and searches so this needs more than the other benchmarks.
+    struct Allocator* alloc = MallocAllocator_new(1<<28);
+    struct SearchSim* sim = Allocator_calloc(alloc, sizeof(struct SearchSim), 1);
+    Identity_set(sim);
+    sim->ctx = ctx;
+    sim->alloc = alloc;
+    sim->scheme = NumberCompress_defineScheme(alloc);
+    for (int i = 0; i < SearchSim_NODES; i++) {
+        sim->nodes[i] = simNode(sim, keys[i]);
+        sim->nodes[i]->runner->maxAlpha = maxAlpha;
+        sim->nodes[i]->dead = !(Random_uint32(ctx->rand) % SearchSim_DEAD_ONE_IN);
+    }
+
+    // Half of the peers are the nodes closest in keyspace, the rest are random.
+    for (int i = 0; i < SearchSim_NODES; i++) {
+        struct SearchSim_Node* node = sim->nodes[i];
+        uint32_t prefix = Address_getPrefix(&node->addr);
+        uint32_t lastDistance = 0;
+        for (int p = 0; p < SearchSim_PEERS / 2; p++) {
+            struct SearchSim_Node* closest = NULL;
+            uint32_t closestDistance = UINT32_MAX;
+            for (int j = 0; j < SearchSim_NODES; j++) {
+                uint32_t distance = prefix ^ Address_getPrefix(&sim->nodes[j]->addr);
+                if (j == i || distance <= lastDistance || distance >= closestDistance) {
+                    continue;
+                }
+                closest = sim->nodes[j];
+                closestDistance = distance;
+            }
+            lastDistance = closestDistance;
+            simLink(node, closest);
+        }
+        for (int p = 0; p < SearchSim_PEERS / 2; p++) {
+            int j = Random_uint32(ctx->rand) % SearchSim_NODES;
+            if (j != i) { simLink(node, sim->nodes[j]); }
+        }
+    }
+
+    // Warm up the global mean response times with a few rounds of pings to the known nodes.
+    for (int round = 0; round < 3; round++) {
+        for (int i = 0; i < SearchSim_NODES; i++) {
+            struct SearchSim_Node* node = sim->nodes[i];
+            if (node->dead) { continue; }
+            struct Node_Two* nn = NULL;
+            while ((nn = NodeStore_getNextNode(node->store, nn))) {
+                if (nn == node->store->selfNode) { continue; }
+                struct RouterModule_Promise* rp =
+                    RouterModule_pingNode(&nn->address, 1000, node->router, alloc);
+                rp->callback = simPingDone;
+                rp->userData = sim;
+                sim->pending++;
+            }
+        }
+        EventBase_beginLoop(ctx->base);
+    }
+
+    int searches = 0;
+    sim->requests = 0;
+    for (int i = 0; i < SearchSim_NODES; i++) {
+        if (!sim->nodes[i]->dead) { searches++; }
+    }
+    char* name = (maxAlpha > 1) ? "DHT search (parallel)" : "DHT search (one at a time)";
+    begin(ctx, name, searches, "searches");
+    for (int i = 0; i < SearchSim_NODES; i++) {
+        struct SearchSim_Node* node = sim->nodes[i];
+        if (node->dead) { continue; }
+        struct SearchSim_Node* target;
+        do {
+            target = sim->nodes[Random_uint32(ctx->rand) % SearchSim_NODES];
+        } while (target == node || target->dead);
+
+        struct RouterModule_Promise* rp =
+            SearchRunner_search(target->addr.ip6.bytes, 20, 3, node->runner, alloc);
+        Assert_true(rp);
+        struct SearchSim_Search* ss =
+            Allocator_calloc(rp->alloc, sizeof(struct SearchSim_Search), 1);
+        Identity_set(ss);
+        ss->sim = sim;
+        ss->target = target;
+        ss->startTime = Time_currentTimeMilliseconds(ctx->base);
+        rp->callback = simSearchDone;
+        rp->userData = ss;
+        sim->pending++;
+    }
+    EventBase_beginLoop(ctx->base);
+    done(ctx);
+
+    Log_info(ctx->log, "%d of %d searches found their target, average [%d]ms and [%d] requests",
+        sim->found, sim->searches, (int) (sim->totalMilliseconds / sim->searches),
+        (int) (sim->requests / sim->searches));
+    Allocator_free(alloc);
+}
+
+/**
+ * How many find node and get peers queries one node can answer per second, the queries are
+ * captured from a real RouterModule and then replayed into the registry of another node
+ * which knows about all of the nodes in the simulated network.
+ */
+static void queries(struct Context* ctx, uint8_t keys[SearchSim_NODES][32])
+{
+    struct Allocator* alloc = MallocAllocator_new(1<<26);
+    struct SearchSim* sim = Allocator_calloc(alloc, sizeof(struct SearchSim), 1);
+    Identity_set(sim);
+    sim->ctx = ctx;
+    sim->alloc = alloc;
+    sim->scheme = NumberCompress_defineScheme(alloc);
+    for (int i = 0; i < SearchSim_NODES; i++) {
+        sim->nodes[i] = simNode(sim, keys[i]);
+    }
+    struct SearchSim_Node* server = sim->nodes[0];
+    struct SearchSim_Node* client = sim->nodes[1];
+    for (int i = 1; i < SearchSim_NODES; i++) {
+        simLink(server, sim->nodes[i]);
+    }
+    simLink(client, server);
+
+    struct Address serverAddr;
+    Bits_memcpy(&serverAddr, &server->addr, Address_SIZE);
+    serverAddr.path = simLabel(server);
+    struct Address clientAddr;
+    Bits_memcpy(&clientAddr, &client->addr, Address_SIZE);
+    clientAddr.path = simLabel(client);
+
+    sim->capture = true;
+    RouterModule_findNode(
+        &serverAddr, sim->nodes[SearchSim_NODES - 1]->addr.ip6.bytes, 10000, client->router, alloc);
+    RouterModule_getPeers(&serverAddr, 0, 10000, client->router, alloc);
+    // Requests are sent asynchronously.
+    EventBase_beginLoop(ctx->base);
+    Assert_true(sim->capturedCount == SearchSim_CAPTURE_MAX);
+
+    const int count = 100000;
+    begin(ctx, "DHT query handling", count, "queries");
+    for (int i = 0; i < count; i++) {
+        struct Allocator* child = Allocator_child(alloc);
+        struct DHTMessage dht = {
+            .address = &clientAddr,
+            .binMessage = Message_clone(sim->captured[i % SearchSim_CAPTURE_MAX], child),
+            .allocator = child
+        };
+        DHTModuleRegistry_handleIncoming(&dht, server->registry);
+        Allocator_free(child);
+    }
+    done(ctx);
+
+    Assert_true(sim->replies == (uint64_t)count);
+    Assert_true(sim->lastReplyLength > RouterModule_K * Address_SERIALIZED_SIZE);
+    Allocator_free(alloc);
+}
+
+static void search(struct Context* ctx)
+{
+    Log_info(ctx->log, "Setting up DHT search benchmark in a simulated network");
+    uint8_t keys[SearchSim_NODES][32];
+    for (int i = 0; i < SearchSim_NODES; i++) {
+        uint8_t ip6[16];
+        uint8_t privateKey[32];
+        Key_gen(ip6, keys[i], privateKey, ctx->rand);
+    }
+    searchRound(ctx, keys, 1);
+    searchRound(ctx, keys, SearchRunner_DEFAULT_MAX_ALPHA);
+    queries(ctx, keys);
+}
+
+#endif
+
+static void logging(struct Context* ctx)
+{
+    Log_info(ctx->log, "Setting up logging benchmark");
+    struct Allocator* alloc = Allocator_child(ctx->alloc);
+    FILE* devNull = fopen("/dev/null", "w");
+    Assert_true(devNull);
+    int count = 200000;
+    struct Log* fileLog = FileWriterLog_new(devNull, alloc);
+    begin(ctx, "FileWriterLog", count, "lines");
+    for (int i = 0; i < count; i++) {
+        Log_info(fileLog, "Benchmark line [%d] of [%d] to [%s]", i, count, "/dev/null");
+    }
+    done(ctx);
+
+    struct Allocator* asyncAlloc = Allocator_child(alloc);
+    struct Log* asyncLog = AsyncFileLog_new(devNull, ctx->base, asyncAlloc);
+    begin(ctx, "AsyncFileLog", count, "lines");
+    for (int i = 0; i < count; i++) {
+        Log_info(asyncLog, "Benchmark line [%d] of [%d] to [%s]", i, count, "/dev/null");
+    }
+    done(ctx);
+    Log_info(ctx->log, "AsyncFileLog dropped [%d] lines", (int) AsyncFileLog_dropped(asyncLog));
+
+    struct Log* levelLog = LevelLog_new(asyncLog, alloc);
+    LevelLog_setLevel(levelLog, NULL, Log_Level_INFO);
+    LevelLog_setLevel(levelLog, "SessionManager.c", Log_Level_DEBUG);
+    begin(ctx, "LevelLog filtered", count, "lines");
+    for (int i = 0; i < count; i++) {
+        Log_debug(levelLog, "Benchmark line [%d] of [%d] to [%s]", i, count, "/dev/null");
+    }
+    done(ctx);
+
+    Allocator_free(asyncAlloc);
+    fclose(devNull);
+    Allocator_free(alloc);
+}
+
 /** Check if nodes A and C can communicate via B without A knowing that C exists. */
 void Benchmark_runAll(void)
 {
@@ -229,5 +1287,27 @@ void Benchmark_runAll(void)
     ctx->rand = Random_new(alloc, log, NULL);
 
     cryptoAuth(ctx);
+    signatures(ctx);
+    keyGen(ctx);
+    handshakes(ctx);
+    replayWindow(ctx, 2, "ReplayProtector 128 bit window");
+    replayWindow(ctx, 16, "ReplayProtector 1024 bit window");
+    replayWindow(ctx, 64, "ReplayProtector 4096 bit window");
     switching(ctx);
+    bencReader(ctx);
+    upperHandlers(ctx);
+    tunToWire(ctx, 0, "TUN to switch");
+    tunToWire(ctx, 1000, "TUN to switch with 1000 other sessions");
+    logging(ctx);
+    framing(ctx, 64, "FramingIface 64 byte frames");
+    framing(ctx, 1400, "FramingIface 1400 byte frames");
+    #ifndef win32
+        pipes(ctx);
+    #endif
+    gateway(ctx, 10, "IpTunnel gateway 10 clients");
+    gateway(ctx, 10000, "IpTunnel gateway 10k clients");
+    gateway(ctx, 100000, "IpTunnel gateway 100k clients");
+    #ifndef SUBNODE
+        search(ctx);
+    #endif
 }
@@ -555,6 +555,8 @@ static Iface_DEFUN sendFromSwitch(struct Message* msg, struct Iface* switchIf)
 
     ep->bytesOut += msg->length;
 
+    int* queueBytes = ep->ici->pub.queueBytes;
+    ep->peerLink->lowerQueueBytes = (queueBytes) ? *queueBytes : 0;
     int msgs = PeerLink_send(msg, ep->peerLink);
 
     for (int i = 0; i < msgs; i++) {
@@ -134,6 +134,12 @@ struct InterfaceController_Iface
     enum InterfaceController_BeaconState beaconState;
 
     String* name;
+
+    /**
+     * If the interface sets this, the number of bytes which it has waiting to be written out.
+     * Packets switched to peers on the interface are marked as congested when it grows.
+     */
+    int* queueBytes;
 };
 
 /**
@@ -42,6 +42,7 @@ struct NetCore* NetCore_new(uint8_t* privateKey,
     nc->base = base;
     nc->rand = rand;
     nc->log = log;
+    struct Metrics* metrics = nc->metrics = Metrics_new(alloc);
 
     struct CryptoAuth* ca = nc->ca = CryptoAuth_new(alloc, privateKey, base, log, rand);
     struct EventEmitter* ee = nc->ee = EventEmitter_new(alloc, log, ca->publicKey);
@@ -52,9 +53,12 @@ struct NetCore* NetCore_new(uint8_t* privateKey,
     myAddress->protocolVersion = Version_CURRENT_PROTOCOL;
     myAddress->path = 1;
 
-    struct SwitchCore* switchCore = nc->switchCore = SwitchCore_new(log, alloc, base);
+    struct SwitchCore* switchCore = nc->switchCore = SwitchCore_new(log, alloc, base, metrics);
 
-    struct SessionManager* sm = nc->sm = SessionManager_new(alloc, base, ca, rand, log, ee);
+    struct SwitchPinger* sp = nc->sp = SwitchPinger_new(base, rand, log, myAddress, alloc);
+
+    struct SessionManager* sm = nc->sm =
+        SessionManager_new(alloc, base, ca, rand, log, ee, sp, metrics);
     Iface_plumb(switchCore->routerIf, &sm->switchIf);
 
     struct UpperDistributor* upper = nc->upper = UpperDistributor_new(alloc, log, ee, myAddress);
@@ -64,7 +68,6 @@ struct NetCore* NetCore_new(uint8_t* privateKey,
         ControlHandler_new(alloc, log, ee, ca->publicKey);
     Iface_plumb(&controlHandler->coreIf, &upper->controlHandlerIf);
 
-    struct SwitchPinger* sp = nc->sp = SwitchPinger_new(base, rand, log, myAddress, alloc);
     Iface_plumb(&controlHandler->switchPingerIf, &sp->controlHandlerIf);
 
     nc->ifController = InterfaceController_new(ca, switchCore, log, base, sp, rand, alloc, ee);
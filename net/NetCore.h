@@ -20,6 +20,7 @@
 #include "memory/Allocator.h"
 #include "switch/SwitchCore.h"
 #include "util/log/Log.h"
+#include "util/Metrics.h"
 #include "util/events/EventBase.h"
 #include "net/SwitchPinger.h"
 #include "net/ControlHandler.h"
@@ -39,6 +40,7 @@ struct NetCore
     struct EventBase* base;
     struct Random* rand;
     struct Log* log;
+    struct Metrics* metrics;
     struct CryptoAuth* ca;
     struct EventEmitter* ee;
     struct Address* myAddress;
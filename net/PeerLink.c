@@ -47,6 +47,14 @@ struct Message* PeerLink_poll(struct PeerLink* peerLink)
 int PeerLink_send(struct Message* msg, struct PeerLink* peerLink)
 {
     struct PeerLink_pvt* pl = Identity_check((struct PeerLink_pvt*) peerLink);
+    int backlog = pl->pub.lowerQueueBytes;
+    if (backlog > PeerLink_MARK_BYTES && msg->length >= SwitchHeader_SIZE) {
+        if (backlog > PeerLink_CONGESTED_BYTES) { backlog = PeerLink_CONGESTED_BYTES; }
+        uint32_t level = SwitchHeader_CONGESTION_NONE + 126 * (backlog - PeerLink_MARK_BYTES) /
+            (PeerLink_CONGESTED_BYTES - PeerLink_MARK_BYTES);
+        struct SwitchHeader* sh = (struct SwitchHeader*) msg->bytes;
+        if (level > SwitchHeader_getCongestion(sh)) { SwitchHeader_setCongestion(sh, level); }
+    }
     Allocator_adopt(pl->alloc, msg->alloc);
     ArrayList_Messages_add(pl->queue, msg);
     return pl->queue->length;
@@ -35,8 +35,18 @@ struct PeerLink
     int queueLength;
     int linkMTU;
     bool peerHeaderEnabled;
+
+    /**
+     * Bytes waiting to be written by the interface under this link, set by the owner before
+     * PeerLink_send(). Over PeerLink_MARK_BYTES, packets are marked with a congestion level
+     * which rises until PeerLink_CONGESTED_BYTES.
+     */
+    int lowerQueueBytes;
 };
 
+#define PeerLink_MARK_BYTES 4096
+#define PeerLink_CONGESTED_BYTES 16384
+
 struct PeerLink_Kbps
 {
     uint32_t sendKbps;
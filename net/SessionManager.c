@@ -23,13 +23,45 @@
 #include "wire/RouteHeader.h"
 #include "util/events/Timeout.h"
 #include "util/Checksum.h"
+#include "util/Hash.h"
 #include "wire/Metric.h"
+#include "wire/Headers.h"
 
 /** Handle numbers 0-3 are reserved for CryptoAuth nonces. */
 #define MIN_FIRST_HANDLE 4
 
 #define MAX_FIRST_HANDLE 100000
 
+/**
+ * End to end packets may take different paths and arrive far out of order, peering sessions keep
+ * the default window because a single link seldom reorders.
+ */
+#define REPLAY_WINDOW_BITS 1024
+
+/** Only sessions which have sent traffic this recently have their paths probed. */
+#define PROBE_ACTIVE_MILLISECONDS 10000
+
+/**
+ * The most probes sent each probeIntervalMilliseconds. The SwitchPinger is shared with peer
+ * keepalives and has SwitchPinger_DEFAULT_MAX_CONCURRENT_PINGS slots, probes time out within the
+ * interval so they never hold more than this many of them.
+ */
+#define PROBES_PER_INTERVAL 16
+
+/** Number of switch label and key pairs which handshakes are counted for, see admitHandshake(). */
+#define HANDSHAKE_SOURCES 256
+
+/** Number of destinations which the flow cache remembers sessions for, a power of 2. */
+#define FLOW_CACHE_SIZE 256
+
+struct HandshakeSource
+{
+    uint32_t hash;
+
+    /** The time when this source will have no more handshakes counted against it. */
+    int64_t clearTime;
+};
+
 struct BufferedMessage
 {
     struct Message* msg;
@@ -51,6 +83,14 @@ struct Ip6 {
 #define Map_ENABLE_HANDLES
 #include "util/Map.h"
 
+struct FlowCacheEntry
+{
+    struct Ip6 ip6;
+
+    /** NULL if the entry is empty. */
+    struct SessionManager_Session_pvt* sess;
+};
+
 struct SessionManager_pvt
 {
     struct SessionManager pub;
@@ -61,7 +101,31 @@ struct SessionManager_pvt
     struct Log* log;
     struct CryptoAuth* cryptoAuth;
     struct EventBase* eventBase;
+    struct SwitchPinger* switchPinger;
+    struct Timeout* probeTimeout;
+
+    /** Index in ifaceMap of the session to probe first, the sessions are probed in turn. */
+    uint32_t probeCursor;
     uint32_t firstHandle;
+
+    /**
+     * Sessions for recent destinations of packets from inside, indexed by the end of the address.
+     * Map_OfSessionsByIp6 is searched linearly so this spares each packet of a flow the search.
+     */
+    struct FlowCacheEntry flowCache[FLOW_CACHE_SIZE];
+
+    struct HandshakeSource handshakeSources[HANDSHAKE_SOURCES];
+    uint32_t handshakeHashSeed;
+
+    /** Nanoseconds which handshakes may still take, refilled with time by handshakeCpuPercent. */
+    int64_t handshakeBudget;
+    int64_t handshakeBudgetTime;
+
+    struct Metrics_Counter* decryptFailures;
+    struct Metrics_Counter* flowCacheMisses;
+    struct Metrics_Histogram* decryptTime;
+    struct Metrics_Histogram* encryptTime;
+
     Identity
 };
 
@@ -179,6 +243,38 @@ static inline struct SessionManager_Session_pvt* sessionForIp6(uint8_t ip6[16],
     return Identity_check(sm->ifaceMap.values[ifaceIndex]);
 }
 
+static inline struct FlowCacheEntry* flowCacheEntry(uint8_t ip6[16], struct SessionManager_pvt* sm)
+{
+    // Addresses are hashes of keys so the last bytes are as good as any hash of them.
+    uint32_t index;
+    Bits_memcpy(&index, &ip6[12], 4);
+    return &sm->flowCache[index & (FLOW_CACHE_SIZE - 1)];
+}
+
+static inline struct SessionManager_Session_pvt* sessionForFlow(uint8_t ip6[16],
+                                                                struct SessionManager_pvt* sm)
+{
+    struct FlowCacheEntry* entry = flowCacheEntry(ip6, sm);
+    if (entry->sess && !Bits_memcmp(entry->ip6.bytes, ip6, 16)) {
+        return Identity_check(entry->sess);
+    }
+    Metrics_Counter_add(sm->flowCacheMisses, 1);
+    struct SessionManager_Session_pvt* sess = sessionForIp6(ip6, sm);
+    if (sess) {
+        Bits_memcpy(entry->ip6.bytes, ip6, 16);
+        entry->sess = sess;
+    }
+    return sess;
+}
+
+static inline void forgetFlow(uint8_t ip6[16], struct SessionManager_pvt* sm)
+{
+    struct FlowCacheEntry* entry = flowCacheEntry(ip6, sm);
+    if (!Bits_memcmp(entry->ip6.bytes, ip6, 16)) {
+        entry->sess = NULL;
+    }
+}
+
 struct SessionManager_Session* SessionManager_sessionForIp6(uint8_t* ip6,
                                                             struct SessionManager* manager)
 {
@@ -201,45 +297,215 @@ struct SessionManager_HandleList* SessionManager_getHandleList(struct SessionMan
     return out;
 }
 
-static struct SessionManager_Session_pvt* getSession(struct SessionManager_pvt* sm,
-                                                     uint8_t ip6[16],
-                                                     uint8_t pubKey[32],
-                                                     uint32_t version,
-                                                     uint64_t label,
-                                                     uint32_t metric,
-                                                     int maintainSession)
+static struct SessionManager_Path* pathForLabel(struct SessionManager_Session_pvt* sess,
+                                                uint64_t label)
 {
-    Assert_true(AddressCalc_validAddress(ip6));
-    struct SessionManager_Session_pvt* sess = sessionForIp6(ip6, sm);
-    if (sess) {
-        sess->pub.version = (sess->pub.version) ? sess->pub.version : version;
-        sess->pub.maintainSession |= maintainSession;
-        if (metric == Metric_DEAD_LINK) {
-            // this is a broken path
-            if (sess->pub.sendSwitchLabel == label) {
-                debugSession0(sm->log, sess, "broken path");
-                if (sess->pub.sendSwitchLabel == sess->pub.recvSwitchLabel) {
-                    sess->pub.sendSwitchLabel = 0;
-                    sess->pub.metric = Metric_DEAD_LINK;
-                } else {
-                    sess->pub.sendSwitchLabel = sess->pub.recvSwitchLabel;
-                    sess->pub.metric = Metric_SM_INCOMING;
-                }
+    for (int i = 0; i < SessionManager_PATHS; i++) {
+        if (sess->pub.paths[i].label == label) { return &sess->pub.paths[i]; }
+    }
+    return NULL;
+}
+
+/** The share of traffic which a path should get, zero if it should not be used. */
+static uint32_t pathWeight(struct SessionManager_Session_pvt* sess, struct SessionManager_Path* p)
+{
+    if (!p->label || (p->lossHistory & 1)) { return 0; }
+    if (!p->rttMilliseconds) {
+        // Not measured yet, only the path which the pathfinder chose is trusted.
+        return (p->label == sess->pub.sendSwitchLabel) ? 1 : 0;
+    }
+    uint32_t lost = Bits_popCountx64(p->lossHistory);
+    return (1000000 / p->rttMilliseconds) * (16 - lost) / 16 + 1;
+}
+
+/**
+ * Keep a label as a path, pushing out the least useful path other than sendSwitchLabel.
+ * A path is only pushed out once a probe on it has returned or been lost, otherwise new paths
+ * would always push each other out before they could be measured. The exception is that
+ * sendSwitchLabel must always be a path.
+ */
+static void addPath(struct SessionManager_Session_pvt* sess, uint64_t label)
+{
+    if (!label || pathForLabel(sess, label)) { return; }
+    struct SessionManager_Path* worst = NULL;
+    struct SessionManager_Path* unmeasured = NULL;
+    for (int i = 0; i < SessionManager_PATHS; i++) {
+        struct SessionManager_Path* p = &sess->pub.paths[i];
+        if (!p->label) {
+            worst = p;
+            break;
+        }
+        if (p->label == sess->pub.sendSwitchLabel) { continue; }
+        if (!p->rttMilliseconds && !p->lostProbes) {
+            unmeasured = p;
+            continue;
+        }
+        if (!worst || pathWeight(sess, p) < pathWeight(sess, worst)) { worst = p; }
+    }
+    if (!worst && label == sess->pub.sendSwitchLabel) { worst = unmeasured; }
+    if (!worst) { return; }
+    Bits_memset(worst, 0, sizeof(struct SessionManager_Path));
+    worst->label = label;
+}
+
+/** Move sendSwitchLabel to the best path other than the current one, if there is one. */
+static void failover(struct SessionManager_pvt* sm, struct SessionManager_Session_pvt* sess)
+{
+    struct SessionManager_Path* best = NULL;
+    uint32_t bestWeight = 0;
+    for (int i = 0; i < SessionManager_PATHS; i++) {
+        struct SessionManager_Path* p = &sess->pub.paths[i];
+        if (p->label == sess->pub.sendSwitchLabel) { continue; }
+        uint32_t weight = pathWeight(sess, p);
+        if (weight > bestWeight) {
+            best = p;
+            bestWeight = weight;
+        }
+    }
+    if (!best) { return; }
+    sess->pub.sendSwitchLabel = best->label;
+    debugSession0(sm->log, sess, "failed over to another path");
+}
+
+/**
+ * Choose the label for a packet. Packets of a TCP or UDP flow stay on one path so that they are
+ * not reordered and the flows are spread over the paths by weight, everything else goes on
+ * sendSwitchLabel.
+ */
+static uint64_t pickPath(struct SessionManager_Session_pvt* sess, struct Message* msg)
+{
+    struct DataHeader* dh = (struct DataHeader*) &msg->bytes[RouteHeader_SIZE];
+    enum ContentType type = DataHeader_getContentType(dh);
+    if ((type != ContentType_IP6_TCP && type != ContentType_IP6_UDP) ||
+        msg->length < RouteHeader_SIZE + DataHeader_SIZE + 4)
+    {
+        return sess->pub.sendSwitchLabel;
+    }
+    uint32_t weights[SessionManager_PATHS];
+    uint32_t total = 0;
+    for (int i = 0; i < SessionManager_PATHS; i++) {
+        weights[i] = pathWeight(sess, &sess->pub.paths[i]);
+        total += weights[i];
+    }
+    if (!total) { return sess->pub.sendSwitchLabel; }
+
+    // The content type and the source and destination ports.
+    uint8_t flow[5] = { type };
+    Bits_memcpy(&flow[1], &dh[1], 4);
+    uint32_t point = Hash_compute(flow, 5) % total;
+    for (int i = 0; i < SessionManager_PATHS; i++) {
+        if (point < weights[i]) { return sess->pub.paths[i].label; }
+        point -= weights[i];
+    }
+    return sess->pub.sendSwitchLabel;
+}
+
+struct Probe
+{
+    struct SessionManager_Session_pvt* sess;
+    uint64_t label;
+    Identity
+};
+
+static void onProbeResponse(struct SwitchPinger_Response* resp, void* vprobe)
+{
+    struct Probe* probe = Identity_check((struct Probe*) vprobe);
+    struct SessionManager_Session_pvt* sess = Identity_check(probe->sess);
+    struct SessionManager_Path* path = pathForLabel(sess, probe->label);
+    if (!path) { return; }
+    path->lossHistory <<= 1;
+    if (resp->res == SwitchPinger_Result_OK) {
+        uint32_t rtt = (resp->milliseconds) ? resp->milliseconds : 1;
+        path->rttMilliseconds =
+            (path->rttMilliseconds) ? (path->rttMilliseconds * 7 + rtt) / 8 : rtt;
+        return;
+    }
+    path->lossHistory |= 1;
+    path->lostProbes++;
+    if (path->label == sess->pub.sendSwitchLabel) {
+        failover(sess->sessionManager, sess);
+    }
+}
+
+static void probePaths(void* vSessionManager)
+{
+    struct SessionManager_pvt* sm = Identity_check((struct SessionManager_pvt*) vSessionManager);
+    int64_t interval = sm->pub.probeIntervalMilliseconds;
+    Timeout_resetTimeout(sm->probeTimeout,
+        (interval) ? interval : SessionManager_PROBE_INTERVAL_MILLISECONDS_DEFAULT);
+    if (!interval) { return; }
+
+    int64_t now = Time_currentTimeMilliseconds(sm->eventBase);
+    int budget = PROBES_PER_INTERVAL;
+    uint32_t sessions = sm->ifaceMap.count;
+    uint32_t n = 0;
+    for (; n < sessions; n++) {
+        uint32_t i = (sm->probeCursor + n) % sessions;
+        struct SessionManager_Session_pvt* sess = sm->ifaceMap.values[i];
+        if (now - sess->pub.timeOfLastOut > PROBE_ACTIVE_MILLISECONDS) { continue; }
+        int count = 0;
+        for (int j = 0; j < SessionManager_PATHS; j++) { count += !!sess->pub.paths[j].label; }
+        if (count < 2) { continue; }
+        // Out of probes for this interval, this session is the first one next time.
+        if (count > budget) { break; }
+        budget -= count;
+
+        for (int j = 0; j < SessionManager_PATHS; j++) {
+            struct SessionManager_Path* path = &sess->pub.paths[j];
+            if (!path->label) { continue; }
+            // A path which does not answer within twice its usual time is not used.
+            int64_t timeout = (path->rttMilliseconds) ? path->rttMilliseconds * 2 + 50 : interval;
+            struct SwitchPinger_Ping* ping =
+                SwitchPinger_newPing(path->label,
+                                     String_CONST(""),
+                                     (timeout < interval) ? timeout : interval,
+                                     onProbeResponse,
+                                     sess->alloc,
+                                     sm->switchPinger);
+            if (!ping) {
+                budget = -1;
+                break;
             }
-        } else if (metric <= sess->pub.metric && label) {
-            sess->pub.sendSwitchLabel = label;
-            sess->pub.version = (version) ? version : sess->pub.version;
-            sess->pub.metric = metric;
-            debugSession0(sm->log, sess, "discovered path");
+            struct Probe* probe = Allocator_calloc(ping->pingAlloc, sizeof(struct Probe), 1);
+            probe->sess = sess;
+            probe->label = path->label;
+            Identity_set(probe);
+            ping->onResponseContext = probe;
+            path->probes++;
+        }
+        // The SwitchPinger is full, start with the next session next time.
+        if (budget < 0) {
+            n++;
+            break;
         }
-        return sess;
     }
+    sm->probeCursor = (sessions) ? (sm->probeCursor + n) % sessions : 0;
+}
+
+/** A session which is not yet in the table, it is put there by addSession(). */
+static struct SessionManager_Session_pvt* newSession(struct SessionManager_pvt* sm,
+                                                     uint8_t pubKey[32])
+{
     struct Allocator* alloc = Allocator_child(sm->alloc);
-    sess = Allocator_calloc(alloc, sizeof(struct SessionManager_Session_pvt), 1);
+    struct SessionManager_Session_pvt* sess =
+        Allocator_calloc(alloc, sizeof(struct SessionManager_Session_pvt), 1);
     Identity_set(sess);
-
+    sess->alloc = alloc;
+    sess->sessionManager = sm;
     sess->pub.caSession = CryptoAuth_newSession(sm->cryptoAuth, alloc, pubKey, false, "inner");
+    CryptoAuth_setReplayWindow(sess->pub.caSession, REPLAY_WINDOW_BITS);
+    return sess;
+}
 
+static struct SessionManager_Session_pvt* addSession(struct SessionManager_pvt* sm,
+                                                     struct SessionManager_Session_pvt* sess,
+                                                     uint8_t ip6[16],
+                                                     uint32_t version,
+                                                     uint64_t label,
+                                                     uint32_t metric,
+                                                     int maintainSession)
+{
+    uint8_t* pubKey = sess->pub.caSession->herPublicKey;
     sess->foundKey = !Bits_isZero(pubKey, 32);
     if (sess->foundKey) {
         uint8_t realIp6[16];
@@ -257,8 +523,6 @@ static struct SessionManager_Session_pvt* getSession(struct SessionManager_pvt*
                   printedIp6, sess->pub.receiveHandle);
     }
 
-    sess->alloc = alloc;
-    sess->sessionManager = sm;
     sess->pub.version = version;
     sess->pub.timeOfLastIn = Time_currentTimeMilliseconds(sm->eventBase);
     sess->pub.timeOfKeepAliveIn = Time_currentTimeMilliseconds(sm->eventBase);
@@ -266,12 +530,53 @@ static struct SessionManager_Session_pvt* getSession(struct SessionManager_pvt*
     sess->pub.sendSwitchLabel = label;
     sess->pub.metric = metric;
     sess->pub.maintainSession = maintainSession;
+    addPath(sess, label);
     //Allocator_onFree(alloc, sessionCleanup, sess);
     sendSession(sess, label, 0xffffffff, PFChan_Core_SESSION);
     check(sm, ifaceIndex);
     return sess;
 }
 
+static struct SessionManager_Session_pvt* getSession(struct SessionManager_pvt* sm,
+                                                     uint8_t ip6[16],
+                                                     uint8_t pubKey[32],
+                                                     uint32_t version,
+                                                     uint64_t label,
+                                                     uint32_t metric,
+                                                     int maintainSession)
+{
+    Assert_true(AddressCalc_validAddress(ip6));
+    struct SessionManager_Session_pvt* sess = sessionForIp6(ip6, sm);
+    if (sess) {
+        sess->pub.version = (sess->pub.version) ? sess->pub.version : version;
+        sess->pub.maintainSession |= maintainSession;
+        if (metric == Metric_DEAD_LINK) {
+            // this is a broken path
+            struct SessionManager_Path* path = pathForLabel(sess, label);
+            if (path) { Bits_memset(path, 0, sizeof(struct SessionManager_Path)); }
+            if (sess->pub.sendSwitchLabel == label) {
+                debugSession0(sm->log, sess, "broken path");
+                if (sess->pub.sendSwitchLabel == sess->pub.recvSwitchLabel) {
+                    sess->pub.sendSwitchLabel = 0;
+                    sess->pub.metric = Metric_DEAD_LINK;
+                } else {
+                    sess->pub.sendSwitchLabel = sess->pub.recvSwitchLabel;
+                    sess->pub.metric = Metric_SM_INCOMING;
+                }
+            }
+        } else if (metric <= sess->pub.metric && label) {
+            sess->pub.sendSwitchLabel = label;
+            sess->pub.version = (version) ? version : sess->pub.version;
+            sess->pub.metric = metric;
+            debugSession0(sm->log, sess, "discovered path");
+        }
+        addPath(sess, sess->pub.sendSwitchLabel);
+        if (metric != Metric_DEAD_LINK) { addPath(sess, label); }
+        return sess;
+    }
+    return addSession(sm, newSession(sm, pubKey), ip6, version, label, metric, maintainSession);
+}
+
 static Iface_DEFUN ctrlFrame(struct Message* msg, struct SessionManager_pvt* sm)
 {
     struct RouteHeader rh;
@@ -306,6 +611,52 @@ static Iface_DEFUN failedDecrypt(struct Message* msg,
     return Iface_next(&sm->pub.switchIf, msg);
 }
 
+/**
+ * Decide whether a handshake packet is worth decrypting. Each switch label and key gets a burst
+ * of handshakes and then one per interval, sources share a small table so a flood of made-up keys
+ * only pushes out entries which will begin again with a full burst. Whatever gets through is also
+ * held to the CPU share in handshakeCpuPercent.
+ */
+static bool admitHandshake(struct SessionManager_pvt* sm, uint64_t label_be, uint8_t key[32])
+{
+    int64_t now = Time_currentTimeMilliseconds(sm->eventBase);
+
+    struct {
+        uint32_t seed;
+        uint64_t label_be;
+        uint8_t key[32];
+    } Gcc_PACKED source = { .seed = sm->handshakeHashSeed, .label_be = label_be };
+    Bits_memcpy(source.key, key, 32);
+    uint32_t hash = Hash_compute((uint8_t*) &source, sizeof source);
+
+    struct HandshakeSource* hs = &sm->handshakeSources[hash % HANDSHAKE_SOURCES];
+    if (hs->hash != hash || hs->clearTime < now) {
+        hs->hash = hash;
+        hs->clearTime = now;
+    }
+    // An interval of 0 means there is no per-source limit, only the CPU budget.
+    int64_t interval = sm->pub.sourceHandshakeIntervalMilliseconds;
+    if (interval && hs->clearTime - now >= sm->pub.sourceHandshakeBurst * interval) {
+        sm->pub.handshakeStats.droppedSource++;
+        return false;
+    }
+
+    // Nanoseconds of handshake per millisecond, up to a second's worth may be saved up.
+    int64_t perMillisecond = (int64_t) sm->pub.handshakeCpuPercent * 10000;
+    sm->handshakeBudget += (now - sm->handshakeBudgetTime) * perMillisecond;
+    sm->handshakeBudgetTime = now;
+    if (sm->handshakeBudget > perMillisecond * 1000) {
+        sm->handshakeBudget = perMillisecond * 1000;
+    }
+    if (sm->handshakeBudget <= 0) {
+        sm->pub.handshakeStats.droppedBusy++;
+        return false;
+    }
+
+    hs->clearTime += interval;
+    return true;
+}
+
 static Iface_DEFUN incomingFromSwitchIf(struct Message* msg, struct Iface* iface)
 {
     struct SessionManager_pvt* sm =
@@ -326,6 +677,9 @@ static Iface_DEFUN incomingFromSwitchIf(struct Message* msg, struct Iface* iface
     switchHeader->label_be = Bits_bitReverse64(switchHeader->label_be);
 
     struct SessionManager_Session_pvt* session;
+    // If the session is not known yet, the address to add it under once the handshake is good.
+    uint8_t newSessionIp6Buf[16];
+    uint8_t* newSessionIp6 = NULL;
     uint32_t nonceOrHandle = Endian_bigEndianToHost32(((uint32_t*)msg->bytes)[0]);
     if (nonceOrHandle == 0xffffffff) {
         Er_assert(Message_eshift(msg, SwitchHeader_SIZE));
@@ -377,16 +731,39 @@ static Iface_DEFUN incomingFromSwitchIf(struct Message* msg, struct Iface* iface
             return NULL;
         }
 
+        if (!admitHandshake(sm, switchHeader->label_be, caHeader->publicKey)) {
+            Log_debug(sm->log, "DROP Handshake over the limit");
+            return NULL;
+        }
+
         uint64_t label = Endian_bigEndianToHost64(switchHeader->label_be);
-        session = getSession(sm, ip6, caHeader->publicKey, 0, label, Metric_SM_INCOMING, 0);
-        CryptoAuth_resetIfTimeout(session->pub.caSession);
+        if (sessionForIp6(ip6, sm)) {
+            session = getSession(sm, ip6, caHeader->publicKey, 0, label, Metric_SM_INCOMING, 0);
+            CryptoAuth_resetIfTimeout(session->pub.caSession);
+        } else {
+            session = newSession(sm, caHeader->publicKey);
+            Bits_memcpy(newSessionIp6Buf, ip6, 16);
+            newSessionIp6 = newSessionIp6Buf;
+        }
         debugHandlesAndLabel(sm->log, session, label, "new session nonce[%d]", nonceOrHandle);
     }
 
     bool currentMessageSetup = (nonceOrHandle <= 3);
 
+    uint64_t start = Metrics_Histogram_start(sm->decryptTime);
+    if (currentMessageSetup && !start) { start = Time_hrtime(); }
     enum CryptoAuth_DecryptErr ret = CryptoAuth_decrypt(session->pub.caSession, msg);
+    Metrics_Histogram_stop(sm->decryptTime, start);
+    if (currentMessageSetup) {
+        sm->handshakeBudget -= Time_hrtime() - start;
+        if (ret) {
+            sm->pub.handshakeStats.failed++;
+        } else {
+            sm->pub.handshakeStats.accepted++;
+        }
+    }
     if (ret) {
+        Metrics_Counter_add(sm->decryptFailures, 1);
         debugHandlesAndLabel(sm->log, session,
                              Endian_bigEndianToHost64(switchHeader->label_be),
                              "DROP Failed decrypting message NoH[%d] state[%s]",
@@ -401,9 +778,18 @@ static Iface_DEFUN incomingFromSwitchIf(struct Message* msg, struct Iface* iface
         Assert_true(msg->bytes == (uint8_t*)switchHeader);
         uint64_t label_be = switchHeader->label_be;
         switchHeader->label_be = Bits_bitReverse64(switchHeader->label_be);
+        if (newSessionIp6) {
+            sm->pub.handshakeStats.sessionsNotCreated++;
+            Allocator_free(session->alloc);
+        }
         return failedDecrypt(msg, label_be, sm);
     }
 
+    if (newSessionIp6) {
+        uint64_t label = Endian_bigEndianToHost64(switchHeader->label_be);
+        addSession(sm, session, newSessionIp6, 0, label, Metric_SM_INCOMING, 0);
+    }
+
     if (currentMessageSetup) {
         session->pub.sendHandle = Er_assert(Message_epop32be(msg));
     }
@@ -419,6 +805,18 @@ static Iface_DEFUN incomingFromSwitchIf(struct Message* msg, struct Iface* iface
     session->pub.bytesIn += msg->length;
     session->pub.timeOfKeepAliveIn = Time_currentTimeMilliseconds(sm->eventBase);
 
+    uint32_t congestion = SwitchHeader_getCongestion(switchHeader);
+    if (congestion > SwitchHeader_CONGESTION_NONE) {
+        session->pub.congestedPackets++;
+        // Tell the endpoint if it said it can take it, otherwise the mark goes no further.
+        if (DataHeader_getEcn(dh) != Headers_ECN_NOT_ECT) {
+            DataHeader_setEcn(dh, Headers_ECN_CE);
+        }
+    } else {
+        congestion = 0;
+    }
+    session->pub.congestion = (session->pub.congestion * 15 + congestion) / 16;
+
     if (currentMessageSetup) {
         Bits_memcpy(&header->sh, switchHeader, SwitchHeader_SIZE);
         debugHandlesAndLabel0(sm->log,
@@ -449,6 +847,7 @@ static Iface_DEFUN incomingFromSwitchIf(struct Message* msg, struct Iface* iface
     }
     if (path != session->pub.recvSwitchLabel) {
         session->pub.recvSwitchLabel = path;
+        addPath(session, path);
         sendSession(session, path, 0xffffffff, PFChan_Core_DISCOVERED_PATH);
     }
 
@@ -512,6 +911,7 @@ static void checkTimedOutSessions(struct SessionManager_pvt* sm)
         if (now - sess->pub.timeOfKeepAliveIn > sm->pub.sessionTimeoutMilliseconds) {
             debugSession0(sm->log, sess, "ended");
             sendSession(sess, sess->pub.sendSwitchLabel, 0xffffffff, PFChan_Core_SESSION_ENDED);
+            forgetFlow(sm->ifaceMap.keys[i].bytes, sm);
             Map_OfSessionsByIp6_remove(i, &sm->ifaceMap);
             Allocator_free(sess->alloc);
             continue;
@@ -609,7 +1009,9 @@ static Iface_DEFUN readyToSend(struct Message* msg,
 
     sess->pub.bytesOut += msg->length;
 
+    uint64_t start = Metrics_Histogram_start(sm->encryptTime);
     Assert_true(!CryptoAuth_encrypt(sess->pub.caSession, msg));
+    Metrics_Histogram_stop(sm->encryptTime, start);
 
     if (CryptoAuth_getState(sess->pub.caSession) >= CryptoAuth_State_RECEIVED_KEY) {
         if (0) { // Noisy
@@ -671,7 +1073,9 @@ static Iface_DEFUN incomingFromInsideIf(struct Message* msg, struct Iface* iface
     Assert_true(msg->length >= RouteHeader_SIZE + DataHeader_SIZE);
     struct DataHeader* dataHeader = (struct DataHeader*) &header[1];
 
-    struct SessionManager_Session_pvt* sess = sessionForIp6(header->ip6, sm);
+    // Only the session is cached, the path is chosen for each packet so a change of path or the
+    // loss of a peer takes effect immediately.
+    struct SessionManager_Session_pvt* sess = sessionForFlow(header->ip6, sm);
     if (!sess) {
         if (!Bits_isZero(header->publicKey, 32) && header->version_be) {
             sess = getSession(sm,
@@ -698,7 +1102,7 @@ static Iface_DEFUN incomingFromInsideIf(struct Message* msg, struct Iface* iface
         // fallthrough
     } else if (sess->pub.sendSwitchLabel) {
         Bits_memset(&header->sh, 0, SwitchHeader_SIZE);
-        header->sh.label_be = Endian_hostToBigEndian64(sess->pub.sendSwitchLabel);
+        header->sh.label_be = Endian_hostToBigEndian64(pickPath(sess, msg));
         SwitchHeader_setVersion(&header->sh, SwitchHeader_CURRENT_VERSION);
     } else {
         needsLookup(sm, msg, false);
@@ -770,12 +1174,59 @@ static Iface_DEFUN incomingFromEventIf(struct Message* msg, struct Iface* iface)
     return NULL;
 }
 
+#define SUM_OVER_SESSIONS(name, expr) \
+    static int64_t name(void* vsm)                                                     \
+    {                                                                                  \
+        struct SessionManager_pvt* sm = Identity_check((struct SessionManager_pvt*) vsm); \
+        int64_t out = 0;                                                               \
+        for (int i = 0; i < (int)sm->ifaceMap.count; i++) {                            \
+            struct SessionManager_Session_pvt* sess = sm->ifaceMap.values[i];          \
+            out += (expr);                                                             \
+        }                                                                              \
+        return out;                                                                    \
+    }
+SUM_OVER_SESSIONS(sessionCount, (sess != NULL))
+SUM_OVER_SESSIONS(sumBytesIn, sess->pub.bytesIn)
+SUM_OVER_SESSIONS(sumBytesOut, sess->pub.bytesOut)
+SUM_OVER_SESSIONS(sumDuplicates, sess->pub.caSession->replayProtector.duplicates)
+SUM_OVER_SESSIONS(sumLostPackets, sess->pub.caSession->replayProtector.lostPackets)
+SUM_OVER_SESSIONS(sumOutOfRange, sess->pub.caSession->replayProtector.receivedOutOfRange)
+SUM_OVER_SESSIONS(sumCongested, sess->pub.congestedPackets)
+#undef SUM_OVER_SESSIONS
+
+static void registerMetrics(struct SessionManager_pvt* sm, struct Metrics* metrics)
+{
+    sm->decryptFailures = Metrics_counter(metrics, "cjdns_session_decrypt_failures_total",
+        "Packets which could not be decrypted");
+    sm->flowCacheMisses = Metrics_counter(metrics, "cjdns_session_flow_cache_misses_total",
+        "Packets from inside whose destination was not in the flow cache");
+    sm->decryptTime = Metrics_histogram(metrics, "cjdns_session_decrypt_ns",
+        "Time spent decrypting a packet which came from the switch");
+    sm->encryptTime = Metrics_histogram(metrics, "cjdns_session_encrypt_ns",
+        "Time spent encrypting a packet which is going to the switch");
+    Metrics_gaugeFn(metrics, "cjdns_sessions", "Number of open sessions", sessionCount, sm);
+    Metrics_gaugeFn(metrics, "cjdns_session_bytes_in", "Bytes received by open sessions",
+        sumBytesIn, sm);
+    Metrics_gaugeFn(metrics, "cjdns_session_bytes_out", "Bytes sent by open sessions",
+        sumBytesOut, sm);
+    Metrics_gaugeFn(metrics, "cjdns_session_replay_duplicates",
+        "Duplicate packets seen by the replay protectors of open sessions", sumDuplicates, sm);
+    Metrics_gaugeFn(metrics, "cjdns_session_replay_lost",
+        "Lost packets seen by the replay protectors of open sessions", sumLostPackets, sm);
+    Metrics_gaugeFn(metrics, "cjdns_session_replay_out_of_range",
+        "Packets too old for the replay protectors of open sessions", sumOutOfRange, sm);
+    Metrics_gaugeFn(metrics, "cjdns_session_congested_packets",
+        "Packets received by open sessions which were marked as congested", sumCongested, sm);
+}
+
 struct SessionManager* SessionManager_new(struct Allocator* allocator,
                                           struct EventBase* eventBase,
                                           struct CryptoAuth* cryptoAuth,
                                           struct Random* rand,
                                           struct Log* log,
-                                          struct EventEmitter* ee)
+                                          struct EventEmitter* ee,
+                                          struct SwitchPinger* switchPinger,
+                                          struct Metrics* metrics)
 {
     struct Allocator* alloc = Allocator_child(allocator);
     struct SessionManager_pvt* sm = Allocator_calloc(alloc, sizeof(struct SessionManager_pvt), 1);
@@ -787,10 +1238,18 @@ struct SessionManager* SessionManager_new(struct Allocator* allocator,
     sm->log = log;
     sm->cryptoAuth = cryptoAuth;
     sm->eventBase = eventBase;
+    sm->switchPinger = switchPinger;
     sm->pub.sessionTimeoutMilliseconds = SessionManager_SESSION_TIMEOUT_MILLISECONDS_DEFAULT;
     sm->pub.maxBufferedMessages = SessionManager_MAX_BUFFERED_MESSAGES_DEFAULT;
     sm->pub.sessionSearchAfterMilliseconds =
         SessionManager_SESSION_SEARCH_AFTER_MILLISECONDS_DEFAULT;
+    sm->pub.sourceHandshakeBurst = SessionManager_SOURCE_HANDSHAKE_BURST_DEFAULT;
+    sm->pub.sourceHandshakeIntervalMilliseconds =
+        SessionManager_SOURCE_HANDSHAKE_INTERVAL_MILLISECONDS_DEFAULT;
+    sm->pub.handshakeCpuPercent = SessionManager_HANDSHAKE_CPU_PERCENT_DEFAULT;
+    sm->pub.probeIntervalMilliseconds = SessionManager_PROBE_INTERVAL_MILLISECONDS_DEFAULT;
+    sm->handshakeBudgetTime = Time_currentTimeMilliseconds(eventBase);
+    sm->handshakeBudget = (int64_t) sm->pub.handshakeCpuPercent * 10000 * 1000;
 
     sm->eventIf.send = incomingFromEventIf;
     EventEmitter_regCore(ee, &sm->eventIf, PFChan_Pathfinder_NODE);
@@ -798,10 +1257,14 @@ struct SessionManager* SessionManager_new(struct Allocator* allocator,
 
     sm->firstHandle =
         (Random_uint32(rand) % (MAX_FIRST_HANDLE - MIN_FIRST_HANDLE)) + MIN_FIRST_HANDLE;
+    sm->handshakeHashSeed = Random_uint32(rand);
 
     Timeout_setInterval(periodically, sm, 10000, eventBase, alloc);
+    sm->probeTimeout = Timeout_setTimeout(probePaths, sm, sm->pub.probeIntervalMilliseconds,
+                                          eventBase, alloc);
 
     Identity_set(sm);
+    registerMetrics(sm, metrics);
 
     return &sm->pub;
 }
@@ -20,11 +20,29 @@
 #include "memory/Allocator.h"
 #include "wire/PFChan.h"
 #include "net/EventEmitter.h"
+#include "net/SwitchPinger.h"
+#include "util/Metrics.h"
 #include "wire/SwitchHeader.h"
 #include "wire/CryptoHeader.h"
 #include "util/Linker.h"
 Linker_require("net/SessionManager.c");
 
+struct SessionManager_HandshakeStats
+{
+    /** Handshake packets which were decrypted and which failed to decrypt. */
+    uint64_t accepted;
+    uint64_t failed;
+
+    /** Handshake packets dropped because the same switch label and key sent too many. */
+    uint64_t droppedSource;
+
+    /** Handshake packets dropped because handshakes had used up their share of the CPU. */
+    uint64_t droppedBusy;
+
+    /** Handshakes from unknown nodes which failed, so no session was created. */
+    uint64_t sessionsNotCreated;
+};
+
 /**
  * Purpose of this module is to take packets from "the inside" which contain ipv6 address and
  * skeleton switch header and find an appropriate CryptoAuth session for them or begin one.
@@ -67,8 +85,56 @@ struct SessionManager
      */
     #define SessionManager_SESSION_SEARCH_AFTER_MILLISECONDS_DEFAULT 30000
     int64_t sessionSearchAfterMilliseconds;
+
+    /**
+     * Handshake packets from a switch label and key are allowed in a burst of sourceHandshakeBurst
+     * and then one per sourceHandshakeIntervalMilliseconds, the rest are dropped.
+     * If sourceHandshakeIntervalMilliseconds is 0 there is no per-source limit.
+     */
+    #define SessionManager_SOURCE_HANDSHAKE_BURST_DEFAULT 16
+    int sourceHandshakeBurst;
+    #define SessionManager_SOURCE_HANDSHAKE_INTERVAL_MILLISECONDS_DEFAULT 250
+    int64_t sourceHandshakeIntervalMilliseconds;
+
+    /**
+     * Percent of the CPU which decrypting handshakes may take, measured over about a second.
+     * When it is used up, handshake packets are dropped without being decrypted.
+     */
+    #define SessionManager_HANDSHAKE_CPU_PERCENT_DEFAULT 50
+    int handshakeCpuPercent;
+
+    struct SessionManager_HandshakeStats handshakeStats;
+
+    /**
+     * Sessions which have sent traffic recently and have more than one path probe each path this
+     * often, a path is not used after a probe on it is lost until one returns again.
+     * Only a few probes are sent each time so with many sessions they take turns.
+     * Zero disables probing and so spreading traffic over more than one path.
+     */
+    #define SessionManager_PROBE_INTERVAL_MILLISECONDS_DEFAULT 1000
+    int64_t probeIntervalMilliseconds;
+};
+
+/** A switch label to a node along with how well probes are doing on it. */
+struct SessionManager_Path
+{
+    /** The label, zero if this path is not in use. */
+    uint64_t label;
+
+    /** Smoothed round trip time of probes, zero until one has returned. */
+    uint32_t rttMilliseconds;
+
+    /** One bit per probe, most recent in the low bit, set if it was lost. */
+    uint16_t lossHistory;
+
+    /** Number of probes which were sent and which were lost. */
+    uint32_t probes;
+    uint32_t lostProbes;
 };
 
+/** Most paths which are kept for a session. */
+#define SessionManager_PATHS 4
+
 struct SessionManager_Session
 {
     struct CryptoAuth_Session* caSession;
@@ -111,6 +177,21 @@ struct SessionManager_Session
 
     /** If non-zero, the peer will be periodically queries to maintain the session. */
     int maintainSession;
+
+    /**
+     * Paths which traffic may be spread over, sendSwitchLabel is always among them if it is
+     * non-zero. Paths other than sendSwitchLabel are only used once probes have returned on them.
+     */
+    struct SessionManager_Path paths[SessionManager_PATHS];
+
+    /** Incoming packets which a switch along the way marked as congested. */
+    uint32_t congestedPackets;
+
+    /**
+     * Smoothed congestion level of incoming packets, from 0 to 127, a switch with a queue building
+     * up marks packets with a higher level the longer the queue is.
+     */
+    uint32_t congestion;
 };
 
 struct SessionManager_HandleList
@@ -143,6 +224,8 @@ struct SessionManager* SessionManager_new(struct Allocator* alloc,
                                           struct CryptoAuth* cryptoAuth,
                                           struct Random* rand,
                                           struct Log* log,
-                                          struct EventEmitter* ee);
+                                          struct EventEmitter* ee,
+                                          struct SwitchPinger* switchPinger,
+                                          struct Metrics* metrics);
 
 #endif
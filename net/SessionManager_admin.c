@@ -100,6 +100,23 @@ static void outputSession(struct Context* context,
 
     Dict_putIntC(r, "metric", session->metric, alloc);
     Dict_putIntC(r, "maintainSession", session->maintainSession, alloc);
+    Dict_putIntC(r, "congestedPackets", session->congestedPackets, alloc);
+    Dict_putIntC(r, "congestion", session->congestion, alloc);
+
+    List* paths = List_new(alloc);
+    for (int i = 0; i < SessionManager_PATHS; i++) {
+        struct SessionManager_Path* p = &session->paths[i];
+        if (!p->label) { continue; }
+        Dict* path = Dict_new(alloc);
+        uint8_t printedPath[20];
+        AddrTools_printPath(printedPath, p->label);
+        Dict_putStringC(path, "path", String_new(printedPath, alloc), alloc);
+        Dict_putIntC(path, "rtt", p->rttMilliseconds, alloc);
+        Dict_putIntC(path, "probes", p->probes, alloc);
+        Dict_putIntC(path, "lostProbes", p->lostProbes, alloc);
+        List_addDict(paths, path, alloc);
+    }
+    Dict_putListC(r, "paths", paths, alloc);
 
     Admin_sendMessage(r, txid, context->admin);
     return;
@@ -169,6 +186,47 @@ static void resetCA(Dict* args,
     Admin_sendMessage(r, txid, context->admin);
 }
 
+static void handshakeStats(Dict* args, void* vcontext, String* txid, struct Allocator* alloc)
+{
+    struct Context* context = Identity_check((struct Context*) vcontext);
+    struct SessionManager* sm = context->sm;
+    struct SessionManager_HandshakeStats* stats = &sm->handshakeStats;
+    Dict* r = Dict_new(alloc);
+    Dict_putIntC(r, "accepted", stats->accepted, alloc);
+    Dict_putIntC(r, "failed", stats->failed, alloc);
+    Dict_putIntC(r, "droppedSource", stats->droppedSource, alloc);
+    Dict_putIntC(r, "droppedBusy", stats->droppedBusy, alloc);
+    Dict_putIntC(r, "sessionsNotCreated", stats->sessionsNotCreated, alloc);
+    Dict_putIntC(r, "sourceBurst", sm->sourceHandshakeBurst, alloc);
+    Dict_putIntC(r, "sourceIntervalMilliseconds", sm->sourceHandshakeIntervalMilliseconds, alloc);
+    Dict_putIntC(r, "cpuPercent", sm->handshakeCpuPercent, alloc);
+    Dict_putStringCC(r, "error", "none", alloc);
+    Admin_sendMessage(r, txid, context->admin);
+}
+
+static void setHandshakeLimits(Dict* args, void* vcontext, String* txid, struct Allocator* alloc)
+{
+    struct Context* context = Identity_check((struct Context*) vcontext);
+    int64_t* burst = Dict_getIntC(args, "sourceBurst");
+    int64_t* interval = Dict_getIntC(args, "sourceIntervalMilliseconds");
+    int64_t* cpuPercent = Dict_getIntC(args, "cpuPercent");
+    char* err = "none";
+    if (burst && (*burst < 1 || *burst > 1000000)) {
+        err = "sourceBurst must be between 1 and 1000000";
+    } else if (interval && (*interval < 0 || *interval > 3600000)) {
+        err = "sourceIntervalMilliseconds must be between 0 (no limit) and 3600000";
+    } else if (cpuPercent && (*cpuPercent < 1 || *cpuPercent > 100)) {
+        err = "cpuPercent must be between 1 and 100";
+    } else {
+        if (burst) { context->sm->sourceHandshakeBurst = *burst; }
+        if (interval) { context->sm->sourceHandshakeIntervalMilliseconds = *interval; }
+        if (cpuPercent) { context->sm->handshakeCpuPercent = *cpuPercent; }
+    }
+    Dict* r = Dict_new(alloc);
+    Dict_putStringCC(r, "error", err, alloc);
+    Admin_sendMessage(r, txid, context->admin);
+}
+
 void SessionManager_admin_register(struct SessionManager* sm,
                                    struct Admin* admin,
                                    struct Allocator* alloc)
@@ -199,4 +257,14 @@ void SessionManager_admin_register(struct SessionManager* sm,
         ((struct Admin_FunctionArg[]) {
             { .name = "ip6", .required = 1, .type = "String" }
         }), admin);
+
+    Admin_registerFunction("SessionManager_handshakeStats", handshakeStats, ctx, false, NULL,
+        admin);
+
+    Admin_registerFunction("SessionManager_setHandshakeLimits", setHandshakeLimits, ctx, true,
+        ((struct Admin_FunctionArg[]) {
+            { .name = "sourceBurst", .required = 0, .type = "Int" },
+            { .name = "sourceIntervalMilliseconds", .required = 0, .type = "Int" },
+            { .name = "cpuPercent", .required = 0, .type = "Int" }
+        }), admin);
 }
@@ -84,6 +84,8 @@ static Iface_DEFUN incomingFromTunIf(struct Message* msg, struct Iface* tunIf)
         return Iface_next(tunIf, msg);
     }
 
+    uint8_t ecn = Headers_IP6Header_getEcn(header);
+
     // first move the dest addr to the right place.
     Bits_memmove(header->destinationAddr - DataHeader_SIZE, header->destinationAddr, 16);
 
@@ -94,6 +96,7 @@ static Iface_DEFUN incomingFromTunIf(struct Message* msg, struct Iface* tunIf)
     Bits_memset(dh, 0, DataHeader_SIZE);
     DataHeader_setContentType(dh, header->nextHeader);
     DataHeader_setVersion(dh, DataHeader_CURRENT_VERSION);
+    DataHeader_setEcn(dh, ecn);
 
     // Other than the ipv6 addr at the end, everything is zeros right down the line.
     Bits_memset(rh, 0, RouteHeader_SIZE - 16);
@@ -127,6 +130,7 @@ static Iface_DEFUN incomingFromUpperDistributorIf(struct Message* msg,
     struct DataHeader* dh = (struct DataHeader*) &hdr[1];
     enum ContentType type = DataHeader_getContentType(dh);
     Assert_true(type <= ContentType_IP6_MAX);
+    uint8_t ecn = DataHeader_getEcn(dh);
 
     // Shift ip address into destination slot.
     Bits_memmove(hdr->ip6 + DataHeader_SIZE - 16, hdr->ip6, 16);
@@ -137,6 +141,7 @@ static Iface_DEFUN incomingFromUpperDistributorIf(struct Message* msg,
     struct Headers_IP6Header* ip6 = (struct Headers_IP6Header*) msg->bytes;
     Bits_memset(ip6, 0, Headers_IP6Header_SIZE - 32);
     Headers_setIpVersion(ip6);
+    Headers_IP6Header_setEcn(ip6, ecn);
     ip6->payloadLength_be = Endian_bigEndianToHost16(msg->length - Headers_IP6Header_SIZE);
     ip6->nextHeader = type;
     ip6->hopLimit = 42;
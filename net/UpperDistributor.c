@@ -29,6 +29,12 @@ struct UpperDistributor_Handler_pvt
 {
     struct UpperDistributor_Handler pub;
     struct Allocator* alloc;
+
+    /** The next handler in the same slot of UpperDistributor_pvt.byType. */
+    struct UpperDistributor_Handler_pvt* next;
+
+    /** Number of messages of this type which have been seen, for sampling. */
+    uint32_t seen;
 };
 
 #define Map_KEY_TYPE int
@@ -36,6 +42,20 @@ struct UpperDistributor_Handler_pvt
 #define Map_NAME OfHandlers
 #include "util/Map.h"
 
+/**
+ * Every content type up to ContentType_RESERVED has its own slot in the table of handlers,
+ * CTRL has one and all of the others share the last one.
+ */
+#define TYPE_SLOTS (ContentType_RESERVED + 2)
+
+static inline int typeSlot(enum ContentType type)
+{
+    if (type < ContentType_RESERVED) {
+        return type;
+    }
+    return (type == ContentType_CTRL) ? ContentType_RESERVED : ContentType_RESERVED + 1;
+}
+
 struct UpperDistributor_pvt
 {
     struct UpperDistributor pub;
@@ -45,6 +65,15 @@ struct UpperDistributor_pvt
 
     struct Map_OfHandlers* handlers;
 
+    /** The same handlers as in the map, in linked lists by content type. */
+    struct UpperDistributor_Handler_pvt* byType[TYPE_SLOTS];
+
+    /** Checksum of the source and destination addresses of the messages sent to handlers. */
+    uint32_t handlerAddrSum;
+
+    /** The address which handlers appear at, messages from the TUN to it go to fromHandler(). */
+    uint8_t handlerIp6[16];
+
     struct Allocator* alloc;
     int noSendToHandler;
     Identity
@@ -108,23 +137,48 @@ static void sendToHandlers(struct Message* msg,
         ud->noSendToHandler--;
         return;
     }
-    for (int i = 0; i < (int)ud->handlers->count; i++) {
-        if (ud->handlers->values[i]->pub.type != type) { continue; }
-        struct Allocator* alloc = Allocator_child(msg->alloc);
-        struct Message* cmsg = Message_clone(msg, alloc);
+
+    // One allocator for the copies to all handlers, if a copy is queued somewhere then the
+    // allocator is adopted and it lives until the last user is done with it.
+    struct Allocator* alloc = NULL;
+
+    // Handlers with the same snapLen get the same content so it only needs to be summed once.
+    int32_t sumLength = -1;
+    uint32_t contentSum = 0;
+
+    for (struct UpperDistributor_Handler_pvt* h = ud->byType[typeSlot(type)]; h; h = h->next) {
+        if (h->pub.type != type) { continue; }
+        if (h->pub.sampleRate > 1 && (h->seen++ % h->pub.sampleRate)) { continue; }
+
+        int32_t length = msg->length;
+        if (h->pub.snapLen && (uint32_t)(length - RouteHeader_SIZE) > h->pub.snapLen) {
+            length = RouteHeader_SIZE + h->pub.snapLen;
+        }
+        if (!alloc) {
+            alloc = Allocator_child(msg->alloc);
+        }
+        struct Message* cmsg = Message_new(length, (msg->padding + 7) & ~7, alloc);
+        Bits_memcpy(cmsg->bytes, msg->bytes, length);
+        if (length != sumLength) {
+            contentSum = Checksum_step(cmsg->bytes, length, 0);
+            sumLength = length;
+        }
 
         {
             struct Headers_UDPHeader udpH;
             udpH.srcPort_be = Endian_hostToBigEndian16(MAGIC_PORT);
-            udpH.destPort_be = Endian_hostToBigEndian16(ud->handlers->values[i]->pub.udpPort);
+            udpH.destPort_be = Endian_hostToBigEndian16(h->pub.udpPort);
             udpH.length_be = Endian_hostToBigEndian16(cmsg->length + Headers_UDPHeader_SIZE);
             udpH.checksum_be = 0;
             Er_assert(Message_epush(cmsg, &udpH, Headers_UDPHeader_SIZE));
-            uint8_t srcAndDest[32] = {0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1};
-            AddressCalc_makeValidAddress(srcAndDest);
-            Bits_memcpy(&srcAndDest[16], ud->myAddress->ip6.bytes, 16);
-            uint16_t checksum = Checksum_udpIp6(srcAndDest, cmsg->bytes, cmsg->length);
-            ((struct Headers_UDPHeader*)cmsg->bytes)->checksum_be = checksum;
+
+            // Same as Checksum_udpIp6() but with the sum of the content reused.
+            uint32_t sum = Checksum_step32(Endian_hostToBigEndian32(cmsg->length),
+                                           ud->handlerAddrSum);
+            sum = Checksum_step32(Endian_hostToBigEndian32(17), sum);
+            sum = Checksum_step(cmsg->bytes, Headers_UDPHeader_SIZE, sum);
+            ((struct Headers_UDPHeader*)cmsg->bytes)->checksum_be =
+                Checksum_complete(sum + contentSum);
         }
         {
             struct DataHeader dh = { .unused = 0 };
@@ -142,6 +196,8 @@ static void sendToHandlers(struct Message* msg,
         }
 
         Iface_send(&ud->pub.tunAdapterIf, cmsg);
+    }
+    if (alloc) {
         Allocator_free(alloc);
     }
 }
@@ -173,9 +229,7 @@ static Iface_DEFUN incomingFromTunAdapterIf(struct Message* msg, struct Iface* t
         Identity_containerOf(tunAdapterIf, struct UpperDistributor_pvt, pub.tunAdapterIf);
     struct RouteHeader* rh = (struct RouteHeader*) msg->bytes;
     Assert_true(msg->length >= RouteHeader_SIZE);
-    uint8_t expected_ip6[16] = {0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1};
-    AddressCalc_makeValidAddress(expected_ip6);
-    if (!Bits_memcmp(rh->ip6, expected_ip6, 16)) {
+    if (!Bits_memcmp(rh->ip6, ud->handlerIp6, 16)) {
         return fromHandler(msg, ud);
     }
     return toSessionManagerIf(msg, ud);
@@ -239,6 +293,11 @@ int UpperDistributor_unregisterHandler(struct UpperDistributor* upper, int udpPo
     }
     struct UpperDistributor_Handler_pvt* udhp = ud->handlers->values[index];
     Map_OfHandlers_remove(index, ud->handlers);
+    struct UpperDistributor_Handler_pvt** hp = &ud->byType[typeSlot(udhp->pub.type)];
+    while (*hp != udhp) {
+        hp = &(*hp)->next;
+    }
+    *hp = udhp->next;
     Allocator_free(udhp->alloc);
     return 0;
 }
@@ -262,7 +321,9 @@ int UpperDistributor_listHandlers(struct UpperDistributor* ud,
 
 int UpperDistributor_registerHandler(struct UpperDistributor* upper,
                                      enum ContentType ct,
-                                     int udpPort)
+                                     int udpPort,
+                                     uint32_t sampleRate,
+                                     uint32_t snapLen)
 {
     struct UpperDistributor_pvt* ud = Identity_check((struct UpperDistributor_pvt*) upper);
 
@@ -278,7 +339,16 @@ int UpperDistributor_registerHandler(struct UpperDistributor* upper,
     udhp->alloc = alloc;
     udhp->pub.udpPort = udpPort;
     udhp->pub.type = ct;
+    udhp->pub.sampleRate = sampleRate;
+    udhp->pub.snapLen = snapLen;
     Assert_true(Map_OfHandlers_put(&udpPort, &udhp, ud->handlers) >= 0);
+
+    // Appended so that handlers of the same type are called in the order they registered.
+    struct UpperDistributor_Handler_pvt** hp = &ud->byType[typeSlot(ct)];
+    while (*hp) {
+        hp = &(*hp)->next;
+    }
+    *hp = udhp;
     return 0;
 }
 
@@ -301,6 +371,12 @@ struct UpperDistributor* UpperDistributor_new(struct Allocator* allocator,
     out->alloc = alloc;
     out->myAddress = myAddress;
 
+    uint8_t srcAndDest[32] = {0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1};
+    AddressCalc_makeValidAddress(srcAndDest);
+    Bits_memcpy(out->handlerIp6, srcAndDest, 16);
+    Bits_memcpy(&srcAndDest[16], myAddress->ip6.bytes, 16);
+    out->handlerAddrSum = Checksum_step(srcAndDest, 32, 0);
+
     EventEmitter_regCore(ee, &out->eventIf, PFChan_Pathfinder_SENDMSG);
     EventEmitter_regCore(ee, &out->eventIf, PFChan_Pathfinder_CTRL_SENDMSG);
 
@@ -41,6 +41,15 @@ struct UpperDistributor_Handler
 {
     enum ContentType type;
     int udpPort;
+
+    /** One in every sampleRate messages is sent to the handler, 0 or 1 means all of them. */
+    uint32_t sampleRate;
+
+    /**
+     * Only the RouteHeader and the first snapLen bytes after it are sent to the handler,
+     * 0 means the whole message.
+     */
+    uint32_t snapLen;
 };
 
 /** If the regNum does not corrispond to an existing handler */
@@ -62,11 +71,16 @@ int UpperDistributor_listHandlers(struct UpperDistributor* ud,
 
 /**
  * Register a handler for receiving messages of a given contentType.
+ *
+ * @param sampleRate send only one in every sampleRate messages, 0 for all.
+ * @param snapLen send only this many bytes after the RouteHeader, 0 for the whole message.
  * @return 0 unless there is an error.
  */
 int UpperDistributor_registerHandler(struct UpperDistributor* ud,
                                      enum ContentType ct,
-                                     int udpPort);
+                                     int udpPort,
+                                     uint32_t sampleRate,
+                                     uint32_t snapLen);
 
 struct UpperDistributor* UpperDistributor_new(struct Allocator* alloc,
                                               struct Log* log,
@@ -70,6 +70,8 @@ static void listHandlers(Dict* args, void* vctx, String* txid, struct Allocator*
         Dict* d = Dict_new(requestAlloc);
         Dict_putIntC(d, "udpPort", handlers[i].udpPort, requestAlloc);
         Dict_putIntC(d, "type", handlers[i].type, requestAlloc);
+        Dict_putIntC(d, "sampleRate", handlers[i].sampleRate, requestAlloc);
+        Dict_putIntC(d, "snapLen", handlers[i].snapLen, requestAlloc);
         List_addDict(handlerList, d, requestAlloc);
     }
     Dict* out = Dict_new(requestAlloc);
@@ -92,8 +94,18 @@ static void registerHandler(Dict* args, void* vctx, String* txid, struct Allocat
         return;
     }
     enum ContentType ct = (enum ContentType) *contentTypeP;
+    int64_t* sampleRateP = Dict_getIntC(args, "sampleRate");
+    int64_t* snapLenP = Dict_getIntC(args, "snapLen");
+    if ((sampleRateP && (*sampleRateP < 0 || *sampleRateP > UINT32_MAX))
+        || (snapLenP && (*snapLenP < 0 || *snapLenP > 65535)))
+    {
+        sendError(ctx, txid, requestAlloc, "invalid_sampleRate_or_snapLen");
+        return;
+    }
+    uint32_t sampleRate = (sampleRateP) ? *sampleRateP : 0;
+    uint32_t snapLen = (snapLenP) ? *snapLenP : 0;
 
-    int ret = UpperDistributor_registerHandler(ctx->ud, ct, (int) *udpPort);
+    int ret = UpperDistributor_registerHandler(ctx->ud, ct, (int) *udpPort, sampleRate, snapLen);
     if (ret < 0) {
         char* err = "UNKNOWN";
         if (ret == UpperDistributor_registerHandler_PORT_REGISTERED) {
@@ -128,5 +140,7 @@ void UpperDistributor_admin_register(struct UpperDistributor* ud,
         ((struct Admin_FunctionArg[]) {
             { .name = "contentType", .required = true, .type = "Int" },
             { .name = "udpPort", .required = true, .type = "Int" },
+            { .name = "sampleRate", .required = false, .type = "Int" },
+            { .name = "snapLen", .required = false, .type = "Int" },
         }), admin);
 }
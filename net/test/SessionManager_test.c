@@ -0,0 +1,166 @@
+/* vim: set expandtab ts=4 sw=4: */
+/*
+ * You may redistribute this program and/or modify it under the terms of
+ * the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "crypto/CryptoAuth.h"
+#include "crypto/Key.h"
+#include "crypto/random/Random.h"
+#include "dht/Address.h"
+#include "interface/Iface.h"
+#include "memory/MallocAllocator.h"
+#include "net/EventEmitter.h"
+#include "net/SessionManager.h"
+#include "net/SwitchPinger.h"
+#include "util/Assert.h"
+#include "util/Bits.h"
+#include "util/Endian.h"
+#include "util/Identity.h"
+#include "util/Metrics.h"
+#include "util/events/EventBase.h"
+#include "util/events/Time.h"
+#include "util/events/Timeout.h"
+#include "util/log/FileWriterLog.h"
+#include "wire/Message.h"
+#include "wire/SwitchHeader.h"
+
+#include <stdio.h>
+
+#define BURST 4
+#define INTERVAL 50
+
+struct Context
+{
+    /** Plumbed to the SessionManager's switchIf, anything sent back is dropped. */
+    struct Iface switchIf;
+
+    struct SessionManager* sm;
+    struct EventBase* base;
+    struct Allocator* alloc;
+
+    /** A handshake which will not decrypt so that each copy is counted as failed. */
+    struct Message* hello;
+
+    Identity
+};
+
+static Iface_DEFUN fromSessionManager(struct Message* msg, struct Iface* iface)
+{
+    return NULL;
+}
+
+/** Send copies of the hello, returns how many were let through to be decrypted. */
+static int sendHellos(struct Context* ctx, int count)
+{
+    uint64_t admitted = ctx->sm->handshakeStats.failed;
+    uint64_t dropped = ctx->sm->handshakeStats.droppedSource;
+    for (int i = 0; i < count; i++) {
+        struct Allocator* alloc = Allocator_child(ctx->alloc);
+        struct Message* msg = Message_new(0, ctx->hello->length + 64, alloc);
+        Er_assert(Message_epush(msg, ctx->hello->bytes, ctx->hello->length));
+        Iface_send(&ctx->switchIf, msg);
+        Allocator_free(alloc);
+    }
+    Assert_true(!ctx->sm->handshakeStats.accepted);
+    Assert_true(!ctx->sm->handshakeStats.droppedBusy);
+    admitted = ctx->sm->handshakeStats.failed - admitted;
+    dropped = ctx->sm->handshakeStats.droppedSource - dropped;
+    Assert_true(admitted + dropped == (uint64_t) count);
+    return (int) admitted;
+}
+
+static void stopLoop(void* vcontext)
+{
+    struct Context* ctx = Identity_check((struct Context*) vcontext);
+    EventBase_endLoop(ctx->base);
+}
+
+/** Run the event loop for a while so that the time moves on. */
+static void waitMilliseconds(struct Context* ctx, int milliseconds)
+{
+    Timeout_setTimeout(stopLoop, ctx, milliseconds, ctx->base, ctx->alloc);
+    EventBase_beginLoop(ctx->base);
+}
+
+static void mkHello(struct Context* ctx, struct Random* rand, struct Log* log, uint8_t* herKey)
+{
+    uint8_t ip6[16];
+    uint8_t publicKey[32];
+    uint8_t privateKey[32];
+    Assert_true(!Key_gen(ip6, publicKey, privateKey, rand));
+    struct CryptoAuth* ca = CryptoAuth_new(ctx->alloc, privateKey, ctx->base, log, rand);
+    struct CryptoAuth_Session* sess =
+        CryptoAuth_newSession(ca, ctx->alloc, herKey, false, "test");
+
+    struct Message* msg = ctx->hello = Message_new(64, 512, ctx->alloc);
+    Bits_memset(msg->bytes, 0, msg->length);
+    Assert_true(!CryptoAuth_encrypt(sess, msg));
+    Assert_true(CryptoAuth_getState(sess) == CryptoAuth_State_SENT_HELLO);
+    // Break the authenticator so it is never decrypted and no session is made.
+    msg->bytes[msg->length - 1] ^= 1;
+
+    struct SwitchHeader sh = { .label_be = Endian_hostToBigEndian64(0x13) };
+    Er_assert(Message_epush(msg, &sh, SwitchHeader_SIZE));
+}
+
+int main()
+{
+    struct Allocator* alloc = MallocAllocator_new(1<<22);
+    struct Log* log = FileWriterLog_new(stdout, alloc);
+    struct Random* rand = Random_new(alloc, log, NULL);
+    struct Context* ctx = Allocator_calloc(alloc, sizeof(struct Context), 1);
+    Identity_set(ctx);
+    ctx->alloc = alloc;
+    ctx->base = EventBase_new(alloc);
+
+    struct Address* myAddr = Allocator_calloc(alloc, sizeof(struct Address), 1);
+    uint8_t privateKey[32];
+    Assert_true(!Key_gen(myAddr->ip6.bytes, myAddr->key, privateKey, rand));
+    myAddr->path = 1;
+    struct CryptoAuth* ca = CryptoAuth_new(alloc, privateKey, ctx->base, log, rand);
+    struct EventEmitter* ee = EventEmitter_new(alloc, log, ca->publicKey);
+    struct SwitchPinger* sp = SwitchPinger_new(ctx->base, rand, log, myAddr, alloc);
+    ctx->sm = SessionManager_new(alloc, ctx->base, ca, rand, log, ee, sp, Metrics_new(alloc));
+    ctx->switchIf.send = fromSessionManager;
+    Iface_plumb(&ctx->switchIf, &ctx->sm->switchIf);
+
+    ctx->sm->sourceHandshakeBurst = BURST;
+    ctx->sm->sourceHandshakeIntervalMilliseconds = INTERVAL;
+    ctx->sm->handshakeCpuPercent = 100;
+    mkHello(ctx, rand, log, myAddr->key);
+
+    // The whole burst gets through and the next one is dropped.
+    Assert_true(sendHellos(ctx, BURST) == BURST);
+    int64_t start = Time_currentTimeMilliseconds(ctx->base);
+    Assert_true(sendHellos(ctx, 1) == 0);
+
+    // One more for every interval which has passed, part of an interval counts as a whole one.
+    waitMilliseconds(ctx, INTERVAL);
+    int64_t passed = Time_currentTimeMilliseconds(ctx->base) - start;
+    Assert_true(passed >= INTERVAL);
+    if (passed < INTERVAL * BURST) {
+        Assert_true(sendHellos(ctx, BURST) == (passed + INTERVAL - 1) / INTERVAL);
+        Assert_true(sendHellos(ctx, 1) == 0);
+    }
+
+    // Once the burst has been earned back it can all be sent again.
+    waitMilliseconds(ctx, INTERVAL * (BURST + 1));
+    Assert_true(sendHellos(ctx, BURST) == BURST);
+    Assert_true(sendHellos(ctx, 1) == 0);
+
+    // With no interval there is no limit per source.
+    ctx->sm->sourceHandshakeIntervalMilliseconds = 0;
+    Assert_true(sendHellos(ctx, BURST * 4) == BURST * 4);
+
+    Allocator_free(alloc);
+    return 0;
+}
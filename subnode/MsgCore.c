@@ -21,6 +21,7 @@
 #include "subnode/MsgCore.h"
 #include "benc/serialization/standard/BencMessageReader.h"
 #include "benc/serialization/standard/BencMessageWriter.h"
+#include "benc/serialization/standard/BencStreamReader.h"
 #include "switch/EncodingScheme.h"
 #include "util/Escape.h"
 #include "util/Defined.h"
@@ -217,29 +218,25 @@ struct MsgCore_Promise* MsgCore_createQuery(struct MsgCore* core,
     return &out->pub;
 }
 
-static Iface_DEFUN queryMsg(struct MsgCore_pvt* mcp,
-                            Dict* content,
-                            struct Address* src,
-                            struct Message* msg)
+static struct QueryHandler* getQueryHandler(struct MsgCore_pvt* mcp,
+                                            struct BencStreamReader_Token* q)
 {
-    String* q = Dict_getStringC(content, "q");
-    struct QueryHandler* qh = NULL;
     for (int i = 0; i < mcp->qh->length; i++) {
         struct QueryHandler* qhx = ArrayList_OfQueryHandlers_get(mcp->qh, i);
         Identity_check(qhx);
-        if (String_equals(qhx->queryType, q)) {
-            qh = qhx;
-            break;
-        }
-    }
-    if (!qh) {
-        Log_debug(mcp->log, "Unhandled query type [%s]", q->bytes);
-        return NULL;
-    }
-    if (!qh->pub.cb) {
-        Log_info(mcp->log, "Query handler for [%s] not setup", q->bytes);
-        return NULL;
+        if (qhx->queryType->len != q->len) { continue; }
+        if (Bits_memcmp(qhx->queryType->bytes, q->bytes, q->len)) { continue; }
+        return qhx;
     }
+    return NULL;
+}
+
+static Iface_DEFUN queryMsg(struct MsgCore_pvt* mcp,
+                            struct QueryHandler* qh,
+                            Dict* content,
+                            struct Address* src,
+                            struct Message* msg)
+{
     qh->pub.cb(content, src, msg->alloc, &qh->pub);
     return NULL;
 }
@@ -274,6 +271,14 @@ struct MsgCore_Handler* MsgCore_onQuery(struct MsgCore* core,
     return &qh->pub;
 }
 
+static char* queryStr(struct BencStreamReader_Token* q, struct Allocator* alloc)
+{
+    if (q->type == BencStreamReader_Type_STRING) {
+        return Escape_getEscaped((uint8_t*) q->bytes, q->len, alloc);
+    }
+    return "(no query)";
+}
+
 static Iface_DEFUN incoming(struct Message* msg, struct Iface* interRouterIf)
 {
     struct MsgCore_pvt* mcp =
@@ -294,48 +299,70 @@ static Iface_DEFUN incoming(struct Message* msg, struct Iface* interRouterIf)
     //    Escape_getEscaped(msg->bytes, msg->length, msg->alloc),
     //    Address_toString(&addr, msg->alloc)->bytes);
     //
-    BencMessageReader_readNoExcept(msg, msg->alloc, &content);
-    if (!content) {
+
+    // Everything needed to decide whether to drop the message is read in place so that the
+    // Dict is only built for messages which are going to be handled.
+    struct BencStreamReader_Field fields[] = { { .key = "p" }, { .key = "q" }, { .key = "txid" } };
+    struct BencStreamReader_Token* ver = &fields[0].value;
+    struct BencStreamReader_Token* q = &fields[1].value;
+    struct BencStreamReader_Token* txid = &fields[2].value;
+    struct BencStreamReader r;
+    BencStreamReader_init(&r, msgBytes, length);
+    if (BencStreamReader_getFields(&r, fields, sizeof(fields) / sizeof(*fields))) {
         char* esc = Escape_getEscaped(msgBytes, length, msg->alloc);
-        Log_debug(mcp->log, "DROP Malformed message [%s]", esc);
+        Log_debug(mcp->log, "DROP Malformed message [%s] [%s]", esc, r.error);
         return NULL;
     }
 
-    int64_t* verP = Dict_getIntC(content, "p");
-    if (!verP) {
+    if (ver->type != BencStreamReader_Type_INT) {
         Log_debug(mcp->log, "DROP Message without version");
         return NULL;
     }
-    addr.protocolVersion = *verP;
+    addr.protocolVersion = ver->number;
     if (!addr.protocolVersion) {
         Log_debug(mcp->log, "DROP Message with zero version");
         return NULL;
     }
 
-    String* q = Dict_getStringC(content, "q");
+    bool isQuery = (q->type == BencStreamReader_Type_STRING);
 
-    String* txid = Dict_getStringC(content, "txid");
-    if (!txid || !txid->len) {
-        Log_debug(mcp->log, "Message with no txid [%s]", q ? (q->bytes) : "(no query)");
+    if (txid->type != BencStreamReader_Type_STRING || !txid->len) {
+        Log_debug(mcp->log, "Message with no txid [%s]", queryStr(q, msg->alloc));
         return NULL;
     }
 
-    if (!Defined(SUBNODE)) {
-        if (q) {
-            if (txid->bytes[0] != '1') {
-                Log_debug(mcp->log, "DROP query which begins with 0 and is for old pathfinder");
-                return NULL;
-            }
-        } else {
-            String* newTxid = String_newBinary(NULL, txid->len - 1, msg->alloc);
-            Bits_memcpy(newTxid->bytes, &txid->bytes[1], txid->len - 1);
-            Dict_putStringC(content, "txid", newTxid, msg->alloc);
-            txid = newTxid;
+    if (!Defined(SUBNODE) && isQuery && txid->bytes[0] != '1') {
+        Log_debug(mcp->log, "DROP query which begins with 0 and is for old pathfinder");
+        return NULL;
+    }
+
+    struct QueryHandler* qh = NULL;
+    if (isQuery) {
+        qh = getQueryHandler(mcp, q);
+        if (!qh) {
+            Log_debug(mcp->log, "Unhandled query type [%s]", queryStr(q, msg->alloc));
+            return NULL;
+        }
+        if (!qh->pub.cb) {
+            Log_info(mcp->log, "Query handler for [%s] not setup", queryStr(q, msg->alloc));
+            return NULL;
         }
     }
 
-    if (q) {
-        return queryMsg(mcp, content, &addr, msg);
+    BencMessageReader_readNoExcept(msg, msg->alloc, &content);
+    if (!content) {
+        // BencStreamReader accepts nothing which BencMessageReader does not.
+        Log_debug(mcp->log, "DROP Malformed message");
+        return NULL;
+    }
+
+    if (!Defined(SUBNODE) && !isQuery) {
+        String* newTxid = String_newBinary((char*) &txid->bytes[1], txid->len - 1, msg->alloc);
+        Dict_putStringC(content, "txid", newTxid, msg->alloc);
+    }
+
+    if (qh) {
+        return queryMsg(mcp, qh, content, &addr, msg);
     } else {
         return replyMsg(mcp, content, &addr, msg);
     }
@@ -20,6 +20,7 @@
 #include "crypto/AddressCalc.h"
 #include "crypto/Sign.h"
 #include "util/AddrTools.h"
+#include "util/Hash.h"
 #include "util/Hex.h"
 
 #include "crypto_hash_sha512.h"
@@ -35,14 +36,33 @@
 struct ReachabilityAnnouncer_Peer {
     struct Announce_Peer ap;
     struct ReachabilityCollector_PeerInfo* pi;
-    // The number of link state samples which have already been announced up to the snode
+    // The number of link state samples which the snode has acknowledged
     uint32_t samplesAnnounced;
+    // The number of link state samples which will be acknowledged when msgOnWire is replied to
+    uint32_t samplesOnWire;
 };
 
 #define ArrayList_TYPE struct ReachabilityAnnouncer_Peer
 #define ArrayList_NAME OfLocalPeers
 #include "util/ArrayList.h"
 
+// The same peers as in the ArrayList, indexed by ip so a subnode with hundreds of peers does
+// not search the list once for every peer of every message.
+static inline uint32_t peerHashCode(const struct ReachabilityAnnouncer_Peer* p)
+{
+    return Hash_compute((uint8_t*) p->ap.ipv6, 16);
+}
+static inline int peerCompare(const struct ReachabilityAnnouncer_Peer* a,
+                              const struct ReachabilityAnnouncer_Peer* b)
+{
+    return Bits_memcmp(a->ap.ipv6, b->ap.ipv6, 16);
+}
+#define Set_COMPARE peerCompare
+#define Set_HASHCODE peerHashCode
+#define Set_NAME OfLocalPeersByIp
+#define Set_TYPE struct ReachabilityAnnouncer_Peer
+#include "util/Set.h"
+
 #define ArrayList_TYPE struct Announce_Peer
 #define ArrayList_NAME OfBarePeers
 #include "util/ArrayList.h"
@@ -61,13 +81,11 @@ static struct Announce_Peer* peerFromMsg(struct Message* msg, uint8_t ip[16])
 }
 
 static struct ReachabilityAnnouncer_Peer*
-    peerFromLocalState(struct ArrayList_OfLocalPeers* localState, uint8_t addr[16])
+    peerFromLocalState(struct Set_OfLocalPeersByIp* index, uint8_t addr[16])
 {
-    for (int i = 0; i < localState->length; i++) {
-        struct ReachabilityAnnouncer_Peer* peer = ArrayList_OfLocalPeers_get(localState, i);
-        if (!Bits_memcmp(peer->ap.ipv6, addr, 16)) { return peer; }
-    }
-    return NULL;
+    struct ReachabilityAnnouncer_Peer key;
+    Bits_memcpy(key.ap.ipv6, addr, 16);
+    return Set_OfLocalPeersByIp_get(index, &key);
 }
 
 static int64_t timestampFromMsg(struct Message* msg)
@@ -176,6 +194,7 @@ struct ReachabilityAnnouncer_pvt
     uint8_t pubSigningKey[32];
 
     struct ArrayList_OfLocalPeers* localPeers;
+    struct Set_OfLocalPeersByIp* localPeersByIp;
 
     int64_t timeOfLastReply;
 
@@ -237,6 +256,8 @@ static bool pushLinkState(struct ReachabilityAnnouncer_pvt* rap,
             continue;
         }
         int lastLen = msg->length;
+        // Everything since the last acknowledged announcement, if the last one was lost then
+        // its samples are sent again.
         if (LinkState_encode(msg, &p->pi->linkState, p->samplesAnnounced)) {
             Log_debug(rap->log, "Failed to add link state for [%s]", peerIpPrinted);
         }
@@ -246,7 +267,7 @@ static bool pushLinkState(struct ReachabilityAnnouncer_pvt* rap,
             return true;
         } else {
             Log_debug(rap->log, "Updated link state for [%s]", peerIpPrinted);
-            p->samplesAnnounced = p->pi->linkState.samples;
+            p->samplesOnWire = p->pi->linkState.samples;
         }
     }
     return false;
@@ -317,6 +338,7 @@ static void removeLocalStatePeer(struct ReachabilityAnnouncer_pvt* rap, int i)
 {
     struct ReachabilityAnnouncer_Peer* peer =
         ArrayList_OfLocalPeers_remove(rap->localPeers, i);
+    Assert_true(peer == Set_OfLocalPeersByIp_remove(rap->localPeersByIp, peer));
     Allocator_realloc(rap->alloc, peer, 0);
 }
 
@@ -327,6 +349,7 @@ static struct ReachabilityAnnouncer_Peer* addLocalStatePeer(struct ReachabilityA
         Allocator_calloc(rap->alloc, sizeof(struct ReachabilityAnnouncer_Peer), 1);
     Bits_memcpy(&peer->ap, p, Announce_Peer_SIZE);
     ArrayList_OfLocalPeers_add(rap->localPeers, peer);
+    Set_OfLocalPeersByIp_add(rap->localPeersByIp, peer);
     Log_debug(rap->log, "addLocalStatePeer() now [%u] peers", rap->localPeers->length);
     return peer;
 }
@@ -384,6 +407,7 @@ static void stateReset(struct ReachabilityAnnouncer_pvt* rap)
     for (int i = 0; i < rap->localPeers->length; i++) {
         struct ReachabilityAnnouncer_Peer* p = ArrayList_OfLocalPeers_get(rap->localPeers, i);
         p->samplesAnnounced = 0;
+        p->samplesOnWire = 0;
     }
 }
 
@@ -433,6 +457,16 @@ static void addServerStateMsg(struct ReachabilityAnnouncer_pvt* rap, struct Mess
     Allocator_free(tempAlloc);
 }
 
+static bool hasOtherReachablePeer(struct ReachabilityAnnouncer_pvt* rap,
+                                  struct ReachabilityAnnouncer_Peer* peer)
+{
+    for (int i = 0; i < rap->localPeers->length; i++) {
+        struct ReachabilityAnnouncer_Peer* p = ArrayList_OfLocalPeers_get(rap->localPeers, i);
+        if (p != peer && p->ap.label_be) { return true; }
+    }
+    return false;
+}
+
 // -- Public -- //
 
 void ReachabilityAnnouncer_updatePeer(struct ReachabilityAnnouncer* ra,
@@ -459,19 +493,14 @@ void ReachabilityAnnouncer_updatePeer(struct ReachabilityAnnouncer* ra,
     }
     Bits_memcpy(refPeer.ipv6, ipv6, 16);
 
-    struct ReachabilityAnnouncer_Peer* peer = NULL;
-    bool unreachable = true;
-    for (int i = 0; i < rap->localPeers->length; i++) {
-        peer = ArrayList_OfLocalPeers_get(rap->localPeers, i);
-        if (peer->ap.label_be) { unreachable = false; }
-        if (Bits_memcmp(refPeer.ipv6, peer->ap.ipv6, 16)) {
-            peer = NULL;
-            continue;
-        }
+    struct ReachabilityAnnouncer_Peer* peer = peerFromLocalState(rap->localPeersByIp, ipv6);
+    bool wasReachable = false;
+    if (peer) {
         if (!Bits_memcmp(&refPeer, &peer->ap, Announce_Peer_SIZE)) {
             Log_debug(rap->log, "Update peer [%s] peer exists and needs no update", ipPrinted);
             return;
         }
+        wasReachable = (peer->ap.label_be != 0);
         peer->pi = pi;
         if (pi) {
             // It's an announce, copy the refPeer over the peer
@@ -481,9 +510,7 @@ void ReachabilityAnnouncer_updatePeer(struct ReachabilityAnnouncer* ra,
             // it's being withdrawn.
             peer->ap.label_be = 0;
         }
-        break;
-    }
-    if (!peer) {
+    } else {
         if (!pi) {
             Log_debug(rap->log, "[%s] didnt exist before and is now unreachable", ipPrinted);
             return;
@@ -506,7 +533,7 @@ void ReachabilityAnnouncer_updatePeer(struct ReachabilityAnnouncer* ra,
             return;
         }
         case updatePeer_ADD: {
-            if (unreachable) {
+            if (!wasReachable && !hasOtherReachablePeer(rap, peer)) {
                 Log_debug(rap->log, "first peer");
                 stateUpdate(rap, ReachabilityAnnouncer_State_FIRSTPEER);
             } else {
@@ -534,7 +561,8 @@ static void onReplyTimeout(struct ReachabilityAnnouncer_pvt* rap, struct Address
     rap->msgOnWire = NULL;
     struct Announce_Peer* p;
     for (p = Announce_Peer_next(mow, NULL); p; p = Announce_Peer_next(mow, p)) {
-        struct ReachabilityAnnouncer_Peer* lPeer = peerFromLocalState(rap->localPeers, p->ipv6);
+        struct ReachabilityAnnouncer_Peer* lPeer =
+            peerFromLocalState(rap->localPeersByIp, p->ipv6);
         if (!lPeer) { continue; }
         int ret = updatePeer(rap, &lPeer->ap, 0);
         if (updatePeer_ENOSPACE == ret) {
@@ -543,6 +571,11 @@ static void onReplyTimeout(struct ReachabilityAnnouncer_pvt* rap, struct Address
         }
     }
     Allocator_free(mow->alloc);
+    // The link state samples which were on the wire will be sent again
+    for (int i = 0; i < rap->localPeers->length; i++) {
+        struct ReachabilityAnnouncer_Peer* lPeer = ArrayList_OfLocalPeers_get(rap->localPeers, i);
+        lPeer->samplesOnWire = lPeer->samplesAnnounced;
+    }
     if (!Bits_memcmp(snodeAddr, &rap->snode, Address_SIZE)) {
         rap->snh->snodeIsReachable = false;
         if (rap->snh->onSnodeUnreachable) {
@@ -582,6 +615,10 @@ static void onReply(Dict* msg, struct Address* src, struct MsgCore_Promise* prom
     Log_debug(rap->log, "snode messages before [%d]", rap->snodeState->length);
     addServerStateMsg(rap, rap->msgOnWire);
     Log_debug(rap->log, "snode messages after [%d]", rap->snodeState->length);
+    for (int i = 0; i < rap->localPeers->length; i++) {
+        struct ReachabilityAnnouncer_Peer* lPeer = ArrayList_OfLocalPeers_get(rap->localPeers, i);
+        lPeer->samplesAnnounced = lPeer->samplesOnWire;
+    }
     rap->msgOnWire = NULL;
     rap->resetState = false;
     int64_t now = rap->timeOfLastReply = ourTime(rap);
@@ -647,27 +684,26 @@ static void onAnnounceCycle(void* vRap)
     struct Message* msg = rap->msgOnWire = rap->nextMsg;
     rap->msgOnWireSentTime = now;
 
+    uint64_t cycleBegin = Time_hrtime();
+
     // re-announce any peer which is older than AGREED_TIMEOUT_MS
+    // The peers which are updated do not depend on which snode message is being looked at and
+    // after one pass every one of them is already up to date in msg, so one pass is enough
+    // as long as the oldest snode message is not out of date.
     int64_t sinceTime = snNow - AGREED_TIMEOUT_MS;
-    for (int i = 0; i < rap->snodeState->length; i++) {
-        struct Message* snm = ArrayList_OfMessages_get(rap->snodeState, i);
-        int64_t msgTime = timestampFromMsg(snm);
-        if (msgTime < sinceTime) { break; }
+    if (rap->snodeState->length &&
+        timestampFromMsg(ArrayList_OfMessages_get(rap->snodeState, 0)) >= sinceTime)
+    {
         struct Announce_Peer* p;
-        int ret = updatePeer_NOOP;
         for (p = Announce_Peer_next(msg, NULL); p; p = Announce_Peer_next(msg, p)) {
             struct ReachabilityAnnouncer_Peer* lPeer =
-                peerFromLocalState(rap->localPeers, p->ipv6);
+                peerFromLocalState(rap->localPeersByIp, p->ipv6);
             if (!lPeer) { continue; }
-            ret = updatePeer(rap, &lPeer->ap, sinceTime);
-            if (updatePeer_ENOSPACE == ret) {
+            if (updatePeer_ENOSPACE == updatePeer(rap, &lPeer->ap, sinceTime)) {
                 stateUpdate(rap, ReachabilityAnnouncer_State_MSGFULL);
                 break;
             }
         }
-        if (updatePeer_ENOSPACE == ret) {
-            break;
-        }
     }
 
     setupNextMsg(rap);
@@ -707,6 +743,13 @@ static void onAnnounceCycle(void* vRap)
     Er_assert(Message_epop(msg, NULL, 64));
     Sign_signMsg(rap->signingKeypair, msg, rap->rand);
 
+    uint64_t cycleNs = Time_hrtime() - cycleBegin;
+    rap->pub.announcements++;
+    rap->pub.announceBytes += msg->length;
+    rap->pub.lastAnnounceBytes = msg->length;
+    rap->pub.announceNs += cycleNs;
+    if (cycleNs > rap->pub.maxAnnounceNs) { rap->pub.maxAnnounceNs = cycleNs; }
+
     struct MsgCore_Promise* qp = MsgCore_createQuery(rap->msgCore, 0, rap->alloc);
     Dict* dict = qp->msg = Dict_new(qp->alloc);
     qp->cb = onReply;
@@ -787,6 +830,7 @@ struct ReachabilityAnnouncer* ReachabilityAnnouncer_new(struct Allocator* alloca
     rap->rand = rand;
     rap->snodeState = ArrayList_OfMessages_new(alloc);
     rap->localPeers = ArrayList_OfLocalPeers_new(alloc);
+    rap->localPeersByIp = Set_OfLocalPeersByIp_new(alloc);
     rap->myScheme = myScheme;
     rap->encodingSchemeStr = EncodingScheme_serialize(myScheme, alloc);
 
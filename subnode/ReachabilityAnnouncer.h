@@ -29,7 +29,14 @@ Linker_require("subnode/ReachabilityAnnouncer.c");
 
 struct ReachabilityAnnouncer
 {
-    int unused;
+    /** Number of announcements which were sent to the supernode and their total size. */
+    uint64_t announcements;
+    uint64_t announceBytes;
+    uint32_t lastAnnounceBytes;
+
+    /** Nanoseconds spent building and signing announcements. */
+    uint64_t announceNs;
+    uint64_t maxAnnounceNs;
 };
 
 // (pi == NULL) -> peer is gone.
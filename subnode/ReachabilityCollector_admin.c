@@ -15,6 +15,7 @@
 #include "admin/Admin.h"
 #include "benc/List.h"
 #include "crypto/Key.h"
+#include "subnode/ReachabilityAnnouncer.h"
 #include "subnode/ReachabilityCollector.h"
 #include "subnode/ReachabilityCollector_admin.h"
 #include "util/AddrTools.h"
@@ -24,6 +25,7 @@ struct Context {
     struct Admin* admin;
     struct Allocator* alloc;
     struct ReachabilityCollector* rc;
+    struct ReachabilityAnnouncer* ra;
     Identity
 };
 
@@ -81,14 +83,30 @@ static void getPeerInfo(Dict* args, void* vcontext, String* txid, struct Allocat
     Admin_sendMessage(out, txid, ctx->admin);
 }
 
+static void announceStats(Dict* args, void* vcontext, String* txid, struct Allocator* requestAlloc)
+{
+    struct Context* ctx = Identity_check((struct Context*) vcontext);
+    struct ReachabilityAnnouncer* ra = ctx->ra;
+    Dict* out = Dict_new(requestAlloc);
+    Dict_putIntC(out, "announcements", ra->announcements, requestAlloc);
+    Dict_putIntC(out, "bytes", ra->announceBytes, requestAlloc);
+    Dict_putIntC(out, "lastBytes", ra->lastAnnounceBytes, requestAlloc);
+    Dict_putIntC(out, "ns", ra->announceNs, requestAlloc);
+    Dict_putIntC(out, "maxNs", ra->maxAnnounceNs, requestAlloc);
+    Dict_putStringCC(out, "error", "none", requestAlloc);
+    Admin_sendMessage(out, txid, ctx->admin);
+}
+
 void ReachabilityCollector_admin_register(struct ReachabilityCollector* rc,
+                                          struct ReachabilityAnnouncer* ra,
                                           struct Admin* admin,
                                           struct Allocator* alloc)
 {
     struct Context* ctx = Allocator_clone(alloc, (&(struct Context) {
         .admin = admin,
         .alloc = alloc,
-        .rc = rc
+        .rc = rc,
+        .ra = ra
     }));
     Identity_set(ctx);
 
@@ -96,4 +114,6 @@ void ReachabilityCollector_admin_register(struct ReachabilityCollector* rc,
         ((struct Admin_FunctionArg[]) {
             { .name = "page", .required = true, .type = "Int" }
         }), admin);
+    Admin_registerFunction("ReachabilityCollector_announceStats", announceStats, ctx, true,
+        NULL, admin);
 }
@@ -16,11 +16,13 @@
 #define ReachabilityCollector_admin_H
 
 #include "admin/Admin.h"
+#include "subnode/ReachabilityAnnouncer.h"
 #include "subnode/ReachabilityCollector.h"
 #include "util/Linker.h"
 Linker_require("subnode/ReachabilityCollector_admin.c");
 
 void ReachabilityCollector_admin_register(struct ReachabilityCollector* rc,
+                                          struct ReachabilityAnnouncer* ra,
                                           struct Admin* admin,
                                           struct Allocator* alloc);
 
@@ -0,0 +1,211 @@
+/* vim: set expandtab ts=4 sw=4: */
+/*
+ * You may redistribute this program and/or modify it under the terms of
+ * the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "subnode/RouteCache.h"
+#include "switch/LabelSplicer.h"
+#include "util/Assert.h"
+#include "util/Bits.h"
+#include "util/Hash.h"
+#include "util/Identity.h"
+
+struct Entry
+{
+    struct Address addr;
+    int64_t expires;
+
+    /** The time after which RouteCache_getExpiring() will return this route. */
+    int64_t refreshAt;
+
+    bool unreachable;
+    bool active;
+    bool inUse;
+
+    /** Least recently used list, newer is toward the head. */
+    struct Entry* newer;
+    struct Entry* older;
+};
+
+static inline uint32_t entryHashCode(const struct Entry* e)
+{
+    return Hash_compute((uint8_t*) e->addr.ip6.bytes, 16);
+}
+static inline int entryCompare(const struct Entry* a, const struct Entry* b)
+{
+    return Bits_memcmp(a->addr.ip6.bytes, b->addr.ip6.bytes, 16);
+}
+#define Set_COMPARE entryCompare
+#define Set_HASHCODE entryHashCode
+#define Set_NAME OfEntriesByIp
+#define Set_TYPE struct Entry
+#include "util/Set.h"
+
+struct RouteCache_pvt
+{
+    struct RouteCache pub;
+    struct Set_OfEntriesByIp* byIp;
+    struct Entry* newest;
+    struct Entry* oldest;
+    struct Entry* entries;
+    uint32_t capacity;
+
+    /** Entries which have never been used are entries[used] and above. */
+    uint32_t used;
+
+    /** Entries which were removed, linked by their older pointer. */
+    struct Entry* free;
+
+    Identity
+};
+
+static void unlinkEntry(struct RouteCache_pvt* rc, struct Entry* e)
+{
+    if (e->newer) { e->newer->older = e->older; } else { rc->newest = e->older; }
+    if (e->older) { e->older->newer = e->newer; } else { rc->oldest = e->newer; }
+    e->newer = e->older = NULL;
+}
+
+static void linkNewest(struct RouteCache_pvt* rc, struct Entry* e)
+{
+    e->older = rc->newest;
+    e->newer = NULL;
+    if (rc->newest) { rc->newest->newer = e; } else { rc->oldest = e; }
+    rc->newest = e;
+}
+
+static void removeEntry(struct RouteCache_pvt* rc, struct Entry* e)
+{
+    Assert_true(e == Set_OfEntriesByIp_remove(rc->byIp, e));
+    unlinkEntry(rc, e);
+    e->inUse = false;
+    e->older = rc->free;
+    rc->free = e;
+}
+
+static struct Entry* getEntry(struct RouteCache_pvt* rc, uint8_t ip6[16])
+{
+    struct Entry key;
+    Bits_memcpy(key.addr.ip6.bytes, ip6, 16);
+    return Set_OfEntriesByIp_get(rc->byIp, &key);
+}
+
+/** Get the entry for an ip, creating it and evicting the least recently used if necessary. */
+static struct Entry* entryFor(struct RouteCache_pvt* rc, uint8_t ip6[16])
+{
+    struct Entry* e = getEntry(rc, ip6);
+    if (e) {
+        unlinkEntry(rc, e);
+        linkNewest(rc, e);
+        return e;
+    }
+    if (!rc->free && rc->used < rc->capacity) {
+        e = &rc->entries[rc->used++];
+    } else {
+        if (!rc->free) { removeEntry(rc, rc->oldest); }
+        e = rc->free;
+        rc->free = e->older;
+    }
+    Bits_memset(e, 0, sizeof(struct Entry));
+    Bits_memcpy(e->addr.ip6.bytes, ip6, 16);
+    e->inUse = true;
+    Set_OfEntriesByIp_add(rc->byIp, e);
+    linkNewest(rc, e);
+    return e;
+}
+
+enum RouteCache_Status RouteCache_get(struct RouteCache* rcPub,
+                                      uint8_t ip6[16],
+                                      int64_t now,
+                                      struct Address* out)
+{
+    struct RouteCache_pvt* rc = Identity_check((struct RouteCache_pvt*) rcPub);
+    struct Entry* e = getEntry(rc, ip6);
+    if (e && e->expires <= now) {
+        removeEntry(rc, e);
+        e = NULL;
+    }
+    if (!e) {
+        rc->pub.misses++;
+        return RouteCache_Status_MISS;
+    }
+    unlinkEntry(rc, e);
+    linkNewest(rc, e);
+    if (e->unreachable) {
+        rc->pub.unreachableHits++;
+        return RouteCache_Status_UNREACHABLE;
+    }
+    rc->pub.hits++;
+    Bits_memcpy(out, &e->addr, sizeof(struct Address));
+    return RouteCache_Status_FOUND;
+}
+
+void RouteCache_put(struct RouteCache* rcPub, struct Address* addr, int64_t now)
+{
+    struct RouteCache_pvt* rc = Identity_check((struct RouteCache_pvt*) rcPub);
+    struct Entry* e = entryFor(rc, addr->ip6.bytes);
+    Bits_memcpy(&e->addr, addr, sizeof(struct Address));
+    e->unreachable = false;
+    e->expires = now + RouteCache_TTL_MS;
+    e->refreshAt = e->expires - RouteCache_REFRESH_MS;
+}
+
+void RouteCache_putUnreachable(struct RouteCache* rcPub, uint8_t ip6[16], int64_t now)
+{
+    struct RouteCache_pvt* rc = Identity_check((struct RouteCache_pvt*) rcPub);
+    struct Entry* e = entryFor(rc, ip6);
+    e->unreachable = true;
+    e->addr.path = 0;
+    e->expires = now + RouteCache_UNREACHABLE_TTL_MS;
+}
+
+void RouteCache_setActive(struct RouteCache* rcPub, uint8_t ip6[16], bool active)
+{
+    struct RouteCache_pvt* rc = Identity_check((struct RouteCache_pvt*) rcPub);
+    struct Entry* e = getEntry(rc, ip6);
+    if (e) { e->active = active; }
+}
+
+void RouteCache_removeThrough(struct RouteCache* rcPub, uint64_t path)
+{
+    struct RouteCache_pvt* rc = Identity_check((struct RouteCache_pvt*) rcPub);
+    for (uint32_t i = 0; i < rc->used; i++) {
+        struct Entry* e = &rc->entries[i];
+        if (!e->inUse || e->unreachable) { continue; }
+        if (LabelSplicer_routesThrough(e->addr.path, path)) { removeEntry(rc, e); }
+    }
+}
+
+int RouteCache_getExpiring(struct RouteCache* rcPub, int64_t now, uint8_t out[][16], int max)
+{
+    struct RouteCache_pvt* rc = Identity_check((struct RouteCache_pvt*) rcPub);
+    int count = 0;
+    for (uint32_t i = 0; i < rc->used && count < max; i++) {
+        struct Entry* e = &rc->entries[i];
+        if (!e->inUse || e->unreachable || !e->active) { continue; }
+        if (e->refreshAt > now || e->expires <= now) { continue; }
+        e->refreshAt = now + RouteCache_REFRESH_MS / 4;
+        Bits_memcpy(out[count++], e->addr.ip6.bytes, 16);
+    }
+    return count;
+}
+
+struct RouteCache* RouteCache_new(struct Allocator* alloc, uint32_t capacity)
+{
+    Assert_true(capacity);
+    struct RouteCache_pvt* rc = Allocator_calloc(alloc, sizeof(struct RouteCache_pvt), 1);
+    rc->byIp = Set_OfEntriesByIp_new(alloc);
+    rc->entries = Allocator_calloc(alloc, sizeof(struct Entry), capacity);
+    rc->capacity = capacity;
+    Identity_set(rc);
+    return &rc->pub;
+}
@@ -0,0 +1,87 @@
+/* vim: set expandtab ts=4 sw=4: */
+/*
+ * You may redistribute this program and/or modify it under the terms of
+ * the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef RouteCache_H
+#define RouteCache_H
+
+#include "dht/Address.h"
+#include "memory/Allocator.h"
+#include "util/Linker.h"
+Linker_require("subnode/RouteCache.c");
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Routes which the supernode gave us, by destination ip, so that a destination which was
+ * looked up recently can have a session set up without asking the supernode again.
+ * Destinations which the supernode could not find a route to are remembered for a shorter
+ * time so that the search is not repeated immediately. When the cache is full the least
+ * recently used entry is dropped.
+ * All times are in milliseconds and passed in by the caller.
+ */
+#define RouteCache_TTL_MS (1000 * 60 * 10)
+#define RouteCache_UNREACHABLE_TTL_MS (1000 * 30)
+
+/** Routes which are in use by a session are refreshed when they are this close to expiring. */
+#define RouteCache_REFRESH_MS (1000 * 60)
+
+struct RouteCache
+{
+    uint64_t hits;
+    uint64_t unreachableHits;
+    uint64_t misses;
+};
+
+enum RouteCache_Status
+{
+    RouteCache_Status_MISS,
+    RouteCache_Status_FOUND,
+    RouteCache_Status_UNREACHABLE
+};
+
+/**
+ * Look up a destination.
+ *
+ * @param out the route is copied here if the status is FOUND.
+ */
+enum RouteCache_Status RouteCache_get(struct RouteCache* rc,
+                                      uint8_t ip6[16],
+                                      int64_t now,
+                                      struct Address* out);
+
+void RouteCache_put(struct RouteCache* rc, struct Address* addr, int64_t now);
+
+void RouteCache_putUnreachable(struct RouteCache* rc, uint8_t ip6[16], int64_t now);
+
+/** Mark a route as used by a session, only routes which are active are refreshed. */
+void RouteCache_setActive(struct RouteCache* rc, uint8_t ip6[16], bool active);
+
+/** Forget every route which goes through path, eg: because a link on the way is broken. */
+void RouteCache_removeThrough(struct RouteCache* rc, uint64_t path);
+
+/**
+ * Get the destinations of active routes which are about to expire. Each one is not returned
+ * again for a while so that a lost refresh does not cause a flood of queries.
+ *
+ * @param out the ips are written here.
+ * @param max the number of ips which fit in out.
+ * @return the number of ips written.
+ */
+int RouteCache_getExpiring(struct RouteCache* rc, int64_t now, uint8_t out[][16], int max);
+
+/** @param capacity the maximum number of destinations to remember. */
+struct RouteCache* RouteCache_new(struct Allocator* alloc, uint32_t capacity);
+
+#endif
@@ -0,0 +1,239 @@
+/* vim: set expandtab ts=4 sw=4: */
+/*
+ * You may redistribute this program and/or modify it under the terms of
+ * the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "subnode/RouteRequester.h"
+#include "benc/Dict.h"
+#include "benc/List.h"
+#include "benc/String.h"
+#include "crypto/AddressCalc.h"
+#include "dht/dhtcore/ReplySerializer.h"
+#include "util/AddrTools.h"
+#include "util/Bits.h"
+#include "util/Identity.h"
+#include "util/events/Time.h"
+#include "util/events/Timeout.h"
+
+struct Query {
+    uint8_t snodeIp[16];
+    uint8_t target[16];
+};
+#define Map_NAME OfRequestTimeByQuery
+#define Map_KEY_TYPE struct Query
+#define Map_VALUE_TYPE uint64_t
+#include "util/Map.h"
+
+/** The destinations which were sent in one query. */
+struct Batch
+{
+    struct RouteRequester_pvt* rr;
+    uint8_t snodeIp[16];
+
+    /** Sent to find out whether the supernode accepts bulk queries. */
+    bool probe;
+
+    int count;
+    uint8_t targets[RouteRequester_MAX_BATCH][16];
+
+    Identity
+};
+
+struct RouteRequester_pvt
+{
+    struct RouteRequester pub;
+
+    struct MsgCore* msgCore;
+    struct Log* log;
+    struct EventBase* base;
+    struct Allocator* alloc;
+    uint8_t myIp[16];
+
+    /** Every destination which was requested and has no reply yet. */
+    struct Map_OfRequestTimeByQuery outstanding;
+
+    /** The supernode which snodeKnown and bulkMax are about. */
+    struct Address snode;
+
+    /** True once the supernode has replied so that bulkMax is known. */
+    bool snodeKnown;
+    bool probing;
+    uint32_t bulkMax;
+
+    /** Destinations which are waiting to be sent. */
+    int pendingCount;
+    uint8_t pending[RouteRequester_MAX_PENDING][16];
+    struct Timeout* flushTimeout;
+
+    Identity
+};
+
+static void flush(struct RouteRequester_pvt* rr);
+
+static void onReply(Dict* msg, struct Address* src, struct MsgCore_Promise* prom)
+{
+    struct Batch* b = Identity_check((struct Batch*) prom->userData);
+    struct RouteRequester_pvt* rr = Identity_check(b->rr);
+
+    bool currentSnode = !Bits_memcmp(b->snodeIp, rr->snode.ip6.bytes, 16);
+    if (src && currentSnode) {
+        int64_t* grb = Dict_getIntC(msg, "grb");
+        rr->bulkMax = 0;
+        if (grb && *grb > 1) {
+            rr->bulkMax = (*grb < RouteRequester_MAX_BATCH) ? *grb : RouteRequester_MAX_BATCH;
+        }
+        rr->snodeKnown = true;
+    }
+
+    List* rs = NULL;
+    if (src && b->count > 1) {
+        rs = Dict_getListC(msg, "rs");
+        if (!rs || List_size(rs) != b->count) {
+            Log_debug(rr->log, "getRoute reply with [%d] targets missing [rs]", b->count);
+            src = NULL;
+        }
+    }
+
+    uint64_t now = Time_currentTimeMilliseconds(rr->base);
+    for (int i = 0; i < b->count; i++) {
+        struct Query q;
+        Bits_memcpy(q.snodeIp, b->snodeIp, 16);
+        Bits_memcpy(q.target, b->targets[i], 16);
+        int index = Map_OfRequestTimeByQuery_indexForKey(&q, &rr->outstanding);
+        Assert_true(index > -1);
+        if (src) {
+            uint8_t printedAddr[40];
+            AddrTools_printIp(printedAddr, b->targets[i]);
+            Log_debug(rr->log, "getRoute [%s] replied in [%d]ms", printedAddr,
+                (int) (now - rr->outstanding.values[index]));
+        }
+        Map_OfRequestTimeByQuery_remove(index, &rr->outstanding);
+
+        // BencMessageReader puts the last element of a list first.
+        Dict* reply = (!src) ? NULL : (rs) ? List_getDict(rs, b->count - 1 - i) : msg;
+        struct Address_List* al =
+            (reply) ? ReplySerializer_parse(src, reply, rr->log, false, prom->alloc) : NULL;
+        rr->pub.onReply(&rr->pub, b->targets[i], al, src, prom->alloc);
+    }
+
+    if (b->probe && currentSnode) {
+        // If the supernode did not reply then the others go one at a time, as they used to.
+        rr->probing = false;
+        flush(rr);
+    }
+}
+
+static void sendQuery(struct RouteRequester_pvt* rr, uint8_t* targets, int count, bool probe)
+{
+    struct MsgCore_Promise* qp = MsgCore_createQuery(rr->msgCore, 0, rr->alloc);
+    struct Batch* b = Allocator_calloc(qp->alloc, sizeof(struct Batch), 1);
+    Identity_set(b);
+    b->rr = rr;
+    b->probe = probe;
+    b->count = count;
+    Bits_memcpy(b->snodeIp, rr->snode.ip6.bytes, 16);
+    Bits_memcpy(b->targets, targets, count * 16);
+
+    Dict* dict = qp->msg = Dict_new(qp->alloc);
+    qp->cb = onReply;
+    qp->userData = b;
+    Assert_true(AddressCalc_validAddress(rr->snode.ip6.bytes));
+    qp->target = Address_clone(&rr->snode, qp->alloc);
+
+    Log_debug(rr->log, "Sending getRoute for [%d] targets to snode %s",
+        count, Address_toString(qp->target, qp->alloc)->bytes);
+    Dict_putStringCC(dict, "sq", "gr", qp->alloc);
+    String* src = String_newBinary(rr->myIp, 16, qp->alloc);
+    Dict_putStringC(dict, "src", src, qp->alloc);
+    String* tar = String_newBinary(targets, count * 16, qp->alloc);
+    Dict_putStringC(dict, (count > 1) ? "tars" : "tar", tar, qp->alloc);
+
+    rr->pub.queries++;
+}
+
+static void flush(struct RouteRequester_pvt* rr)
+{
+    Timeout_clearTimeout(rr->flushTimeout);
+    int batch = (rr->snodeKnown && rr->bulkMax > 1) ? rr->bulkMax : 1;
+    for (int i = 0; i < rr->pendingCount; i += batch) {
+        int count = (rr->pendingCount - i < batch) ? rr->pendingCount - i : batch;
+        sendQuery(rr, rr->pending[i], count, false);
+    }
+    rr->pendingCount = 0;
+}
+
+static void flushCallback(void* vrr)
+{
+    flush(Identity_check((struct RouteRequester_pvt*) vrr));
+}
+
+int RouteRequester_request(struct RouteRequester* rrPub, struct Address* snode, uint8_t target[16])
+{
+    struct RouteRequester_pvt* rr = Identity_check((struct RouteRequester_pvt*) rrPub);
+
+    struct Query q;
+    Bits_memcpy(q.snodeIp, snode->ip6.bytes, 16);
+    Bits_memcpy(q.target, target, 16);
+    if (Map_OfRequestTimeByQuery_indexForKey(&q, &rr->outstanding) > -1) {
+        return RouteRequester_request_OUTSTANDING;
+    }
+    uint64_t now = Time_currentTimeMilliseconds(rr->base);
+    Map_OfRequestTimeByQuery_put(&q, &now, &rr->outstanding);
+    rr->pub.targets++;
+
+    if (Bits_memcmp(snode->ip6.bytes, rr->snode.ip6.bytes, 16)) {
+        // Whatever is waiting goes to the old supernode, it has been asked for already.
+        flush(rr);
+        rr->snodeKnown = false;
+        rr->probing = false;
+        rr->bulkMax = 0;
+    }
+    Bits_memcpy(&rr->snode, snode, sizeof(struct Address));
+
+    bool probe = !rr->snodeKnown && !rr->probing;
+    bool bulk = rr->snodeKnown && rr->bulkMax > 1;
+    if (probe || (rr->snodeKnown && !bulk) || rr->pendingCount >= RouteRequester_MAX_PENDING) {
+        rr->probing |= probe;
+        sendQuery(rr, target, 1, probe);
+        return 0;
+    }
+
+    Bits_memcpy(rr->pending[rr->pendingCount++], target, 16);
+    if (rr->probing) {
+        // Sent when the probe comes back.
+    } else if (rr->pendingCount >= (int) rr->bulkMax) {
+        flush(rr);
+    } else if (!Timeout_isActive(rr->flushTimeout)) {
+        Timeout_resetTimeout(rr->flushTimeout, RouteRequester_BATCH_DELAY_MS);
+    }
+    return 0;
+}
+
+struct RouteRequester* RouteRequester_new(struct MsgCore* msgCore,
+                                          struct Log* log,
+                                          struct EventBase* base,
+                                          uint8_t myIp[16],
+                                          struct Allocator* allocator)
+{
+    struct Allocator* alloc = Allocator_child(allocator);
+    struct RouteRequester_pvt* rr = Allocator_calloc(alloc, sizeof(struct RouteRequester_pvt), 1);
+    Identity_set(rr);
+    rr->msgCore = msgCore;
+    rr->log = log;
+    rr->base = base;
+    rr->alloc = alloc;
+    Bits_memcpy(rr->myIp, myIp, 16);
+    rr->outstanding.allocator = alloc;
+    rr->flushTimeout = Timeout_setTimeout(flushCallback, rr, 0, base, alloc);
+    Timeout_clearTimeout(rr->flushTimeout);
+    return &rr->pub;
+}
@@ -0,0 +1,92 @@
+/* vim: set expandtab ts=4 sw=4: */
+/*
+ * You may redistribute this program and/or modify it under the terms of
+ * the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef RouteRequester_H
+#define RouteRequester_H
+
+#include "dht/Address.h"
+#include "memory/Allocator.h"
+#include "subnode/MsgCore.h"
+#include "util/events/EventBase.h"
+#include "util/log/Log.h"
+#include "util/Linker.h"
+Linker_require("subnode/RouteRequester.c");
+
+#include <stdint.h>
+
+/**
+ * Asks the supernode for routes to destinations.
+ *
+ * A getRoute query is { "sq": "gr", "src": <our ip>, "tar": <destination ip> } and the reply
+ * has the route in "n" and "np". A supernode which can answer for more than one destination
+ * at a time puts the number it accepts in "grb" in its replies. After that, destinations which
+ * are requested close together are sent in one query with their ips concatenated in "tars".
+ * The reply has a list "rs" with one dict of "n" and "np" for each destination, in order.
+ *
+ * Until the supernode has answered once it is not known whether it can take many destinations
+ * so the first one is sent alone and the others wait for the reply.
+ */
+struct RouteRequester;
+
+/**
+ * Called once for each destination which was requested.
+ *
+ * @param target the ip of the destination.
+ * @param routes the routes which the supernode gave, NULL if it had nothing or did not reply.
+ * @param snode the supernode, NULL if it did not reply in time.
+ */
+typedef void (* RouteRequester_Callback)(struct RouteRequester* rr,
+                                         uint8_t target[16],
+                                         struct Address_List* routes,
+                                         struct Address* snode,
+                                         struct Allocator* tmpAlloc);
+
+/** Most destinations which are put in one query, whatever the supernode accepts. */
+#define RouteRequester_MAX_BATCH 64
+
+/** Destinations which can wait for the supernode to say whether it accepts bulk queries. */
+#define RouteRequester_MAX_PENDING 512
+
+/** How long to wait for more destinations before sending a query which is not full. */
+#define RouteRequester_BATCH_DELAY_MS 5
+
+struct RouteRequester
+{
+    RouteRequester_Callback onReply;
+    void* userData;
+
+    /** Number of query messages sent. */
+    uint64_t queries;
+
+    /** Number of destinations which were asked for. */
+    uint64_t targets;
+};
+
+#define RouteRequester_request_OUTSTANDING -1
+
+/**
+ * Ask the supernode for a route to a destination.
+ *
+ * @return 0 or RouteRequester_request_OUTSTANDING if the destination was already requested
+ *         and there is no reply yet.
+ */
+int RouteRequester_request(struct RouteRequester* rr, struct Address* snode, uint8_t target[16]);
+
+struct RouteRequester* RouteRequester_new(struct MsgCore* msgCore,
+                                          struct Log* log,
+                                          struct EventBase* base,
+                                          uint8_t myIp[16],
+                                          struct Allocator* alloc);
+
+#endif
@@ -20,12 +20,15 @@
 #include "subnode/PingResponder.h"
 #include "subnode/BoilerplateResponder.h"
 #include "subnode/ReachabilityCollector.h"
+#include "subnode/RouteCache.h"
+#include "subnode/RouteRequester.h"
 #include "crypto/AddressCalc.h"
 #include "dht/Address.h"
 #include "wire/DataHeader.h"
 #include "wire/RouteHeader.h"
 #include "dht/dhtcore/ReplySerializer.h"
 #include "util/AddrTools.h"
+#include "util/events/Time.h"
 #include "util/events/Timeout.h"
 #include "net/SwitchPinger.h"
 #include "switch/LabelSplicer.h"
@@ -48,6 +51,12 @@ struct Query {
 #define Map_ENABLE_HANDLES
 #include "util/Map.h"
 
+#define ROUTE_CACHE_SIZE 1024
+
+// How often to look for routes in use by sessions which need to be refreshed.
+#define ROUTE_REFRESH_INTERVAL_MS 10000
+#define ROUTE_REFRESH_MAX 16
+
 struct SubnodePathfinder_pvt
 {
     struct SubnodePathfinder pub;
@@ -73,10 +82,13 @@ struct SubnodePathfinder_pvt
 
     struct BoilerplateResponder* br;
 
-    struct ReachabilityAnnouncer* ra;
 
     struct Map_OfPromiseByQuery queryMap;
 
+    struct RouteRequester* routeRequester;
+
+    struct RouteCache* routeCache;
+
     struct SwitchPinger* sp;
     struct Iface switchPingerIf;
 
@@ -155,6 +167,8 @@ static Iface_DEFUN switchErr(struct Message* msg, struct SubnodePathfinder_pvt*
         }
     }
 
+    RouteCache_removeThrough(pf->routeCache, path);
+
     // TODO(cjd): We should be reporting a bad link to the session manager but
     // we only really have the ability to report a node with known IPv6 address
     // so we will need to add a new event type to PFChan.
@@ -162,40 +176,49 @@ static Iface_DEFUN switchErr(struct Message* msg, struct SubnodePathfinder_pvt*
     return NULL;
 }
 
-struct SnodeQuery {
-    struct SubnodePathfinder_pvt* pf;
-    uint32_t mapHandle;
-    Identity
-};
-
-static void getRouteReply(Dict* msg, struct Address* src, struct MsgCore_Promise* prom)
+static int64_t now(struct SubnodePathfinder_pvt* pf)
 {
-    struct SnodeQuery* snq = Identity_check((struct SnodeQuery*) prom->userData);
-    struct SubnodePathfinder_pvt* pf = Identity_check(snq->pf);
-    int index = Map_OfPromiseByQuery_indexForHandle(snq->mapHandle, &pf->queryMap);
-    Assert_true(index > -1);
-    Map_OfPromiseByQuery_remove(index, &pf->queryMap);
+    return (int64_t) Time_currentTimeMilliseconds(pf->base);
+}
 
+static void getRouteReply(struct RouteRequester* rr,
+                          uint8_t target[16],
+                          struct Address_List* al,
+                          struct Address* src,
+                          struct Allocator* tmpAlloc)
+{
+    struct SubnodePathfinder_pvt* pf = Identity_check((struct SubnodePathfinder_pvt*) rr->userData);
     if (!src) {
         Log_debug(pf->log, "GetRoute timeout");
         return;
     }
     Log_debug(pf->log, "Search reply!");
-    struct Address_List* al = ReplySerializer_parse(src, msg, pf->log, false, prom->alloc);
-    if (!al || al->length == 0) { return; }
-    Log_debug(pf->log, "reply with[%s]", Address_toString(&al->elems[0], prom->alloc)->bytes);
+    if (!al || al->length == 0) {
+        RouteCache_putUnreachable(pf->routeCache, target, now(pf));
+        return;
+    }
+    Log_debug(pf->log, "reply with[%s]", Address_toString(&al->elems[0], tmpAlloc)->bytes);
 
     if (al->elems[0].protocolVersion < 20) {
         Log_debug(pf->log, "not sending [%s] because version is old",
-            Address_toString(&al->elems[0], prom->alloc)->bytes);
+            Address_toString(&al->elems[0], tmpAlloc)->bytes);
+        RouteCache_putUnreachable(pf->routeCache, target, now(pf));
         return;
     }
+    RouteCache_put(pf->routeCache, &al->elems[0], now(pf));
 
     //NodeCache_discoverNode(pf->nc, &al->elems[0]);
-    struct Message* msgToCore = Message_new(0, 512, prom->alloc);
+    struct Message* msgToCore = Message_new(0, 512, tmpAlloc);
     Iface_CALL(sendNode, msgToCore, &al->elems[0], Metric_SNODE_SAYS, PFChan_Pathfinder_NODE, pf);
 }
 
+static void getRoute(struct SubnodePathfinder_pvt* pf, uint8_t addr[16])
+{
+    if (RouteRequester_request(pf->routeRequester, &pf->pub.snh->snodeAddr, addr)) {
+        Log_debug(pf->log, "Skipping snode query because one is outstanding");
+    }
+}
+
 static Iface_DEFUN searchReq(struct Message* msg, struct SubnodePathfinder_pvt* pf)
 {
     uint8_t addr[16];
@@ -226,48 +249,40 @@ static Iface_DEFUN searchReq(struct Message* msg, struct SubnodePathfinder_pvt*
         return sendNode(msg, &pf->pub.snh->snodeAddr, Metric_SNODE, PFChan_Pathfinder_NODE, pf);
     }
 
-    struct Query q = { .routeFrom = { 0 } };
-    Bits_memcpy(&q.target, &pf->pub.snh->snodeAddr, sizeof(struct Address));
-    Bits_memcpy(q.routeFrom, pf->myAddress->ip6.bytes, 16);
-    Bits_memcpy(q.routeFrom, addr, 16);
-    if (Map_OfPromiseByQuery_indexForKey(&q, &pf->queryMap) > -1) {
-        Log_debug(pf->log, "Skipping snode query because one is outstanding");
-        return NULL;
+    struct Address cached;
+    switch (RouteCache_get(pf->routeCache, addr, now(pf), &cached)) {
+        case RouteCache_Status_FOUND: {
+            Log_debug(pf->log, "Route to [%s] is cached", printedAddr);
+            return sendNode(msg, &cached, Metric_SNODE_SAYS, PFChan_Pathfinder_NODE, pf);
+        }
+        case RouteCache_Status_UNREACHABLE: {
+            Log_debug(pf->log, "Skip search for [%s] because snode had no route", printedAddr);
+            return NULL;
+        }
+        default: break;
     }
 
-    struct MsgCore_Promise* qp = MsgCore_createQuery(pf->msgCore, 0, pf->alloc);
-
-    struct SnodeQuery* snq = Allocator_calloc(qp->alloc, sizeof(struct SnodeQuery), 1);
-    Identity_set(snq);
-    snq->pf = pf;
-
-    Dict* dict = qp->msg = Dict_new(qp->alloc);
-    qp->cb = getRouteReply;
-    qp->userData = snq;
-
-    Assert_true(AddressCalc_validAddress(pf->pub.snh->snodeAddr.ip6.bytes));
-    qp->target = &pf->pub.snh->snodeAddr;
-
-    Log_debug(pf->log, "Sending getRoute to snode %s",
-        Address_toString(qp->target, qp->alloc)->bytes);
-    Dict_putStringCC(dict, "sq", "gr", qp->alloc);
-    String* src = String_newBinary(pf->myAddress->ip6.bytes, 16, qp->alloc);
-    Dict_putStringC(dict, "src", src, qp->alloc);
-    String* target = String_newBinary(addr, 16, qp->alloc);
-    Dict_putStringC(dict, "tar", target, qp->alloc);
-
-    int index = Map_OfPromiseByQuery_put(&q, &qp, &pf->queryMap);
-    snq->mapHandle = pf->queryMap.handles[index];
-
+    getRoute(pf, addr);
     return NULL;
 }
 
+// Ask for routes in use by sessions again before they expire from the cache so that the
+// cache is never the reason for a session to wait for the snode.
+static void refreshRoutes(void* vpf)
+{
+    struct SubnodePathfinder_pvt* pf = Identity_check((struct SubnodePathfinder_pvt*) vpf);
+    if (!pf->pub.snh->snodeAddr.path) { return; }
+    uint8_t ips[ROUTE_REFRESH_MAX][16];
+    int count = RouteCache_getExpiring(pf->routeCache, now(pf), ips, ROUTE_REFRESH_MAX);
+    for (int i = 0; i < count; i++) { getRoute(pf, ips[i]); }
+}
+
 static void rcChange(struct ReachabilityCollector* rc,
                      uint8_t nodeIpv6[16],
                      struct ReachabilityCollector_PeerInfo* pi)
 {
     struct SubnodePathfinder_pvt* pf = Identity_check((struct SubnodePathfinder_pvt*) rc->userData);
-    ReachabilityAnnouncer_updatePeer(pf->ra, nodeIpv6, pi);
+    ReachabilityAnnouncer_updatePeer(pf->pub.ra, nodeIpv6, pi);
 }
 
 static Iface_DEFUN peer(struct Message* msg, struct SubnodePathfinder_pvt* pf)
@@ -312,6 +327,7 @@ static Iface_DEFUN peerGone(struct Message* msg, struct SubnodePathfinder_pvt* p
             Log_debug(pf->log, "Peer gone [%s]", str->bytes);
         }
     }
+    RouteCache_removeThrough(pf->routeCache, addr.path);
 
     //NodeCache_forgetNode(pf->nc, &addr);
 
@@ -330,6 +346,7 @@ static Iface_DEFUN session(struct Message* msg, struct SubnodePathfinder_pvt* pf
     addressForNode(&addr, msg);
     String* str = Address_toString(&addr, msg->alloc);
     Log_debug(pf->log, "Session [%s]", str->bytes);
+    RouteCache_setActive(pf->routeCache, addr.ip6.bytes, true);
     //if (addr.protocolVersion) { NodeCache_discoverNode(pf->nc, &addr); }
     return NULL;
 }
@@ -340,6 +357,7 @@ static Iface_DEFUN sessionEnded(struct Message* msg, struct SubnodePathfinder_pv
     addressForNode(&addr, msg);
     String* str = Address_toString(&addr, msg->alloc);
     Log_debug(pf->log, "Session ended [%s]", str->bytes);
+    RouteCache_setActive(pf->routeCache, addr.ip6.bytes, false);
     //NodeCache_forgetNode(pf->nc, &addr);
     return NULL;
 }
@@ -545,9 +563,15 @@ void SubnodePathfinder_start(struct SubnodePathfinder* sp)
     struct SupernodeHunter* snh = pf->pub.snh = SupernodeHunter_new(
         pf->alloc, pf->log, pf->base, pf->sp, pf->myPeers, msgCore, pf->myAddress, rc);
 
-    pf->ra = ReachabilityAnnouncer_new(
+    pf->pub.ra = ReachabilityAnnouncer_new(
         pf->alloc, pf->log, pf->base, pf->rand, msgCore, snh, pf->privateKey, pf->myScheme);
 
+    pf->routeRequester =
+        RouteRequester_new(msgCore, pf->log, pf->base, pf->myAddress->ip6.bytes, pf->alloc);
+    pf->routeRequester->userData = pf;
+    pf->routeRequester->onReply = getRouteReply;
+    Timeout_setInterval(refreshRoutes, pf, ROUTE_REFRESH_INTERVAL_MS, pf->base, pf->alloc);
+
     struct PFChan_Pathfinder_Connect conn = {
         .superiority_be = Endian_hostToBigEndian32(1),
         .version_be = Endian_hostToBigEndian32(Version_CURRENT_PROTOCOL)
@@ -587,6 +611,7 @@ struct SubnodePathfinder* SubnodePathfinder_new(struct Allocator* allocator,
     pf->msgCoreIf.send = incomingFromMsgCore;
     pf->privateKey = privateKey;
     pf->queryMap.allocator = Allocator_child(alloc);
+    pf->routeCache = RouteCache_new(alloc, ROUTE_CACHE_SIZE);
 
     pf->myScheme = myScheme;
     pf->br = BoilerplateResponder_new(myScheme, alloc);
@@ -21,6 +21,7 @@
 #include "util/log/Log.h"
 #include "util/events/EventBase.h"
 #include "crypto/random/Random.h"
+#include "subnode/ReachabilityAnnouncer.h"
 #include "subnode/SupernodeHunter.h"
 #include "switch/EncodingScheme.h"
 #include "util/Linker.h"
@@ -31,6 +32,7 @@ struct SubnodePathfinder
     struct Iface eventIf;
     struct SupernodeHunter* snh;
     struct ReachabilityCollector* rc;
+    struct ReachabilityAnnouncer* ra;
 };
 
 void SubnodePathfinder_start(struct SubnodePathfinder*);
@@ -0,0 +1,81 @@
+/* vim: set expandtab ts=4 sw=4: */
+/*
+ * You may redistribute this program and/or modify it under the terms of
+ * the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "memory/MallocAllocator.h"
+#include "subnode/RouteCache.h"
+#include "util/Assert.h"
+#include "util/Bits.h"
+
+static struct Address mkAddr(uint8_t n, uint64_t path)
+{
+    struct Address addr = { .path = path, .protocolVersion = 20 };
+    addr.ip6.bytes[0] = 0xfc;
+    addr.ip6.bytes[15] = n;
+    return addr;
+}
+
+int main()
+{
+    struct Allocator* alloc = MallocAllocator_new(1<<20);
+    struct RouteCache* rc = RouteCache_new(alloc, 4);
+    struct Address out;
+
+    // Hit until the route expires.
+    struct Address a = mkAddr(1, 0x13);
+    Assert_true(RouteCache_get(rc, a.ip6.bytes, 0, &out) == RouteCache_Status_MISS);
+    RouteCache_put(rc, &a, 0);
+    Assert_true(RouteCache_get(rc, a.ip6.bytes, 1, &out) == RouteCache_Status_FOUND);
+    Assert_true(out.path == 0x13);
+    Assert_true(
+        RouteCache_get(rc, a.ip6.bytes, RouteCache_TTL_MS, &out) == RouteCache_Status_MISS);
+
+    // Negative entries expire sooner.
+    struct Address b = mkAddr(2, 0);
+    RouteCache_putUnreachable(rc, b.ip6.bytes, 0);
+    Assert_true(RouteCache_get(rc, b.ip6.bytes, 1, &out) == RouteCache_Status_UNREACHABLE);
+    Assert_true(RouteCache_get(rc, b.ip6.bytes, RouteCache_UNREACHABLE_TTL_MS, &out) ==
+        RouteCache_Status_MISS);
+    Assert_true(rc->hits == 1 && rc->unreachableHits == 1 && rc->misses == 3);
+
+    // Least recently used is evicted, a lookup counts as use.
+    for (int i = 1; i <= 4; i++) {
+        struct Address x = mkAddr(i, 0x13 + i);
+        RouteCache_put(rc, &x, 0);
+    }
+    Assert_true(RouteCache_get(rc, a.ip6.bytes, 1, &out) == RouteCache_Status_FOUND);
+    struct Address e = mkAddr(5, 0x15);
+    RouteCache_put(rc, &e, 0);
+    b = mkAddr(2, 0);
+    Assert_true(RouteCache_get(rc, b.ip6.bytes, 1, &out) == RouteCache_Status_MISS);
+    Assert_true(RouteCache_get(rc, a.ip6.bytes, 1, &out) == RouteCache_Status_FOUND);
+
+    // 0x15 goes through 0x15 but 0x14 does not.
+    RouteCache_removeThrough(rc, 0x15);
+    Assert_true(RouteCache_get(rc, e.ip6.bytes, 1, &out) == RouteCache_Status_MISS);
+    Assert_true(RouteCache_get(rc, a.ip6.bytes, 1, &out) == RouteCache_Status_FOUND);
+
+    // Only active routes are refreshed and only once per REFRESH_MS / 4.
+    uint8_t ips[4][16];
+    int64_t refresh = RouteCache_TTL_MS - RouteCache_REFRESH_MS;
+    Assert_true(RouteCache_getExpiring(rc, refresh, ips, 4) == 0);
+    RouteCache_setActive(rc, a.ip6.bytes, true);
+    Assert_true(RouteCache_getExpiring(rc, refresh - 1, ips, 4) == 0);
+    Assert_true(RouteCache_getExpiring(rc, refresh, ips, 4) == 1);
+    Assert_true(!Bits_memcmp(ips[0], a.ip6.bytes, 16));
+    Assert_true(RouteCache_getExpiring(rc, refresh + 1, ips, 4) == 0);
+    Assert_true(RouteCache_getExpiring(rc, refresh + RouteCache_REFRESH_MS / 4, ips, 4) == 1);
+
+    Allocator_free(alloc);
+    return 0;
+}
@@ -0,0 +1,241 @@
+/* vim: set expandtab ts=4 sw=4: */
+/*
+ * You may redistribute this program and/or modify it under the terms of
+ * the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "benc/Dict.h"
+#include "benc/List.h"
+#include "benc/serialization/standard/BencMessageReader.h"
+#include "benc/serialization/standard/BencMessageWriter.h"
+#include "crypto/AddressCalc.h"
+#include "crypto/random/Random.h"
+#include "dht/dhtcore/ReplySerializer.h"
+#include "memory/MallocAllocator.h"
+#include "subnode/MsgCore.h"
+#include "subnode/RouteRequester.h"
+#include "switch/NumberCompress.h"
+#include "util/Assert.h"
+#include "util/events/EventBase.h"
+#include "util/events/Time.h"
+#include "util/events/Timeout.h"
+#include "util/log/FileWriterLog.h"
+#include "util/version/Version.h"
+#include "wire/DataHeader.h"
+#include "wire/Message.h"
+#include "wire/RouteHeader.h"
+
+#define TARGETS 128
+
+// The fake supernode handles one query at a time and each takes this long.
+#define SNODE_QUERY_MS 1
+#define RTT_MS 10
+
+#define BULK 32
+
+struct Context
+{
+    /** The fake supernode, plumbed to the MsgCore of the subnode. */
+    struct Iface snodeIf;
+
+    struct EventBase* base;
+    struct Allocator* alloc;
+    struct Address snode;
+    bool bulk;
+    uint64_t snodeBusyUntil;
+    struct Address nodes[TARGETS];
+    int replies;
+    uint64_t startMs;
+    uint64_t doneMs;
+};
+
+struct Reply
+{
+    struct Context* ctx;
+    Dict* msg;
+    struct Allocator* alloc;
+};
+
+static struct Address* findNode(struct Context* ctx, uint8_t* ip)
+{
+    for (int i = 0; i < TARGETS; i++) {
+        if (!Bits_memcmp(ctx->nodes[i].ip6.bytes, ip, 16)) { return &ctx->nodes[i]; }
+    }
+    Assert_failure("unknown target");
+}
+
+static void routeFor(struct Context* ctx, uint8_t* ip, Dict* out, struct Allocator* alloc)
+{
+    struct Address_List al = { .length = 1, .elems = findNode(ctx, ip) };
+    ReplySerializer_serialize(&al, out, NULL, alloc);
+}
+
+static void sendReply(void* vreply)
+{
+    struct Reply* r = vreply;
+    struct Context* ctx = r->ctx;
+    struct Message* msg = Message_new(0, 4096, r->alloc);
+    Er_assert(BencMessageWriter_write(r->msg, msg));
+
+    struct DataHeader data = { .unused = 0 };
+    DataHeader_setVersion(&data, DataHeader_CURRENT_VERSION);
+    DataHeader_setContentType(&data, ContentType_CJDHT);
+    Er_assert(Message_epush(msg, &data, DataHeader_SIZE));
+
+    struct RouteHeader route = { .sh.label_be = Endian_hostToBigEndian64(ctx->snode.path) };
+    route.version_be = Endian_hostToBigEndian32(Version_CURRENT_PROTOCOL);
+    Bits_memcpy(route.ip6, ctx->snode.ip6.bytes, 16);
+    Bits_memcpy(route.publicKey, ctx->snode.key, 32);
+    Er_assert(Message_epush(msg, &route, RouteHeader_SIZE));
+
+    Iface_send(&ctx->snodeIf, msg);
+    Allocator_free(r->alloc);
+}
+
+static Iface_DEFUN onGetRoute(struct Message* query, struct Iface* snodeIf)
+{
+    struct Context* ctx = (struct Context*) snodeIf;
+    Er_assert(Message_eshift(query, -(RouteHeader_SIZE + DataHeader_SIZE)));
+    Dict* msg = NULL;
+    Assert_true(!BencMessageReader_readNoExcept(query, query->alloc, &msg));
+    Assert_true(String_equals(Dict_getStringC(msg, "sq"), String_CONST("gr")));
+
+    struct Allocator* alloc = Allocator_child(ctx->alloc);
+    struct Reply* r = Allocator_calloc(alloc, sizeof(struct Reply), 1);
+    r->ctx = ctx;
+    r->alloc = alloc;
+    r->msg = Dict_new(alloc);
+    Dict_putIntC(r->msg, "p", Version_CURRENT_PROTOCOL, alloc);
+    Dict_putStringC(r->msg, "txid", String_clone(Dict_getStringC(msg, "txid"), alloc), alloc);
+
+    String* tar = Dict_getStringC(msg, "tar");
+    String* tars = Dict_getStringC(msg, "tars");
+    if (tar) {
+        Assert_true(tar->len == 16);
+        routeFor(ctx, tar->bytes, r->msg, alloc);
+    } else {
+        Assert_true(ctx->bulk && tars && tars->len % 16 == 0 && tars->len <= BULK * 16);
+        List* rs = List_new(alloc);
+        // List_addDict() puts each one first.
+        for (int i = tars->len - 16; i >= 0; i -= 16) {
+            Dict* d = Dict_new(alloc);
+            routeFor(ctx, &tars->bytes[i], d, alloc);
+            List_addDict(rs, d, alloc);
+        }
+        Dict_putListC(r->msg, "rs", rs, alloc);
+    }
+    if (ctx->bulk) { Dict_putIntC(r->msg, "grb", BULK, alloc); }
+
+    uint64_t now = Time_currentTimeMilliseconds(ctx->base);
+    if (ctx->snodeBusyUntil < now) { ctx->snodeBusyUntil = now; }
+    ctx->snodeBusyUntil += SNODE_QUERY_MS;
+    Timeout_setTimeout(sendReply, r, ctx->snodeBusyUntil - now + RTT_MS, ctx->base, alloc);
+    return NULL;
+}
+
+static void onReply(struct RouteRequester* rr,
+                    uint8_t target[16],
+                    struct Address_List* routes,
+                    struct Address* snode,
+                    struct Allocator* tmpAlloc)
+{
+    struct Context* ctx = rr->userData;
+    Assert_true(snode && routes && routes->length == 1);
+    Assert_true(!Bits_memcmp(routes->elems[0].ip6.bytes, target, 16));
+    Assert_true(findNode(ctx, target)->path == routes->elems[0].path);
+    if (++ctx->replies == TARGETS) {
+        ctx->doneMs = Time_currentTimeMilliseconds(ctx->base);
+        EventBase_endLoop(ctx->base);
+    }
+}
+
+static void randomNode(struct Random* rand, struct Address* out)
+{
+    do {
+        Random_bytes(rand, out->key, 32);
+    } while (!AddressCalc_addressForPublicKey(out->ip6.bytes, out->key));
+    out->protocolVersion = Version_CURRENT_PROTOCOL;
+}
+
+static void timeout(void* vctx)
+{
+    Assert_failure("Not all routes came back");
+}
+
+/** @return the number of queries it took to get all of the routes. */
+static uint64_t getRoutes(bool bulk, uint64_t* timeMs, struct Random* rand)
+{
+    struct Allocator* alloc = MallocAllocator_new(1<<22);
+    struct EventBase* base = EventBase_new(alloc);
+    struct EncodingScheme* scheme = NumberCompress_defineScheme(alloc);
+    struct Context* ctx = Allocator_calloc(alloc, sizeof(struct Context), 1);
+    ctx->base = base;
+    ctx->alloc = alloc;
+    ctx->bulk = bulk;
+    for (int i = 0; i < TARGETS; i++) {
+        randomNode(rand, &ctx->nodes[i]);
+        ctx->nodes[i].path = 0x13 + i;
+    }
+    randomNode(rand, &ctx->snode);
+    ctx->snode.path = 0x15;
+
+    // Whatever the subnode sends reaches the supernode and the other way around.
+    struct MsgCore* subCore = MsgCore_new(base, rand, alloc, NULL, scheme);
+    ctx->snodeIf.send = onGetRoute;
+    Iface_plumb(&subCore->interRouterIf, &ctx->snodeIf);
+
+    uint8_t myIp[16];
+    struct Address me;
+    randomNode(rand, &me);
+    Bits_memcpy(myIp, me.ip6.bytes, 16);
+    struct RouteRequester* rr = RouteRequester_new(subCore, NULL, base, myIp, alloc);
+    rr->onReply = onReply;
+    rr->userData = ctx;
+
+    ctx->startMs = Time_currentTimeMilliseconds(base);
+    for (int i = 0; i < TARGETS; i++) {
+        Assert_true(!RouteRequester_request(rr, &ctx->snode, ctx->nodes[i].ip6.bytes));
+    }
+    Assert_true(RouteRequester_request(rr, &ctx->snode, ctx->nodes[0].ip6.bytes) ==
+        RouteRequester_request_OUTSTANDING);
+
+    Timeout_setTimeout(timeout, ctx, 5000, base, alloc);
+    EventBase_beginLoop(base);
+
+    *timeMs = ctx->doneMs - ctx->startMs;
+    uint64_t queries = rr->queries;
+    Assert_true(rr->targets == TARGETS);
+    Allocator_free(alloc);
+    return queries;
+}
+
+int main()
+{
+    struct Allocator* alloc = MallocAllocator_new(1<<20);
+    struct Log* log = FileWriterLog_new(stdout, alloc);
+    struct Random* rand = Random_new(alloc, NULL, NULL);
+
+    uint64_t singleMs;
+    uint64_t singleQueries = getRoutes(false, &singleMs, rand);
+    Assert_true(singleQueries == TARGETS);
+
+    // One to find out that the supernode takes bulk queries, then the rest BULK at a time.
+    uint64_t bulkMs;
+    uint64_t bulkQueries = getRoutes(true, &bulkMs, rand);
+    Assert_true(bulkQueries == 1 + (TARGETS - 1 + BULK - 1) / BULK);
+
+    Assert_true(bulkMs < singleMs);
+    Log_info(log, "[%d] routes with one query each took [%d]ms, with bulk queries [%d]ms",
+        TARGETS, (int) singleMs, (int) bulkMs);
+
+    Allocator_free(alloc);
+    return 0;
+}
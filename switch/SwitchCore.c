@@ -55,6 +55,10 @@ struct SwitchCore_pvt
     struct Log* logger;
     struct EventBase* eventBase;
 
+    struct Metrics_Counter* packets;
+    struct Metrics_Counter* errors;
+    struct Metrics_Histogram* switchTime;
+
     struct Allocator* allocator;
     Identity
 };
@@ -66,10 +70,11 @@ struct ErrorPacket8 {
 };
 Assert_compileTime(sizeof(struct ErrorPacket8) == SwitchHeader_SIZE + 4 + sizeof(struct Control));
 
-static inline Iface_DEFUN sendError(struct SwitchInterface* iface,
-                                    struct Message* cause,
-                                    uint32_t code,
-                                    struct Log* logger)
+/** Turn the message into an error packet, returns the interface to send it back on. */
+static inline struct Iface* sendError(struct SwitchInterface* iface,
+                                      struct Message* cause,
+                                      uint32_t code,
+                                      struct Log* logger)
 {
     if (cause->length < SwitchHeader_SIZE + 4) {
         Log_debug(logger, "runt");
@@ -107,16 +112,19 @@ static inline Iface_DEFUN sendError(struct SwitchInterface* iface,
     err->ctrl.header.checksum_be =
         Checksum_engine((uint8_t*) &err->ctrl, cause->length - SwitchHeader_SIZE - 4);
 
-    return Iface_next(&iface->iface, cause);
+    Metrics_Counter_add(iface->core->errors, 1);
+    return &iface->iface;
 }
 
 #define DEBUG_SRC_DST(logger, message) \
     Log_debug(logger, message " ([%u] to [%u])", sourceIndex, destIndex)
 
-/** This never returns an error, it sends an error packet instead. */
-static Iface_DEFUN receiveMessage(struct Message* message, struct Iface* iface)
+/**
+ * Rewrite the label of a message and get the interface which it should be sent on.
+ * If the message cannot be forwarded it is replaced by an error packet for the sender.
+ */
+static struct Iface* switchMessage(struct Message* message, struct SwitchInterface* sourceIf)
 {
-    struct SwitchInterface* sourceIf = Identity_check((struct SwitchInterface*) iface);
     struct SwitchCore_pvt* core = Identity_check(sourceIf->core);
 
     if (message->length < SwitchHeader_SIZE) {
@@ -224,7 +232,20 @@ static Iface_DEFUN receiveMessage(struct Message* message, struct Iface* iface)
     SwitchHeader_setLabelShift(header, labelShift);
     SwitchHeader_setTrafficClass(header, 0xffff);
 
-    return Iface_next(&core->interfaces[destIndex].iface, message);
+    return &core->interfaces[destIndex].iface;
+}
+
+/** This never returns an error, it sends an error packet instead. */
+static Iface_DEFUN receiveMessage(struct Message* message, struct Iface* iface)
+{
+    struct SwitchInterface* sourceIf = Identity_check((struct SwitchInterface*) iface);
+    struct SwitchCore_pvt* core = Identity_check(sourceIf->core);
+    Metrics_Counter_add(core->packets, 1);
+    uint64_t start = Metrics_Histogram_start(core->switchTime);
+    struct Iface* out = switchMessage(message, sourceIf);
+    Metrics_Histogram_stop(core->switchTime, start);
+    if (!out) { return NULL; }
+    return Iface_next(out, message);
 }
 
 static int removeInterface(struct Allocator_OnFreeJob* job)
@@ -294,13 +315,20 @@ int SwitchCore_addInterface(struct SwitchCore* switchCore,
 
 struct SwitchCore* SwitchCore_new(struct Log* logger,
                                   struct Allocator* allocator,
-                                  struct EventBase* base)
+                                  struct EventBase* base,
+                                  struct Metrics* metrics)
 {
     struct SwitchCore_pvt* core = Allocator_calloc(allocator, sizeof(struct SwitchCore_pvt), 1);
     Identity_set(core);
     core->allocator = allocator;
     core->logger = logger;
     core->eventBase = base;
+    core->packets = Metrics_counter(metrics, "cjdns_switch_packets_total",
+        "Packets which entered the switch");
+    core->errors = Metrics_counter(metrics, "cjdns_switch_errors_total",
+        "Error packets sent by the switch because a packet could not be forwarded");
+    core->switchTime = Metrics_histogram(metrics, "cjdns_switch_ns",
+        "Time spent by the switch deciding where to send a packet");
 
     struct SwitchInterface* routerIf = &core->interfaces[1];
     Identity_set(routerIf);
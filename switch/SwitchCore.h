@@ -16,6 +16,7 @@
 #define SwitchCore_H
 
 #include "util/log/Log.h"
+#include "util/Metrics.h"
 #include "wire/Message.h"
 #include "util/events/EventBase.h"
 #include "interface/Iface.h"
@@ -35,10 +36,12 @@ struct SwitchCore
  *
  * @param logger what to log output to.
  * @param allocator the memory allocator to use for allocating the core context and interfaces.
+ * @param metrics where to count packets and forwarding time, may be NULL.
  */
 struct SwitchCore* SwitchCore_new(struct Log* logger,
                                   struct Allocator* allocator,
-                                  struct EventBase* base);
+                                  struct EventBase* base,
+                                  struct Metrics* metrics);
 
 #define SwitchCore_addInterface_OUT_OF_SPACE -1
 int SwitchCore_addInterface(struct SwitchCore* switchCore,
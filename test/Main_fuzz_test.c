@@ -163,7 +163,7 @@ void CJDNS_FUZZ_MAIN(void* vctx, struct Message* msg)
     }
 
     // We're not limited to sending data types which we have registered for
-    Assert_true(!UpperDistributor_registerHandler(ctx->nodeA->nc->upper, 0, 0xfcfc));
+    Assert_true(!UpperDistributor_registerHandler(ctx->nodeA->nc->upper, 0, 0xfcfc, 0, 0));
 
     struct Headers_UDPHeader udp = {
         .srcPort_be = 0xfcfc,
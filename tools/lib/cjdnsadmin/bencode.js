@@ -147,7 +147,6 @@ function blist(list) {
     for(var key in list) {
         enclist.push(bencode(list[key]));
     }
-    enclist.sort();
 
     str = "l";
     for(var enckey in enclist) {
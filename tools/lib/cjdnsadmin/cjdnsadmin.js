@@ -22,14 +22,18 @@ var Semaphore = require('../Semaphore.js');
 
 var TIMEOUT_MILLISECONDS = 10000;
 
-var sendmsg = function (sock, addr, port, msg, txid, callback) {
-    var to = setTimeout(function () {
+var sendmsg = function (sock, addr, port, msg, txid, callback, stream) {
+    var onTimeout = function () {
         callback(new Error("timeout after " + TIMEOUT_MILLISECONDS + "ms"));
         delete sock.handlers[txid];
-    }, TIMEOUT_MILLISECONDS);
+    };
+    var to = setTimeout(onTimeout, TIMEOUT_MILLISECONDS);
     sock.handlers[txid] = {
         callback: callback,
-        timeout: to
+        timeout: to,
+        onTimeout: onTimeout,
+        // If set, responses are collected until one comes without "more"
+        stream: (stream) ? [] : undefined
     };
 
     sock.send(msg, 0, msg.length, port, addr, function(err, bytes) {
@@ -41,7 +45,7 @@ var sendmsg = function (sock, addr, port, msg, txid, callback) {
     });
 };
 
-var callFunc = function (sock, addr, port, pass, func, args, callback) {
+var callFunc = function (sock, addr, port, pass, func, args, callback, stream) {
     var cookieTxid = String(sock.counter++);
     var cookieMsg = Buffer.from(Bencode.encode({'q':'cookie','txid':cookieTxid}));
     sendmsg(sock, addr, port, cookieMsg, cookieTxid, function (err, ret) {
@@ -64,7 +68,7 @@ var callFunc = function (sock, addr, port, pass, func, args, callback) {
             json.hash = Crypto.createHash('sha256').update(pass + cookie).digest('hex');
             json.hash = Crypto.createHash('sha256').update(Bencode.encode(json)).digest('hex');
         }
-        sendmsg(sock, addr, port, Buffer.from(Bencode.encode(json)), json.txid, callback);
+        sendmsg(sock, addr, port, Buffer.from(Bencode.encode(json)), json.txid, callback, stream);
     });
 };
 
@@ -179,7 +183,8 @@ var connect = module.exports.connect = function (addr, port, pass, callback) {
         if (!response.txid) {
             throw new Error("Response [" + msg + "] with no txid");
         }
-        var handler = sock.handlers[response.txid];
+        var txid = response.txid;
+        var handler = sock.handlers[txid];
         if (!handler) {
             if (sock.defaultHandler) {
                 sock.defaultHandler(undefined, response);
@@ -187,7 +192,15 @@ var connect = module.exports.connect = function (addr, port, pass, callback) {
             return;
         }
         clearTimeout(handler.timeout);
-        delete sock.handlers[response.txid];
+        if (handler.stream) {
+            handler.stream.push(response);
+            if (response.more) {
+                handler.timeout = setTimeout(handler.onTimeout, TIMEOUT_MILLISECONDS);
+                return;
+            }
+            response = handler.stream;
+        }
+        delete sock.handlers[txid];
         handler.callback(undefined, response);
     });
 
@@ -201,6 +214,26 @@ var connect = module.exports.connect = function (addr, port, pass, callback) {
         getFunctions(sock, addr, port, pass, function (cjdns) {
             cjdns.disconnect = function () { sock.close(); };
             cjdns.setDefaultHandler = function (handler) { sock.defaultHandler = handler; };
+            // calls is a list of { q: 'function name', args: {...}, allPages: 1 }, the result
+            // is a list with, for each call, the list of its replies, one per page.
+            cjdns.batch = function (calls, cb) {
+                sock.semaphore.take(function (returnAfter) {
+                    callFunc(sock, addr, port, pass, 'Admin_batch', { calls: calls },
+                        returnAfter(function (err, responses) {
+                            if (err) { return void cb(err); }
+                            var results = calls.map(function () { return []; });
+                            for (var i = 0; i < responses.length; i++) {
+                                if (!responses[i].results) {
+                                    return void cb(new Error(responses[i].error));
+                                }
+                                responses[i].results.forEach(function (res) {
+                                    results[Number(res.call)].push(res);
+                                });
+                            }
+                            cb(undefined, results);
+                        }), true);
+                });
+            };
             callback(cjdns);
         });
     });
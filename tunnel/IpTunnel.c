@@ -28,6 +28,7 @@
 #include "util/platform/netdev/NetDev.h"
 #include "util/Checksum.h"
 #include "util/AddrTools.h"
+#include "util/Bits.h"
 #include "util/events/EventBase.h"
 #include "util/Identity.h"
 #include "util/events/Timeout.h"
@@ -40,6 +41,43 @@
 
 #include <stddef.h>
 
+/**
+ * The connection list is indexed by public key and by address so that neither a packet from the
+ * TUN nor one from a node requires a walk of the list.
+ * There is one address index per IP version and direction because a packet from the TUN is
+ * matched on its destination for incoming connections and on its source for outgoing ones.
+ */
+enum Index {
+    Index_KEY,
+    Index_IP6_INCOMING,
+    Index_IP6_OUTGOING,
+    Index_IP4_INCOMING,
+    Index_IP4_OUTGOING,
+    Index_COUNT
+};
+
+/**
+ * An open addressing hash table, each slot contains the index of a connection in the
+ * connection list plus one so that zero means empty. In the address indexes, a connection is
+ * keyed by its address masked to its alloc size and a lookup is done once for each alloc size
+ * which is in use, longest first, so the longest matching prefix wins.
+ */
+struct IpTunnel_Index
+{
+    uint32_t* slots;
+
+    /** Always a power of 2, at least twice count. */
+    uint32_t size;
+    uint32_t count;
+
+    /** Connections which were not inserted because another connection has the same key. */
+    uint32_t dups;
+
+    /** Number of entries with each alloc size and a bitmap of the alloc sizes in use. */
+    uint32_t lenCount[129];
+    uint64_t present[3];
+};
+
 struct IpTunnel_pvt
 {
     struct IpTunnel pub;
@@ -51,9 +89,14 @@ struct IpTunnel_pvt
 
     uint32_t connectionCapacity;
 
+    /** Incoming connections are always at the beginning of the list, before outgoing ones. */
+    uint32_t incomingCount;
+
     /** An always incrementing number which represents the connections. */
     uint32_t nextConnectionNumber;
 
+    struct IpTunnel_Index index[Index_COUNT];
+
     /** To get the name of the TUN interface so that ip addresses can be added. */
     struct GlobalConfig* globalConf;
 
@@ -68,33 +111,255 @@ struct IpTunnel_pvt
     Identity
 };
 
+struct IndexKey
+{
+    /** The address as a big number, IPv4 addresses are in the upper 32 bits of high. */
+    uint64_t high;
+    uint64_t low;
+    int len;
+
+    /** Only for Index_KEY, the other fields are unused. */
+    const uint8_t* publicKey;
+};
+
+static void addressKey(const uint8_t* addr, int addrLen, int len, struct IndexKey* key)
+{
+    Bits_memset(key, 0, sizeof(struct IndexKey));
+    if (addrLen == 16) {
+        Bits_memcpy(&key->high, addr, 8);
+        Bits_memcpy(&key->low, &addr[8], 8);
+        key->high = Endian_bigEndianToHost64(key->high);
+        key->low = Endian_bigEndianToHost64(key->low);
+    } else {
+        uint32_t a;
+        Bits_memcpy(&a, addr, 4);
+        key->high = ((uint64_t) Endian_bigEndianToHost32(a)) << 32;
+    }
+    key->len = len;
+    if (len <= 64) {
+        key->high = (len) ? (key->high & (~((uint64_t)0) << (64 - len))) : 0;
+        key->low = 0;
+    } else if (len < 128) {
+        key->low &= ~((uint64_t)0) << (128 - len);
+    }
+}
+
+/** Get the key of a connection in an index, false if the connection is not in that index. */
+static bool connectionKey(struct IpTunnel_Connection* conn, enum Index idx, struct IndexKey* key)
+{
+    if (idx == Index_KEY) {
+        Bits_memset(key, 0, sizeof(struct IndexKey));
+        key->publicKey = conn->routeHeader.publicKey;
+        return true;
+    }
+    if ((idx == Index_IP6_OUTGOING || idx == Index_IP4_OUTGOING) != !!conn->isOutgoing) {
+        return false;
+    }
+    if (idx == Index_IP6_INCOMING || idx == Index_IP6_OUTGOING) {
+        if (!conn->connectionIp6Alloc || conn->connectionIp6Alloc > 128) { return false; }
+        addressKey(conn->connectionIp6, 16, conn->connectionIp6Alloc, key);
+    } else {
+        if (!conn->connectionIp4Alloc || conn->connectionIp4Alloc > 32) { return false; }
+        addressKey(conn->connectionIp4, 4, conn->connectionIp4Alloc, key);
+    }
+    return true;
+}
+
+static bool keyEquals(struct IndexKey* a, struct IndexKey* b)
+{
+    if (a->publicKey) {
+        return !Bits_memcmp(a->publicKey, b->publicKey, 32);
+    }
+    return a->high == b->high && a->low == b->low && a->len == b->len;
+}
+
+static uint32_t keyHash(struct IndexKey* key)
+{
+    uint64_t x;
+    if (key->publicKey) {
+        Bits_memcpy(&x, key->publicKey, 8);
+    } else {
+        x = key->high ^ (key->low * 0x9e3779b97f4a7c15ull) ^ (uint64_t)key->len;
+    }
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdull;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ull;
+    x ^= x >> 33;
+    return (uint32_t) x;
+}
+
+/** Find the slot which contains a connection with this key or else the empty slot for it. */
+static uint32_t findSlot(struct IpTunnel_pvt* ctx, enum Index idx, struct IndexKey* key)
+{
+    struct IpTunnel_Index* ix = &ctx->index[idx];
+    uint32_t mask = ix->size - 1;
+    for (uint32_t i = keyHash(key) & mask;; i = (i + 1) & mask) {
+        if (!ix->slots[i]) { return i; }
+        struct IndexKey k;
+        struct IpTunnel_Connection* conn = &ctx->pub.connectionList.connections[ix->slots[i] - 1];
+        Assert_true(connectionKey(conn, idx, &k));
+        if (keyEquals(&k, key)) { return i; }
+    }
+}
+
+static void insertSlot(struct IpTunnel_pvt* ctx, enum Index idx, int i, struct IndexKey* key)
+{
+    struct IpTunnel_Index* ix = &ctx->index[idx];
+    uint32_t slot = findSlot(ctx, idx, key);
+    if (ix->slots[slot]) {
+        // Same as the order of the list, incoming connections come before outgoing ones.
+        struct IpTunnel_Connection* conns = ctx->pub.connectionList.connections;
+        if (conns[ix->slots[slot] - 1].isOutgoing && !conns[i].isOutgoing) {
+            ix->slots[slot] = i + 1;
+        }
+        ix->dups++;
+        return;
+    }
+    ix->slots[slot] = i + 1;
+    ix->count++;
+    if (idx != Index_KEY) {
+        ix->lenCount[key->len]++;
+        ix->present[key->len / 64] |= ((uint64_t)1) << (key->len % 64);
+    }
+}
+
+/** Backward shift deletion, entries after the slot are moved back if it is closer to home. */
+static void removeSlot(struct IpTunnel_pvt* ctx, enum Index idx, uint32_t slot, int len)
+{
+    struct IpTunnel_Index* ix = &ctx->index[idx];
+    uint32_t mask = ix->size - 1;
+    for (uint32_t j = (slot + 1) & mask; ix->slots[j]; j = (j + 1) & mask) {
+        struct IndexKey k;
+        struct IpTunnel_Connection* conn = &ctx->pub.connectionList.connections[ix->slots[j] - 1];
+        Assert_true(connectionKey(conn, idx, &k));
+        uint32_t home = keyHash(&k) & mask;
+        if (((j - home) & mask) >= ((j - slot) & mask)) {
+            ix->slots[slot] = ix->slots[j];
+            slot = j;
+        }
+    }
+    ix->slots[slot] = 0;
+    ix->count--;
+    if (idx != Index_KEY && !--ix->lenCount[len]) {
+        ix->present[len / 64] &= ~(((uint64_t)1) << (len % 64));
+    }
+}
+
+static void rebuildIndex(struct IpTunnel_pvt* ctx, enum Index idx)
+{
+    struct IpTunnel_Index* ix = &ctx->index[idx];
+    struct IpTunnel_Connection* conns = ctx->pub.connectionList.connections;
+    struct IndexKey key;
+    uint32_t n = 0;
+    for (int i = 0; i < (int)ctx->pub.connectionList.count; i++) {
+        n += connectionKey(&conns[i], idx, &key);
+    }
+    uint32_t size = 16;
+    while (size < n * 2 + 2) { size *= 2; }
+    if (size != ix->size) {
+        ix->slots = Allocator_realloc(ctx->allocator, ix->slots, size * sizeof(uint32_t));
+        ix->size = size;
+    }
+    Bits_memset(ix->slots, 0, size * sizeof(uint32_t));
+    Bits_memset(ix->lenCount, 0, sizeof(ix->lenCount));
+    Bits_memset(ix->present, 0, sizeof(ix->present));
+    ix->count = 0;
+    ix->dups = 0;
+    for (int i = 0; i < (int)ctx->pub.connectionList.count; i++) {
+        if (connectionKey(&conns[i], idx, &key)) {
+            insertSlot(ctx, idx, i, &key);
+        }
+    }
+}
+
+static void rebuildIndexes(struct IpTunnel_pvt* ctx)
+{
+    for (int idx = 0; idx < Index_COUNT; idx++) {
+        rebuildIndex(ctx, idx);
+    }
+}
+
+/** Add connection number i to the indexes, it must already have its key and addresses. */
+static void indexConnection(int i, struct IpTunnel_pvt* ctx)
+{
+    struct IpTunnel_Connection* conn = &ctx->pub.connectionList.connections[i];
+    for (int idx = 0; idx < Index_COUNT; idx++) {
+        struct IpTunnel_Index* ix = &ctx->index[idx];
+        struct IndexKey key;
+        if (!connectionKey(conn, idx, &key)) { continue; }
+        if ((ix->count + 1) * 2 > ix->size) {
+            // Rebuilding picks up this connection because it is already in the list.
+            rebuildIndex(ctx, idx);
+        } else {
+            insertSlot(ctx, idx, i, &key);
+        }
+    }
+}
+
+/**
+ * Remove connection number i from the indexes.
+ *
+ * @return true if there are duplicate keys, in which case another connection may now need to
+ *         take the place of this one so rebuildIndexes() must be called once the list is updated.
+ */
+static bool unindexConnection(int i, struct IpTunnel_pvt* ctx)
+{
+    struct IpTunnel_Connection* conn = &ctx->pub.connectionList.connections[i];
+    bool dups = false;
+    for (int idx = 0; idx < Index_COUNT; idx++) {
+        struct IpTunnel_Index* ix = &ctx->index[idx];
+        struct IndexKey key;
+        dups |= (ix->dups > 0);
+        if (!ix->size || !connectionKey(conn, idx, &key)) { continue; }
+        uint32_t slot = findSlot(ctx, idx, &key);
+        if (ix->slots[slot] == (uint32_t)i + 1) {
+            removeSlot(ctx, idx, slot, key.len);
+        }
+    }
+    return dups;
+}
+
+/** Move a connection to another place in the list, the destination must not be indexed. */
+static void moveConnection(int from, int to, struct IpTunnel_pvt* ctx)
+{
+    struct IpTunnel_Connection* conns = ctx->pub.connectionList.connections;
+    Bits_memcpy(&conns[to], &conns[from], sizeof(struct IpTunnel_Connection));
+    for (int idx = 0; idx < Index_COUNT; idx++) {
+        struct IpTunnel_Index* ix = &ctx->index[idx];
+        struct IndexKey key;
+        if (!ix->size || !connectionKey(&conns[to], idx, &key)) { continue; }
+        uint32_t slot = findSlot(ctx, idx, &key);
+        if (ix->slots[slot] == (uint32_t)from + 1) {
+            ix->slots[slot] = to + 1;
+        }
+    }
+}
+
 static struct IpTunnel_Connection* newConnection(bool isOutgoing, struct IpTunnel_pvt* context)
 {
     if (context->pub.connectionList.count == context->connectionCapacity) {
-        uint32_t newSize = (context->connectionCapacity + 4) * sizeof(struct IpTunnel_Connection);
+        uint32_t capacity = (context->connectionCapacity) ? context->connectionCapacity * 2 : 4;
         context->pub.connectionList.connections =
-            Allocator_realloc(context->allocator, context->pub.connectionList.connections, newSize);
-        context->connectionCapacity += 4;
+            Allocator_realloc(context->allocator,
+                              context->pub.connectionList.connections,
+                              capacity * sizeof(struct IpTunnel_Connection));
+        context->connectionCapacity = capacity;
     }
-    struct IpTunnel_Connection* conn =
-        &context->pub.connectionList.connections[context->pub.connectionList.count];
+    int i = context->pub.connectionList.count;
 
-    // If it's an incoming connection, it must be lower on the list than any outgoing connections.
+    // If it's an incoming connection, it must be lower on the list than any outgoing connections
+    // so the first outgoing connection is moved to the end to make room.
     if (!isOutgoing) {
-        for (int i = (int)context->pub.connectionList.count - 1; i >= 0; i--) {
-            if (!context->pub.connectionList.connections[i].isOutgoing
-                && conn != &context->pub.connectionList.connections[i + 1])
-            {
-                Bits_memcpy(conn,
-                                 &context->pub.connectionList.connections[i + 1],
-                                 sizeof(struct IpTunnel_Connection));
-                conn = &context->pub.connectionList.connections[i + 1];
-            }
+        if (context->incomingCount < context->pub.connectionList.count) {
+            moveConnection(context->incomingCount, i, context);
         }
+        i = context->incomingCount++;
     }
 
     context->pub.connectionList.count++;
 
+    struct IpTunnel_Connection* conn = &context->pub.connectionList.connections[i];
     Bits_memset(conn, 0, sizeof(struct IpTunnel_Connection));
     conn->number = context->nextConnectionNumber++;
     conn->isOutgoing = isOutgoing;
@@ -105,38 +370,65 @@ static struct IpTunnel_Connection* newConnection(bool isOutgoing, struct IpTunne
     return conn;
 }
 
-static void deleteConnection(struct IpTunnel_Connection* conn, struct IpTunnel_pvt* context)
+static void deleteConnection(int i, struct IpTunnel_pvt* context)
 {
-    // Delete connection and shift the list elements following the removed connection
-
-    int i = (((char *)conn)-((char *)&context->pub.connectionList.connections[0]))
-                                                  / sizeof(struct IpTunnel_Connection);
-
     // Sanity check
     Assert_true(i >= 0 && i < (signed int)context->pub.connectionList.count);
 
-    for (; (unsigned int)i < context->pub.connectionList.count-1; ++i) {
-        Bits_memcpy(&context->pub.connectionList.connections[i],
-                    &context->pub.connectionList.connections[i + 1],
-                    sizeof(struct IpTunnel_Connection));
-    }
+    bool dups = unindexConnection(i, context);
 
-    int last = context->pub.connectionList.count-1;
-    if (last > 0) {
-        Bits_memset(&context->pub.connectionList.connections[last], 0,
-                    sizeof(struct IpTunnel_Connection));
+    // Fill the hole with the last connection of the same direction and if it was an incoming
+    // connection, fill the resulting hole with the last outgoing connection.
+    int last = context->pub.connectionList.count - 1;
+    if (!context->pub.connectionList.connections[i].isOutgoing) {
+        int lastIncoming = --context->incomingCount;
+        if (i != lastIncoming) {
+            moveConnection(lastIncoming, i, context);
+        }
+        i = lastIncoming;
     }
+    if (i != last) {
+        moveConnection(last, i, context);
+    }
+
+    Bits_memset(&context->pub.connectionList.connections[last], 0,
+                sizeof(struct IpTunnel_Connection));
 
     context->pub.connectionList.count--;
+
+    if (dups) {
+        rebuildIndexes(context);
+    }
 }
 
 static struct IpTunnel_Connection* connectionByPubKey(uint8_t pubKey[32],
                                                       struct IpTunnel_pvt* context)
 {
-    for (int i = 0; i < (int)context->pub.connectionList.count; i++) {
-        struct IpTunnel_Connection* conn = &context->pub.connectionList.connections[i];
-        if (!Bits_memcmp(pubKey, conn->routeHeader.publicKey, 32)) {
-            return conn;
+    if (!context->index[Index_KEY].count) { return NULL; }
+    struct IndexKey key = { .publicKey = pubKey };
+    uint32_t slot = findSlot(context, Index_KEY, &key);
+    if (!context->index[Index_KEY].slots[slot]) { return NULL; }
+    return &context->pub.connectionList.connections[context->index[Index_KEY].slots[slot] - 1];
+}
+
+/** Find the connection with the longest prefix which contains an address. */
+static struct IpTunnel_Connection* connectionByAddress(const uint8_t* addr,
+                                                       int addrLen,
+                                                       enum Index idx,
+                                                       struct IpTunnel_pvt* context)
+{
+    struct IpTunnel_Index* ix = &context->index[idx];
+    if (!ix->count) { return NULL; }
+    for (int word = 2; word >= 0; word--) {
+        for (uint64_t lens = ix->present[word]; lens;) {
+            int bit = Bits_log2x64(lens);
+            lens &= ~(((uint64_t)1) << bit);
+            struct IndexKey key;
+            addressKey(addr, addrLen, word * 64 + bit, &key);
+            uint32_t slot = findSlot(context, idx, &key);
+            if (ix->slots[slot]) {
+                return &context->pub.connectionList.connections[ix->slots[slot] - 1];
+            }
         }
     }
     return NULL;
@@ -192,6 +484,8 @@ int IpTunnel_allowConnection(uint8_t publicKeyOfAuthorizedNode[32],
         Assert_true(ip6Alloc);
     }
 
+    indexConnection(conn - context->pub.connectionList.connections, context);
+
     return conn->number;
 }
 
@@ -280,6 +574,7 @@ int IpTunnel_connectTo(uint8_t publicKeyOfNodeToConnectTo[32], struct IpTunnel*
     struct IpTunnel_Connection* conn = newConnection(true, context);
     Bits_memcpy(conn->routeHeader.publicKey, publicKeyOfNodeToConnectTo, 32);
     AddressCalc_addressForPublicKey(conn->routeHeader.ip6, publicKeyOfNodeToConnectTo);
+    indexConnection(conn - context->pub.connectionList.connections, context);
 
     if (Defined(Log_DEBUG)) {
         uint8_t addr[40];
@@ -306,7 +601,7 @@ int IpTunnel_removeConnection(int connectionNumber, struct IpTunnel* tunnel)
     {
         if (tunnel->connectionList.connections[i].number==connectionNumber)
         {
-            deleteConnection(&tunnel->connectionList.connections[i], context);
+            deleteConnection(i, context);
             return 0;
         }
     }
@@ -487,6 +782,10 @@ static Iface_DEFUN incomingAddresses(Dict* d,
 
     Dict* addresses = Dict_getDictC(d, "addresses");
 
+    // The addresses are part of the key in the address indexes.
+    int connIndex = conn - context->pub.connectionList.connections;
+    bool dups = unindexConnection(connIndex, context);
+
     String* ip4 = Dict_getStringC(addresses, "ip4");
     int64_t* ip4Prefix = Dict_getIntC(addresses, "ip4Prefix");
     int64_t* ip4Alloc = Dict_getIntC(addresses, "ip4Alloc");
@@ -550,6 +849,13 @@ static Iface_DEFUN incomingAddresses(Dict* d,
         addAddress(printedAddr,
             conn->connectionIp6Prefix, conn->connectionIp6Alloc, context, alloc);
     }
+
+    if (dups) {
+        rebuildIndexes(context);
+    } else {
+        indexConnection(connIndex, context);
+    }
+
     if (context->rg->hasUncommittedChanges) {
         String* tunName = GlobalConfig_getTunName(context->globalConf);
         if (!tunName) {
@@ -649,45 +955,57 @@ static bool prefixMatches4(uint8_t* addressA, uint8_t* refAddr, uint32_t prefixL
     return !((a ^ b) >> (32 - prefixLen));
 }
 
-static bool isValidAddress4(uint8_t sourceAndDestIp4[8],
+static bool isValidAddress4(uint8_t sourceIp4[4],
+                            uint8_t destIp4[4],
                             bool isFromTun,
                             struct IpTunnel_Connection* conn)
 {
     uint8_t* compareAddr = (isFromTun)
-        ? ((conn->isOutgoing) ? sourceAndDestIp4 : &sourceAndDestIp4[4])
-        : ((conn->isOutgoing) ? &sourceAndDestIp4[4] : sourceAndDestIp4);
+        ? ((conn->isOutgoing) ? sourceIp4 : destIp4)
+        : ((conn->isOutgoing) ? destIp4 : sourceIp4);
     return prefixMatches4(compareAddr, conn->connectionIp4, conn->connectionIp4Alloc);
 }
 
-static bool isValidAddress6(uint8_t sourceAndDestIp6[32],
+static bool isValidAddress6(uint8_t sourceIp6[16],
+                            uint8_t destIp6[16],
                             bool isFromTun,
                             struct IpTunnel_Connection* conn)
 {
-    if (AddressCalc_validAddress(sourceAndDestIp6)
-        || AddressCalc_validAddress(&sourceAndDestIp6[16])) {
+    if (AddressCalc_validAddress(sourceIp6) || AddressCalc_validAddress(destIp6)) {
         return false;
     }
     uint8_t* compareAddr = (isFromTun)
-        ? ((conn->isOutgoing) ? sourceAndDestIp6 : &sourceAndDestIp6[16])
-        : ((conn->isOutgoing) ? &sourceAndDestIp6[16] : sourceAndDestIp6);
+        ? ((conn->isOutgoing) ? sourceIp6 : destIp6)
+        : ((conn->isOutgoing) ? destIp6 : sourceIp6);
     return prefixMatches6(compareAddr, conn->connectionIp6, conn->connectionIp6Alloc);
 }
 
-static struct IpTunnel_Connection* findConnection(uint8_t sourceAndDestIp6[32],
-                                                  uint8_t sourceAndDestIp4[8],
-                                                  bool isFromTun,
+/**
+ * Find the connection for a packet from the TUN, incoming connections are matched on the
+ * destination address and take precedence over outgoing connections which are matched on the
+ * source address. The addresses are 16 bytes for IPv6 and 4 for IPv4.
+ */
+static struct IpTunnel_Connection* findConnection(uint8_t* sourceAddr,
+                                                  uint8_t* destAddr,
+                                                  int addrLen,
                                                   struct IpTunnel_pvt* context)
 {
-    for (int i = 0; i < (int)context->pub.connectionList.count; i++) {
-        struct IpTunnel_Connection* conn = &context->pub.connectionList.connections[i];
-        if (sourceAndDestIp6 && isValidAddress6(sourceAndDestIp6, isFromTun, conn)) {
-            return conn;
+    struct IpTunnel_Connection* conn = NULL;
+    if (addrLen == 16) {
+        if (AddressCalc_validAddress(sourceAddr) || AddressCalc_validAddress(destAddr)) {
+            return NULL;
         }
-        if (sourceAndDestIp4 && isValidAddress4(sourceAndDestIp4, isFromTun, conn)) {
-            return conn;
+        conn = connectionByAddress(destAddr, 16, Index_IP6_INCOMING, context);
+        if (!conn) {
+            conn = connectionByAddress(sourceAddr, 16, Index_IP6_OUTGOING, context);
+        }
+    } else {
+        conn = connectionByAddress(destAddr, 4, Index_IP4_INCOMING, context);
+        if (!conn) {
+            conn = connectionByAddress(sourceAddr, 4, Index_IP4_OUTGOING, context);
         }
     }
-    return NULL;
+    return conn;
 }
 
 static Iface_DEFUN incomingFromTun(struct Message* message, struct Iface* tunIf)
@@ -703,10 +1021,10 @@ static Iface_DEFUN incomingFromTun(struct Message* message, struct Iface* tunIf)
         // No connections authorized, fall through to "unrecognized address"
     } else if (message->length > 40 && Headers_getIpVersion(message->bytes) == 6) {
         struct Headers_IP6Header* header = (struct Headers_IP6Header*) message->bytes;
-        conn = findConnection(header->sourceAddr, NULL, true, context);
+        conn = findConnection(header->sourceAddr, header->destinationAddr, 16, context);
     } else if (message->length > 20 && Headers_getIpVersion(message->bytes) == 4) {
         struct Headers_IP4Header* header = (struct Headers_IP4Header*) message->bytes;
-        conn = findConnection(NULL, header->sourceAddr, true, context);
+        conn = findConnection(header->sourceAddr, header->destAddr, 4, context);
     } else {
         Log_info(context->logger, "Message of unknown type from TUN");
         return 0;
@@ -732,7 +1050,7 @@ static Iface_DEFUN ip6FromNode(struct Message* message,
         Log_debug(context->logger, "Got message with zero address");
         return 0;
     }
-    if (!isValidAddress6(header->sourceAddr, false, conn)) {
+    if (!isValidAddress6(header->sourceAddr, header->destinationAddr, false, conn)) {
         uint8_t addr[40];
         AddrTools_printIp(addr, header->sourceAddr);
         Log_debug(context->logger, "Got message with wrong address for connection [%s]", addr);
@@ -751,7 +1069,7 @@ static Iface_DEFUN ip4FromNode(struct Message* message,
     if (Bits_isZero(header->sourceAddr, 4) || Bits_isZero(header->destAddr, 4)) {
         Log_debug(context->logger, "Got message with zero address");
         return 0;
-    } else if (!isValidAddress4(header->sourceAddr, false, conn)) {
+    } else if (!isValidAddress4(header->sourceAddr, header->destAddr, false, conn)) {
         Log_debug(context->logger, "Got message with wrong address [%d.%d.%d.%d] for connection "
                                    "[%d.%d.%d.%d/%d:%d]",
                   header->sourceAddr[0], header->sourceAddr[1],
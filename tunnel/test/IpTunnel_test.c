@@ -365,6 +365,91 @@ static void testAddr(struct Context* ctx,
     Allocator_free(alloc);
 }
 
+static Iface_DEFUN recordKeyCallback(struct Message* message, struct Iface* iface)
+{
+    struct Context* ctx = Identity_check(((struct IfaceContext*)iface)->ctx);
+    struct RouteHeader* rh = (struct RouteHeader*) message->bytes;
+    ctx->called = rh->publicKey[0];
+    return NULL;
+}
+
+/** Send a packet from the TUN and return the first byte of the key of the node it went to. */
+static int routeFromTun4(uint32_t dest, struct Iface* tunIf, struct Context* ctx)
+{
+    struct Allocator* alloc = Allocator_child(ctx->alloc);
+    struct Message* msg = Message_new(0, 512, alloc);
+    Er_assert(Message_epush(msg, "hello world", 12));
+    Er_assert(Message_epush(msg, NULL, Headers_IP4Header_SIZE));
+    struct Headers_IP4Header* iph = (struct Headers_IP4Header*) msg->bytes;
+    Headers_setIpVersion(iph);
+    Bits_memcpy(iph->sourceAddr, ((uint8_t[]){ 11, 0, 0, 1 }), 4);
+    uint32_t dest_be = Endian_hostToBigEndian32(dest);
+    Bits_memcpy(iph->destAddr, &dest_be, 4);
+    ctx->called = 0;
+    Iface_send(tunIf, msg);
+    Allocator_free(alloc);
+    int out = ctx->called;
+    ctx->called = 0;
+    return out;
+}
+
+static int allow4(uint8_t keyByte, uint32_t addr, int alloc4, struct IpTunnel* ipTun)
+{
+    uint8_t key[32];
+    Bits_memset(key, keyByte, 32);
+    Bits_memcpy(&key[1], &addr, 4);
+    struct Sockaddr_storage ss;
+    Assert_true(!Sockaddr_parse("0.0.0.0", &ss));
+    uint8_t* addrBytes = NULL;
+    Assert_true(Sockaddr_getAddress(&ss.addr, &addrBytes) == 4);
+    uint32_t addr_be = Endian_hostToBigEndian32(addr);
+    Bits_memcpy(addrBytes, &addr_be, 4);
+    return IpTunnel_allowConnection(key, NULL, 0, 0, &ss.addr, 0, alloc4, ipTun);
+}
+
+static void testLongestPrefix(struct Context* ctx)
+{
+    struct Allocator* alloc = Allocator_child(ctx->alloc);
+    struct GlobalConfig* gc = GlobalConfig_new(alloc);
+    struct IpTunnel* ipTun = IpTunnel_new(ctx->log, ctx->base, alloc, ctx->rand, NULL, gc);
+
+    struct IfaceContext* nodeIf = Allocator_calloc(alloc, sizeof(struct IfaceContext), 1);
+    nodeIf->ctx = ctx;
+    nodeIf->iface.send = recordKeyCallback;
+    struct IfaceContext* tunIf = Allocator_calloc(alloc, sizeof(struct IfaceContext), 1);
+    tunIf->ctx = ctx;
+    Iface_plumb(&nodeIf->iface, &ipTun->nodeInterface);
+    Iface_plumb(&tunIf->iface, &ipTun->tunInterface);
+
+    allow4(1, 0x0a000000, 8, ipTun);
+    int conn2 = allow4(2, 0x0a010203, 32, ipTun);
+
+    // Enough clients that the indexes need to grow.
+    int clients[100];
+    for (int i = 0; i < 100; i++) {
+        clients[i] = allow4(3, 0x0a020000 + i, 32, ipTun);
+    }
+
+    Assert_true(routeFromTun4(0x0a010203, &tunIf->iface, ctx) == 2);
+    Assert_true(routeFromTun4(0x0a010204, &tunIf->iface, ctx) == 1);
+    Assert_true(routeFromTun4(0x0b000001, &tunIf->iface, ctx) == 0);
+    for (int i = 0; i < 100; i++) {
+        Assert_true(routeFromTun4(0x0a020000 + i, &tunIf->iface, ctx) == 3);
+    }
+
+    Assert_true(!IpTunnel_removeConnection(conn2, ipTun));
+    Assert_true(routeFromTun4(0x0a010203, &tunIf->iface, ctx) == 1);
+    for (int i = 0; i < 100; i += 2) {
+        Assert_true(!IpTunnel_removeConnection(clients[i], ipTun));
+    }
+    for (int i = 0; i < 100; i++) {
+        Assert_true(routeFromTun4(0x0a020000 + i, &tunIf->iface, ctx) == ((i & 1) ? 3 : 1));
+    }
+    Assert_true(ipTun->connectionList.count == 51);
+
+    Allocator_free(alloc);
+}
+
 int main()
 {
     struct Allocator* alloc = MallocAllocator_new(1<<20);
@@ -388,6 +473,8 @@ int main()
     testAddr(ctx, "192.168.1.1", 16, 24, "fd00::1", 8, 64);
     testAddr(ctx, "192.168.1.1", 16, 24, "fd00::1", 64, 128);
 
+    testLongestPrefix(ctx);
+
     EventBase_beginLoop(eb);
 
     Allocator_free(alloc);
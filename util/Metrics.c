@@ -0,0 +1,245 @@
+/* vim: set expandtab ts=4 sw=4: */
+/*
+ * You may redistribute this program and/or modify it under the terms of
+ * the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "util/Metrics.h"
+#include "util/Assert.h"
+#include "util/CString.h"
+#include "util/Gcc.h"
+#include "util/Identity.h"
+#include "util/events/Timeout.h"
+
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdio.h>
+
+struct Metric
+{
+    const char* name;
+    const char* help;
+    enum Metrics_Type type;
+    union {
+        struct Metrics_Counter* counter;
+        struct Metrics_Gauge* gauge;
+        struct Metrics_Histogram* histogram;
+    } as;
+    Metrics_GaugeFn fn;
+    void* fnContext;
+};
+
+struct Metrics
+{
+    struct Allocator* alloc;
+    int count;
+    struct Metric metrics[Metrics_MAX];
+    Identity
+};
+
+struct Metrics* Metrics_new(struct Allocator* alloc)
+{
+    struct Metrics* m = Allocator_calloc(alloc, sizeof(struct Metrics), 1);
+    m->alloc = alloc;
+    Identity_set(m);
+    return m;
+}
+
+static struct Metric* getMetric(struct Metrics* m,
+                                const char* name,
+                                const char* help,
+                                enum Metrics_Type type,
+                                uint32_t size)
+{
+    if (!m) { return NULL; }
+    Identity_check(m);
+    for (int i = 0; i < m->count; i++) {
+        if (m->metrics[i].type != type || CString_strcmp(m->metrics[i].name, name)) { continue; }
+        return &m->metrics[i];
+    }
+    if (m->count >= Metrics_MAX) { return NULL; }
+    struct Metric* out = &m->metrics[m->count++];
+    out->name = name;
+    out->help = help;
+    out->type = type;
+    if (size) {
+        out->as.counter = Allocator_calloc(m->alloc, size, 1);
+    }
+    return out;
+}
+
+struct Metrics_Counter* Metrics_counter(struct Metrics* metrics,
+                                        const char* name,
+                                        const char* help)
+{
+    struct Metric* m = getMetric(metrics, name, help, Metrics_Type_COUNTER,
+                                 sizeof(struct Metrics_Counter));
+    return (m) ? m->as.counter : NULL;
+}
+
+struct Metrics_Gauge* Metrics_gauge(struct Metrics* metrics, const char* name, const char* help)
+{
+    struct Metric* m = getMetric(metrics, name, help, Metrics_Type_GAUGE,
+                                 sizeof(struct Metrics_Gauge));
+    return (m) ? m->as.gauge : NULL;
+}
+
+struct Metrics_Histogram* Metrics_histogram(struct Metrics* metrics,
+                                            const char* name,
+                                            const char* help)
+{
+    struct Metric* m = getMetric(metrics, name, help, Metrics_Type_HISTOGRAM,
+                                 sizeof(struct Metrics_Histogram));
+    return (m) ? m->as.histogram : NULL;
+}
+
+void Metrics_gaugeFn(struct Metrics* metrics,
+                     const char* name,
+                     const char* help,
+                     Metrics_GaugeFn fn,
+                     void* context)
+{
+    struct Metric* m = getMetric(metrics, name, help, Metrics_Type_GAUGE, 0);
+    if (!m) { return; }
+    m->fn = fn;
+    m->fnContext = context;
+}
+
+uint64_t Metrics_Histogram_percentile(struct Metrics_Histogram* h, uint32_t perMillion)
+{
+    if (!h->count) { return 0; }
+    uint64_t target = (h->count * perMillion + 999999) / 1000000;
+    if (!target) { target = 1; }
+    uint64_t seen = 0;
+    for (int i = 0; i < Metrics_Histogram_BUCKETS; i++) {
+        seen += h->buckets[i];
+        if (seen < target) { continue; }
+        if (i + 1 == Metrics_Histogram_BUCKETS) { return h->max; }
+        uint64_t top = Metrics_Histogram_bucketFloor(i + 1) - 1;
+        return (top < h->max) ? top : h->max;
+    }
+    return h->max;
+}
+
+int Metrics_get(struct Metrics* metrics, int n, struct Metrics_Entry* out)
+{
+    Identity_check(metrics);
+    if (n < 0 || n >= metrics->count) { return -1; }
+    struct Metric* m = &metrics->metrics[n];
+    Bits_memset(out, 0, sizeof(struct Metrics_Entry));
+    out->name = m->name;
+    out->help = m->help;
+    out->type = m->type;
+    switch (m->type) {
+        case Metrics_Type_COUNTER: out->value = m->as.counter->value; break;
+        case Metrics_Type_GAUGE: {
+            out->value = (m->fn) ? m->fn(m->fnContext) : m->as.gauge->value;
+            break;
+        }
+        case Metrics_Type_HISTOGRAM: out->histogram = m->as.histogram; break;
+    }
+    return 0;
+}
+
+struct Buf
+{
+    char* bytes;
+    uint32_t len;
+    uint32_t size;
+    struct Allocator* alloc;
+};
+
+Gcc_PRINTF(2, 3)
+static void append(struct Buf* b, const char* format, ...)
+{
+    for (;;) {
+        va_list args;
+        va_start(args, format);
+        int len = vsnprintf(&b->bytes[b->len], b->size - b->len, format, args);
+        va_end(args);
+        Assert_true(len >= 0);
+        if (b->len + len < b->size) {
+            b->len += len;
+            return;
+        }
+        b->size *= 2;
+        b->bytes = Allocator_realloc(b->alloc, b->bytes, b->size);
+    }
+}
+
+static const uint32_t QUANTILES[] = { 500000, 900000, 990000, 999000 };
+
+String* Metrics_prometheus(struct Metrics* metrics, struct Allocator* alloc)
+{
+    struct Buf b = { .size = 4096, .alloc = alloc };
+    b.bytes = Allocator_malloc(alloc, b.size);
+    b.bytes[0] = '\0';
+    struct Metrics_Entry e;
+    for (int i = 0; !Metrics_get(metrics, i, &e); i++) {
+        append(&b, "# HELP %s %s\n", e.name, e.help);
+        switch (e.type) {
+            case Metrics_Type_COUNTER: {
+                append(&b, "# TYPE %s counter\n%s %" PRIu64 "\n",
+                       e.name, e.name, (uint64_t) e.value);
+                break;
+            }
+            case Metrics_Type_GAUGE: {
+                append(&b, "# TYPE %s gauge\n%s %" PRId64 "\n", e.name, e.name, e.value);
+                break;
+            }
+            case Metrics_Type_HISTOGRAM: {
+                append(&b, "# TYPE %s summary\n", e.name);
+                for (int q = 0; q < (int) (sizeof QUANTILES / sizeof *QUANTILES); q++) {
+                    append(&b, "%s{quantile=\"%g\"} %" PRIu64 "\n", e.name,
+                           QUANTILES[q] / 1000000.0,
+                           Metrics_Histogram_percentile(e.histogram, QUANTILES[q]));
+                }
+                append(&b, "%s_sum %" PRIu64 "\n%s_count %" PRIu64 "\n",
+                       e.name, e.histogram->sum, e.name, e.histogram->count);
+                break;
+            }
+        }
+    }
+    return String_newBinary(b.bytes, b.len, alloc);
+}
+
+struct LoopWatch
+{
+    struct Metrics_Histogram* lag;
+    uint64_t last;
+    uint64_t intervalNs;
+    Identity
+};
+
+static void loopWatchCycle(void* vlw)
+{
+    struct LoopWatch* lw = Identity_check((struct LoopWatch*) vlw);
+    uint64_t now = Time_hrtime();
+    uint64_t expected = lw->last + lw->intervalNs;
+    Metrics_Histogram_record(lw->lag, (now > expected) ? now - expected : 0);
+    lw->last = now;
+}
+
+void Metrics_watchEventLoop(struct Metrics* metrics,
+                            struct EventBase* base,
+                            uint32_t intervalMilliseconds,
+                            struct Allocator* alloc)
+{
+    struct Metrics_Histogram* lag = Metrics_histogram(metrics, "cjdns_eventloop_lag_ns",
+        "How much later than scheduled the event loop ran a timeout");
+    if (!lag) { return; }
+    struct LoopWatch* lw = Allocator_calloc(alloc, sizeof(struct LoopWatch), 1);
+    lw->lag = lag;
+    lw->last = Time_hrtime();
+    lw->intervalNs = ((uint64_t) intervalMilliseconds) * 1000000;
+    Identity_set(lw);
+    Timeout_setInterval(loopWatchCycle, lw, intervalMilliseconds, base, alloc);
+}
@@ -0,0 +1,188 @@
+/* vim: set expandtab ts=4 sw=4: */
+/*
+ * You may redistribute this program and/or modify it under the terms of
+ * the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef Metrics_H
+#define Metrics_H
+
+#include "benc/String.h"
+#include "memory/Allocator.h"
+#include "util/Bits.h"
+#include "util/events/EventBase.h"
+#include "util/events/Time.h"
+#include "util/Linker.h"
+Linker_require("util/Metrics.c");
+
+#include <stdint.h>
+
+/**
+ * A registry of counters, gauges and histograms which belong to the whole process.
+ * Modules ask the registry for a metric once, when they are created, and then update it with
+ * the inline functions below which cost a few instructions and no locks, metrics are only
+ * touched from the event loop. Every function accepts NULL in place of a metric so a module
+ * which was created without a registry (tests, benchmarks) need not check.
+ */
+struct Metrics;
+
+#define Metrics_MAX 128
+
+struct Metrics_Counter
+{
+    uint64_t value;
+};
+
+/** A gauge is either set directly or, if it was created with a function, read when dumped. */
+struct Metrics_Gauge
+{
+    int64_t value;
+};
+typedef int64_t (* Metrics_GaugeFn)(void* context);
+
+/**
+ * Log-linear histogram in the style of HdrHistogram, each power of two is divided into
+ * 1 << Metrics_Histogram_SUB_BITS buckets so any recorded value is known within 12.5%.
+ */
+#define Metrics_Histogram_SUB_BITS 3
+#define Metrics_Histogram_SUB_COUNT (1 << Metrics_Histogram_SUB_BITS)
+#define Metrics_Histogram_BUCKETS \
+    ((64 - Metrics_Histogram_SUB_BITS + 1) * Metrics_Histogram_SUB_COUNT)
+struct Metrics_Histogram
+{
+    uint64_t count;
+    uint64_t sum;
+    uint64_t max;
+    uint64_t buckets[Metrics_Histogram_BUCKETS];
+};
+
+static inline int Metrics_Histogram_bucket(uint64_t value)
+{
+    if (value < Metrics_Histogram_SUB_COUNT) { return value; }
+    int exp = Bits_log2x64(value);
+    int sub = (value >> (exp - Metrics_Histogram_SUB_BITS)) & (Metrics_Histogram_SUB_COUNT - 1);
+    return (exp - Metrics_Histogram_SUB_BITS + 1) * Metrics_Histogram_SUB_COUNT + sub;
+}
+
+/** The smallest value which falls into a bucket. */
+static inline uint64_t Metrics_Histogram_bucketFloor(int bucket)
+{
+    if (bucket < Metrics_Histogram_SUB_COUNT) { return bucket; }
+    int exp = bucket / Metrics_Histogram_SUB_COUNT + Metrics_Histogram_SUB_BITS - 1;
+    uint64_t sub = bucket % Metrics_Histogram_SUB_COUNT;
+    return (Metrics_Histogram_SUB_COUNT + sub) << (exp - Metrics_Histogram_SUB_BITS);
+}
+
+static inline void Metrics_Counter_add(struct Metrics_Counter* c, uint64_t amount)
+{
+    if (c) { c->value += amount; }
+}
+
+static inline void Metrics_Gauge_set(struct Metrics_Gauge* g, int64_t value)
+{
+    if (g) { g->value = value; }
+}
+
+static inline void Metrics_Histogram_record(struct Metrics_Histogram* h, uint64_t value)
+{
+    if (!h) { return; }
+    h->count++;
+    h->sum += value;
+    if (value > h->max) { h->max = value; }
+    h->buckets[Metrics_Histogram_bucket(value)]++;
+}
+
+/** Begin timing something, returns 0 without looking at the clock if there is no histogram. */
+static inline uint64_t Metrics_Histogram_start(struct Metrics_Histogram* h)
+{
+    return (h) ? Time_hrtime() : 0;
+}
+
+/** Record the nanoseconds since Metrics_Histogram_start(). */
+static inline void Metrics_Histogram_stop(struct Metrics_Histogram* h, uint64_t start)
+{
+    if (h) { Metrics_Histogram_record(h, Time_hrtime() - start); }
+}
+
+/**
+ * Get the value below which a fraction of the recorded values fall, reported as the top of the
+ * bucket but never more than the largest recorded value.
+ *
+ * @param h the histogram.
+ * @param perMillion the fraction times one million, 990000 for the 99th percentile.
+ */
+uint64_t Metrics_Histogram_percentile(struct Metrics_Histogram* h, uint32_t perMillion);
+
+struct Metrics* Metrics_new(struct Allocator* alloc);
+
+/**
+ * Get a metric, if there is already one with the same name and type it is returned so modules
+ * which exist more than once add up to the same numbers.
+ * Names should follow the prometheus rules, eg: "cjdns_switch_packets_total", the help is
+ * a short description and both must be constant strings.
+ *
+ * @return the metric or NULL if metrics is NULL or there are already Metrics_MAX metrics.
+ */
+struct Metrics_Counter* Metrics_counter(struct Metrics* metrics,
+                                        const char* name,
+                                        const char* help);
+struct Metrics_Gauge* Metrics_gauge(struct Metrics* metrics, const char* name, const char* help);
+struct Metrics_Histogram* Metrics_histogram(struct Metrics* metrics,
+                                            const char* name,
+                                            const char* help);
+
+/** Register a gauge whose value is computed by calling fn(context) when it is dumped. */
+void Metrics_gaugeFn(struct Metrics* metrics,
+                     const char* name,
+                     const char* help,
+                     Metrics_GaugeFn fn,
+                     void* context);
+
+/**
+ * Measure how late the event loop runs timeouts by setting one every intervalMilliseconds,
+ * the lateness is recorded in the histogram "cjdns_eventloop_lag_ns".
+ */
+void Metrics_watchEventLoop(struct Metrics* metrics,
+                            struct EventBase* base,
+                            uint32_t intervalMilliseconds,
+                            struct Allocator* alloc);
+
+enum Metrics_Type
+{
+    Metrics_Type_COUNTER,
+    Metrics_Type_GAUGE,
+    Metrics_Type_HISTOGRAM
+};
+
+struct Metrics_Entry
+{
+    const char* name;
+    const char* help;
+    enum Metrics_Type type;
+
+    /** For counters and gauges. */
+    int64_t value;
+
+    /** For histograms. */
+    struct Metrics_Histogram* histogram;
+};
+
+/**
+ * Read the metric number n.
+ *
+ * @return 0 or -1 if there is no such metric.
+ */
+int Metrics_get(struct Metrics* metrics, int n, struct Metrics_Entry* out);
+
+/** Render all metrics in the prometheus text exposition format. */
+String* Metrics_prometheus(struct Metrics* metrics, struct Allocator* alloc);
+
+#endif
@@ -0,0 +1,187 @@
+/* vim: set expandtab ts=4 sw=4: */
+/*
+ * You may redistribute this program and/or modify it under the terms of
+ * the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "admin/Admin.h"
+#include "benc/Dict.h"
+#include "benc/List.h"
+#include "benc/String.h"
+#include "interface/addressable/AddrIface.h"
+#include "util/Identity.h"
+#include "util/Metrics.h"
+#include "util/Metrics_admin.h"
+#include "util/events/Pipe.h"
+#include "util/events/PipeServer.h"
+#include "wire/Message.h"
+
+#include <unistd.h>
+
+#define ENTRIES_PER_PAGE 16
+
+struct Context
+{
+    /** Receives scrape requests from the PipeServer. */
+    struct Iface iface;
+
+    struct Metrics* metrics;
+    struct EventBase* base;
+    struct Log* log;
+    struct Admin* admin;
+    struct Allocator* alloc;
+
+    /** Allocator of the PipeServer which is serving prometheus, NULL if there is none. */
+    struct Allocator* listenAlloc;
+
+    Identity
+};
+
+static const char* typeName(enum Metrics_Type type)
+{
+    switch (type) {
+        case Metrics_Type_COUNTER: return "counter";
+        case Metrics_Type_GAUGE: return "gauge";
+        case Metrics_Type_HISTOGRAM: return "histogram";
+    }
+    return "unknown";
+}
+
+static void dump(Dict* args, void* vcontext, String* txid, struct Allocator* requestAlloc)
+{
+    struct Context* ctx = Identity_check((struct Context*) vcontext);
+    int64_t* pageP = Dict_getIntC(args, "page");
+    int first = (pageP && *pageP > 0) ? *pageP * ENTRIES_PER_PAGE : 0;
+
+    List* list = List_new(requestAlloc);
+    struct Metrics_Entry e;
+    int end = first;
+    while (end < first + ENTRIES_PER_PAGE && !Metrics_get(ctx->metrics, end, &e)) { end++; }
+    // List_addDict() prepends so walk backward to list the metrics in the order of creation.
+    for (int i = end - 1; i >= first; i--) {
+        Metrics_get(ctx->metrics, i, &e);
+        Dict* d = Dict_new(requestAlloc);
+        Dict_putStringCC(d, "name", e.name, requestAlloc);
+        Dict_putStringCC(d, "type", typeName(e.type), requestAlloc);
+        if (e.type != Metrics_Type_HISTOGRAM) {
+            Dict_putIntC(d, "value", e.value, requestAlloc);
+            List_addDict(list, d, requestAlloc);
+            continue;
+        }
+        struct Metrics_Histogram* h = e.histogram;
+        Dict_putIntC(d, "count", h->count, requestAlloc);
+        Dict_putIntC(d, "sum", h->sum, requestAlloc);
+        Dict_putIntC(d, "max", h->max, requestAlloc);
+        Dict_putIntC(d, "p50", Metrics_Histogram_percentile(h, 500000), requestAlloc);
+        Dict_putIntC(d, "p90", Metrics_Histogram_percentile(h, 900000), requestAlloc);
+        Dict_putIntC(d, "p99", Metrics_Histogram_percentile(h, 990000), requestAlloc);
+        Dict_putIntC(d, "p999", Metrics_Histogram_percentile(h, 999000), requestAlloc);
+        List_addDict(list, d, requestAlloc);
+    }
+
+    Dict* out = Dict_new(requestAlloc);
+    Dict_putListC(out, "metrics", list, requestAlloc);
+    if (!Metrics_get(ctx->metrics, end, &e)) {
+        Dict_putIntC(out, "more", 1, requestAlloc);
+    }
+    Dict_putStringCC(out, "error", "none", requestAlloc);
+    Admin_sendMessage(out, txid, ctx->admin);
+}
+
+static bool endsWith(struct Message* msg, const char* end, int len)
+{
+    return msg->length >= len && !Bits_memcmp(&msg->bytes[msg->length - len], end, len);
+}
+
+/** Answer anything which ends like an HTTP request with the metrics. */
+static Iface_DEFUN scrape(struct Message* msg, struct Iface* iface)
+{
+    struct Context* ctx = Identity_containerOf(iface, struct Context, iface);
+    struct Sockaddr* addr = Er_assert(AddrIface_popAddr(msg));
+    if (!endsWith(msg, "\r\n\r\n", 4) && !endsWith(msg, "\n\n", 2)) { return NULL; }
+
+    String* body = Metrics_prometheus(ctx->metrics, msg->alloc);
+    String* head = String_printf(msg->alloc,
+        "HTTP/1.0 200 OK\r\n"
+        "Content-Type: text/plain; version=0.0.4\r\n"
+        "Content-Length: %lu\r\n"
+        "Connection: close\r\n"
+        "\r\n", (unsigned long) body->len);
+
+    struct Message* resp = Message_new(0, head->len + body->len + 64, msg->alloc);
+    Er_assert(Message_epush(resp, body->bytes, body->len));
+    Er_assert(Message_epush(resp, head->bytes, head->len));
+    Er_assert(AddrIface_pushAddr(resp, addr));
+    Iface_send(&ctx->iface, resp);
+    return NULL;
+}
+
+static void listenPipe(Dict* args, void* vcontext, String* txid, struct Allocator* requestAlloc)
+{
+    struct Context* ctx = Identity_check((struct Context*) vcontext);
+    String* path = Dict_getStringC(args, "path");
+
+    if (ctx->listenAlloc) {
+        Iface_unplumb(&ctx->iface, ctx->iface.connectedIf);
+        Allocator_free(ctx->listenAlloc);
+        ctx->listenAlloc = NULL;
+    }
+
+    char* error = "none";
+    if (path->len) {
+        struct Allocator* alloc = Allocator_child(ctx->alloc);
+        // A socket left behind by the last run, never remove anything which is not a socket.
+        struct Er_Ret* existsEr = NULL;
+        if (Er_check(&existsEr, Pipe_exists(path->bytes, requestAlloc)) && !existsEr) {
+            unlink(path->bytes);
+        }
+        struct Er_Ret* er = NULL;
+        struct PipeServer* ps =
+            Er_check(&er, PipeServer_named(path->bytes, ctx->base, ctx->log, alloc));
+        if (er) {
+            error = String_new(er->message, requestAlloc)->bytes;
+            Allocator_free(alloc);
+        } else {
+            Iface_plumb(&ctx->iface, &ps->iface.iface);
+            ctx->listenAlloc = alloc;
+        }
+    }
+
+    Dict* out = Dict_new(requestAlloc);
+    Dict_putStringCC(out, "error", error, requestAlloc);
+    Admin_sendMessage(out, txid, ctx->admin);
+}
+
+void Metrics_admin_register(struct Metrics* metrics,
+                            struct EventBase* base,
+                            struct Log* log,
+                            struct Admin* admin,
+                            struct Allocator* alloc)
+{
+    struct Context* ctx = Allocator_clone(alloc, (&(struct Context) {
+        .iface = { .send = scrape },
+        .metrics = metrics,
+        .base = base,
+        .log = log,
+        .admin = admin,
+        .alloc = alloc
+    }));
+    Identity_set(ctx);
+
+    Admin_registerFunction("Metrics_dump", dump, ctx, false,
+        ((struct Admin_FunctionArg[]) {
+            { .name = "page", .required = 0, .type = "Int" }
+        }), admin);
+    Admin_registerFunction("Metrics_listen", listenPipe, ctx, true,
+        ((struct Admin_FunctionArg[]) {
+            { .name = "path", .required = 1, .type = "String" }
+        }), admin);
+}
@@ -13,8 +13,8 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
-// sigaction() siginfo_t SIG_UNBLOCK
-#define _POSIX_C_SOURCE 199309L
+// sigaction() siginfo_t SIG_UNBLOCK syscall()
+#define _GNU_SOURCE
 
 #include "util/Seccomp.h"
 #include "util/Bits.h"
@@ -31,6 +31,9 @@
 #include <linux/audit.h>
 #include <linux/netlink.h>
 #include <sys/syscall.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <dirent.h>
 #include <sys/socket.h>
 #include <sys/ioctl.h>
 #include <stddef.h>
@@ -201,6 +204,7 @@ static Er_DEFUN(struct sock_fprog* mkFilter(struct Allocator* alloc))
     int socket = 5;
     int ioctl_setip = 6;
     int bind_netlink = 7;
+    int futex = 8;
 
     uint32_t auditArch = ArchInfo_getAuditArch();
 
@@ -278,6 +282,15 @@ static Er_DEFUN(struct sock_fprog* mkFilter(struct Allocator* alloc))
         // malloc()
         IFEQ(__NR_brk, success),
 
+        // AsyncFileLog, uv_mutex_t and uv_cond_t between the event loop and the writer thread
+        // and uv_thread_join() at shutdown, only the wait and wake operations are allowed.
+        #ifdef __NR_futex
+            IFEQ(__NR_futex, futex),
+        #endif
+        #ifdef __NR_futex_time64
+            IFEQ(__NR_futex_time64, futex),
+        #endif
+
         // abort()
         IFEQ(__NR_gettid, success),
         IFEQ(__NR_tgkill, success),
@@ -285,6 +298,8 @@ static Er_DEFUN(struct sock_fprog* mkFilter(struct Allocator* alloc))
 
         // exit()
         IFEQ(__NR_exit_group, success),
+        // exit of a single thread, the AsyncFileLog writer when its allocator is freed
+        IFEQ(__NR_exit, success),
 
         // Seccomp_isWorking()
         IFEQ(__NR_getpriority, isworking),
@@ -381,10 +396,24 @@ static Er_DEFUN(struct sock_fprog* mkFilter(struct Allocator* alloc))
         IFEQ(sizeof(struct sockaddr_nl), success),
         RET(SECCOMP_RET_TRAP),
 
+        // Private or not, with either clock, glibc and musl need no more than these.
+        LABEL(futex),
+        LOAD(offsetof(struct seccomp_data, args[1])),
+        STMT(BPF_ALU+BPF_AND+BPF_K, ~(uint32_t)(FUTEX_PRIVATE_FLAG | FUTEX_CLOCK_REALTIME)),
+        IFEQ(FUTEX_WAIT, success),
+        IFEQ(FUTEX_WAKE, success),
+        IFEQ(FUTEX_REQUEUE, success),
+        IFEQ(FUTEX_WAIT_BITSET, success),
+        IFEQ(FUTEX_WAKE_BITSET, success),
+        RET(SECCOMP_RET_TRAP),
+
         // We allow sigprocmask to *unmask* signals but we don't allow it to mask them.
+        // Except that glibc and musl block all signals in a thread which is exiting (the
+        // AsyncFileLog writer), SIGSYS from this filter is delivered even when it is blocked.
         LABEL(unmaskOnly),
         LOAD(offsetof(struct seccomp_data, args[0])),
         IFEQ(SIG_UNBLOCK, success),
+        IFEQ(SIG_BLOCK, success),
         RET(SECCOMP_RET_TRAP),
 
         LABEL(isworking),
@@ -400,6 +429,19 @@ static Er_DEFUN(struct sock_fprog* mkFilter(struct Allocator* alloc))
     Er_ret(compile(seccompFilter, sizeof(seccompFilter)/sizeof(seccompFilter[0]), alloc));
 }
 
+/** The number of threads in this process, or -1 if there is no /proc to count them. */
+static int threadCount(void)
+{
+    DIR* dir = opendir("/proc/self/task");
+    if (!dir) { return -1; }
+    int count = 0;
+    for (struct dirent* ent = readdir(dir); ent; ent = readdir(dir)) {
+        if (ent->d_name[0] != '.') { count++; }
+    }
+    closedir(dir);
+    return count;
+}
+
 static Er_DEFUN(void installFilter(
     struct sock_fprog* filter, struct Log* logger, struct Allocator* alloc))
 {
@@ -412,6 +454,25 @@ static Er_DEFUN(void installFilter(
         // don't worry about it.
         Log_warn(logger, "prctl(PR_SET_NO_NEW_PRIVS) -> [%s]\n", strerror(errno));
     }
+
+    // prctl(PR_SET_SECCOMP) only filters this thread, if others are running already
+    // (the AsyncFileLog writer) they have to be filtered too which takes TSYNC.
+    int threads = threadCount();
+    if (threads != 1) {
+        #if defined(__NR_seccomp) && defined(SECCOMP_FILTER_FLAG_TSYNC)
+            if (syscall(__NR_seccomp, SECCOMP_SET_MODE_FILTER, SECCOMP_FILTER_FLAG_TSYNC, filter)) {
+                Er_raise(alloc, "seccomp(SECCOMP_SET_MODE_FILTER, TSYNC) -> [%s]\n",
+                    strerror(errno));
+            }
+            Er_ret();
+        #else
+            if (threads > 1) {
+                Er_raise(alloc, "[%d] threads are running and seccomp(SECCOMP_FILTER_FLAG_TSYNC) "
+                    "is not supported by this build\n", threads);
+            }
+            Log_warn(logger, "Unable to count threads, only the calling thread is filtered\n");
+        #endif
+    }
     if (prctl(PR_SET_SECCOMP, SECCOMP_MODE_FILTER, filter) == -1) {
         Er_raise(alloc, "prctl(PR_SET_SECCOMP) -> [%s]\n", strerror(errno));
     }
@@ -72,15 +72,20 @@ struct Set_pvt
 
 static int compare(const struct Entry* a, const struct Entry* b)
 {
-    if (a->hashCode != b->hashCode) { return a->hashCode - b->hashCode; }
+    if (a->hashCode != b->hashCode) {
+        return (a->hashCode < b->hashCode) ? -1 : 1;
+    }
     struct Set_pvt* set = Identity_check((struct Set_pvt*) a->set);
     return set->compare(a->data, b->data);
 }
 RB_GENERATE_STATIC(ActiveTree, Entry, tree, compare)
 
+// Free entries are ordered by address, entries in the same block share a hashCode and
+// RB_INSERT() silently drops an entry which compares equal to one already in the tree.
 static int freeCompare(const struct Entry* a, const struct Entry* b)
 {
-    return a->hashCode - b->hashCode;
+    if (a == b) { return 0; }
+    return ((uintptr_t) a < (uintptr_t) b) ? -1 : 1;
 }
 RB_GENERATE_STATIC(FreeTree, Entry, tree, freeCompare)
 
@@ -19,9 +19,12 @@
 #include "util/Linker.h"
 Linker_require("util/events/libuv/EventBase.c");
 
+#include <stdint.h>
+
 struct EventBase
 {
-    int unused;
+    /** Non-zero while callbacks are being traced, see EventBase_traceStart(). */
+    int tracing;
 };
 
 struct EventBase* EventBase_new(struct Allocator* alloc);
@@ -32,4 +35,65 @@ void EventBase_beginLoop(struct EventBase* eventBase);
 
 void EventBase_endLoop(struct EventBase* eventBase);
 
+/**
+ * Tracing records how long each callback from the event loop took, so that a stall can be
+ * attributed to the timeout, socket or admin function which caused it. When tracing is off
+ * the cost is one branch per callback.
+ */
+struct EventBase_TraceEvent
+{
+    /** What kind of callback, eg: "timeout", "udp", "admin". */
+    const char* category;
+
+    /** Name of the callback, eg: the file which set the timeout or the admin function. */
+    const char* name;
+
+    /** Line of the file which set the timeout, 0 if not applicable. */
+    uint32_t line;
+
+    uint32_t durationNs;
+    uint64_t startNs;
+};
+
+/**
+ * Begin tracing, anything recorded by an earlier trace is discarded.
+ *
+ * @param capacity the number of callbacks to keep, older ones are overwritten.
+ * @param minNanoseconds callbacks which take less time than this are not recorded.
+ */
+void EventBase_traceStart(struct EventBase* eventBase, uint32_t capacity, uint32_t minNanoseconds);
+
+/** Stop tracing, what has been recorded is kept for EventBase_traceGet(). */
+void EventBase_traceStop(struct EventBase* eventBase);
+
+/**
+ * Get a recorded callback, number 0 is the oldest.
+ *
+ * @return 0 or -1 if there is no such callback.
+ */
+int EventBase_traceGet(struct EventBase* eventBase, uint32_t n, struct EventBase_TraceEvent* out);
+
+uint64_t EventBase__traceNow(void);
+void EventBase__traceRecord(struct EventBase* eventBase,
+                            const char* category,
+                            const char* name,
+                            uint32_t line,
+                            uint64_t begin);
+
+/** Call before a callback, returns 0 without looking at the clock if tracing is off. */
+static inline uint64_t EventBase_traceBegin(struct EventBase* eventBase)
+{
+    return (eventBase->tracing) ? EventBase__traceNow() : 0;
+}
+
+/** Call after a callback with the value returned by EventBase_traceBegin(). */
+static inline void EventBase_traceEnd(struct EventBase* eventBase,
+                                      const char* category,
+                                      const char* name,
+                                      uint32_t line,
+                                      uint64_t begin)
+{
+    if (begin) { EventBase__traceRecord(eventBase, category, name, line, begin); }
+}
+
 #endif
@@ -0,0 +1,133 @@
+/* vim: set expandtab ts=4 sw=4: */
+/*
+ * You may redistribute this program and/or modify it under the terms of
+ * the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "admin/Admin.h"
+#include "benc/Dict.h"
+#include "benc/String.h"
+#include "util/events/EventBase.h"
+#include "util/events/EventBase_admin.h"
+#include "util/Identity.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#define DEFAULT_CAPACITY 65536
+
+// Names are cut to 64 characters so a page is sure to fit in Admin_MAX_RESPONSE_SIZE.
+#define EVENTS_PER_PAGE 200
+#define MAX_EVENT_LEN 256
+
+struct Context
+{
+    struct EventBase* base;
+    struct Admin* admin;
+    Identity
+};
+
+static void traceStart(Dict* args, void* vcontext, String* txid, struct Allocator* requestAlloc)
+{
+    struct Context* ctx = Identity_check((struct Context*) vcontext);
+    int64_t* capacity = Dict_getIntC(args, "capacity");
+    int64_t* minMicroseconds = Dict_getIntC(args, "minMicroseconds");
+    uint32_t cap = (capacity && *capacity > 0 && *capacity < UINT32_MAX)
+        ? *capacity : DEFAULT_CAPACITY;
+    uint32_t minNs = (minMicroseconds && *minMicroseconds > 0 && *minMicroseconds < 4000000)
+        ? *minMicroseconds * 1000 : 0;
+    EventBase_traceStart(ctx->base, cap, minNs);
+
+    Dict* out = Dict_new(requestAlloc);
+    Dict_putStringCC(out, "error", "none", requestAlloc);
+    Admin_sendMessage(out, txid, ctx->admin);
+}
+
+static void traceStop(Dict* args, void* vcontext, String* txid, struct Allocator* requestAlloc)
+{
+    struct Context* ctx = Identity_check((struct Context*) vcontext);
+    EventBase_traceStop(ctx->base);
+
+    Dict* out = Dict_new(requestAlloc);
+    Dict_putStringCC(out, "error", "none", requestAlloc);
+    Admin_sendMessage(out, txid, ctx->admin);
+}
+
+/** Names are file names and admin function names but escape them anyway. */
+static void jsonName(char* out, const char* name)
+{
+    int i = 0;
+    for (; name && *name && i < 64; name++) {
+        out[i++] = (*name == '"' || *name == '\\' || *name < ' ') ? '_' : *name;
+    }
+    out[i] = '\0';
+}
+
+/**
+ * Each page is a piece of one JSON document in the Chrome trace event format,
+ * the pages must be concatenated to make the document.
+ */
+static void traceDump(Dict* args, void* vcontext, String* txid, struct Allocator* requestAlloc)
+{
+    struct Context* ctx = Identity_check((struct Context*) vcontext);
+    int64_t* pageP = Dict_getIntC(args, "page");
+    uint32_t page = (pageP && *pageP > 0) ? *pageP : 0;
+    uint32_t first = page * EVENTS_PER_PAGE;
+
+    char* buf = Allocator_malloc(requestAlloc, EVENTS_PER_PAGE * MAX_EVENT_LEN + 64);
+    int len = 0;
+    if (!page) { len += snprintf(buf, 64, "{\"traceEvents\":["); }
+
+    struct EventBase_TraceEvent ev;
+    uint32_t n = first;
+    for (; n < first + EVENTS_PER_PAGE && !EventBase_traceGet(ctx->base, n, &ev); n++) {
+        char name[65];
+        jsonName(name, ev.name);
+        char line[16] = "";
+        if (ev.line) { snprintf(line, 16, ":%u", ev.line); }
+        len += snprintf(&buf[len], MAX_EVENT_LEN,
+            "%s{\"name\":\"%s%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%" PRIu64 ".%03u,"
+            "\"dur\":%u.%03u,\"pid\":1,\"tid\":1}",
+            (n) ? "," : "", name, line, ev.category,
+            ev.startNs / 1000, (uint32_t) (ev.startNs % 1000),
+            ev.durationNs / 1000, ev.durationNs % 1000);
+    }
+    int more = !EventBase_traceGet(ctx->base, n, &ev);
+    if (!more) { len += snprintf(&buf[len], 64, "]}"); }
+
+    Dict* out = Dict_new(requestAlloc);
+    Dict_putStringC(out, "json", String_newBinary(buf, len, requestAlloc), requestAlloc);
+    if (more) { Dict_putIntC(out, "more", 1, requestAlloc); }
+    Dict_putStringCC(out, "error", "none", requestAlloc);
+    Admin_sendMessage(out, txid, ctx->admin);
+}
+
+void EventBase_admin_register(struct EventBase* base,
+                              struct Admin* admin,
+                              struct Allocator* alloc)
+{
+    struct Context* ctx = Allocator_clone(alloc, (&(struct Context) {
+        .base = base,
+        .admin = admin
+    }));
+    Identity_set(ctx);
+
+    Admin_registerFunction("EventBase_traceStart", traceStart, ctx, true,
+        ((struct Admin_FunctionArg[]) {
+            { .name = "capacity", .required = 0, .type = "Int" },
+            { .name = "minMicroseconds", .required = 0, .type = "Int" }
+        }), admin);
+    Admin_registerFunction("EventBase_traceStop", traceStop, ctx, true, NULL, admin);
+    Admin_registerFunction("EventBase_traceDump", traceDump, ctx, true,
+        ((struct Admin_FunctionArg[]) {
+            { .name = "page", .required = 0, .type = "Int" }
+        }), admin);
+}
@@ -39,11 +39,26 @@ struct Pipe
 
     Pipe_callback onConnection;
     Pipe_callback onClose;
+
+    /**
+     * Called with status 1 when more than highWater bytes are waiting to be written and with
+     * status 0 once no more than lowWater are, the sender should hold off in between.
+     * Messages which would cause more than Pipe_QUEUE_MAX bytes to be waiting are dropped.
+     */
+    Pipe_callback onBackPressure;
+    uint32_t highWater;
+    uint32_t lowWater;
 };
 
 #define Pipe_PADDING_AMOUNT 512
 #define Pipe_BUFFER_CAP 4000
 
+/** Defaults for highWater and lowWater. */
+#define Pipe_HIGH_WATER 65536
+#define Pipe_LOW_WATER 16384
+
+#define Pipe_QUEUE_MAX (1<<18)
+
 #ifdef win32
     #define Pipe_PATH_SEP "\\"
 #else
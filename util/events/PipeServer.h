@@ -16,7 +16,7 @@
 #define PipeServer_H
 
 #include "memory/Allocator.h"
-#include "exception/Except.h"
+#include "exception/Er.h"
 #include "interface/addressable/AddrIface.h"
 #include "util/events/EventBase.h"
 #include "util/Linker.h"
@@ -40,10 +40,9 @@ struct PipeServer
     PipeServer_callback onDisconnection;
 };
 
-struct PipeServer* PipeServer_named(const char* fullPath,
-                                    struct EventBase* eb,
-                                    struct Except* eh,
-                                    struct Log* log,
-                                    struct Allocator* userAlloc);
+Er_DEFUN(struct PipeServer* PipeServer_named(const char* fullPath,
+                                             struct EventBase* eb,
+                                             struct Log* log,
+                                             struct Allocator* userAlloc));
 
 #endif
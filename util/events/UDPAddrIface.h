@@ -35,6 +35,9 @@ Linker_require("util/events/libuv/UDPAddrIface.c");
 struct UDPAddrIface
 {
     struct AddrIface generic;
+
+    /** Bytes which are waiting to be written to the socket. */
+    int queueBytes;
 };
 
 /**
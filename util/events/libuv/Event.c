@@ -37,7 +37,10 @@ static void handleEvent(uv_poll_t* handle, int status, int events)
         Identity_check((struct Event_pvt*) (((char*)handle) - offsetof(struct Event_pvt, handler)));
 
     if ((status == 0) && (events & UV_READABLE)) {
+        struct EventBase* base = EventBase_forLoop(handle->loop);
+        uint64_t begin = EventBase_traceBegin(base);
         event->callback(event->callbackContext);
+        EventBase_traceEnd(base, "event", "Event_socketRead", 0, begin);
     }
 }
 
@@ -64,6 +64,7 @@ struct EventBase* EventBase_new(struct Allocator* allocator)
     struct Allocator* alloc = Allocator_child(allocator);
     struct EventBase_pvt* base = Allocator_calloc(alloc, sizeof(struct EventBase_pvt), 1);
     base->loop = uv_loop_new();
+    base->loop->data = base;
     base->alloc = alloc;
     Identity_set(base);
 
@@ -113,6 +114,68 @@ int EventBase_eventCount(struct EventBase* eventBase)
     return eventCount;
 }
 
+#define MAX_TRACE_CAPACITY (1 << 20)
+
+void EventBase_traceStart(struct EventBase* eventBase, uint32_t capacity, uint32_t minNanoseconds)
+{
+    struct EventBase_pvt* ctx = Identity_check((struct EventBase_pvt*) eventBase);
+    if (ctx->trace) {
+        Allocator_free(ctx->trace->alloc);
+        ctx->trace = NULL;
+    }
+    if (capacity > MAX_TRACE_CAPACITY) { capacity = MAX_TRACE_CAPACITY; }
+    if (!capacity) { capacity = 1; }
+    struct Allocator* alloc = Allocator_child(ctx->alloc);
+    struct EventBase_Trace* trace = Allocator_calloc(alloc,
+        sizeof(struct EventBase_Trace) + capacity * sizeof(struct EventBase_TraceEvent), 1);
+    trace->alloc = alloc;
+    trace->capacity = capacity;
+    trace->minNanoseconds = minNanoseconds;
+    ctx->trace = trace;
+    ctx->pub.tracing = 1;
+}
+
+void EventBase_traceStop(struct EventBase* eventBase)
+{
+    struct EventBase_pvt* ctx = Identity_check((struct EventBase_pvt*) eventBase);
+    ctx->pub.tracing = 0;
+}
+
+int EventBase_traceGet(struct EventBase* eventBase, uint32_t n, struct EventBase_TraceEvent* out)
+{
+    struct EventBase_pvt* ctx = Identity_check((struct EventBase_pvt*) eventBase);
+    struct EventBase_Trace* trace = ctx->trace;
+    if (!trace) { return -1; }
+    uint64_t first = (trace->count > trace->capacity) ? trace->count - trace->capacity : 0;
+    if (first + n >= trace->count) { return -1; }
+    *out = trace->events[(first + n) % trace->capacity];
+    return 0;
+}
+
+uint64_t EventBase__traceNow(void)
+{
+    return uv_hrtime();
+}
+
+void EventBase__traceRecord(struct EventBase* eventBase,
+                            const char* category,
+                            const char* name,
+                            uint32_t line,
+                            uint64_t begin)
+{
+    struct EventBase_pvt* ctx = Identity_check((struct EventBase_pvt*) eventBase);
+    struct EventBase_Trace* trace = ctx->trace;
+    if (!ctx->pub.tracing || !trace) { return; }
+    uint64_t duration = uv_hrtime() - begin;
+    if (duration < trace->minNanoseconds) { return; }
+    struct EventBase_TraceEvent* ev = &trace->events[trace->count++ % trace->capacity];
+    ev->category = category;
+    ev->name = name;
+    ev->line = line;
+    ev->durationNs = (duration > UINT32_MAX) ? UINT32_MAX : duration;
+    ev->startNs = begin;
+}
+
 struct EventBase_pvt* EventBase_privatize(struct EventBase* base)
 {
     return Identity_check((struct EventBase_pvt*) base);
@@ -21,6 +21,18 @@
 
 #include <uv.h>
 
+struct EventBase_Trace
+{
+    struct Allocator* alloc;
+    uint32_t capacity;
+    uint32_t minNanoseconds;
+
+    /** Number of callbacks ever recorded, the next one goes in events[count % capacity]. */
+    uint64_t count;
+
+    struct EventBase_TraceEvent events[];
+};
+
 struct EventBase_pvt
 {
     struct EventBase pub;
@@ -43,9 +55,18 @@ struct EventBase_pvt
 
     void* timeouts;
 
+    /** The callbacks recorded by EventBase_traceStart(), NULL if never started. */
+    struct EventBase_Trace* trace;
+
     Identity
 };
 
 struct EventBase_pvt* EventBase_privatize(struct EventBase* base);
 
+/** Get the EventBase from inside of a libuv callback. */
+static inline struct EventBase* EventBase_forLoop(uv_loop_t* loop)
+{
+    return (struct EventBase*) loop->data;
+}
+
 #endif
@@ -31,6 +31,21 @@
 #include <sys/stat.h>
 #include <string.h>
 
+/** A message waiting to be written, queued messages are written together in one uv_write(). */
+struct Pipe_Queued
+{
+    uint8_t* bytes;
+    uint32_t length;
+
+    /** The file descriptor to send along with the content or -1 if none. */
+    int fd;
+
+    /** The allocator of the message which was adopted, NULL if the content was copied. */
+    struct Allocator* owner;
+
+    struct Pipe_Queued* next;
+};
+
 struct Pipe_WriteRequest_pvt;
 
 struct Pipe_pvt
@@ -51,13 +66,28 @@ struct Pipe_pvt
     /** 1 when the pipe becomes active. */
     int isActive;
 
-    int queueLen;
+    /** Number of bytes queued or being written. */
+    uint32_t queueLen;
+
+    /** True after onBackPressure has been called with 1 and until it is called with 0. */
+    bool backPressure;
 
     /** Used by blockFreeInsideCallback */
     int isInCallback;
 
-    /** only non-null before the connection is setup. */
-    struct Pipe_WriteRequest_pvt* bufferedRequest;
+    /**
+     * Messages which have not yet been handed to libuv, including everything sent before the
+     * connection is setup. All of them are held by queueAlloc.
+     */
+    struct Pipe_Queued* queue;
+    struct Pipe_Queued** queueTail;
+    struct Allocator* queueAlloc;
+
+    /** The last allocator adopted by queueAlloc, senders often send many messages from one. */
+    struct Allocator* queueOwner;
+
+    /** The write which libuv is working on, only one at a time so that the others pile up. */
+    struct Pipe_WriteRequest_pvt* writing;
 
     struct Allocator* alloc;
 
@@ -69,106 +99,159 @@ struct Pipe_pvt
 struct Pipe_WriteRequest_pvt {
     uv_write_t uvReq;
     struct Pipe_pvt* pipe;
-    struct Message* msg;
+    uint32_t length;
     struct Allocator* alloc;
     Identity
 };
 
+static void enqueue(struct Pipe_pvt* pipe,
+                    uint8_t* bytes,
+                    uint32_t length,
+                    int fd,
+                    struct Allocator* owner)
+{
+    if (!pipe->queueAlloc) {
+        pipe->queueAlloc = Allocator_child(pipe->alloc);
+    }
+    if (owner && owner != pipe->queueOwner) {
+        // This will hold the message allocator in existance after it is freed.
+        Allocator_adopt(pipe->queueAlloc, owner);
+        pipe->queueOwner = owner;
+    } else if (!owner) {
+        uint8_t* copy = Allocator_malloc(pipe->queueAlloc, length);
+        Bits_memcpy(copy, bytes, length);
+        bytes = copy;
+    }
+    struct Pipe_Queued* q = Allocator_calloc(pipe->queueAlloc, sizeof(struct Pipe_Queued), 1);
+    q->bytes = bytes;
+    q->length = length;
+    q->fd = fd;
+    q->owner = owner;
+    *pipe->queueTail = q;
+    pipe->queueTail = &q->next;
+}
+
+static void checkBackPressure(struct Pipe_pvt* pipe)
+{
+    if (uv_is_closing((uv_handle_t*) &pipe->peer)) { return; }
+    int pressure;
+    if (!pipe->backPressure && pipe->queueLen > pipe->pub.highWater) {
+        pressure = 1;
+    } else if (pipe->backPressure && pipe->queueLen <= pipe->pub.lowWater) {
+        pressure = 0;
+    } else {
+        return;
+    }
+    pipe->backPressure = pressure;
+    if (pipe->pub.onBackPressure) {
+        pipe->pub.onBackPressure(&pipe->pub, pressure);
+    }
+}
+
+static void flush(struct Pipe_pvt* pipe);
+
 static void sendMessageCallback(uv_write_t* uvReq, int error)
 {
     struct Pipe_WriteRequest_pvt* req = Identity_check((struct Pipe_WriteRequest_pvt*) uvReq);
+    struct Pipe_pvt* pipe = req->pipe;
     if (error) {
-        Log_info(req->pipe->log, "Failed to write to pipe [%s] [%s]",
-                 req->pipe->pub.fullName, uv_strerror(error) );
+        Log_info(pipe->log, "Failed to write to pipe [%s] [%s]",
+                 pipe->pub.fullName, uv_strerror(error) );
     }
-    req->pipe->queueLen -= req->msg->length;
-    Assert_ifParanoid(req->pipe->queueLen >= 0);
+    Assert_true(pipe->writing == req && pipe->queueLen >= req->length);
+    pipe->queueLen -= req->length;
+    pipe->writing = NULL;
     Allocator_free(req->alloc);
+    if (!uv_is_closing((uv_handle_t*) &pipe->peer)) {
+        flush(pipe);
+    }
+    checkBackPressure(pipe);
 }
 
-static void sendMessage2(struct Pipe_WriteRequest_pvt* req)
+/**
+ * Write everything which is queued in one uv_write().
+ * A message carrying a file descriptor is written by itself because the descriptor goes with
+ * the first byte of the write.
+ */
+static void flush(struct Pipe_pvt* pipe)
 {
-    struct Pipe_pvt* pipe = req->pipe;
-    struct Message* m = req->msg;
+    if (!pipe->isActive || pipe->writing || !pipe->queue) { return; }
+
+    struct Pipe_Queued* first = pipe->queue;
+    bool withFd = pipe->ipc && first->fd != -1;
+    struct Pipe_Queued* rest = first->next;
+    int count = 1;
+    if (!withFd) {
+        for (; rest && !(pipe->ipc && rest->fd != -1); rest = rest->next) { count++; }
+    }
+
+    struct Allocator* alloc = pipe->queueAlloc;
+    struct Pipe_WriteRequest_pvt* req =
+        Allocator_calloc(alloc, sizeof(struct Pipe_WriteRequest_pvt), 1);
+    req->pipe = pipe;
+    req->alloc = alloc;
+    Identity_set(req);
 
-    uv_buf_t buffers[] = {
-        { .base = (char*)m->bytes, .len = m->length }
-    };
+    uv_buf_t* buffers = Allocator_malloc(alloc, sizeof(uv_buf_t) * count);
+    struct Pipe_Queued* q = first;
+    for (int i = 0; i < count; i++, q = q->next) {
+        buffers[i] = uv_buf_init((char*)q->bytes, q->length);
+        req->length += q->length;
+    }
+
+    // Anything after a message with a file descriptor is moved to a new queue.
+    pipe->queue = NULL;
+    pipe->queueTail = &pipe->queue;
+    pipe->queueAlloc = NULL;
+    pipe->queueOwner = NULL;
+    for (; rest; rest = rest->next) {
+        enqueue(pipe, rest->bytes, rest->length, rest->fd, rest->owner);
+    }
 
     int ret = -1;
-    if (pipe->ipc && m->associatedFd) {
-        int fd = Message_getAssociatedFd(m);
-        uv_stream_t* fake_handle = Allocator_calloc(req->alloc, sizeof(uv_stream_t), 1);
+    if (withFd) {
+        int fd = first->fd;
+        uv_stream_t* fake_handle = Allocator_calloc(alloc, sizeof(uv_stream_t), 1);
         fake_handle->io_watcher.fd = fd;
         fake_handle->type = UV_TCP;
         ret = uv_write2(
             &req->uvReq,
             (uv_stream_t*) &pipe->peer,
             buffers,
-            1,
+            count,
             fake_handle,
             sendMessageCallback);
         Log_debug(pipe->log, "Sending message with fd [%d]", fd);
     } else {
-        ret = uv_write(&req->uvReq, (uv_stream_t*) &pipe->peer, buffers, 1, sendMessageCallback);
+        ret = uv_write(&req->uvReq, (uv_stream_t*) &pipe->peer, buffers, count,
+                       sendMessageCallback);
     }
     if (ret) {
         Log_info(pipe->log, "Failed writing to pipe [%s] [%s]",
                  pipe->pub.fullName, uv_strerror(ret) );
-        Allocator_free(req->alloc);
+        pipe->queueLen -= req->length;
+        Allocator_free(alloc);
         return;
     }
-    pipe->queueLen += m->length;
-
-    return;
+    pipe->writing = req;
 }
 
 static Iface_DEFUN sendMessage(struct Message* m, struct Iface* iface)
 {
     struct Pipe_pvt* pipe = Identity_check((struct Pipe_pvt*) iface);
 
-    if (pipe->queueLen > 50000) {
-        return 0;
-    }
-
-    // This allocator will hold the message allocator in existance after it is freed.
-    struct Allocator* reqAlloc = Allocator_child(pipe->alloc);
-    if (m->alloc) {
-        Allocator_adopt(reqAlloc, m->alloc);
-    } else {
-        m = Message_clone(m, reqAlloc);
+    if (pipe->queueLen + m->length > Pipe_QUEUE_MAX) {
+        Log_debug(pipe->log, "Dropping message to pipe [%s], [%u] bytes already queued",
+                  pipe->pub.fullName, pipe->queueLen);
+        return NULL;
     }
 
-    struct Pipe_WriteRequest_pvt* req =
-        Allocator_clone(reqAlloc, (&(struct Pipe_WriteRequest_pvt) {
-            .pipe = pipe,
-            .msg = m,
-            .alloc = reqAlloc
-        }));
-    Identity_set(req);
+    enqueue(pipe, m->bytes, m->length, Message_getAssociatedFd(m), m->alloc);
+    pipe->queueLen += m->length;
 
-    if (pipe->isActive) {
-        sendMessage2(req);
-    } else {
-        if (!pipe->bufferedRequest) {
-            Log_debug(pipe->log, "Buffering a message");
-            pipe->bufferedRequest = req;
-        } else {
-            Log_debug(pipe->log, "Appending to the buffered message");
-            uint8_t* buff =
-                Allocator_malloc(reqAlloc, m->length + pipe->bufferedRequest->msg->length);
-            Bits_memcpy(buff,
-                        pipe->bufferedRequest->msg->bytes,
-                        pipe->bufferedRequest->msg->length);
-            Bits_memcpy(buff+pipe->bufferedRequest->msg->length, m->bytes, m->length);
-            m->length += pipe->bufferedRequest->msg->length;
-            m->capacity = m->length;
-            m->bytes = buff;
-
-            Allocator_free(pipe->bufferedRequest->alloc);
-            pipe->bufferedRequest = req;
-        }
-    }
+    // If a write is underway, this message will go out with the others once it completes.
+    flush(pipe);
+    checkBackPressure(pipe);
     return NULL;
 }
 
@@ -219,7 +302,10 @@ static void incoming(uv_stream_t* stream, ssize_t nread, const uv_buf_t* buf)
                 Message_setAssociatedFd(m, stream->accepted_fd);
             #endif
         }
+        struct EventBase* base = EventBase_forLoop(stream->loop);
+        uint64_t begin = EventBase_traceBegin(base);
         Iface_send(&pipe->pub.iface, m);
+        EventBase_traceEnd(base, "pipe", "Pipe", 0, begin);
     }
 
     if (alloc) {
@@ -286,12 +372,8 @@ static void connected(uv_connect_t* req, int status)
             pipe->pub.onConnection(&pipe->pub, status);
         }
 
-        // If there's anything buffered then send it.
-        if (pipe->bufferedRequest) {
-            Log_debug(pipe->log, "Sending buffered message");
-            sendMessage2(pipe->bufferedRequest);
-            pipe->bufferedRequest = NULL;
-        }
+        // If anything was sent before the connection was setup then write it all at once.
+        flush(pipe);
     }
 }
 
@@ -331,6 +413,8 @@ static Er_DEFUN(struct Pipe_pvt* newPipeAny(struct EventBase* eb,
                 .send = sendMessage
             },
             .fullName = (fullPath) ? CString_strdup(fullPath, alloc) : NULL,
+            .highWater = Pipe_HIGH_WATER,
+            .lowWater = Pipe_LOW_WATER,
         },
         .alloc = alloc,
         .log = log,
@@ -346,6 +430,7 @@ static Er_DEFUN(struct Pipe_pvt* newPipeAny(struct EventBase* eb,
     Allocator_onFree(alloc, blockFreeInsideCallback, out);
 
     out->peer.data = out;
+    out->queueTail = &out->queue;
     Identity_set(out);
 
     Er_ret(out);
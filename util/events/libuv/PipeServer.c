@@ -189,11 +189,10 @@ static int closeHandlesOnFree(struct Allocator_OnFreeJob* job)
     return 0;
 }
 
-static struct PipeServer_pvt* newPipeAny(struct EventBase* eb,
-                                  const char* fullPath,
-                                  struct Except* eh,
-                                  struct Log* log,
-                                  struct Allocator* userAlloc)
+static Er_DEFUN(struct PipeServer_pvt* newPipeAny(struct EventBase* eb,
+                                                  const char* fullPath,
+                                                  struct Log* log,
+                                                  struct Allocator* userAlloc))
 {
     struct EventBase_pvt* ctx = EventBase_privatize(eb);
     struct Allocator* alloc = Allocator_child(userAlloc);
@@ -218,7 +217,7 @@ static struct PipeServer_pvt* newPipeAny(struct EventBase* eb,
 
     int ret = uv_pipe_init(ctx->loop, &psp->server, 0);
     if (ret) {
-        Except_throw(eh, "uv_pipe_init() failed [%s]", uv_strerror(ret));
+        Er_raise(alloc, "uv_pipe_init() failed [%s]", uv_strerror(ret));
     }
 
     Allocator_onFree(alloc, closeHandlesOnFree, psp);
@@ -227,26 +226,25 @@ static struct PipeServer_pvt* newPipeAny(struct EventBase* eb,
     //out->out = &out->peer;
     Identity_set(psp);
 
-    return psp;
+    Er_ret(psp);
 }
 
-struct PipeServer* PipeServer_named(const char* fullPath,
-                                    struct EventBase* eb,
-                                    struct Except* eh,
-                                    struct Log* log,
-                                    struct Allocator* userAlloc)
+Er_DEFUN(struct PipeServer* PipeServer_named(const char* fullPath,
+                                             struct EventBase* eb,
+                                             struct Log* log,
+                                             struct Allocator* userAlloc))
 {
-    struct PipeServer_pvt* out = newPipeAny(eb, fullPath, eh, log, userAlloc);
+    struct PipeServer_pvt* out = Er(newPipeAny(eb, fullPath, log, userAlloc));
 
     int ret = uv_pipe_bind(&out->server, out->pub.fullName);
     if (ret) {
-        Except_throw(eh, "uv_pipe_bind() failed [%s] for pipe [%s]",
+        Er_raise(out->alloc, "uv_pipe_bind() failed [%s] for pipe [%s]",
             uv_strerror(ret), out->pub.fullName);
     }
     ret = uv_listen((uv_stream_t*) &out->server, 1, listenCallback);
     if (ret) {
-        Except_throw(eh, "uv_listen() failed [%s] for pipe [%s]",
-                        uv_strerror(ret), out->pub.fullName);
+        Er_raise(out->alloc, "uv_listen() failed [%s] for pipe [%s]",
+                 uv_strerror(ret), out->pub.fullName);
     }
-    return &out->pub;
+    Er_ret(&out->pub);
 }
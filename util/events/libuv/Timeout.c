@@ -37,6 +37,10 @@ struct Timeout
     struct Timeout** selfPtr;
     struct EventBase_pvt* base;
 
+    /** Where the timeout was set, for tracing. */
+    char* file;
+    int line;
+
     Identity
 };
 
@@ -75,7 +79,13 @@ static void handleEvent(uv_timer_t* handle, int status)
     if (!timeout->isInterval) {
         Timeout_clearTimeout(timeout);
     }
+    // The callback might free the timeout.
+    struct EventBase* base = &timeout->base->pub;
+    char* file = timeout->file;
+    int line = timeout->line;
+    uint64_t begin = EventBase_traceBegin(base);
     timeout->callback(timeout->callbackContext);
+    EventBase_traceEnd(base, "timeout", file, line, begin);
 }
 
 static void onFree2(uv_handle_t* timer)
@@ -124,6 +134,8 @@ static struct Timeout* setTimeout(void (* const callback)(void* callbackContext)
     timeout->alloc = alloc;
     timeout->isInterval = interval;
     timeout->base = base;
+    timeout->file = file;
+    timeout->line = line;
     Identity_set(timeout);
 
     uv_timer_init(base->loop, &timeout->timer);
@@ -40,7 +40,6 @@ struct UDPAddrIface_pvt
     struct Allocator_OnFreeJob* blockFreeInsideCallback;
 
     uv_udp_t uvHandle;
-    int queueLen;
 
     /** true if we are inside of the callback, used by blockFreeInsideCallback */
     int inCallback;
@@ -72,8 +71,8 @@ static void sendComplete(uv_udp_send_t* uvReq, int error)
                   uv_strerror(error) );
     }
     Assert_true(req->msg->length == req->length);
-    req->udp->queueLen -= req->msg->length;
-    Assert_true(req->udp->queueLen >= 0);
+    req->udp->pub.queueBytes -= req->msg->length;
+    Assert_true(req->udp->pub.queueBytes >= 0);
     Allocator_free(req->alloc);
 }
 
@@ -89,7 +88,7 @@ static Iface_DEFUN incomingFromIface(struct Message* m, struct Iface* iface)
         return NULL;
     }
 
-    if (context->queueLen > UDPAddrIface_MAX_QUEUE) {
+    if (context->pub.queueBytes > UDPAddrIface_MAX_QUEUE) {
         Log_warn(context->logger, "DROP Maximum queue length reached");
         return NULL;
     }
@@ -129,7 +128,7 @@ static Iface_DEFUN incomingFromIface(struct Message* m, struct Iface* iface)
         Allocator_free(req->alloc);
         return NULL;
     }
-    context->queueLen += m->length;
+    context->pub.queueBytes += m->length;
 
     return NULL;
 }
@@ -176,7 +175,10 @@ static void incoming(uv_udp_t* handle,
         Assert_true(Hex_encode(buff, 255, m->bytes, context->pub.generic.addr->addrLen));
         Log_debug(context->logger, "Message from [%s]", buff);*/
 
+        struct EventBase* base = EventBase_forLoop(handle->loop);
+        uint64_t begin = EventBase_traceBegin(base);
         Iface_send(&context->pub.generic.iface, m);
+        EventBase_traceEnd(base, "udp", "UDPAddrIface", 0, begin);
     }
 
     if (alloc) {
@@ -0,0 +1,195 @@
+/* vim: set expandtab ts=4 sw=4: */
+/*
+ * You may redistribute this program and/or modify it under the terms of
+ * the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "util/events/libuv/UvWrapper.h"
+#include "util/log/AsyncFileLog.h"
+#include "util/log/Log_impl.h"
+#include "util/events/Time.h"
+#include "util/Assert.h"
+#include "util/Bits.h"
+#include "util/Identity.h"
+
+#include <stdarg.h>
+#include <stdbool.h>
+
+/** Must be a power of 2. */
+#define RING_SIZE (1 << 18)
+
+#define LINE_MAX_SIZE 1152
+
+/**
+ * The writer thread checks for lines this often, it is only woken up sooner if there are more than
+ * WAKE_BYTES waiting so that a burst of lines does not cost a wakeup per line.
+ */
+#define IDLE_NANOSECONDS 50000000ull
+#define WAKE_BYTES (RING_SIZE / 8)
+
+struct AsyncFileLog_pvt
+{
+    struct Log pub;
+    FILE* file;
+    struct EventBase* base;
+    uint8_t* ring;
+
+    /** Total bytes put into the ring, only changed by the logging thread. */
+    uint32_t head;
+
+    /** Total bytes written out of the ring, only changed by the writer thread. */
+    uint32_t tail;
+
+    /** Non-zero while the writer thread is waiting for lines. */
+    int sleeping;
+
+    /** Set when the allocator is freed, the writer thread exits when the ring is empty. */
+    int stopping;
+
+    /** Lines dropped since the last line which fit. */
+    uint32_t pendingDrops;
+
+    uint64_t dropped;
+
+    uv_thread_t thread;
+    uv_mutex_t mutex;
+    uv_cond_t cond;
+
+    Identity
+};
+
+static void wakeWriter(struct AsyncFileLog_pvt* log)
+{
+    uv_mutex_lock(&log->mutex);
+    uv_cond_signal(&log->cond);
+    uv_mutex_unlock(&log->mutex);
+}
+
+static bool put(struct AsyncFileLog_pvt* log, const char* line, uint32_t len)
+{
+    uint32_t head = log->head;
+    uint32_t tail = __atomic_load_n(&log->tail, __ATOMIC_ACQUIRE);
+    if (RING_SIZE - (head - tail) < len) { return false; }
+    uint32_t offset = head & (RING_SIZE - 1);
+    uint32_t first = (len < RING_SIZE - offset) ? len : RING_SIZE - offset;
+    Bits_memcpy(&log->ring[offset], line, first);
+    Bits_memcpy(log->ring, &line[first], len - first);
+    __atomic_store_n(&log->head, head + len, __ATOMIC_SEQ_CST);
+    if (head + len - tail >= WAKE_BYTES && __atomic_load_n(&log->sleeping, __ATOMIC_SEQ_CST)) {
+        wakeWriter(log);
+    }
+    return true;
+}
+
+static void print(struct Log* genericLog,
+                  enum Log_Level logLevel,
+                  const char* file,
+                  int line,
+                  const char* format,
+                  va_list args)
+{
+    struct AsyncFileLog_pvt* log = Identity_check((struct AsyncFileLog_pvt*) genericLog);
+    uint32_t now = Time_currentTimeMilliseconds(log->base) / 1000;
+    char buff[LINE_MAX_SIZE];
+
+    if (log->pendingDrops) {
+        int len = snprintf(buff, LINE_MAX_SIZE, "%u %s %s:%u [%u] log lines were dropped\n",
+                           now, Log_nameForLevel(Log_Level_WARN), Gcc_SHORT_FILE, Gcc_LINE,
+                           log->pendingDrops);
+        if (!put(log, buff, len)) {
+            log->pendingDrops++;
+            log->dropped++;
+            return;
+        }
+        log->pendingDrops = 0;
+    }
+
+    int len = snprintf(buff, LINE_MAX_SIZE, "%u %s %s:%u ",
+                       now, Log_nameForLevel(logLevel), file, line);
+    // Leave room for the \n
+    int msgLen = vsnprintf(&buff[len], LINE_MAX_SIZE - len - 1, format, args);
+    if (msgLen > 0) {
+        len += (msgLen < LINE_MAX_SIZE - len - 2) ? msgLen : LINE_MAX_SIZE - len - 2;
+    }
+    // Some log lines end in \n, others don't.
+    if (buff[len - 1] != '\n') {
+        buff[len++] = '\n';
+    }
+    if (!put(log, buff, len)) {
+        log->pendingDrops++;
+        log->dropped++;
+    }
+}
+
+static void writerThread(void* vAsyncFileLog)
+{
+    struct AsyncFileLog_pvt* log = Identity_check((struct AsyncFileLog_pvt*) vAsyncFileLog);
+    uint32_t tail = log->tail;
+    for (;;) {
+        int stopping = __atomic_load_n(&log->stopping, __ATOMIC_ACQUIRE);
+        uint32_t head = __atomic_load_n(&log->head, __ATOMIC_ACQUIRE);
+        if (head != tail) {
+            uint32_t offset = tail & (RING_SIZE - 1);
+            uint32_t len = head - tail;
+            uint32_t first = (len < RING_SIZE - offset) ? len : RING_SIZE - offset;
+            fwrite(&log->ring[offset], 1, first, log->file);
+            fwrite(log->ring, 1, len - first, log->file);
+            fflush(log->file);
+            tail = head;
+            __atomic_store_n(&log->tail, tail, __ATOMIC_RELEASE);
+            continue;
+        }
+        if (stopping) { return; }
+
+        uv_mutex_lock(&log->mutex);
+        __atomic_store_n(&log->sleeping, 1, __ATOMIC_SEQ_CST);
+        // Check again now that the logging thread will wake us if it puts enough.
+        if (__atomic_load_n(&log->head, __ATOMIC_SEQ_CST) - tail < WAKE_BYTES
+            && !__atomic_load_n(&log->stopping, __ATOMIC_SEQ_CST))
+        {
+            uv_cond_timedwait(&log->cond, &log->mutex, IDLE_NANOSECONDS);
+        }
+        __atomic_store_n(&log->sleeping, 0, __ATOMIC_SEQ_CST);
+        uv_mutex_unlock(&log->mutex);
+    }
+}
+
+static int onFree(struct Allocator_OnFreeJob* job)
+{
+    struct AsyncFileLog_pvt* log = Identity_check((struct AsyncFileLog_pvt*) job->userData);
+    __atomic_store_n(&log->stopping, 1, __ATOMIC_SEQ_CST);
+    wakeWriter(log);
+    uv_thread_join(&log->thread);
+    uv_cond_destroy(&log->cond);
+    uv_mutex_destroy(&log->mutex);
+    return 0;
+}
+
+struct Log* AsyncFileLog_new(FILE* writeTo, struct EventBase* base, struct Allocator* alloc)
+{
+    struct AsyncFileLog_pvt* log = Allocator_calloc(alloc, sizeof(struct AsyncFileLog_pvt), 1);
+    Identity_set(log);
+    log->pub.print = print;
+    log->file = writeTo;
+    log->base = base;
+    log->ring = Allocator_malloc(alloc, RING_SIZE);
+    Assert_true(!uv_mutex_init(&log->mutex));
+    Assert_true(!uv_cond_init(&log->cond));
+    Assert_true(!uv_thread_create(&log->thread, writerThread, log));
+    Allocator_onFree(alloc, onFree, log);
+    return &log->pub;
+}
+
+uint64_t AsyncFileLog_dropped(struct Log* asyncFileLog)
+{
+    struct AsyncFileLog_pvt* log = Identity_check((struct AsyncFileLog_pvt*) asyncFileLog);
+    return log->dropped;
+}
@@ -0,0 +1,40 @@
+/* vim: set expandtab ts=4 sw=4: */
+/*
+ * You may redistribute this program and/or modify it under the terms of
+ * the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef AsyncFileLog_H
+#define AsyncFileLog_H
+
+#include "memory/Allocator.h"
+#include "util/events/EventBase.h"
+#include "util/log/Log.h"
+#include "util/Linker.h"
+Linker_require("util/log/AsyncFileLog.c");
+
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * A log which formats each line into a ring buffer and leaves the writing to a background thread
+ * so that a slow disk or a blocked pipe does not stall the event loop. If the buffer is full, the
+ * line is dropped and counted, the count is written to the log when there is room again.
+ *
+ * Only one thread may log to it, lines are written in the same format as FileWriterLog.
+ * The writer thread writes everything which is buffered and then exits when alloc is freed.
+ */
+struct Log* AsyncFileLog_new(FILE* writeTo, struct EventBase* base, struct Allocator* alloc);
+
+/** The number of lines which have been dropped because the buffer was full. */
+uint64_t AsyncFileLog_dropped(struct Log* asyncFileLog);
+
+#endif
@@ -0,0 +1,143 @@
+/* vim: set expandtab ts=4 sw=4: */
+/*
+ * You may redistribute this program and/or modify it under the terms of
+ * the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "util/log/LevelLog.h"
+#include "util/log/Log_impl.h"
+#include "util/Bits.h"
+#include "util/CString.h"
+#include "util/Identity.h"
+
+#include <stdint.h>
+
+/** Must be a power of 2. */
+#define CACHE_SIZE 256
+
+/** The level of a file which was looked up recently, by the pointer which Log_print() got. */
+struct CacheEntry
+{
+    const char* file;
+    uint32_t generation;
+    enum Log_Level level;
+};
+
+struct FileLevel
+{
+    char* file;
+    enum Log_Level level;
+
+    /** Holds the name, freed when the file goes back to the default level. */
+    struct Allocator* alloc;
+};
+
+struct LevelLog_pvt
+{
+    struct Log pub;
+    struct Log* wrapped;
+    struct Allocator* alloc;
+    enum Log_Level defaultLevel;
+
+    int fileCount;
+    struct FileLevel files[LevelLog_MAX_FILES];
+
+    /** Incremented whenever a level changes, cache entries from older generations are invalid. */
+    uint32_t generation;
+    struct CacheEntry cache[CACHE_SIZE];
+
+    Identity
+};
+
+static enum Log_Level levelForFile(struct LevelLog_pvt* ll, const char* file)
+{
+    if (!ll->fileCount) { return ll->defaultLevel; }
+    struct CacheEntry* ce = &ll->cache[(((uintptr_t) file) >> 3) & (CACHE_SIZE - 1)];
+    if (ce->file == file && ce->generation == ll->generation) { return ce->level; }
+    ce->file = file;
+    ce->generation = ll->generation;
+    ce->level = ll->defaultLevel;
+    for (int i = 0; i < ll->fileCount; i++) {
+        if (!CString_strcmp(file, ll->files[i].file)) {
+            ce->level = ll->files[i].level;
+            break;
+        }
+    }
+    return ce->level;
+}
+
+static void doLog(struct Log* genericLog,
+                  enum Log_Level logLevel,
+                  const char* file,
+                  int line,
+                  const char* format,
+                  va_list args)
+{
+    struct LevelLog_pvt* ll = Identity_check((struct LevelLog_pvt*) genericLog);
+    if (logLevel < levelForFile(ll, file)) { return; }
+    ll->wrapped->print(ll->wrapped, logLevel, file, line, format, args);
+}
+
+struct Log* LevelLog_new(struct Log* wrapped, struct Allocator* alloc)
+{
+    struct LevelLog_pvt* ll = Allocator_calloc(alloc, sizeof(struct LevelLog_pvt), 1);
+    Identity_set(ll);
+    ll->pub.print = doLog;
+    ll->wrapped = wrapped;
+    ll->alloc = alloc;
+    ll->defaultLevel = Log_Level_KEYS;
+    // Generation 0 would match the empty cache entries.
+    ll->generation = 1;
+    return &ll->pub;
+}
+
+int LevelLog_setLevel(struct Log* levelLog, const char* file, enum Log_Level level)
+{
+    struct LevelLog_pvt* ll = Identity_check((struct LevelLog_pvt*) levelLog);
+    ll->generation++;
+    if (!file) {
+        if (level != Log_Level_INVALID) { ll->defaultLevel = level; }
+        return 0;
+    }
+    for (int i = 0; i < ll->fileCount; i++) {
+        if (CString_strcmp(file, ll->files[i].file)) { continue; }
+        if (level != Log_Level_INVALID) {
+            ll->files[i].level = level;
+        } else {
+            Allocator_free(ll->files[i].alloc);
+            if (i != --ll->fileCount) {
+                Bits_memcpy(&ll->files[i], &ll->files[ll->fileCount], sizeof(struct FileLevel));
+            }
+        }
+        return 0;
+    }
+    if (level == Log_Level_INVALID) { return 0; }
+    if (ll->fileCount >= LevelLog_MAX_FILES) { return -1; }
+    struct FileLevel* fl = &ll->files[ll->fileCount++];
+    fl->alloc = Allocator_child(ll->alloc);
+    fl->file = CString_strdup(file, fl->alloc);
+    fl->level = level;
+    return 0;
+}
+
+const char* LevelLog_getFile(struct Log* levelLog, int n, enum Log_Level* levelOut)
+{
+    struct LevelLog_pvt* ll = Identity_check((struct LevelLog_pvt*) levelLog);
+    if (n < 0 || n >= ll->fileCount) { return NULL; }
+    *levelOut = ll->files[n].level;
+    return ll->files[n].file;
+}
+
+enum Log_Level LevelLog_getDefault(struct Log* levelLog)
+{
+    struct LevelLog_pvt* ll = Identity_check((struct LevelLog_pvt*) levelLog);
+    return ll->defaultLevel;
+}
@@ -0,0 +1,54 @@
+/* vim: set expandtab ts=4 sw=4: */
+/*
+ * You may redistribute this program and/or modify it under the terms of
+ * the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef LevelLog_H
+#define LevelLog_H
+
+#include "memory/Allocator.h"
+#include "util/log/Log.h"
+#include "util/Linker.h"
+Linker_require("util/log/LevelLog.c");
+
+/** The number of files which may have their own level. */
+#define LevelLog_MAX_FILES 64
+
+/**
+ * A log which passes lines to another log only if they are at or above the level which is set for
+ * the file they come from, or else the default level. The levels can be changed at runtime but
+ * nothing below Log_MIN_LEVEL is ever logged because it is not compiled in.
+ * The default level is Log_Level_KEYS so everything is passed until a level is set.
+ */
+struct Log* LevelLog_new(struct Log* wrapped, struct Allocator* alloc);
+
+/**
+ * Set the level of a file.
+ *
+ * @param levelLog the LevelLog.
+ * @param file the short name of the file, eg: "SessionManager.c", or NULL for the default level.
+ * @param level the lowest level to log, if this is Log_Level_INVALID then the file goes back to
+ *              using the default level.
+ * @return 0 or -1 if LevelLog_MAX_FILES already have their own level.
+ */
+int LevelLog_setLevel(struct Log* levelLog, const char* file, enum Log_Level level);
+
+/**
+ * Get the level of the nth file which has its own level.
+ *
+ * @return the name of the file or NULL if there are not that many files with their own level.
+ */
+const char* LevelLog_getFile(struct Log* levelLog, int n, enum Log_Level* levelOut);
+
+enum Log_Level LevelLog_getDefault(struct Log* levelLog);
+
+#endif
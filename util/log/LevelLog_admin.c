@@ -0,0 +1,82 @@
+/* vim: set expandtab ts=4 sw=4: */
+/*
+ * You may redistribute this program and/or modify it under the terms of
+ * the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "admin/Admin.h"
+#include "benc/Dict.h"
+#include "benc/String.h"
+#include "util/log/LevelLog.h"
+#include "util/log/LevelLog_admin.h"
+#include "util/Identity.h"
+
+struct Context
+{
+    struct Log* levelLog;
+    struct Admin* admin;
+    Identity
+};
+
+static void setLevel(Dict* args, void* vcontext, String* txid, struct Allocator* requestAlloc)
+{
+    struct Context* ctx = Identity_check((struct Context*) vcontext);
+    String* levelName = Dict_getStringC(args, "level");
+    String* file = Dict_getStringC(args, "file");
+    if (file && !file->len) { file = NULL; }
+
+    // "default" puts a file back to the default level.
+    bool isDefault = file && String_equals(levelName, String_CONST("default"));
+    enum Log_Level level = (isDefault) ? Log_Level_INVALID : Log_levelForName(levelName->bytes);
+    char* error = "none";
+    if (!isDefault && level == Log_Level_INVALID) {
+        error = "invalid_level";
+    } else if (LevelLog_setLevel(ctx->levelLog, (file) ? file->bytes : NULL, level)) {
+        error = "too_many_files";
+    }
+    Dict* out = Dict_new(requestAlloc);
+    Dict_putStringCC(out, "error", error, requestAlloc);
+    Admin_sendMessage(out, txid, ctx->admin);
+}
+
+static void listLevels(Dict* args, void* vcontext, String* txid, struct Allocator* requestAlloc)
+{
+    struct Context* ctx = Identity_check((struct Context*) vcontext);
+    Dict* files = Dict_new(requestAlloc);
+    enum Log_Level level;
+    const char* file;
+    for (int i = 0; (file = LevelLog_getFile(ctx->levelLog, i, &level)); i++) {
+        Dict_putStringCC(files, file, Log_nameForLevel(level), requestAlloc);
+    }
+    Dict* out = Dict_new(requestAlloc);
+    Dict_putStringCC(out, "default",
+                     Log_nameForLevel(LevelLog_getDefault(ctx->levelLog)), requestAlloc);
+    Dict_putStringCC(out, "minLevel", Log_nameForLevel(Log_MIN_LEVEL), requestAlloc);
+    Dict_putDictC(out, "files", files, requestAlloc);
+    Dict_putStringCC(out, "error", "none", requestAlloc);
+    Admin_sendMessage(out, txid, ctx->admin);
+}
+
+void LevelLog_admin_register(struct Log* levelLog, struct Admin* admin, struct Allocator* alloc)
+{
+    struct Context* ctx = Allocator_clone(alloc, (&(struct Context) {
+        .levelLog = levelLog,
+        .admin = admin
+    }));
+    Identity_set(ctx);
+
+    Admin_registerFunction("LevelLog_set", setLevel, ctx, true,
+        ((struct Admin_FunctionArg[]) {
+            { .name = "level", .required = 1, .type = "String" },
+            { .name = "file", .required = 0, .type = "String" }
+        }), admin);
+    Admin_registerFunction("LevelLog_list", listLevels, ctx, false, NULL, admin);
+}
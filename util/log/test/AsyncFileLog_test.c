@@ -0,0 +1,59 @@
+/* vim: set expandtab ts=4 sw=4: */
+/*
+ * You may redistribute this program and/or modify it under the terms of
+ * the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "memory/MallocAllocator.h"
+#include "util/Assert.h"
+#include "util/CString.h"
+#include "util/events/EventBase.h"
+#include "util/log/AsyncFileLog.h"
+
+#include <stdio.h>
+
+#define LINES 2000
+
+int main(int argc, char** argv)
+{
+    struct Allocator* alloc = MallocAllocator_new(1<<20);
+    struct EventBase* base = EventBase_new(alloc);
+    FILE* file = tmpfile();
+    Assert_true(file);
+
+    struct Allocator* logAlloc = Allocator_child(alloc);
+    struct Log* log = AsyncFileLog_new(file, base, logAlloc);
+    char big[512];
+    for (int i = 0; i < (int)sizeof(big) - 1; i++) { big[i] = 'x'; }
+    big[sizeof(big) - 1] = '\0';
+    for (int i = 0; i < LINES; i++) {
+        Log_info(log, "line [%d] %s", i, big);
+    }
+    int dropped = AsyncFileLog_dropped(log);
+    // Waits for the writer thread to write everything.
+    Allocator_free(logAlloc);
+
+    rewind(file);
+    char buff[1024];
+    int lines = 0;
+    while (fgets(buff, sizeof(buff), file)) {
+        if (CString_strstr(buff, "] log lines were dropped\n")) { continue; }
+        Assert_true(CString_strstr(buff, " INFO AsyncFileLog_test.c:"));
+        Assert_true(CString_strstr(buff, big));
+        lines++;
+    }
+    Assert_true(lines > 0);
+    Assert_true(lines + dropped == LINES);
+
+    fclose(file);
+    Allocator_free(alloc);
+    return 0;
+}
@@ -0,0 +1,85 @@
+/* vim: set expandtab ts=4 sw=4: */
+/*
+ * You may redistribute this program and/or modify it under the terms of
+ * the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "memory/MallocAllocator.h"
+#include "util/Assert.h"
+#include "util/log/LevelLog.h"
+#include "util/log/Log_impl.h"
+
+#include <stddef.h>
+
+struct CountLog
+{
+    struct Log pub;
+    int count;
+};
+
+static void count(struct Log* genericLog,
+                  enum Log_Level logLevel,
+                  const char* file,
+                  int line,
+                  const char* format,
+                  va_list args)
+{
+    ((struct CountLog*) genericLog)->count++;
+}
+
+static int logged(struct Log* log, struct CountLog* counter)
+{
+    int before = counter->count;
+    Log_debug(log, "debug");
+    Log_info(log, "info");
+    Log_warn(log, "warn");
+    return counter->count - before;
+}
+
+int main(int argc, char** argv)
+{
+    struct Allocator* alloc = MallocAllocator_new(1<<20);
+    struct CountLog counter = { .pub = { .print = count } };
+    struct Log* log = LevelLog_new(&counter.pub, alloc);
+
+    Assert_true(logged(log, &counter) == 3);
+
+    Assert_true(!LevelLog_setLevel(log, NULL, Log_Level_WARN));
+    Assert_true(logged(log, &counter) == 1);
+
+    Assert_true(!LevelLog_setLevel(log, "Other.c", Log_Level_DEBUG));
+    Assert_true(logged(log, &counter) == 1);
+
+    Assert_true(!LevelLog_setLevel(log, "LevelLog_test.c", Log_Level_DEBUG));
+    Assert_true(logged(log, &counter) == 3);
+
+    Assert_true(!LevelLog_setLevel(log, "LevelLog_test.c", Log_Level_INFO));
+    Assert_true(logged(log, &counter) == 2);
+
+    enum Log_Level level;
+    Assert_true(LevelLog_getFile(log, 1, &level) && level == Log_Level_INFO);
+    Assert_true(!LevelLog_getFile(log, 2, &level));
+
+    Assert_true(!LevelLog_setLevel(log, "LevelLog_test.c", Log_Level_INVALID));
+    Assert_true(logged(log, &counter) == 1);
+    Assert_true(!LevelLog_getFile(log, 1, &level));
+
+    // Setting and clearing a level must not leave anything behind.
+    unsigned long bytes = Allocator_bytesAllocated(alloc);
+    for (int i = 0; i < 1000; i++) {
+        Assert_true(!LevelLog_setLevel(log, "LevelLog_test.c", Log_Level_DEBUG));
+        Assert_true(!LevelLog_setLevel(log, "LevelLog_test.c", Log_Level_INVALID));
+    }
+    Assert_true(Allocator_bytesAllocated(alloc) == bytes);
+
+    Allocator_free(alloc);
+    return 0;
+}
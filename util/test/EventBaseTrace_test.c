@@ -0,0 +1,76 @@
+/* vim: set expandtab ts=4 sw=4: */
+/*
+ * You may redistribute this program and/or modify it under the terms of
+ * the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "memory/MallocAllocator.h"
+#include "util/Assert.h"
+#include "util/CString.h"
+#include "util/events/EventBase.h"
+#include "util/events/Timeout.h"
+
+struct Context
+{
+    int ticks;
+    struct Allocator* timeoutAlloc;
+};
+
+static void tick(void* vctx)
+{
+    struct Context* ctx = vctx;
+    if (++ctx->ticks == 3) { Allocator_free(ctx->timeoutAlloc); }
+}
+
+static int countEvents(struct EventBase* base)
+{
+    struct EventBase_TraceEvent ev;
+    int n = 0;
+    while (!EventBase_traceGet(base, n, &ev)) { n++; }
+    return n;
+}
+
+int main()
+{
+    struct Allocator* alloc = MallocAllocator_new(1<<20);
+    struct EventBase* base = EventBase_new(alloc);
+    struct Context ctx = { .timeoutAlloc = Allocator_child(alloc) };
+
+    Assert_true(!base->tracing && !EventBase_traceBegin(base) && !countEvents(base));
+
+    // Only the last 2 callbacks are kept.
+    EventBase_traceStart(base, 2, 0);
+    Timeout_setInterval(tick, &ctx, 1, base, ctx.timeoutAlloc);
+    EventBase_beginLoop(base);
+    EventBase_traceStop(base);
+    Assert_true(ctx.ticks == 3 && countEvents(base) == 2);
+
+    struct EventBase_TraceEvent first;
+    struct EventBase_TraceEvent second;
+    Assert_true(!EventBase_traceGet(base, 0, &first) && !EventBase_traceGet(base, 1, &second));
+    Assert_true(!CString_strcmp(first.category, "timeout"));
+    Assert_true(CString_strstr(first.name, "EventBaseTrace_test.c") && first.line);
+    Assert_true(first.startNs < second.startNs);
+
+    // Nothing is recorded after stopping and anything faster than the minimum is skipped.
+    uint64_t begin = EventBase__traceNow();
+    EventBase__traceRecord(base, "test", "stopped", 0, begin);
+    Assert_true(countEvents(base) == 2);
+    EventBase_traceStart(base, 16, 1000000000);
+    Assert_true(!countEvents(base));
+    begin = EventBase_traceBegin(base);
+    Assert_true(begin);
+    EventBase_traceEnd(base, "test", "fast", 0, begin);
+    Assert_true(!countEvents(base));
+
+    Allocator_free(alloc);
+    return 0;
+}
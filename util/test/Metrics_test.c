@@ -0,0 +1,80 @@
+/* vim: set expandtab ts=4 sw=4: */
+/*
+ * You may redistribute this program and/or modify it under the terms of
+ * the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "memory/MallocAllocator.h"
+#include "util/Assert.h"
+#include "util/CString.h"
+#include "util/Metrics.h"
+
+static int64_t fortyTwo(void* context)
+{
+    return 42;
+}
+
+static void buckets()
+{
+    for (int i = 0; i < Metrics_Histogram_BUCKETS; i++) {
+        uint64_t floor = Metrics_Histogram_bucketFloor(i);
+        Assert_true(Metrics_Histogram_bucket(floor) == i);
+        Assert_true(i == 0 || Metrics_Histogram_bucket(floor - 1) == i - 1);
+    }
+    Assert_true(Metrics_Histogram_bucket(UINT64_MAX) == Metrics_Histogram_BUCKETS - 1);
+
+    // Every value is within 12.5% of the top of its bucket.
+    for (uint64_t v = 1; v < 100000; v += 7) {
+        int b = Metrics_Histogram_bucket(v);
+        uint64_t top = Metrics_Histogram_bucketFloor(b + 1) - 1;
+        Assert_true(top >= v && top - v <= v / 8);
+    }
+}
+
+int main()
+{
+    buckets();
+
+    struct Allocator* alloc = MallocAllocator_new(1<<20);
+    struct Metrics* m = Metrics_new(alloc);
+
+    struct Metrics_Counter* c = Metrics_counter(m, "test_total", "A counter");
+    Assert_true(c && c == Metrics_counter(m, "test_total", "Same counter"));
+    Assert_true(!Metrics_counter(NULL, "test_total", "No registry"));
+    Metrics_Counter_add(c, 3);
+    Metrics_Counter_add(NULL, 3);
+    Metrics_gaugeFn(m, "test_gauge", "A gauge", fortyTwo, NULL);
+
+    struct Metrics_Histogram* h = Metrics_histogram(m, "test_ns", "A histogram");
+    Assert_true(Metrics_Histogram_percentile(h, 500000) == 0);
+    for (uint64_t i = 1; i <= 1000; i++) { Metrics_Histogram_record(h, i); }
+    Assert_true(h->count == 1000 && h->sum == 500500 && h->max == 1000);
+    uint64_t p50 = Metrics_Histogram_percentile(h, 500000);
+    Assert_true(p50 >= 500 && p50 <= 500 + 500 / 8);
+    uint64_t p99 = Metrics_Histogram_percentile(h, 990000);
+    Assert_true(p99 >= 990 && p99 <= 1000);
+    Assert_true(Metrics_Histogram_percentile(h, 1000000) == 1000);
+
+    struct Metrics_Entry e;
+    Assert_true(!Metrics_get(m, 0, &e) && e.type == Metrics_Type_COUNTER && e.value == 3);
+    Assert_true(!Metrics_get(m, 1, &e) && e.type == Metrics_Type_GAUGE && e.value == 42);
+    Assert_true(!Metrics_get(m, 2, &e) && e.type == Metrics_Type_HISTOGRAM && e.histogram == h);
+    Assert_true(Metrics_get(m, 3, &e));
+
+    String* text = Metrics_prometheus(m, alloc);
+    Assert_true(CString_strstr(text->bytes, "# TYPE test_total counter\ntest_total 3\n"));
+    Assert_true(CString_strstr(text->bytes, "test_gauge 42\n"));
+    Assert_true(CString_strstr(text->bytes, "test_ns_count 1000\n"));
+    Assert_true(CString_strstr(text->bytes, "test_ns{quantile=\"0.5\"} "));
+
+    Allocator_free(alloc);
+    return 0;
+}
@@ -0,0 +1,125 @@
+/* vim: set expandtab ts=4 sw=4: */
+/*
+ * You may redistribute this program and/or modify it under the terms of
+ * the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "memory/MallocAllocator.h"
+#include "util/events/EventBase.h"
+#include "util/events/Pipe.h"
+#include "util/events/Timeout.h"
+#include "util/log/FileWriterLog.h"
+#include "util/Assert.h"
+#include "util/Identity.h"
+#include "wire/Message.h"
+
+#include <fcntl.h>
+#include <sys/socket.h>
+
+#define MESSAGE_SIZE 100
+#define MESSAGES 5000
+
+struct Context
+{
+    struct Iface toWriter;
+    struct Iface fromReader;
+    struct Allocator* alloc;
+    struct EventBase* base;
+    int sent;
+    int received;
+    int pressureOn;
+    int pressureOff;
+    bool paused;
+    Identity
+};
+
+static void fill(struct Context* ctx)
+{
+    struct Allocator* alloc = Allocator_child(ctx->alloc);
+    while (!ctx->paused && ctx->sent < MESSAGES) {
+        struct Message* msg = Message_new(MESSAGE_SIZE, 0, alloc);
+        Bits_memset(msg->bytes, ctx->sent & 0xff, MESSAGE_SIZE);
+        Iface_send(&ctx->toWriter, msg);
+        ctx->sent++;
+    }
+    Allocator_free(alloc);
+}
+
+static void onBackPressure(struct Pipe* p, int status)
+{
+    struct Context* ctx = Identity_check((struct Context*) p->userData);
+    Assert_true(ctx->paused != status);
+    ctx->paused = status;
+    if (status) {
+        ctx->pressureOn++;
+    } else {
+        ctx->pressureOff++;
+        fill(ctx);
+    }
+}
+
+static Iface_DEFUN receive(struct Message* msg, struct Iface* iface)
+{
+    struct Context* ctx = Identity_containerOf(iface, struct Context, fromReader);
+    for (int i = 0; i < msg->length; i++) {
+        Assert_true(msg->bytes[i] == ((ctx->received / MESSAGE_SIZE) & 0xff));
+        ctx->received++;
+    }
+    if (ctx->received == MESSAGES * MESSAGE_SIZE) {
+        EventBase_endLoop(ctx->base);
+    }
+    return NULL;
+}
+
+static void timeout(void* vctx)
+{
+    Assert_failure("Timed out with [%d] bytes received",
+        Identity_check((struct Context*) vctx)->received);
+}
+
+int main()
+{
+    struct Allocator* alloc = MallocAllocator_new(1<<22);
+    struct EventBase* base = EventBase_new(alloc);
+    struct Log* log = FileWriterLog_new(stdout, alloc);
+
+    int fds[2];
+    Assert_true(!socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    for (int i = 0; i < 2; i++) {
+        Assert_true(!fcntl(fds[i], F_SETFL, fcntl(fds[i], F_GETFL) | O_NONBLOCK));
+    }
+    struct Allocator* pipeAlloc = Allocator_child(alloc);
+    struct Pipe* writer = Er_assert(Pipe_forFd(fds[0], false, base, log, pipeAlloc));
+    struct Pipe* reader = Er_assert(Pipe_forFd(fds[1], false, base, log, pipeAlloc));
+
+    struct Context* ctx = Allocator_calloc(alloc, sizeof(struct Context), 1);
+    Identity_set(ctx);
+    ctx->alloc = alloc;
+    ctx->base = base;
+    ctx->fromReader.send = receive;
+    Iface_plumb(&ctx->toWriter, &writer->iface);
+    Iface_plumb(&ctx->fromReader, &reader->iface);
+    writer->userData = ctx;
+    writer->onBackPressure = onBackPressure;
+
+    // The messages add up to several times highWater so the writer has to wait for the reader.
+    fill(ctx);
+    Assert_true(ctx->paused && ctx->sent < MESSAGES);
+
+    Timeout_setTimeout(timeout, ctx, 5000, base, alloc);
+    EventBase_beginLoop(base);
+
+    Assert_true(ctx->sent == MESSAGES);
+    Assert_true(ctx->pressureOn >= 2 && ctx->pressureOff >= ctx->pressureOn - 1);
+
+    Allocator_free(alloc);
+    return 0;
+}
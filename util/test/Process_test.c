@@ -168,7 +168,7 @@ int main(int argc, char** argv)
         unlink(textName->bytes);
     }
 
-    struct PipeServer* pipe = PipeServer_named(name->bytes, eb, NULL, log, alloc);
+    struct PipeServer* pipe = Er_assert(PipeServer_named(name->bytes, eb, log, alloc));
     pipe->userData = ctx;
     pipe->onConnection = onConnectionParent;
     Iface_plumb(&ctx->iface, &pipe->iface.iface);
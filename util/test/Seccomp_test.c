@@ -13,6 +13,7 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 #include "benc/String.h"
+#include "util/log/AsyncFileLog.h"
 #include "util/log/FileWriterLog.h"
 #include "memory/Allocator.h"
 #include "memory/MallocAllocator.h"
@@ -46,6 +47,10 @@ struct ChildCtx
     struct Log* log;
     struct Pipe* pipe;
     struct Allocator* alloc;
+
+    /** Its writer thread is started before the filter is installed so it must be filtered too. */
+    struct Log* asyncLog;
+    struct Allocator* asyncAlloc;
     Identity
 };
 
@@ -56,6 +61,10 @@ static void onConnectionChild(struct Pipe* pipe, int status)
     Er_assert(Seccomp_dropPermissions(child->alloc, child->log));
     Assert_true(Seccomp_isWorking());
 
+    // Wake the writer thread and then stop it, all under the filter.
+    Log_debug(child->asyncLog, "Filter installed");
+    Allocator_free(child->asyncAlloc);
+
     struct Message* ok = Message_new(0, 512, child->alloc);
     Er_assert(Message_epush(ok, "OK", 3));
 
@@ -84,6 +93,8 @@ static int child(char* pipeName, struct Allocator* alloc, struct Log* logger)
     ctx->base = EventBase_new(alloc);
     ctx->alloc = alloc;
     ctx->log = logger;
+    ctx->asyncAlloc = Allocator_child(alloc);
+    ctx->asyncLog = AsyncFileLog_new(stdout, ctx->base, ctx->asyncAlloc);
     ctx->pipe = Er_assert(Pipe_named(pipeName, ctx->base, logger, alloc));
     ctx->pipe->onConnection = onConnectionChild;
     ctx->pipe->userData = ctx;
@@ -107,7 +118,7 @@ static Iface_DEFUN receiveMessageParent(struct Message* msg, struct Iface* iface
 
 int main(int argc, char** argv)
 {
-    struct Allocator* alloc = MallocAllocator_new(20000);
+    struct Allocator* alloc = MallocAllocator_new(1<<20);
     struct Log* logger = FileWriterLog_new(stdout, alloc);
 
     if (!Seccomp_exists()) {
@@ -132,7 +143,7 @@ int main(int argc, char** argv)
     ctx->iface.send = receiveMessageParent;
     ctx->eventBase = eb;
 
-    struct PipeServer* pipe = PipeServer_named(name->bytes, eb, NULL, logger, alloc);
+    struct PipeServer* pipe = Er_assert(PipeServer_named(name->bytes, eb, logger, alloc));
     Iface_plumb(&ctx->iface, &pipe->iface.iface);
 
     char* path = Process_getPath(alloc);
@@ -64,6 +64,9 @@ static void simpleTest(struct Allocator* alloc, struct Random* rand)
         }
     }
 
+    // Everything which was added can be found.
+    for (uint32_t i = 0; i < size; i++) { Assert_true(*Set_OfInts_get(set, &buff[i]) == buff[i]); }
+
     uint32_t* val;
     Set_FOREACH(OfInts, set, val) {
         int size = set->size;
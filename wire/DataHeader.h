@@ -23,11 +23,13 @@
  *                     1               2               3
  *     0 1 2 3 4 5 6 7 0 1 2 3 4 5 6 7 0 1 2 3 4 5 6 7 0 1 2 3 4 5 6 7
  *    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
- *  0 |  ver  | unusd |     unused    |         Content Type          |
+ *  0 |  ver  |unu|ECN|     unused    |         Content Type          |
  *    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
  *
  * The DataHeader is protected from the switches by the l2 encryption layer.
  * It's primary use is to tell the endpoint the protocol of the content.
+ * ECN carries the ECN bits of the IPv6 packet from one TUN device to the other, older versions
+ * set it to zero which is Not-ECT.
  */
 struct DataHeader
 {
@@ -65,4 +67,16 @@ static inline uint8_t DataHeader_getVersion(struct DataHeader* hdr)
     return hdr->versionAndFlags >> 4;
 }
 
+/** One of the Headers_ECN_* codepoints. */
+static inline uint8_t DataHeader_getEcn(struct DataHeader* hdr)
+{
+    return hdr->versionAndFlags & 3;
+}
+
+static inline void DataHeader_setEcn(struct DataHeader* hdr, uint8_t ecn)
+{
+    Assert_true(ecn < 4);
+    hdr->versionAndFlags = (hdr->versionAndFlags & 0xfc) | ecn;
+}
+
 #endif
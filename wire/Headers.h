@@ -38,6 +38,21 @@ struct Headers_IP6Header
 #define Headers_IP6Header_SIZE 40
 Assert_compileTime(sizeof(struct Headers_IP6Header) == Headers_IP6Header_SIZE);
 
+/** ECN codepoints, the low 2 bits of the traffic class, see RFC 3168. */
+#define Headers_ECN_NOT_ECT 0
+#define Headers_ECN_CE      3
+
+static inline uint8_t Headers_IP6Header_getEcn(struct Headers_IP6Header* header)
+{
+    return (((uint8_t*) header)[1] >> 4) & 3;
+}
+
+static inline void Headers_IP6Header_setEcn(struct Headers_IP6Header* header, uint8_t ecn)
+{
+    Assert_true(ecn < 4);
+    ((uint8_t*) header)[1] = (((uint8_t*) header)[1] & 0xcf) | (ecn << 4);
+}
+
 struct Headers_IP6Fragment
 {
     uint8_t nextHeader;
@@ -109,6 +109,12 @@ static inline void SwitchHeader_setLabelShift(struct SwitchHeader* header, uint3
     header->versionAndLabelShift |= shift;
 }
 
+/**
+ * Congestion values above this mean that a switch along the way had a queue building up,
+ * SwitchHeader_setCongestion(header, 0) sets it to 1 which is "no congestion".
+ */
+#define SwitchHeader_CONGESTION_NONE 1
+
 static inline uint32_t SwitchHeader_getCongestion(const struct SwitchHeader* header)
 {
     return header->congestAndSuppressErrors >> 1;